@@ -63,7 +63,7 @@ class HAL:
     ----------
     driver: Instance of pystorm.PyDriver Driver
     """
-    def __init__(self, use_soft_driver=False):
+    def __init__(self, use_soft_driver=False, attach_file=None):
         if use_soft_driver:
             self.driver = bd.BDModelDriver()
         else:
@@ -87,17 +87,32 @@ class HAL:
         self.upstream_ns   = 1000000
 
         self.last_mapped_network = None
+        self._table_outputs = np.empty(0, dtype=object) # see _register_translation_tables()
+        self._table_pools = np.empty(0, dtype=object)
         self.last_mapped_core = None
 
-        self.init_hardware()
+        self.init_hardware(attach_file)
 
-    def init_hardware(self):
-        logger.info("HAL: clearing hardware state")
+    def init_hardware(self, attach_file=None):
+        """Reset and initialize the chip.
+        If <attach_file> (written by save_attach_state()) is given and the chip
+        still holds that state, it's left alone instead (no reset)
+        """
+        if attach_file is not None:
+            if self.driver.AttachBD(attach_file):
+                logger.info("HAL: chip matches " + attach_file + ", skipping init")
+                self.driver.SetTimeUnitLen(self.downstream_ns)
+                self.driver.SetTimePerUpHB(self.upstream_ns)
+                return
+            # AttachBD() already fell back to InitBD(), don't reset twice
+            logger.info("HAL: chip doesn't match " + attach_file + ", it was reinitialized")
+        else:
+            logger.info("HAL: clearing hardware state")
 
-        # stop spikes before resetting
-        #self.stop_all_inputs()
+            # stop spikes before resetting
+            #self.stop_all_inputs()
 
-        self.driver.InitBD()
+            self.driver.InitBD()
 
         # DAC settings (should be pretty close to driver defaults)
 
@@ -162,6 +177,12 @@ class HAL:
     def __del__(self):
         self.stop_hardware()
 
+    def save_attach_state(self, filename):
+        """Save the chip's state, so that a later HAL(attach_file=filename)
+        can skip initialization if the chip hasn't been power cycled
+        """
+        return self.driver.SaveAttachState(filename)
+
     def get_time(self):
         """Returns the time in nanoseconds"""
         return self.driver.GetFPGATime()
@@ -195,6 +216,109 @@ class HAL:
         """
         self.driver.Flush()
 
+    def flush_streamed(self):
+        """Like flush(), but timed inputs are streamed to the hardware
+
+        Instead of committing every queued timed input at once (which blocks
+        later inputs until the last time has passed), the driver releases them
+        at most stream_window_ns ahead of the FPGA time. Untimed traffic is
+        committed immediately.
+        """
+        self.driver.FlushStreamed()
+
+    def set_stream_window(self, window_ns):
+        """Set how far ahead of FPGA time (in ns) flush_streamed() inputs may be released"""
+        self.driver.SetStreamWindow(int(window_ns))
+
+    def set_timed_input_lead(self, lead_ns):
+        """Hold flush()ed timed inputs in the driver until they're due within lead_ns (0 to not hold them)
+
+        The FPGA holds up its whole downstream queue until the first input in it is due, so
+        while a long timed schedule is queued, untimed commands (e.g. stopping traffic, DAC
+        changes) can wait as long as the schedule. Untimed commands skip ahead of held inputs,
+        so they're never stuck for more than about lead_ns.
+        """
+        self.driver.SetBulkLead(int(lead_ns))
+
+    def get_stream_stats(self):
+        """Returns how far the input stream ran ahead of or behind FPGA time
+
+        Returns a dict of times (ns) and counts:
+            lead : last released input time - FPGA time (negative means behind)
+            max_lead, max_lag : extremes since the last reset_stream_stats()
+            num_released, num_pending : inputs sent to/still held for the hardware
+        """
+        stats = self.driver.GetStreamStats()
+        return {
+            "fpga_time" : stats.fpga_time,
+            "released_until" : stats.released_until,
+            "lead" : stats.lead,
+            "max_lead" : stats.max_lead,
+            "max_lag" : stats.max_lag,
+            "num_released" : stats.num_released,
+            "num_pending" : stats.num_pending}
+
+    def reset_stream_stats(self):
+        self.driver.ResetStreamStats()
+
+    def start_broadcast(self, name="pystorm_upstream", capacity=1 << 20):
+        """Publish all upstream traffic to a shared memory ring
+
+        Other local processes can watch it with pystorm.hal.shm_ring.ShmRingReader(name)
+        without taking anything away from get_spikes()/get_outputs().
+        Returns False if the ring couldn't be created
+        """
+        return self.driver.StartBroadcast(name, capacity)
+
+    def stop_broadcast(self):
+        self.driver.StopBroadcast()
+
+    def start_rate_map(self, tau=.1, refresh=None, shm_name=""):
+        """Keep a live, exponentially weighted firing rate estimate for every neuron
+
+        Nothing is popped, get_spikes() still sees every spike. With a shm_name, other
+        local processes can poll it with pystorm.hal.rate_map.RateMapReader(shm_name).
+
+        Parameters
+        ----------
+        tau: time constant of the estimate, in seconds
+        refresh: how often the estimate is updated, in seconds, defaults to the upstream HB period
+        shm_name: shared memory segment to publish the map in, "" keeps it private
+
+        Returns False if the segment couldn't be created
+        """
+        refresh_ns = self.upstream_ns if refresh is None else int(refresh * 1e9)
+        return self.driver.StartRateMap(CORE_ID, int(tau * 1e9), refresh_ns, shm_name)
+
+    def stop_rate_map(self):
+        self.driver.StopRateMap(CORE_ID)
+
+    def get_rate_map(self):
+        """Returns (time in ns, np.array of rates in Hz indexed [y, x]), rates is None before the first refresh"""
+        time, rates = self.driver.GetRateMap(CORE_ID)
+        if len(rates) == 0:
+            return time, None
+        return time, rates.reshape(64, 64)
+
+    def start_capture(self, path):
+        """Record all traffic to and from the board, with host timestamps, to a trace file
+
+        Play it back offline with bddriver.ReplayDriver(path).
+        Returns False if the file couldn't be opened
+        """
+        return self.driver.StartCapture(path)
+
+    def stop_capture(self):
+        """Stop recording, returns the number of frames recorded"""
+        return self.driver.StopCapture()
+
+    def snapshot_state(self):
+        """Cheap copy of the driver's software model of the chip state.
+        Shares memory with the driver's state until either changes.
+        Compare snapshots with snapshot.Diff(other), write them with snapshot.Save(filename)
+        """
+        return self.driver.GetState(CORE_ID).Snapshot()
+
     def start_traffic(self, flush=True):
         """Start hardware's internal traffic flow"""
         self.driver.SetTagTrafficState(CORE_ID, True, flush=False)
@@ -250,12 +374,25 @@ class HAL:
         Whether or not you get return values is enabled/disabled by
         enable/disable_output_recording()
         """
-        filt_idxs, filt_states, times = self.driver.RecvSpikeFilterStates(CORE_ID, timeout)
-
-        outputs, dims, counts = self.last_mapped_network.translate_tags(filt_idxs, filt_states)
+        times, output_ids, dims, counts = self.driver.RecvTranslatedOutputs(CORE_ID, False, timeout)
+        outputs = self._table_outputs[output_ids]
 
         return np.array([times, outputs, dims, counts]).T
 
+    def get_outputs_by_output(self, timeout=1000):
+        """Like get_outputs(), but grouped by output
+
+        Data format: {output: numpy array of [(time, dim, count), ...]}
+        """
+        times, output_ids, dims, counts = self.driver.RecvTranslatedOutputs(CORE_ID, True, timeout)
+        starts = np.flatnonzero(np.diff(output_ids)) + 1
+        by_output = {}
+        for idxs in np.split(np.arange(len(output_ids)), starts):
+            if len(idxs) > 0:
+                by_output[self._table_outputs[output_ids[idxs[0]]]] = \
+                    np.array([times[idxs], dims[idxs], counts[idxs]]).T
+        return by_output
+
     def get_binned_spikes(self, bin_time_ns):
         """Returns all the pending spikes gathered since this was last called.
         Returns one numpy array per pool. Highest performance if binning is ultimately desired.
@@ -282,6 +419,64 @@ class HAL:
 
         return trans_spikes, bin_times
 
+    def get_binned_tag_outputs(self, bin_time_boundaries, time_scale=1e-9, timeout=1000):
+        """Bins the pending output tags (skipping the spike filters) into rates, natively
+
+        Like bin_tags_spikes(parse_hal_binned_tags(...)) for outputs, without the per-tag Python loop.
+        Tags' signed counts are summed.
+
+        Parameters
+        ----------
+        bin_time_boundaries: list-like of ns, boundaries of the time bins
+        time_scale: scaling factor to convert bin times into seconds
+
+        Returns {output: np.array of rates indexed [dim, bin]}
+        """
+        edges = [int(t) for t in bin_time_boundaries]
+        binner = self.driver.RecvBinnedTags(CORE_ID, edges, timeout)
+        counts = binner.GetCounts()
+        bin_sizes = np.diff(edges) * time_scale
+
+        rates = {}
+        for output in self.last_mapped_network.get_outputs():
+            # output tags are the output's filter indices
+            rates[output] = counts[:, output.filter_idxs].T / bin_sizes
+        return rates
+
+    def start_host_output_filters(self, tau, sample_ns=None, spikes=False):
+        """Filters output tags (and optionally spikes) on the host instead of the FPGA's spike filters
+
+        Same exponential filters and constants as the FPGA's, decaying every upstream HB,
+        but for every tag at once (the FPGA has 512 filters).
+
+        Parameters
+        ----------
+        tau: filter time constant, in seconds
+        sample_ns: how often the filters are sampled, defaults to the upstream HB period
+        spikes: also filter every neuron's spikes
+        """
+        update_s = self.upstream_ns * 1e-9
+        decay = int(np.exp(-update_s / tau) * 2**27) # 0.27 fixed point
+        increment = int(round(2**9 / tau)) # states are 18.9 fixed point Hz
+        if sample_ns is None:
+            sample_ns = self.upstream_ns
+        return self.driver.StartHostSpikeFilters(CORE_ID, decay, increment, int(sample_ns), spikes)
+
+    def stop_host_output_filters(self):
+        self.driver.StopHostSpikeFilters(CORE_ID)
+
+    def get_host_filtered_outputs(self):
+        """Returns the host output filters' samples taken since this was last called
+
+        Returns ({output: np.array of rates in Hz indexed [sample, dim]}, np.array of sample times in ns)
+        """
+        times, states = self.driver.RecvHostSpikeFilterStates(CORE_ID)
+        rates = {}
+        for output in self.last_mapped_network.get_outputs():
+            # output tags are the output's filter indices
+            rates[output] = states[:, output.filter_idxs] / 2**9
+        return rates, times
+
     def get_array_outputs(self):
         """Returns all binned output tags gathered since this was last called, 
         Each Output is associated with an array of values, indexed by time bin index and dimension
@@ -301,18 +496,141 @@ class HAL:
         tag_arr, bin_times = self.driver.RecvSpikeFilterStatesArray(CORE_ID, N_SF)
         return self.last_mapped_network.translate_tag_array(tag_arr), bin_times
 
+    def retain_spikes(self, horizon_ns):
+        """Keep the last horizon_ns of spikes in the driver, for get_retained_spikes()
+        and get_retained_binned_spikes(). 0 stops keeping them.
+        get_spikes() still gets every spike
+        """
+        NRNI = self.driver.GetBDPars().UpEPCodeFor(bd.bdpars.BDFunnelEP.NRNI)
+        self.driver.SetRetention(CORE_ID, NRNI, horizon_ns)
+
+    def get_retained_spikes(self, t0_ns, t1_ns, release=False):
+        """Returns the retained spikes in [t0_ns, t1_ns), like get_spikes() does.
+        The same window can be read again, unless release, which drops everything before t1_ns
+        """
+        NRNI = self.driver.GetBDPars().UpEPCodeFor(bd.bdpars.BDFunnelEP.NRNI)
+        words, times = self.driver.GetRetained(CORE_ID, NRNI, t0_ns, t1_ns)
+        if release:
+            self.driver.ReleaseRetained(CORE_ID, NRNI, t1_ns)
+
+        spk_ids = self.driver.GetBDPars().GetSomaXYAddrs(words) # NRNI words are just the AER address
+        pool_ids, nrn_idxs, filtered_spk_times = self.last_mapped_network.translate_spikes(spk_ids, times)
+        return np.array([filtered_spk_times, pool_ids, nrn_idxs]).T
+
+    def get_retained_binned_spikes(self, t0_ns, t1_ns, bin_time_ns, release=False):
+        """Bins the retained spikes in [t0_ns, t1_ns) by bin_time_ns, without draining anything.
+        Unlike get_binned_spikes(), bins are aligned to t0_ns however often this is called.
+        release drops everything before t1_ns
+
+        Output:
+        =======
+        Same as get_binned_spikes(): ({pool: [[bin0 data], ..., [binN data]]}, [bin0 time, ..., binN time])
+        """
+        NRNI = self.driver.GetBDPars().UpEPCodeFor(bd.bdpars.BDFunnelEP.NRNI)
+        num_bins = max(int((t1_ns - t0_ns) // bin_time_ns), 0)
+        counts, num_keys = self.driver.GetRetainedBinned(CORE_ID, NRNI, t0_ns, bin_time_ns, num_bins)
+        if release:
+            self.driver.ReleaseRetained(CORE_ID, NRNI, t0_ns + num_bins * bin_time_ns)
+
+        binned_spikes = np.array(counts, dtype=int).reshape((num_bins, num_keys))
+        bin_times = t0_ns + bin_time_ns * np.arange(num_bins)
+        return self.last_mapped_network.translate_binned_spikes(binned_spikes), bin_times
+
+    def subscribe_spikes(self, pools, separate_queues=False):
+        """Only receive spikes from neurons in pools, the rest are dropped by the driver
+        before they're queued for get_spikes(). The rate map and retained spikes still see them.
+        If separate_queues, each pool's spikes skip get_spikes() and go to their own queue,
+        read them with get_pool_spikes(pool)
+        """
+        bdpars = self.driver.GetBDPars()
+        NRNI = bdpars.UpEPCodeFor(bd.bdpars.BDFunnelEP.NRNI)
+        self.driver.ClearSubscription(CORE_ID, NRNI)
+
+        keep = []
+        for pool in pools:
+            xloc, yloc = pool.mapped_xy
+            aer_addrs = [bdpars.GetSomaAERAddr(xloc + x, yloc + y) for y in range(pool.y) for x in range(pool.x)]
+            ranges = [(a, a + 1) for a in aer_addrs]
+            keep += ranges
+            if separate_queues:
+                self.driver.RouteSubscription(CORE_ID, NRNI, self._pool_queue(pool), ranges)
+        self.driver.SetSubscription(CORE_ID, NRNI, keep)
+
+    def unsubscribe_spikes(self):
+        """Receive spikes from all neurons again, through get_spikes()"""
+        NRNI = self.driver.GetBDPars().UpEPCodeFor(bd.bdpars.BDFunnelEP.NRNI)
+        self.driver.ClearSubscription(CORE_ID, NRNI)
+
+    @staticmethod
+    def _pool_queue(pool):
+        return "pool_{}".format(id(pool))
+
+    def get_pool_spikes(self, pool):
+        """Returns the pending spikes of a pool given to subscribe_spikes(separate_queues=True)
+
+        Data format: numpy array: [(timestamp, neuron_index), ...]
+        Timestamps are in nanoseconds
+        """
+        aer_addrs, times = self.driver.RecvFromQueue(self._pool_queue(pool), 1)
+        xy_addrs = np.array(self.driver.GetBDPars().GetSomaXYAddrs(aer_addrs), dtype=int)
+        xloc, yloc = pool.mapped_xy
+        nrn_idxs = (xy_addrs // 64 - yloc) * pool.x + (xy_addrs % 64 - xloc)
+        return np.array([times, nrn_idxs]).T
+
     def get_spikes(self):
         """Returns all the pending spikes gathered since this was last called.
 
         Data format: numpy array: [(timestamp, pool_id, neuron_index), ...]
         Timestamps are in nanoseconds
         """
-        spk_ids, spk_times = self.driver.RecvXYSpikes(CORE_ID)
-
-        pool_ids, nrn_idxs, filtered_spk_times = self.last_mapped_network.translate_spikes(spk_ids, spk_times)
+        times, pool_ids, nrn_idxs = self.driver.RecvTranslatedSpikes(CORE_ID, False, 1)
+        pools = self._table_pools[pool_ids]
 
-        ret_data = np.array([filtered_spk_times, pool_ids, nrn_idxs]).T
+        ret_data = np.array([times, pools, nrn_idxs]).T
         return ret_data
+
+    def get_spikes_by_pool(self):
+        """Like get_spikes(), but grouped by pool
+
+        Data format: {pool: numpy array of [(timestamp, neuron_index), ...]}
+        """
+        times, pool_ids, nrn_idxs = self.driver.RecvTranslatedSpikes(CORE_ID, True, 1)
+        starts = np.flatnonzero(np.diff(pool_ids)) + 1
+        by_pool = {}
+        for idxs in np.split(np.arange(len(pool_ids)), starts):
+            if len(idxs) > 0:
+                by_pool[self._table_pools[pool_ids[idxs[0]]]] = np.array([times[idxs], nrn_idxs[idxs]]).T
+        return by_pool
+
+    def _register_translation_tables(self, network):
+        """Give the driver <network>'s filter -> output/dim and soma -> pool/neuron tables,
+        so receive calls come back translated. Outputs and pools are passed as indices into
+        self._table_outputs/_table_pools
+        """
+        bdpars = self.driver.GetBDPars()
+
+        outputs = list(network.get_outputs())
+        self._table_outputs = np.empty(len(outputs), dtype=object)
+        self._table_outputs[:] = outputs
+        num_filters = max([filt_idx + 1 for filt_idx in network.spike_filter_idx_to_output] + [0])
+        filter_outputs = [-1] * num_filters
+        filter_dims = [0] * num_filters
+        for filt_idx, (output, dim) in network.spike_filter_idx_to_output.items():
+            filter_outputs[filt_idx] = outputs.index(output)
+            filter_dims[filt_idx] = dim
+        self.driver.SetOutputTable(CORE_ID, filter_outputs, filter_dims)
+
+        pools = list(network.get_pools())
+        self._table_pools = np.empty(len(pools), dtype=object)
+        self._table_pools[:] = pools
+        num_neurons = network.core.NeuronArray_width * network.core.NeuronArray_height
+        soma_pools = [-1] * num_neurons
+        soma_nrn_idxs = [0] * num_neurons
+        for xy_addr, (pool, nrn_idx) in network.spk_to_pool_nrn_idx.items():
+            aer_addr = bdpars.GetSomaAERAddr(xy_addr)
+            soma_pools[aer_addr] = pools.index(pool)
+            soma_nrn_idxs[aer_addr] = nrn_idx
+        self.driver.SetPoolTable(CORE_ID, soma_pools, soma_nrn_idxs)
     
     def stop_all_inputs(self, time=0, flush=True):
         """Stop all tag stream generators"""
@@ -383,6 +701,123 @@ class HAL:
 
         self.driver.SetSpikeGeneratorRates(CORE_ID, gen_idxs, out_tags, np.round(rates).astype(int), int(time), flush)
 
+    def set_input_rate_schedule(self, inputs, dims, times, rates, flush=True):
+        """Queues up many tag stream generator rate changes at once (e.g. a rate sweep)
+
+        Entry i sets inputs[i]/dims[i] to rates[i] Hz at times[i] ns.
+        Cheaper than calling set_input_rates() for each time: at each time,
+        only the generators whose rates changed are reprogrammed.
+
+        inputs: list of Input object
+        dims : list of ints
+            dimensions within each Input object to send to
+        times: list of ints (or floats, which will be rounded)
+            time for each rate change, in nanoseconds. Need not be sorted
+        rates: list of ints (or floats, which will be rounded)
+            desired tag rate for each Input/dimension in Hz
+        flush: bool (default true)
+            whether to flush the inputs through the driver immediately.
+
+        WARNING: If <flush> is True, calling this will block traffic until the max <time>
+        provided has passed!
+        """
+        if not (len(inputs) == len(dims) == len(times) == len(rates)):
+            raise ValueError("inputs, dims, times, and rates all have to be the same length")
+        if len(inputs) == 0:
+            return
+
+        gen_idxs = np.array([inp.generator_idxs[dim] for inp, dim in zip(inputs, dims)])
+        out_tags = np.array([inp.generator_out_tags[dim] for inp, dim in zip(inputs, dims)])
+        times = np.round(times).astype(np.int64)
+        rates = np.round(rates).astype(int)
+
+        # the driver wants non-decreasing times
+        order = np.argsort(times, kind="stable")
+
+        self.driver.SetSpikeGeneratorRateSchedule(
+            CORE_ID, times[order], gen_idxs[order], out_tags[order], rates[order], flush)
+
+    def start_input_rate_governor(self, target_loss_rate=1., queue_high=.75, decrease=.8, increase=1.05,
+                                  min_scale=.01, interval=.01):
+        """Automatically scales set_input_rates() rates to keep the chip's FIFOs from overflowing
+
+        Watches FIFO overflows and the FPGA's downstream queue as they're decoded. Rates are scaled
+        by <decrease> each <interval> that was overloaded, and by <increase> (up to 1) each one that
+        wasn't. Rates set before this call aren't governed until they're set again,
+        and set_input_rate_schedule() rates never are.
+
+        target_loss_rate: FIFO overflows/s to stay under
+        queue_high: downstream queue fill (0 to 1) that also counts as overloaded
+        min_scale: never scale rates below this
+        interval: seconds between scale changes
+        """
+        config = bd.RateGovernorConfig()
+        config.target_loss_rate = target_loss_rate
+        config.queue_high = queue_high
+        config.decrease = decrease
+        config.increase = increase
+        config.min_scale = min_scale
+        config.interval_ns = int(interval * 1e9)
+        self.driver.StartRateGovernor(CORE_ID, config)
+
+    def stop_input_rate_governor(self, flush=True):
+        """Stops governing, governed inputs go back to the rates they were set to"""
+        self.driver.StopRateGovernor(CORE_ID, flush)
+
+    def get_input_rate_scale(self):
+        """Scale governed input rates are currently programmed at, 1 if not governing"""
+        return self.driver.GetRateGovernorScale(CORE_ID)
+
+    def get_input_rate_governor_log(self):
+        """Every scale change of the latest start_input_rate_governor()
+
+        Returns (times in ns, scales, loss rates in overflows/s, downstream queue fills) as np.arrays,
+        the rate actually programmed for an input from times[i] on is its set rate * scales[i]
+        """
+        log = self.driver.GetRateGovernorLog(CORE_ID)
+        return (np.array([a.time for a in log], dtype=np.int64),
+                np.array([a.scale for a in log]),
+                np.array([a.loss_rate for a in log]),
+                np.array([a.queue_fill for a in log]))
+
+
+    def start_input_spike_trains(self, inputs, dims, times, rates, stop_time, poisson=True):
+        """Drives Input dimensions with spike trains generated on the host
+
+        Unlike set_input_rates(), doesn't use the FPGA's spike generators, so
+        any number of Input dimensions can be driven, with Poisson statistics.
+        The driver generates the spikes a stream window ahead of FPGA time.
+
+        inputs: list of Input object
+        dims : list of ints
+            dimensions within each Input object to drive
+        times: list of ints
+            times (ns) that the rates change at, shared by all the trains
+        rates: array-like [len(inputs), len(times)] of nonnegative floats
+            rates[i, j] is the rate (Hz) for inputs[i]/dims[i] from times[j] until times[j+1]
+        stop_time: int
+            time (ns) when all the trains stop
+        poisson: bool (default True)
+            Poisson trains if True, regular trains otherwise
+        """
+        rates = np.asarray(rates, dtype=float)
+        if not (len(inputs) == len(dims) == rates.shape[0]):
+            raise ValueError("inputs, dims, and rates all have to be the same length")
+        if rates.shape[1] != len(times):
+            raise ValueError("rates needs one column per entry of times")
+        if np.any(rates < 0):
+            raise ValueError("host-generated spike train rates can't be negative")
+
+        tags = [bd.PackWord([(bd.InputTag.TAG, inp.generator_out_tags[dim]), (bd.InputTag.COUNT, 1)])
+                for inp, dim in zip(inputs, dims)]
+        train_type = bd.SpikeTrainType.POISSON if poisson else bd.SpikeTrainType.REGULAR
+
+        self.driver.AddSpikeTrains(
+            CORE_ID, tags, train_type, [int(t) for t in times], rates.tolist(), int(stop_time))
+
+    def stop_input_spike_trains(self):
+        """Stop all spike trains started by start_input_spike_trains()"""
+        self.driver.ClearSpikeTrains()
 
     ##############################################################################
     #                           Mapping functions                                #
@@ -411,6 +846,7 @@ class HAL:
 
         self.last_mapped_network = network
         self.last_mapped_core = core
+        self._register_translation_tables(network)
 
         # implement core objects, calling driver
         logger.info("HAL: programming mapping results to hardware")
@@ -434,7 +870,54 @@ class HAL:
         # start with a clean slate
         self.init_hardware()
 
-        core = self.last_mapped_core
+        self.program_core(self.last_mapped_core)
+
+        # remove any evidence of old network in driver queues
+        logger.info("HAL: clearing queued-up outputs")
+        self.driver.ClearOutputs()
+
+        ## voodoo sleep, (wait for everything to go in)
+        sleep(1.0)
+
+    def compile_network_image(self, network, filename, remap=False, verbose=False):
+        """Like map(), but also saves the exact load to <filename>.
+        load_network_image(filename) reprograms the same network later
+        without going through the mapper or the driver's memory programming calls.
+        """
+        logger.info("HAL: doing logical mapping")
+        core = network.map(CORE_PARAMETERS, keep_pool_mapping=remap, verbose=verbose)
+
+        self.last_mapped_network = network
+        self.last_mapped_core = core
+        self._register_translation_tables(network)
+
+        self.init_hardware()
+
+        logger.info("HAL: capturing network image")
+        self.driver.BeginNetworkImage()
+        self.program_core(core)
+        image = self.driver.EndNetworkImage()
+        if not image.Save(filename):
+            logger.warning("HAL: couldn't write network image to " + filename)
+
+        logger.info("HAL: loading network image ({} bytes)".format(image.NumBytes()))
+        self.driver.LoadNetworkImage(image)
+        self.driver.ClearOutputs()
+
+    def load_network_image(self, filename):
+        """Reprogram a network saved by compile_network_image().
+        Note that last_mapped_network/last_mapped_core aren't restored.
+        Returns False if the image couldn't be read
+        """
+        self.init_hardware()
+
+        logger.info("HAL: loading network image " + filename)
+        success = self.driver.LoadNetworkImage(filename)
+        self.driver.ClearOutputs()
+        return success
+
+    def program_core(self, core):
+        """Send a mapped core's memories, neuron config, and spike filter settings to the driver"""
 
         # datapath memory programming
 
@@ -554,13 +1037,6 @@ class HAL:
         # exponential decay is also possible
         self.driver.SetSpikeFilterDecayConst(CORE_ID, 0)
         self.driver.SetSpikeFilterIncrementConst(CORE_ID, 1)
-
-        # remove any evidence of old network in driver queues
-        logger.info("HAL: clearing queued-up outputs")
-        self.driver.ClearOutputs()
-
-        ## voodoo sleep, (wait for everything to go in)
-        sleep(1.0)
     
     def get_driver_state(self):
         return self.driver.GetState(CORE_ID)
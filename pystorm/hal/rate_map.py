@@ -0,0 +1,74 @@
+"""Polls the driver's live rate map (Driver.StartRateMap() with a shm_name) from any process
+
+The map is double buffered in POSIX shared memory: the driver writes the buffer
+readers aren't looking at, then bumps a sequence number. Readers never hold up
+the driver, they just retry if the driver wrote over the buffer they were
+copying. The layout matches src/bddriver/common/RateMap.h.
+"""
+import mmap
+import numpy as np
+
+HEADER_SIZE = 128
+BUFFER_HEADER_SIZE = 64
+MAGIC = b"BDRM"
+VERSION = 1
+MAX_READ_TRIES = 8
+
+class RateMapReader:
+    """Numpy reader for a driver rate map
+
+    Parameters:
+    ===========
+    name (str) : shm_name passed to Driver.StartRateMap()
+    """
+    def __init__(self, name):
+        path = "/dev/shm/" + name.lstrip("/")
+        with open(path, "rb") as f:
+            self._mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+        header = np.frombuffer(self._mm, dtype=np.uint8, count=HEADER_SIZE)
+        if bytes(header[:4]) != MAGIC:
+            raise ValueError(path + " isn't a driver rate map")
+        version, num_neurons, width = np.frombuffer(self._mm, dtype="<u4", count=3, offset=4)
+        if version != VERSION:
+            raise ValueError(path + " is a version " + str(version) + " rate map, expected " + str(VERSION))
+
+        self.num_neurons = int(num_neurons)
+        self.width = int(width)
+        self.tau, self.refresh = np.frombuffer(self._mm, dtype="<f8", count=2, offset=16)
+        self._seq = np.frombuffer(self._mm, dtype="<u8", count=1, offset=64)
+
+        buffer_size = BUFFER_HEADER_SIZE + (self.num_neurons * 4 + 7) // 8 * 8
+        self._buffers = []
+        for idx in range(2):
+            offset = HEADER_SIZE + idx * buffer_size
+            self._buffers.append((
+                np.frombuffer(self._mm, dtype="<u8", count=2, offset=offset), # seq, time
+                np.frombuffer(self._mm, dtype="<f4", count=self.num_neurons, offset=offset + BUFFER_HEADER_SIZE)))
+
+    @property
+    def seq(self):
+        """maps published so far"""
+        return int(self._seq[0])
+
+    def read(self):
+        """Returns (time in ns, np.array of rates in Hz indexed [y, x]), or (None, None)
+        if nothing's been published yet (or the driver kept writing over it)
+        """
+        for _ in range(MAX_READ_TRIES):
+            seq = self.seq
+            if seq == 0:
+                return None, None
+            seq_time, rates = self._buffers[seq % 2]
+            if seq_time[0] != seq:
+                continue
+            time = int(seq_time[1])
+            rates = rates.copy()
+            if seq_time[0] == seq:
+                return time, rates.reshape(-1, self.width)
+        return None, None
+
+    def close(self):
+        self._buffers = None
+        self._seq = None
+        self._mm.close()
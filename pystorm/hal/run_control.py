@@ -32,7 +32,7 @@ class RunControl(object):
 
     def run_input_sweep(self, input_vals, get_raw_spikes=True, get_outputs=True,
                         start_time=None, end_time=None, step_options=None, rel_time=True,
-                        toggle_driver_traffic=False):
+                        toggle_driver_traffic=False, stream_inputs=False):
         """Run a simple input sweep, return the binned output values or raw spikes
 
         input_vals : {input_obj : ((len-T array) times, (TxD array) rates)}
@@ -54,6 +54,9 @@ class RunControl(object):
             If false interprets and returns times relative to the time since the FPGA started
         toggle_driver_traffic (bool, default False) : calls HAL.start_hardware and
             HAL.stop_hardware before and after the sweep, toggling the Driver's run state
+        stream_inputs (bool, default False) : stream the input rates to the hardware
+            a window at a time (see HAL.flush_streamed) instead of committing them all
+            up front. Use for long sweeps.
 
         Returns:
         ========
@@ -91,6 +94,10 @@ class RunControl(object):
 
         def enqueue_input_vals(input_vals, offset_ns):
             """Queue up input sequence in hardware"""
+            all_objs = []
+            all_dims = []
+            all_times = []
+            all_rates = []
             for input_obj in input_vals:
                 times, rates = input_vals[input_obj]
                 assert len(times) == rates.shape[0]
@@ -98,12 +105,17 @@ class RunControl(object):
 
                 T, D = rates.shape
 
-                objs = [input_obj] * D
-                dims = [d for d in range(D)]
+                # flatten [time, dim], time major
+                all_objs += [input_obj] * (T * D)
+                all_dims.append(np.tile(np.arange(D), T))
+                all_times.append(np.repeat(np.asarray(times) + offset_ns, D))
+                all_rates.append(rates.flatten())
 
-                for tidx, t in enumerate(times):
-                    self.HAL.set_input_rates(
-                        objs, dims, rates[tidx, :], time=t + offset_ns, flush=False)
+            if len(all_objs) > 0:
+                # only rate changes are sent to the hardware
+                self.HAL.set_input_rate_schedule(
+                    all_objs, np.concatenate(all_dims), np.concatenate(all_times),
+                    np.concatenate(all_rates), flush=False)
 
         def end_sweep(get_raw_spikes, get_outputs, start_time, end_time, offset_ns):
             """"Deactivate chip traffic, and gather output spikes and tags"""
@@ -159,7 +171,11 @@ class RunControl(object):
             offset_ns = 0 + TFUDGE_NS
         start_sweep(get_raw_spikes, get_outputs) # this will cause a flush
         enqueue_input_vals(input_vals, offset_ns) # no flush yet
-        self.HAL.flush()
+        if stream_inputs:
+            self.HAL.reset_stream_stats()
+            self.HAL.flush_streamed()
+        else:
+            self.HAL.flush()
 
         if rel_time:
             sleeptime = (end_time + TFUDGE_NS) / 1e9
@@ -170,6 +186,11 @@ class RunControl(object):
 
         outputs, spikes = end_sweep(get_raw_spikes, get_outputs, start_time, end_time, offset_ns)
 
+        if stream_inputs:
+            stream_stats = self.HAL.get_stream_stats()
+            logger.info("input stream ran at most %d ns ahead of, %d ns behind FPGA time",
+                        stream_stats["max_lead"], stream_stats["max_lag"])
+
 
         if toggle_driver_traffic:
             raise NotImplementedError("toggle_driver_traffic not currently supported")
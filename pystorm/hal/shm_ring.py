@@ -0,0 +1,108 @@
+"""Reads the driver's upstream broadcast ring (Driver.StartBroadcast()) from any process
+
+The ring lives in POSIX shared memory. Each reader keeps its own cursor, so
+a recorder, a GUI and the experiment script can all see the same upstream
+traffic without popping it from the driver. The layout matches
+src/bddriver/common/ShmRing.h.
+"""
+import mmap
+import os
+import numpy as np
+
+HEADER_SIZE = 128
+MAGIC = b"BDSR"
+VERSION = 2 # 2: 64-bit payloads
+
+RECORD_DTYPE = np.dtype([
+    ("seq", "<u8"),      # 1-based sequence number, 0 while being written
+    ("time", "<u8"),     # FPGA time units
+    ("payload", "<u8"),  # two-word outputs are already put back together
+    ("core_id", "u1"),
+    ("ep_code", "u1"),   # upstream ep code
+    ("pad", "V6")])
+
+class ShmRingReader:
+    """Numpy reader for a driver broadcast ring
+
+    Parameters:
+    ===========
+    name (str) : ring name passed to Driver.StartBroadcast()
+    from_oldest (bool) : start at the oldest record still in the ring,
+        instead of at the newest
+    """
+    def __init__(self, name, from_oldest=False):
+        path = "/dev/shm/" + name.lstrip("/")
+        with open(path, "rb") as f:
+            self._mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+        header = np.frombuffer(self._mm, dtype=np.uint8, count=HEADER_SIZE)
+        if bytes(header[:4]) != MAGIC:
+            raise ValueError(path + " isn't a driver broadcast ring")
+        version, record_size, capacity = np.frombuffer(self._mm, dtype="<u4", count=3, offset=4)
+        if version != VERSION or record_size != RECORD_DTYPE.itemsize:
+            raise ValueError(path + " is a version " + str(version) + " ring, expected " + str(VERSION))
+
+        self.capacity = int(capacity)
+        self._mask = self.capacity - 1
+        self._ns_per_unit = np.frombuffer(self._mm, dtype="<u8", count=1, offset=16)
+        self._write_seq = np.frombuffer(self._mm, dtype="<u8", count=1, offset=64)
+        self._records = np.frombuffer(self._mm, dtype=RECORD_DTYPE, count=self.capacity, offset=HEADER_SIZE)
+
+        write_seq = self.write_seq
+        if from_oldest:
+            self.cursor = max(write_seq - self.capacity, 0)
+        else:
+            self.cursor = write_seq
+        self.num_lost = 0
+
+    @property
+    def write_seq(self):
+        """records published so far"""
+        return int(self._write_seq[0])
+
+    @property
+    def ns_per_unit(self):
+        return int(self._ns_per_unit[0])
+
+    def seek_to_latest(self):
+        self.cursor = self.write_seq
+
+    def read(self, max_records=0):
+        """Returns the records after the cursor and advances it
+
+        Returns:
+        ========
+        (records, num_lost)
+        records : structured array of RECORD_DTYPE, times in FPGA units (see ns_per_unit)
+        num_lost : records the writer overwrote before we got to them
+        """
+        write_seq = self.write_seq
+        start = max(self.cursor, write_seq - self.capacity)
+        end = write_seq
+        if max_records > 0:
+            end = min(end, start + max_records)
+
+        seqs = np.arange(start, end, dtype=np.uint64)
+        records = self._records[seqs & np.uint64(self._mask)].copy()
+
+        # anything the writer got to while we copied is garbage
+        oldest_valid = self.write_seq - self.capacity + 1
+        valid = (records["seq"] == seqs + 1) & (seqs.astype(np.int64) >= oldest_valid)
+        records = records[valid]
+
+        lost = (start - self.cursor) + (len(valid) - len(records))
+        self.cursor = end
+        self.num_lost += lost
+        return records, lost
+
+    def read_ep(self, up_ep_code, max_records=0):
+        """Like read(), but only returns (times (ns), payloads, core_ids) from <up_ep_code>"""
+        records, lost = self.read(max_records)
+        records = records[records["ep_code"] == up_ep_code]
+        return records["time"] * self.ns_per_unit, records["payload"], records["core_id"], lost
+
+    def close(self):
+        self._records = None
+        self._write_seq = None
+        self._ns_per_unit = None
+        self._mm.close()
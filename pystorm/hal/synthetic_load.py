@@ -0,0 +1,74 @@
+"""Finds how much upstream traffic the host keeps up with, without a chip
+
+Runs a bddriver.SyntheticDriver, which generates Poisson spike traffic like
+a loaded board would, and drains it through the same Python receive call
+HAL.get_spikes() uses. The C++ side of this is CommSyntheticTest.MaxSustainedRate.
+"""
+import time
+from pystorm.PyDriver import bddriver as bd
+
+READ_SIZE = 32768 # bytes per comm read, driverpars::READ_SIZE
+
+def _run_step(driver, rate, step_s, recv):
+    load = bd.SyntheticLoad()
+    load.spike_rate = rate
+    generated_before = driver.GetSyntheticStats().num_spikes
+    driver.SetLoad(load)
+
+    # first half settles, second half shows whether the lag grows
+    received = 0
+    queue_mid = None
+    start = time.time()
+    while time.time() - start < step_s:
+        received += len(recv(driver)[0])
+        if queue_mid is None and time.time() - start > step_s / 2:
+            queue_mid = driver.GetDecoderQueueBytes()
+        time.sleep(0.001)
+    queue_end = driver.GetDecoderQueueBytes()
+    stats = driver.GetSyntheticStats()
+    generated = stats.num_spikes - generated_before
+
+    driver.SetLoad(bd.SyntheticLoad())
+    while driver.GetDecoderQueueBytes() > 0 or driver.GetSyntheticStats().backlog_words > 0:
+        recv(driver)
+        time.sleep(0.001)
+    recv(driver)
+
+    kept_up = (stats.backlog_words < READ_SIZE and
+               queue_end <= (queue_mid or 0) + 4 * READ_SIZE and
+               received + stats.backlog_words + queue_end / 4 >= 0.9 * generated)
+    return kept_up, received, generated, queue_end
+
+def max_sustained_spike_rate(start_rate=2.5e5, max_rate=64e6, step_s=1.0,
+                             recv=lambda driver: driver.RecvXYSpikes(0), verbose=True):
+    """Double the synthetic spike rate until the host falls behind
+
+    Parameters:
+    ===========
+    start_rate, max_rate (float) : spikes/s range to try
+    step_s (float) : how long to run each rate
+    recv (function(driver)) : the receive call to keep up with, returns (spikes, times)
+
+    Returns the highest rate (spikes/s) at which the decoder queue didn't grow
+    and <recv> got at least 90% of the spikes, 0 if none
+    """
+    driver = bd.SyntheticDriver()
+    driver.SetTimePerUpHB(1000000)
+    driver.Start()
+
+    max_sustained = 0
+    rate = start_rate
+    try:
+        while rate <= max_rate:
+            kept_up, received, generated, queue_end = _run_step(driver, rate, step_s, recv)
+            if verbose:
+                print("spike rate {:.2f} M/s: received {:.2f} M of {:.2f} M, decoder queue {} KB{}".format(
+                    rate / 1e6, received / 1e6, generated / 1e6, queue_end // 1024,
+                    "" if kept_up else " (falling behind)"))
+            if not kept_up:
+                break
+            max_sustained = rate
+            rate *= 2
+    finally:
+        driver.Stop()
+    return max_sustained
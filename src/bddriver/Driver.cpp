@@ -1,6 +1,9 @@
 #include "Driver.h"
 
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <unordered_map>
 #include <array>
@@ -12,6 +15,7 @@
 #include <chrono>
 #include <thread>
 #include <math.h>
+#include <cmath>
 
 #include "comm/Comm.h"
 #include "comm/CommSoft.h"
@@ -28,7 +32,6 @@
 #include "common/DriverPars.h"
 #include "common/DriverTypes.h"
 #include "common/MutexBuffer.h"
-#include "common/vector_util.h"
 #include "decoder/Decoder.h"
 #include "encoder/Encoder.h"
 
@@ -38,7 +41,11 @@ using std::endl;
 namespace pystorm {
 namespace bddriver {
 
-const bdpars::BDPars Driver::kBDPars_;
+const unsigned int Driver::num_SG_en_words_;
+const BDWord Driver::SG_prog_unknown_;
+
+constexpr char Driver::kAttachFileMagic[4];
+constexpr uint32_t Driver::kAttachFileVersion;
 
 // Driver * Driver::GetInstance()
 //{
@@ -49,7 +56,7 @@ const bdpars::BDPars Driver::kBDPars_;
 //    return &m_instance;
 //}
 
-Driver::Driver() {
+Driver::Driver(unsigned int num_cores) : kBDPars_(num_cores) {
   // load parameters
   ok_pars_     = OKPars();
 
@@ -58,32 +65,40 @@ Driver::Driver() {
     bd_state_.push_back(BDState(GetBDPars()));
   }
 
+  // hot-swap bookkeeping for the memories a network spans (the PAT is what gets swapped)
+  mem_allocs_.resize(kBDPars_.NumCores);
+  for (auto &it : mem_allocs_) {
+    for (auto mem_id : {bdpars::BDMemId::AM, bdpars::BDMemId::MM, bdpars::BDMemId::TAT0, bdpars::BDMemId::TAT1}) {
+      it.insert({mem_id, MemAllocator(kBDPars_.mem_info_.at(mem_id).size)});
+    }
+  }
+  staged_AM_dump_words_.assign(kBDPars_.NumCores, 0);
+  pause_start_.resize(kBDPars_.NumCores);
+  traffic_paused_ns_.assign(kBDPars_.NumCores, 0);
+
   // initialize buffers
   enc_buf_in_  = new MutexBuffer<EncInput>();
+  enc_bulk_buf_in_ = new MutexBuffer<EncInput>();
   enc_buf_out_ = new MutexBuffer<EncOutput>();
   dec_buf_in_  = new MutexBuffer<DecInput>();
 
-  // there is one dec_buf_out per upstream EP
+  // there is one dec_buf_out per core and upstream EP
   std::vector<uint8_t> up_eps = kBDPars_.GetUpEPs();
 
-  for (auto& it : up_eps) {
-    dec_bufs_out_.insert({it, new MutexBuffer<DecOutput>()});
-  }
-
-  // initialize deserializers for upstream traffic
-  // deserialization is needed when ep size exceeds FPGA word payload size
-  // deserializers make it possible to track "extra" remainder words
-  // we might get out of the decoder
-  for (auto& ep : up_eps) {
-    const unsigned int FPGA_payload_width = FieldWidth(FPGAIO::PAYLOAD);
-    const unsigned int ep_data_size = kBDPars_.Up_EP_size_.at(ep);
-    const unsigned int D = ep_data_size % FPGA_payload_width == 0 ?
-        ep_data_size / FPGA_payload_width
-      : ep_data_size / FPGA_payload_width + 1;
-
-    // only create a deserializer when needed
-    if (D > 1) {
-      up_ep_deserializers_.insert({ep, new VectorDeserializer<DecOutput>(D)});
+  dec_bufs_out_.resize(kBDPars_.NumCores);
+  retention_stores_.resize(kBDPars_.NumCores);
+  subscriptions_.resize(kBDPars_.NumCores);
+  translation_tables_.resize(kBDPars_.NumCores);
+  tag_binnings_.resize(kBDPars_.NumCores);
+  host_filter_banks_.resize(kBDPars_.NumCores);
+  rate_maps_.resize(kBDPars_.NumCores);
+  governings_.resize(kBDPars_.NumCores);
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    dec_bufs_out_signals_.push_back(new PushSignal());
+    for (auto& it : up_eps) {
+      auto buf = new MutexBuffer<DecOutput>();
+      buf->SetPushSignal(dec_bufs_out_signals_[i]);
+      dec_bufs_out_[i].insert({it, buf});
     }
   }
 
@@ -92,7 +107,9 @@ Driver::Driver() {
       enc_buf_in_,
       enc_buf_out_,
       GetBDPars(),
-      driverpars::ENC_TIMEOUT_US);
+      driverpars::ENC_TIMEOUT_US,
+      enc_bulk_buf_in_,
+      [this] { return dec_->GetLatestHB(); });
 
   dec_ = new Decoder(
       dec_buf_in_,
@@ -100,6 +117,24 @@ Driver::Driver() {
       GetBDPars(),
       driverpars::DEC_TIMEOUT_US);
 
+  feeder_ = new TimedFeeder(
+      enc_bulk_buf_in_,
+      &kBDPars_,
+      [this] { return dec_->GetLatestHB(); },
+      NsToUnits(stream_window_ns_));
+
+  spike_gen_ = new SpikeTrainGenerator(
+      enc_bulk_buf_in_,
+      &kBDPars_,
+      [this] { return dec_->GetLatestHB(); },
+      kBDPars_.DnEPCodeFor(bdpars::BDHornEP::RI),
+      NsToUnits(stream_window_ns_));
+  // the feeder releases the spikes with its schedule, so the bulk lane gets one time-ordered stream
+  feeder_->SetSource([this](BDTime fpga_time, BDTime horizon, std::vector<EncInput> *out) {
+      spike_gen_->GenerateInto(fpga_time, horizon, out);
+    });
+  assert(kBDPars_.Dn_EP_size_[kBDPars_.DnEPCodeFor(bdpars::BDHornEP::RI)] <= FieldWidth(FPGAIO::PAYLOAD)); // tags aren't serialized
+
   // initialize Comm
 #ifdef BD_COMM_TYPE_SOFT
   cout << "initializing CommSoft" << endl;
@@ -128,21 +163,43 @@ Driver::Driver() {
 
   // set up FPGA data structures
   SG_en_.resize(kBDPars_.NumCores);
+  SG_en_words_sent_.resize(kBDPars_.NumCores);
+  SG_en_words_sent_valid_.resize(kBDPars_.NumCores, false);
+  SG_gens_used_sent_.resize(kBDPars_.NumCores, -1);
+  SG_prog_sent_.resize(kBDPars_.NumCores);
+  num_SG_words_sent_.resize(kBDPars_.NumCores, 0);
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    InitSGEn(i);
+  }
 
 }
 
 Driver::~Driver() {
   delete enc_buf_in_;
+  delete enc_bulk_buf_in_;
   delete enc_buf_out_;
   delete dec_buf_in_;
-  for (auto& it : dec_bufs_out_) {
-    delete it.second;
+  for (auto& core_bufs : dec_bufs_out_) {
+    for (auto& it : core_bufs) {
+      delete it.second;
+    }
   }
-  for (auto& it : up_ep_deserializers_) {
-    delete it.second;
+  for (auto& it : dec_bufs_out_signals_) {
+    delete it;
   }
+  delete feeder_;
+  delete spike_gen_;
   delete enc_;
   delete dec_;
+  for (auto& core_stores : retention_stores_) {
+    for (auto& it : core_stores) {
+      delete it.second;
+    }
+  }
+  for (auto& it : subscription_queues_) {
+    delete it.second;
+  }
+  delete broadcast_;
   delete comm_;
 }
 
@@ -154,6 +211,18 @@ void Driver::SetTimeUnitLen(BDTime ns_per_unit) {
   // update FPGA state
   ns_per_unit_ = ns_per_unit;
   clks_per_unit_ = ns_per_unit / ns_per_clk_;
+  if (broadcast_ != nullptr) {
+    broadcast_->SetNsPerUnit(ns_per_unit);
+  }
+  // retained times are in the old units
+  {
+    std::unique_lock<std::mutex> lock(retention_lock_);
+    for (auto& core_stores : retention_stores_) {
+      for (auto& it : core_stores) {
+        it.second->Clear();
+      }
+    }
+  }
   //cout << "setting FPGA time unit to " << ns_per_unit << " ns = " << clks_per_unit_ << " clocks per unit" << endl;
 
   // make sure that we aren't going to break the SG or SF
@@ -175,9 +244,15 @@ void Driver::SetTimeUnitLen(BDTime ns_per_unit) {
   }
 
   BDWord unit_len_word = PackWord<FPGATMUnitLen>({{FPGATMUnitLen::UNIT_LEN, clks_per_unit_}});
-  SendToEP(0, bdpars::FPGARegEP::TM_UNIT_LEN, {unit_len_word}); // XXX core id?
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    SendToEP(i, bdpars::FPGARegEP::TM_UNIT_LEN, {unit_len_word});
+  }
   Flush();
 
+  // the stream window is kept in ns, update it for the new unit
+  feeder_->SetWindow(NsToUnits(stream_window_ns_));
+  enc_->SetBulkLead(NsToUnits(bulk_lead_ns_));
+
   // call SetTimePerUpHB with using old ns_per_HB_
   // (the time unit may have just changed, need to update how often we send upstream HB)
   Driver::SetTimePerUpHB(ns_per_HB_);
@@ -195,34 +270,28 @@ void Driver::SetTimePerUpHB(BDTime ns_per_hb) {
   uint64_t w1 = GetField(units_per_HB_word, THREEFPGAREGS::W1);
   uint64_t w2 = GetField(units_per_HB_word, THREEFPGAREGS::W2);
 
-  SendToEP(0, bdpars::FPGARegEP::TM_PC_SEND_HB_UP_EVERY0, {w0}); // XXX core id?
-  SendToEP(0, bdpars::FPGARegEP::TM_PC_SEND_HB_UP_EVERY1, {w1}); // XXX core id?
-  SendToEP(0, bdpars::FPGARegEP::TM_PC_SEND_HB_UP_EVERY2, {w2}); // XXX core id?
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    SendToEP(i, bdpars::FPGARegEP::TM_PC_SEND_HB_UP_EVERY0, {w0});
+    SendToEP(i, bdpars::FPGARegEP::TM_PC_SEND_HB_UP_EVERY1, {w1});
+    SendToEP(i, bdpars::FPGARegEP::TM_PC_SEND_HB_UP_EVERY2, {w2});
+  }
   Flush();
 }
 
 void Driver::ResetBD() {
   // XXX this is only guaranteed to work after bring-up.
   // There's no simple way to enforce this timing if the downstream traffic flow is blocked.
-  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
-
-    BDWord pReset_1_sReset_1 = PackWord<FPGABDReset>({{FPGABDReset::PRESET, 1}, {FPGABDReset::SRESET, 1}});
-    BDWord pReset_0_sReset_1 = PackWord<FPGABDReset>({{FPGABDReset::PRESET, 0}, {FPGABDReset::SRESET, 1}});
-    BDWord pReset_0_sReset_0 = PackWord<FPGABDReset>({{FPGABDReset::PRESET, 0}, {FPGABDReset::SRESET, 0}});
-
-    unsigned int delay_us = 500000; // hold reset states for 5 ms (probably conservative)
+  BDWord pReset_1_sReset_1 = PackWord<FPGABDReset>({{FPGABDReset::PRESET, 1}, {FPGABDReset::SRESET, 1}});
+  BDWord pReset_0_sReset_1 = PackWord<FPGABDReset>({{FPGABDReset::PRESET, 0}, {FPGABDReset::SRESET, 1}});
+  BDWord pReset_0_sReset_0 = PackWord<FPGABDReset>({{FPGABDReset::PRESET, 0}, {FPGABDReset::SRESET, 0}});
 
-    SendToEP(i, bdpars::FPGARegEP::BD_RESET, {pReset_1_sReset_1});
-    Flush();
-
-    std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+  unsigned int delay_us = 500000; // hold reset states for 5 ms (probably conservative)
 
-    SendToEP(i, bdpars::FPGARegEP::BD_RESET, {pReset_0_sReset_1});
-    Flush();
-
-    std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
-
-    SendToEP(i, bdpars::FPGARegEP::BD_RESET, {pReset_0_sReset_0});
+  // every core goes through each reset state together, so they share the holds
+  for (auto& reset_state : {pReset_1_sReset_1, pReset_0_sReset_1, pReset_0_sReset_0}) {
+    for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+      SendToEP(i, bdpars::FPGARegEP::BD_RESET, {reset_state});
+    }
     Flush();
 
     std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
@@ -256,15 +325,21 @@ void Driver::ResetFPGATime() {
 
   BDWord reset_time_1 = PackWord<FPGAResetClock>({{FPGAResetClock::RESET_STATE, 1}});
   BDWord reset_time_0 = PackWord<FPGAResetClock>({{FPGAResetClock::RESET_STATE, 0}});
-  SendToEP(0, bdpars::FPGARegEP::TM_PC_RESET_TIME, {reset_time_1, reset_time_0}); // XXX core_id?
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    SendToEP(i, bdpars::FPGARegEP::TM_PC_RESET_TIME, {reset_time_1, reset_time_0});
+  }
 }
 
 BDTime Driver::GetFPGATime() {
   // the Decoder already decoded the times, ignore the payload and just use the last timestamp
-  std::vector<BDTime> times = RecvFromEP(0, bdpars::FPGAOutputEP::UPSTREAM_HB_MSB, 1000).second;
-  auto dont_care = RecvFromEP(0, bdpars::FPGAOutputEP::UPSTREAM_HB_LSB, 1000).second; // drain the LSBs too so the queue doesn't pile up
-  if (times.size() > 0) {
-    last_time_ = times.back();
+  // drain the LSBs too so the queue doesn't pile up
+  const uint8_t MSB_code = kBDPars_.UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_HB_MSB);
+  auto recvd = RecvFromEPs(0, {MSB_code, kBDPars_.UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_HB_LSB)}, 1000);
+  const std::vector<uint8_t> &ep_codes = std::get<0>(recvd);
+  for (unsigned int i = 0; i < ep_codes.size(); i++) {
+    if (ep_codes[i] == MSB_code) {
+      last_time_ = std::get<2>(recvd)[i];
+    }
   }
   return last_time_;
 }
@@ -279,6 +354,10 @@ void Driver::SetOKBitFile(std::string bitfile) {
     ok_pars_.ok_bitfile = bitfile;
 }
 
+void Driver::SetOKSerial(std::string serial) {
+    ok_pars_.ok_serial = serial;
+}
+
 void Driver::InitDAC(unsigned int core_id, bool flush) {
   // List of DAC
   std::array<bdpars::BDHornEP, 12> dac_list {
@@ -309,6 +388,7 @@ void Driver::InitFPGA() {
   cout << "InitFPGA: initializing SGs" << endl;
   for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
     InitSGEn(i);
+    std::unique_lock<std::mutex> lock(governor_lock_);
     SendSGEns(i, 0);
   }
 
@@ -331,22 +411,28 @@ void Driver::InitBD() {
   cout << "InitBD: BD reset cycle" << endl;
   ResetBD();
 
+  std::vector<unsigned int> all_cores;
   for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    all_cores.push_back(i);
+
     // turn off traffic
     cout << "InitBD: disabling traffic flow" << endl;
-    SetTagTrafficState(i, false);
-    SetSpikeTrafficState(i, false);
+    SetTagTrafficState(i, false, false);
+    SetSpikeTrafficState(i, false, false);
 
     // Set the memory delays
     for(auto& mem : {bdpars::BDMemId::AM, bdpars::BDMemId::MM, bdpars::BDMemId::FIFO_PG, bdpars::BDMemId::FIFO_DCT, bdpars::BDMemId::TAT0, bdpars::BDMemId::TAT1, bdpars::BDMemId::PAT}) {
       const unsigned delay_val = 0;
-      SetMemoryDelay(i, mem, delay_val, delay_val);
+      SetMemoryDelay(i, mem, delay_val, delay_val, false);
     }
+  }
+  Flush();
 
-    // init the FIFO
-    cout << "InitBD: initializing FIFO" << endl;
-    InitFIFO(i);
+  // init the FIFOs, on all cores at once
+  cout << "InitBD: initializing FIFO" << endl;
+  InitFIFOs(all_cores);
 
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
     cout << "InitBD: programming memories to default values" << endl;
     // initialize memories to sane values (critically, that can't cause infinite loops)
     SetMem(i , bdpars::BDMemId::PAT  , GetDefaultPATEntries()  , 0);
@@ -380,19 +466,286 @@ void Driver::InitBD() {
 
     // XXX other stuff to do?
     Flush();
+
+    // every memory was just overwritten, no network is using any of it
+    for (auto &it : mem_allocs_[i]) {
+      it.second.Clear();
+    }
+    staged_AM_dump_words_[i] = 0;
+  }
+}
+
+bool Driver::SaveAttachState(const std::string &filename) const {
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    cout << "WARNING: SaveAttachState: couldn't open " << filename << " for writing" << endl;
+    return false;
+  }
+
+  uint32_t num_cores = bd_state_.size();
+  file.write(kAttachFileMagic, 4);
+  file.write(reinterpret_cast<const char *>(&kAttachFileVersion), sizeof(kAttachFileVersion));
+  file.write(reinterpret_cast<const char *>(&num_cores), sizeof(num_cores));
+  for (auto &it : bd_state_) {
+    uint64_t fingerprint = it.Fingerprint();
+    file.write(reinterpret_cast<const char *>(&fingerprint), sizeof(fingerprint));
+    it.Write(file);
+  }
+  return file.good();
+}
+
+bool Driver::ReadAttachState(const std::string &filename, std::vector<BDState> *states) const {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    cout << "WARNING: AttachBD: couldn't open " << filename << endl;
+    return false;
+  }
+
+  char magic[4];
+  uint32_t version, num_cores;
+  file.read(magic, 4);
+  file.read(reinterpret_cast<char *>(&version), sizeof(version));
+  file.read(reinterpret_cast<char *>(&num_cores), sizeof(num_cores));
+  if (!file.good() || std::memcmp(magic, kAttachFileMagic, 4) != 0 || version != kAttachFileVersion || num_cores != kBDPars_.NumCores) {
+    cout << "WARNING: AttachBD: " << filename << " isn't an attach state file (version " << kAttachFileVersion << ") for this chip" << endl;
+    return false;
+  }
+
+  for (unsigned int i = 0; i < num_cores; i++) {
+    uint64_t fingerprint;
+    BDState state(&kBDPars_);
+    file.read(reinterpret_cast<char *>(&fingerprint), sizeof(fingerprint));
+    if (!file.good() || !state.Read(file) || state.Fingerprint() != fingerprint) {
+      cout << "WARNING: AttachBD: core " << i << " state in " << filename << " is corrupt" << endl;
+      return false;
+    }
+    states->push_back(state);
+  }
+  return true;
+}
+
+bool Driver::AttachBD(const std::string &filename, const std::vector<uint64_t> &saved_fingerprints, unsigned int samples_per_mem) {
+
+  std::vector<BDState> states;
+  bool attached = ReadAttachState(filename, &states);
+
+  // the file is what we expect, the chip is checked below
+  if (attached && saved_fingerprints.size() > 0) {
+    assert(saved_fingerprints.size() == kBDPars_.NumCores);
+    for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+      if (states[i].Fingerprint() != saved_fingerprints[i]) {
+        cout << "WARNING: AttachBD: core " << i << " state saved in " << filename << " isn't the expected configuration" << endl;
+        attached = false;
+      }
+    }
+  }
+
+  if (attached) {
+    InitFPGA();
+
+    cout << "AttachBD: checking chip memories against " << filename << endl;
+    for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+      bd_state_[i].Restore(states[i]);
+    }
+    unsigned int num_mismatches = VerifyMemSamples(samples_per_mem);
+    if (num_mismatches > 0) {
+      cout << "WARNING: AttachBD: " << num_mismatches << " memory entries don't match " << filename << endl;
+      attached = false;
+    }
+  }
+
+  if (!attached) {
+    cout << "AttachBD: falling back to InitBD" << endl;
+    for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+      bd_state_[i] = BDState(GetBDPars());
+    }
+    InitBD();
+    return false;
+  }
+
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    ResendBDRegisters(i);
+    RebuildMemAllocs(i);
+  }
+  return true;
+}
+
+unsigned int Driver::VerifyMemSamples(unsigned int samples_per_mem) {
+  const std::vector<bdpars::BDMemId> mems = {
+    bdpars::BDMemId::PAT, bdpars::BDMemId::TAT0, bdpars::BDMemId::TAT1, bdpars::BDMemId::MM, bdpars::BDMemId::AM};
+
+  // addresses dumped, per core and memory, in the order they come back
+  std::vector<std::unordered_map<bdpars::BDMemId, std::vector<unsigned int>, EnumClassHash>> addrs(kBDPars_.NumCores);
+
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    const BDState &state = bd_state_[i];
+    PauseTraffic(i);
+    for (auto mem_id : mems) {
+      const unsigned int size = kBDPars_.mem_info_.at(mem_id).size;
+      const unsigned int window = std::min(driverpars::ATTACH_SAMPLE_WORDS, size);
+      const unsigned int num_windows = size / window;
+      const unsigned int num_samples = std::min(samples_per_mem, num_windows);
+
+      for (unsigned int j = 0; j < num_samples; j++) {
+        // spread evenly over the memory
+        const unsigned int start = j * num_windows / num_samples * window;
+
+        // skip windows with nothing programmed. Dumping the AM rewrites it,
+        // so AM windows have to be fully programmed
+        unsigned int num_valid = 0;
+        for (unsigned int addr = start; addr < start + window; addr++) {
+          num_valid += state.IsMemValid(mem_id, addr);
+        }
+        if (num_valid == 0 || (mem_id == bdpars::BDMemId::AM && num_valid < window)) continue;
+
+        SendToEP(i, kBDPars_.mem_info_.at(mem_id).prog_leaf, PackDumpWords(i, mem_id, start, start + window));
+        for (unsigned int addr = start; addr < start + window; addr++) {
+          addrs[i][mem_id].push_back(addr);
+        }
+      }
+    }
+    ResumeTraffic(i);
+  }
+
+  IssuePushWords();
+  // PAT dumps come after the pushes that were pending, see DumpMemRecv()
+  const unsigned int pushs_before = num_pushs_pending_ - 2;
+
+  // wait for everything at once, instead of sleeping once per dump
+  std::vector<std::unordered_map<bdpars::BDMemId, std::vector<BDWord>, EnumClassHash>> recvd(kBDPars_.NumCores);
+  auto ExpectedWords = [&](unsigned int core_id, bdpars::BDMemId mem_id) {
+    unsigned int num_addrs = addrs[core_id][mem_id].size();
+    return num_addrs + (mem_id == bdpars::BDMemId::PAT && num_addrs > 0 ? pushs_before : 0);
+  };
+  auto RecvMore = [&](unsigned int core_id, bdpars::BDMemId mem_id, unsigned int timeout_us) {
+    std::vector<BDWord> words = RecvFromEP(core_id, kBDPars_.mem_info_.at(mem_id).dump_leaf, timeout_us).first;
+    recvd[core_id][mem_id].insert(recvd[core_id][mem_id].end(), words.begin(), words.end());
+  };
+
+  auto start = std::chrono::high_resolution_clock::now();
+  bool all_recvd = false;
+  while (!all_recvd && std::chrono::high_resolution_clock::now() - start < std::chrono::microseconds(driverpars::ATTACH_TIMEOUT_US)) {
+    all_recvd = true;
+    for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+      for (auto mem_id : mems) {
+        if (recvd[i][mem_id].size() < ExpectedWords(i, mem_id)) {
+          RecvMore(i, mem_id, 1000);
+          all_recvd = all_recvd && recvd[i][mem_id].size() >= ExpectedWords(i, mem_id);
+        }
+      }
+    }
+  }
+
+  unsigned int num_mismatches = 0;
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    const BDState &state = bd_state_[i];
+    for (auto mem_id : mems) {
+      const std::vector<unsigned int> &mem_addrs = addrs[i][mem_id];
+      if (mem_addrs.size() == 0) continue;
+      const std::vector<BDWord> &expected = *state.GetMem(mem_id);
+      const std::vector<BDWord> &words = recvd[i][mem_id];
+
+      auto CountMismatches = [&](unsigned int skip) {
+        unsigned int count = 0;
+        for (unsigned int k = 0; k < mem_addrs.size(); k++) {
+          if (!state.IsMemValid(mem_id, mem_addrs[k])) continue;
+          if (skip + k >= words.size() || words[skip + k] != expected.at(mem_addrs[k])) count++;
+        }
+        return count;
+      };
+
+      unsigned int skip = 0;
+      if (mem_id == bdpars::BDMemId::PAT) {
+        // the last session's last two outputs may still have been trapped in the chip
+        // (most likely its push words), they come out ahead of everything else.
+        // Pick up any stragglers behind them, and try the dump after them too
+        RecvMore(i, mem_id, 1000);
+        skip = pushs_before;
+        for (unsigned int stale = 1; stale <= 2; stale++) {
+          if (CountMismatches(pushs_before + stale) < CountMismatches(skip)) {
+            skip = pushs_before + stale;
+          }
+        }
+        // whatever came after the dump was our own pushes
+        num_pushs_pending_ -= std::min<unsigned int>(pushs_before, words.size());
+        if (words.size() > skip + mem_addrs.size()) {
+          num_pushs_pending_ -= std::min<unsigned int>(num_pushs_pending_, words.size() - skip - mem_addrs.size());
+        }
+      } else if (words.size() > mem_addrs.size()) {
+        cout << "WARNING: AttachBD: got more words than expected from memory " << static_cast<unsigned int>(mem_id) << endl;
+      }
+      num_mismatches += CountMismatches(skip);
+    }
+  }
+
+  return num_mismatches;
+}
+
+void Driver::ResendBDRegisters(unsigned int core_id) {
+  for (auto reg_id : kBDPars_.GetBDRegs()) {
+    // PauseTraffic()/ResumeTraffic() already sent these
+    if (std::find(kTrafficRegs.begin(), kTrafficRegs.end(), reg_id) != kTrafficRegs.end()) continue;
+
+    std::pair<const BDWord, bool> reg = bd_state_.at(core_id).GetReg(reg_id);
+    if (reg.second) {
+      SetBDRegister(core_id, reg_id, reg.first, false);
+    }
+  }
+
+  // same as SetDACCount(), the last DAC write needs two more behind it
+  std::pair<const BDWord, bool> unused = bd_state_.at(core_id).GetReg(bdpars::BDHornEP::DAC_UNUSED);
+  if (unused.second) {
+    SetBDRegister(core_id, bdpars::BDHornEP::DAC_UNUSED, unused.first, false);
+    SetBDRegister(core_id, bdpars::BDHornEP::DAC_UNUSED, unused.first, false);
   }
+  Flush();
+}
+
+void Driver::RebuildMemAllocs(unsigned int core_id) {
+  const BDState &state = bd_state_.at(core_id);
+  const std::unordered_map<bdpars::BDMemId, std::vector<BDWord>, EnumClassHash> defaults = {
+    {bdpars::BDMemId::AM, GetDefaultAMEntries()},
+    {bdpars::BDMemId::MM, GetDefaultMMEntries()},
+    {bdpars::BDMemId::TAT0, GetDefaultTAT0Entries()},
+    {bdpars::BDMemId::TAT1, GetDefaultTAT1Entries()}};
+
+  for (auto &it : mem_allocs_.at(core_id)) {
+    const std::vector<BDWord> &words = *state.GetMem(it.first);
+    const std::vector<BDWord> &default_words = defaults.at(it.first);
+    MemAllocator &alloc = it.second;
+    alloc.Clear();
+
+    // claim each run of entries that InitBD() didn't leave that way
+    unsigned int run_start = 0;
+    for (unsigned int addr = 0; addr <= words.size(); addr++) {
+      bool used = addr < words.size() && state.IsMemValid(it.first, addr) && words[addr] != default_words[addr];
+      if (!used) {
+        if (addr > run_start) alloc.Reserve(run_start, addr - run_start, true);
+        run_start = addr + 1;
+      }
+    }
+  }
+  staged_AM_dump_words_[core_id] = 0;
 }
 
 void Driver::ClearOutputs() {
   std::vector<uint8_t> up_eps = kBDPars_.GetUpEPs();
-  for (auto& it : up_eps) {
-    dec_bufs_out_.at(it)->PopAll();
+  for (auto& core_bufs : dec_bufs_out_) {
+    for (auto& it : up_eps) {
+      core_bufs.at(it)->PopAll();
+    }
   }
 }
 
 void Driver::InitFIFO(unsigned int core_id) {
+  InitFIFOs({core_id});
+}
 
-  PauseTraffic(core_id);
+void Driver::InitFIFOs(const std::vector<unsigned int> &core_ids) {
+
+  for (auto core_id : core_ids) {
+    PauseTraffic(core_id);
+  }
 
   // turn post-FIFO dumps on, in case you want to watch
   //SetToggle(core_id , bdpars::BDHornEP::TOGGLE_POST_FIFO0 , false, true);
@@ -400,126 +753,979 @@ void Driver::InitFIFO(unsigned int core_id) {
   //cout << "configured FIFO valves for dump" << endl;
 
   // make FIFO_HT head = tail (doesn't matter what you send)
-  SendToEP(core_id, bdpars::BDHornEP::INIT_FIFO_HT, {0});
+  for (auto core_id : core_ids) {
+    SendToEP(core_id, bdpars::BDHornEP::INIT_FIFO_HT, {0});
+  }
+  Flush();
+
+
+  // send all tag values to DCT FIF0 to dirty them so they flush
+  std::vector<BDWord> all_tag_vals;
+  for (unsigned int i = 0; i < kBDPars_.mem_info_.at(bdpars::BDMemId::FIFO_DCT).size; i++) {
+    all_tag_vals.push_back(PackWord<FIFOInputTag>({{FIFOInputTag::TAG, i}}));
+  }
+  for (auto core_id : core_ids) {
+    SendToEP(core_id, bdpars::BDHornEP::INIT_FIFO_DCT, all_tag_vals);
+  }
+  Flush();
+
+  // resume traffic will wait for the traffic drain timer before turning traffic regs back on.
+  // The cores flush their FIFOs at the same time, one wait covers all of them
+  std::this_thread::sleep_for(std::chrono::microseconds(1000000));
+
+  for (auto core_id : core_ids) {
+    ResumeTraffic(core_id);
+  }
+
+  // turn traffic on, dumps off
+  //SetToggle(core_id , bdpars::BDHornEP::TOGGLE_POST_FIFO0 , true, true);
+  //SetToggle(core_id , bdpars::BDHornEP::TOGGLE_POST_FIFO1 , true, true);
+  //cout << "fifo valves configured to pass traffic"  << endl;
+}
+
+
+int Driver::Start() {
+  // start all worker threads
+  enc_->Start();
+  dec_->Start();
+  feeder_->Start();
+  cout << "enc and dec started" << endl;
+
+  int comm_state = 0;
+
+#ifdef BD_COMM_TYPE_OPALKELLY
+  // Initialize Opal Kelly Board, unless a subclass swapped in another comm (e.g. ReplayDriver)
+  comm::CommOK * ok_comm = dynamic_cast<comm::CommOK*>(comm_);
+  if (ok_comm != nullptr && kBDPars_.NumCores > 1) {
+    // the router FPGA doesn't send UPSTREAM_CORE words yet, upstream traffic couldn't be told apart
+    cout << "WARNING: Driver::Start: the FPGA only supports 1 core, not " << kBDPars_.NumCores << endl;
+    comm_state = -1;
+  } else if (ok_comm != nullptr) {
+    comm_state = ok_comm->Init(ok_pars_.ok_bitfile, ok_pars_.ok_serial);
+  }
+#endif
+
+  if (comm_state >= 0) {
+    comm_->StartStreaming();
+  }
+
+  return comm_state;
+}
+
+void Driver::Stop() {
+  feeder_->Stop();
+  enc_->Stop();
+  // held timed traffic would go out late after a restart
+  uint64_t num_dropped = enc_->ClearHeld();
+  if (num_dropped > 0) {
+    cout << "WARNING: Driver::Stop: dropped " << num_dropped << " blocks of timed traffic the FPGA wasn't ready for" << endl;
+  }
+  dec_->Stop();
+  comm_->StopStreaming();
+}
+
+void Driver::Flush() {
+  FlushQueues(false);
+}
+
+void Driver::FlushStreamed() {
+  FlushQueues(true);
+}
+
+void Driver::FlushQueues(bool stream_timed) {
+
+  // pushes a special ep_code
+
+  // XXX note that the order that the user makes timed vs sequenced downstream calls is lost!
+  //
+  // If I call:
+  // SendSpikes(), SetMem(), SendSpikes(), Flush()
+  // there's no guarantee that the memory is going to be set after the first batch of spikes is sent
+  //
+  // If you really want that, do this:
+  // SendSpikes(), Flush(),
+  // SetMem(), Flush(),
+  // SendSpikes(), Flush()
+  //
+  // The order of sequenced calls is conserved, and, of course, the timing is correct
+  //
+  // If I call:
+  // SendSpikes(a), SetMem(x), SendSpikes(b), SetMem(y), Flush()
+  //
+  // then SetMem(x) is guaranteed to occur before SetMem(y)
+  // and the traffic of SendSpikes(a) is interleaved with SendSpikes(b) as necessary
+
+
+  // sequenced traffic first, many sequenced commands are treated as "ASAP".
+  // It takes the encoder's priority lane, so it also gets ahead of timed traffic
+  // from earlier flushes that the encoder is still holding
+  
+  PushSequenced(enc_buf_in_);
+
+  // now send the timed traffic, through the bulk lane
+  
+  // sort times
+  std::sort(timed_queue_.begin(), timed_queue_.end()); // (operator< is defined for EncInput)
+  // now reset curr_sequence_num_ so it doesn't overflow
+  curr_sequence_num_ = 0;
+
+  auto from_queue = std::make_unique<std::vector<EncInput>>();
+  from_queue->swap(timed_queue_);
+
+  // time 0 is as soon as possible, not a schedule the FPGA could hold on.
+  // It keeps its place right behind this flush's sequenced traffic
+  // (streamed traffic all goes through the feeder, which accounts for it)
+  auto first_timed = std::find_if(from_queue->begin(), from_queue->end(), [](const EncInput &in) { return in.time > 0; });
+  if (!stream_timed && first_timed != from_queue->begin()) {
+    enc_buf_in_->Push(std::make_unique<std::vector<EncInput>>(from_queue->begin(), first_timed));
+    from_queue->erase(from_queue->begin(), first_timed);
+  }
+  const bool sent_timed = !stream_timed && from_queue->size() > 0;
+
+  if (stream_timed) {
+    feeder_->Append(std::move(*from_queue));
+  }
+
+
+  // now finish each lane that got traffic: Encoder::AppendFlush() adds the
+  // phantom DAC words that push the last words into BD (circumventing the
+  // synchronizer bug) and the encoder flush code (so it knows to pad up and finish the USB frame)
+  //
+  // The priority lane is flushed before anything goes in the bulk lane:
+  // the encoder could otherwise send the bulk lane's blocks before the
+  // priority lane's unfinished one
+
+  BDWord word = PackWord<DACWord>({{DACWord::DAC_VALUE, 1}, {DACWord::DAC_TO_ADC_CONN, 0}}); // what the phantom writes set
+  for(unsigned int _core_id = 0; _core_id < kBDPars_.NumCores; _core_id ++){
+    bd_state_[_core_id].SetReg(bdpars::BDHornEP::DAC_UNUSED, word);
+  }
+
+  std::vector<MutexBuffer<EncInput> *> lanes = {enc_buf_in_};
+  if (sent_timed) lanes.push_back(enc_bulk_buf_in_);
+  for (auto lane : lanes) {
+    auto to_send = lane == enc_bulk_buf_in_ ? std::move(from_queue) : std::make_unique<std::vector<EncInput>>();
+    Encoder::AppendFlush(to_send.get(), &kBDPars_);
+    lane->Push(std::move(to_send));
+  }
+
+}
+
+void Driver::PushSequenced(MutexBuffer<EncInput> *buf) {
+  while (!sequenced_queue_.empty()) {
+    if (capturing_image_) {
+      // record for the network image instead, minus the traffic toggles
+      for (auto &it : *sequenced_queue_.front()) {
+        if (!kBDPars_.DnEPCodeIsBDHornEP(it.FPGA_ep_code) ||
+            std::find(kTrafficRegs.begin(), kTrafficRegs.end(), static_cast<bdpars::BDHornEP>(it.FPGA_ep_code)) == kTrafficRegs.end()) {
+          image_inputs_.push_back(it);
+        }
+      }
+    } else {
+      buf->Push(std::move(sequenced_queue_.front()));
+    }
+    sequenced_queue_.pop();
+  }
+}
+
+bool Driver::SaveTimedInputs(const std::string& filename) {
+  std::sort(timed_queue_.begin(), timed_queue_.end());
+  curr_sequence_num_ = 0;
+  bool success = TimedFeeder::WriteScheduleFile(filename, timed_queue_, ns_per_unit_);
+  timed_queue_.clear();
+  return success;
+}
+
+bool Driver::StreamTimedInputsFromFile(const std::string& filename) {
+  BDTime file_ns_per_unit;
+  bool success = feeder_->OpenScheduleFile(filename, &file_ns_per_unit);
+  if (success && file_ns_per_unit != ns_per_unit_) {
+    cout << "WARNING: Driver::StreamTimedInputsFromFile: " << filename << " was written with " <<
+      file_ns_per_unit << " ns per FPGA time unit, currently " << ns_per_unit_ << ". Input times will be off" << endl;
+  }
+  return success;
+}
+
+void Driver::BeginNetworkImage() {
+  assert(!capturing_image_ && "called BeginNetworkImage twice before calling EndNetworkImage");
+  Flush(); // anything already queued goes out now, not into the image
+
+  capturing_image_ = true;
+  image_inputs_.clear();
+  image_start_states_.clear();
+  for (auto &it : bd_state_) {
+    image_start_states_.push_back(it.Snapshot());
+  }
+  image_AM_dump_words_.assign(kBDPars_.NumCores, 0);
+}
+
+NetworkImage Driver::EndNetworkImage() {
+  assert(capturing_image_ && "called EndNetworkImage before calling BeginNetworkImage");
+  Flush(); // picks up whatever's still queued
+
+  NetworkImage image;
+  image.blocks = Encoder::EncodeBlocks(image_inputs_, GetBDPars());
+  image.num_AM_dump_words = image_AM_dump_words_;
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    image.states.push_back(bd_state_[i].Snapshot());
+    // none of it was sent
+    bd_state_[i].Restore(image_start_states_[i]);
+    InvalidateSGsSent(i);
+  }
+
+  capturing_image_ = false;
+  image_inputs_.clear();
+  image_start_states_.clear();
+  return image;
+}
+
+void Driver::LoadNetworkImage(const NetworkImage &image) {
+  assert(!capturing_image_ && "can't load a network image while capturing one");
+  assert(image.states.size() == kBDPars_.NumCores);
+
+  // one pause for the whole load
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    PauseTraffic(i);
+  }
+
+  for (auto &it : image.blocks) {
+    enc_->PushEncoded(std::make_unique<std::vector<EncOutput>>(it));
+  }
+
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    std::vector<bool> resume_state = last_traffic_state_[i];
+    last_traffic_state_[i] = {};
+
+    bd_state_[i].Restore(image.states[i]);
+    InvalidateSGsSent(i);
+
+    // toggles the image doesn't set go back to what they were
+    unsigned int j = 0;
+    for (auto& reg_id : kTrafficRegs) {
+      bool traffic_en, dump_en, reg_valid;
+      std::tie(traffic_en, dump_en, reg_valid) = bd_state_[i].GetToggle(reg_id);
+      if (!reg_valid) {
+        traffic_en = resume_state[j];
+        dump_en = false;
+      }
+      SetToggle(i, reg_id, traffic_en, dump_en, false);
+      j++;
+    }
+  }
   Flush();
 
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    if (image.num_AM_dump_words[i] > 0) {
+      SinkAMDump(i, image.num_AM_dump_words[i]);
+    }
+  }
+}
+
+bool Driver::LoadNetworkImage(const std::string &filename) {
+  NetworkImage image;
+  if (!image.Load(filename, GetBDPars())) {
+    return false;
+  }
+  LoadNetworkImage(image);
+  return true;
+}
+
+void Driver::ClearStreamedInputs() {
+  feeder_->Clear();
+  enc_->ClearHeld();
+  // some of the dropped inputs may have been SG updates
+  for (unsigned int i = 0; i < kBDPars_.NumCores; i++) {
+    InvalidateSGsSent(i);
+  }
+}
+
+void Driver::SetStreamWindow(BDTime window_ns) {
+  stream_window_ns_ = window_ns;
+  feeder_->SetWindow(NsToUnits(window_ns));
+}
+
+void Driver::SetBulkLead(BDTime lead_ns) {
+  bulk_lead_ns_ = lead_ns;
+  // a lead shorter than a time unit would hold everything
+  enc_->SetBulkLead(lead_ns > 0 ? std::max<BDTime>(NsToUnits(lead_ns), 1) : 0);
+}
+
+TimedFeederStats Driver::GetStreamStats() {
+  TimedFeederStats stats = feeder_->GetStats();
+  const int64_t ns_per_unit = static_cast<int64_t>(ns_per_unit_);
+  stats.fpga_time      = UnitsToNs(stats.fpga_time);
+  stats.released_until = UnitsToNs(stats.released_until);
+  stats.lead          *= ns_per_unit;
+  stats.max_lead      *= ns_per_unit;
+  stats.max_lag       *= ns_per_unit;
+  return stats;
+}
+
+void Driver::AddSpikeTrains(
+    unsigned int core_id,
+    const std::vector<BDWord>& tags,
+    SpikeTrainType type,
+    const std::vector<BDTime>& times,
+    const std::vector<std::vector<double>>& rates,
+    BDTime stop_time) {
+
+  assert(tags.size() == rates.size());
+
+  std::vector<BDTime> times_units;
+  for (auto& it : times) {
+    times_units.push_back(NsToUnits(it));
+  }
+
+  // Hz -> spikes per time unit
+  const double units_per_sec = 1e9 / ns_per_unit_;
+  std::vector<double> rates_units;
+  for (unsigned int i = 0; i < tags.size(); i++) {
+    assert(rates[i].size() == times.size());
+    rates_units.resize(rates[i].size());
+    for (unsigned int j = 0; j < rates[i].size(); j++) {
+      rates_units[j] = rates[i][j] / units_per_sec;
+    }
+    spike_gen_->AddTrain(core_id, tags[i], type, times_units, rates_units, NsToUnits(stop_time));
+  }
+}
+
+SpikeTrainGeneratorStats Driver::GetSpikeTrainStats() {
+  SpikeTrainGeneratorStats stats = spike_gen_->GetStats();
+  stats.fpga_time       = UnitsToNs(stats.fpga_time);
+  stats.generated_until = UnitsToNs(stats.generated_until);
+  stats.lead           *= static_cast<int64_t>(ns_per_unit_);
+  return stats;
+}
+
+namespace {
+
+// decoder-thread-only state of a closed-loop callback, reused between calls
+struct ClosedLoopState {
+  std::vector<BDWord> words;
+  std::vector<BDTime> times;
+  std::vector<BDWord> response_tags;
+};
+
+}  // anonymous namespace
+
+void Driver::SetClosedLoopCallback(unsigned int core_id, uint8_t up_ep_code, ClosedLoopCallback callback, bool consume) {
+  assert(kBDPars_.Up_EP_size_[up_ep_code] > 0 && "unused upstream ep code");
+
+  const uint8_t RI_code = kBDPars_.DnEPCodeFor(bdpars::BDHornEP::RI);
+  auto state = std::make_shared<ClosedLoopState>();
+
+  dec_->SetOutputHook(core_id, up_ep_code, "closed_loop", [this, core_id, callback, consume, RI_code, state]
+      (const std::vector<DecOutput>& outputs) {
+
+    state->words.clear();
+    state->times.clear();
+    for (auto& it : outputs) {
+      state->words.push_back(it.payload);
+      state->times.push_back(UnitsToNs(it.time));
+    }
+
+    if (state->words.size() > 0) {
+      state->response_tags.clear();
+      callback(state->words, state->times, &state->response_tags);
+
+      if (state->response_tags.size() > 0) {
+        // tags fit in one FPGA word, no serialization needed
+        auto to_send = std::make_unique<std::vector<EncInput>>();
+        for (auto& tag : state->response_tags) {
+          EncInput in;
+          in.core_id      = core_id;
+          in.FPGA_ep_code = RI_code;
+          in.payload      = tag;
+          in.time         = 0;
+          in.sequence_num = 0;
+          to_send->push_back(in);
+        }
+
+        // finish the block so the tags go out now
+        Encoder::AppendFlush(to_send.get(), &kBDPars_);
+
+        enc_buf_in_->Push(std::move(to_send));
+      }
+    }
+
+    return consume;
+  });
+}
+
+bool Driver::StartBroadcast(const std::string& name, unsigned int capacity) {
+  StopBroadcast();
+  ShmRingWriter * ring = new ShmRingWriter(name, capacity, ns_per_unit_);
+  if (!ring->IsOpen()) {
+    delete ring;
+    return false;
+  }
+  broadcast_ = ring;
+  dec_->SetBroadcast(broadcast_);
+  return true;
+}
+
+void Driver::StopBroadcast() {
+  if (broadcast_ != nullptr) {
+    dec_->SetBroadcast(nullptr); // decoder is done with it once this returns
+    delete broadcast_;
+    broadcast_ = nullptr;
+  }
+}
+
+bool Driver::StartRateMap(unsigned int core_id, BDTime tau_ns, BDTime refresh_ns, const std::string& shm_name) {
+  if (tau_ns == 0) {
+    cout << "WARNING: StartRateMap: the time constant must be positive" << endl;
+    return false;
+  }
+  StopRateMap(core_id);
+
+  std::vector<unsigned int> aer_to_xy(kBDPars_.NumNeurons);
+  for (unsigned int i = 0; i < aer_to_xy.size(); i++) {
+    aer_to_xy[i] = kBDPars_.GetSomaXYAddr(i);
+  }
+  auto rate_map = std::make_shared<RateMap>(aer_to_xy, 64, tau_ns, refresh_ns, ns_per_unit_, shm_name);
+  if (!rate_map->IsOpen()) return false;
+
+  std::unique_lock<std::mutex> lock(rate_map_lock_);
+  rate_maps_.at(core_id) = rate_map;
+  dec_->SetRateMap(core_id, rate_map.get());
+  return true;
+}
+
+void Driver::StopRateMap(unsigned int core_id) {
+  std::unique_lock<std::mutex> lock(rate_map_lock_);
+  if (rate_maps_.at(core_id)) {
+    dec_->SetRateMap(core_id, nullptr); // decoder is done with it once this returns
+    rate_maps_.at(core_id).reset();
+  }
+}
+
+std::pair<BDTime, std::vector<float>> Driver::GetRateMap(unsigned int core_id) {
+  std::shared_ptr<RateMap> rate_map;
+  {
+    std::unique_lock<std::mutex> lock(rate_map_lock_);
+    rate_map = rate_maps_.at(core_id);
+  }
+  std::pair<BDTime, std::vector<float>> time_rates;
+  if (!rate_map) {
+    cout << "WARNING: GetRateMap: core " << core_id << " has no rate map, see StartRateMap()" << endl;
+  } else if (!rate_map->Read(&time_rates.first, &time_rates.second)) {
+    time_rates.second.clear();
+  }
+  return time_rates;
+}
+
+void Driver::SetRetention(unsigned int core_id, uint8_t up_ep_code, BDTime horizon_ns) {
+  assert(kBDPars_.Up_EP_size_[up_ep_code] > 0 && "unused upstream ep code");
+
+  std::unique_lock<std::mutex> lock(retention_lock_);
+  auto& core_stores = retention_stores_.at(core_id);
+  auto it = core_stores.find(up_ep_code);
+  if (horizon_ns > 0) {
+    if (it != core_stores.end()) {
+      it->second->SetHorizon(NsToUnits(horizon_ns));
+    } else {
+      OutputStore * store = new OutputStore(NsToUnits(horizon_ns));
+      core_stores.insert({up_ep_code, store});
+      dec_->SetStore(core_id, up_ep_code, store);
+    }
+  } else if (it != core_stores.end()) {
+    dec_->SetStore(core_id, up_ep_code, nullptr); // decoder is done with it once this returns
+    delete it->second;
+    core_stores.erase(it);
+  }
+}
+
+OutputStore * Driver::GetRetentionStore(unsigned int core_id, uint8_t up_ep_code) {
+  auto& core_stores = retention_stores_.at(core_id);
+  auto it = core_stores.find(up_ep_code);
+  if (it == core_stores.end()) {
+    cout << "WARNING: up ep " << static_cast<unsigned int>(up_ep_code) << " of core " << core_id <<
+      " isn't retained, call SetRetention() first" << endl;
+    return nullptr;
+  }
+  return it->second;
+}
+
+std::pair<std::vector<BDWord>, std::vector<BDTime>>
+  Driver::GetRetained(unsigned int core_id, uint8_t up_ep_code, BDTime t0_ns, BDTime t1_ns) {
+
+  std::unique_lock<std::mutex> lock(retention_lock_);
+  OutputStore * store = GetRetentionStore(core_id, up_ep_code);
+  if (store == nullptr) return {};
+
+  // an output at unit u happened at u * ns_per_unit_, round the bounds up to whole units
+  auto recvd = store->Query(NsToUnits(t0_ns + ns_per_unit_ - 1), NsToUnits(t1_ns + ns_per_unit_ - 1));
+  for (auto& it : recvd.second) {
+    it = UnitsToNs(it);
+  }
+  return recvd;
+}
+
+std::pair<std::vector<uint32_t>, unsigned int> Driver::GetRetainedBinned(
+    unsigned int core_id, uint8_t up_ep_code, BDTime t0_ns, BDTime bin_ns, unsigned int num_bins) {
+
+  std::unique_lock<std::mutex> lock(retention_lock_);
+  OutputStore * store = GetRetentionStore(core_id, up_ep_code);
+  if (store == nullptr) return {};
+
+  if (bin_ns < ns_per_unit_ || bin_ns % ns_per_unit_ != 0) {
+    cout << "WARNING: GetRetainedBinned: bin_ns (" << bin_ns << ") isn't a multiple of the FPGA time unit (" <<
+      ns_per_unit_ << " ns), bins will be rounded down to one" << endl;
+  }
+  const BDTime bin_units = std::max<BDTime>(NsToUnits(bin_ns), 1);
+  const BDTime t0_units = NsToUnits(t0_ns + ns_per_unit_ - 1);
+
+  std::function<unsigned int(BDWord)> key;
+  unsigned int num_keys;
+  if (up_ep_code == kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::NRNI)) {
+    num_keys = bdpars::BDPars::NumNeurons;
+    key = [this](BDWord word) {
+      unsigned int aer_addr = GetField(word, OutputSpike::NEURON_ADDRESS);
+      return aer_addr < bdpars::BDPars::NumNeurons ? kBDPars_.GetSomaXYAddr(aer_addr) : bdpars::BDPars::NumNeurons;
+    };
+  } else if (up_ep_code == kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::RO_ACC) ||
+             up_ep_code == kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::RO_TAT)) {
+    num_keys = 1 << FieldWidth(AccOutputTag::TAG);
+    key = [](BDWord word) { return static_cast<unsigned int>(GetField(word, AccOutputTag::TAG)); };
+  } else {
+    num_keys = 1;
+    key = [](BDWord word) { return 0u; };
+  }
+
+  return {store->Bin(t0_units, num_bins, bin_units, key, num_keys), num_keys};
+}
+
+void Driver::ReleaseRetained(unsigned int core_id, uint8_t up_ep_code, BDTime t_ns) {
+  std::unique_lock<std::mutex> lock(retention_lock_);
+  OutputStore * store = GetRetentionStore(core_id, up_ep_code);
+  if (store != nullptr) {
+    store->Release(NsToUnits(t_ns + ns_per_unit_ - 1));
+  }
+}
+
+Decoder::OutputFilter * Driver::GetSubscription(unsigned int core_id, uint8_t up_ep_code) {
+  auto& core_subs = subscriptions_.at(core_id);
+  auto it = core_subs.find(up_ep_code);
+  if (it != core_subs.end()) {
+    return &it->second;
+  }
+
+  Decoder::OutputFilter filter;
+  if (up_ep_code == kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::NRNI)) {
+    filter.key_shift = FieldShift(OutputSpike::NEURON_ADDRESS);
+    filter.key_width = FieldWidth(OutputSpike::NEURON_ADDRESS);
+  } else if (up_ep_code == kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::RO_ACC)) {
+    filter.key_shift = FieldShift(AccOutputTag::TAG);
+    filter.key_width = FieldWidth(AccOutputTag::TAG);
+  } else if (up_ep_code == kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::RO_TAT)) {
+    filter.key_shift = FieldShift(TATOutputTag::TAG);
+    filter.key_width = FieldWidth(TATOutputTag::TAG);
+  } else if (up_ep_code == kBDPars_.UpEPCodeFor(bdpars::FPGAOutputEP::SF_OUTPUT)) {
+    filter.key_shift = FieldShift(FPGASFWORD::FILTIDX);
+    filter.key_width = FieldWidth(FPGASFWORD::FILTIDX);
+  } else {
+    cout << "WARNING: up ep " << static_cast<unsigned int>(up_ep_code) << " can't be filtered, " <<
+      "only NRNI, RO_ACC, RO_TAT and SF_OUTPUT can" << endl;
+    return nullptr;
+  }
+  filter.keep.assign(((1u << filter.key_width) + 63) / 64, ~static_cast<uint64_t>(0));
+  return &core_subs.insert({up_ep_code, filter}).first->second;
+}
+
+bool Driver::SetSubscription(unsigned int core_id, uint8_t up_ep_code, const KeyRanges& keep, bool before_taps) {
+  std::unique_lock<std::mutex> lock(subscription_lock_);
+  Decoder::OutputFilter * filter = GetSubscription(core_id, up_ep_code);
+  if (filter == nullptr) return false;
+
+  filter->before_taps = before_taps;
+  const unsigned int num_keys = 1u << filter->key_width;
+  std::fill(filter->keep.begin(), filter->keep.end(), 0);
+  for (auto& range : keep) {
+    for (unsigned int key = range.first; key < std::min(range.second, num_keys); key++) {
+      filter->keep[key / 64] |= static_cast<uint64_t>(1) << (key % 64);
+    }
+  }
+  dec_->SetOutputFilter(core_id, up_ep_code, *filter);
+  return true;
+}
+
+bool Driver::RouteSubscription(unsigned int core_id, uint8_t up_ep_code, const std::string& queue, const KeyRanges& keys) {
+  std::unique_lock<std::mutex> lock(subscription_lock_);
+  Decoder::OutputFilter * filter = GetSubscription(core_id, up_ep_code);
+  if (filter == nullptr) return false;
+
+  auto queue_it = subscription_queues_.find(queue);
+  if (queue_it == subscription_queues_.end()) {
+    queue_it = subscription_queues_.insert({queue, new MutexBuffer<DecOutput>()}).first;
+  }
+
+  // route index of the queue for this ep
+  auto route_it = std::find(filter->queues.begin(), filter->queues.end(), queue_it->second);
+  if (route_it == filter->queues.end()) {
+    if (filter->queues.size() == 255) {
+      cout << "WARNING: RouteSubscription: up ep " << static_cast<unsigned int>(up_ep_code) <<
+        " already goes to 255 queues, can't add " << queue << endl;
+      return false;
+    }
+    route_it = filter->queues.insert(filter->queues.end(), queue_it->second);
+  }
+  const uint8_t route = route_it - filter->queues.begin() + 1;
+
+  const unsigned int num_keys = 1u << filter->key_width;
+  filter->route.resize(num_keys, 0);
+  for (auto& range : keys) {
+    for (unsigned int key = range.first; key < std::min(range.second, num_keys); key++) {
+      filter->route[key] = route;
+    }
+  }
+  dec_->SetOutputFilter(core_id, up_ep_code, *filter);
+  return true;
+}
+
+void Driver::ClearSubscription(unsigned int core_id, uint8_t up_ep_code) {
+  std::unique_lock<std::mutex> lock(subscription_lock_);
+  subscriptions_.at(core_id).erase(up_ep_code);
+  dec_->ClearOutputFilter(core_id, up_ep_code);
+}
+
+std::pair<std::vector<BDWord>, std::vector<BDTime>> Driver::RecvFromQueue(const std::string& queue, unsigned int timeout_us) {
+  MutexBuffer<DecOutput> * buf;
+  {
+    std::unique_lock<std::mutex> lock(subscription_lock_);
+    auto it = subscription_queues_.find(queue);
+    if (it == subscription_queues_.end()) {
+      cout << "WARNING: RecvFromQueue: no queue named " << queue << ", see RouteSubscription()" << endl;
+      return {};
+    }
+    buf = it->second; // queues live as long as the Driver
+  }
+  return RecvFromBuf(buf, timeout_us);
+}
+
+void Driver::SetOutputTable(unsigned int core_id, const std::vector<int>& outputs, const std::vector<unsigned int>& dims) {
+  assert(outputs.size() == dims.size());
+  std::unique_lock<std::mutex> lock(translation_lock_);
+  translation_tables_.at(core_id).filter_outputs = outputs;
+  translation_tables_.at(core_id).filter_dims = dims;
+}
+
+void Driver::SetPoolTable(unsigned int core_id, const std::vector<int>& pools, const std::vector<unsigned int>& nrn_idxs) {
+  assert(pools.size() == nrn_idxs.size());
+  if (pools.size() > bdpars::BDPars::NumNeurons) {
+    cout << "WARNING: SetPoolTable: got " << pools.size() << " somas, only " << bdpars::BDPars::NumNeurons << " are used" << endl;
+  }
+  std::unique_lock<std::mutex> lock(translation_lock_);
+  translation_tables_.at(core_id).soma_pools = pools;
+  translation_tables_.at(core_id).soma_nrn_idxs = nrn_idxs;
+}
+
+namespace {
+
+// <v> reordered so element i is <v>[<order>[i]]
+template <class T>
+std::vector<T> Permute(const std::vector<T>& v, const std::vector<unsigned int>& order) {
+  std::vector<T> permuted;
+  permuted.reserve(order.size());
+  for (auto& it : order) {
+    permuted.push_back(v[it]);
+  }
+  return permuted;
+}
+
+}  // anonymous namespace
+
+std::vector<unsigned int> Driver::GroupOrder(const std::vector<int>& ids) {
+  int max_id = -1;
+  for (auto& it : ids) max_id = std::max(max_id, it);
+
+  // where each group starts, then fill them in
+  std::vector<unsigned int> starts(max_id + 2, 0);
+  for (auto& it : ids) starts[it + 1]++;
+  for (unsigned int i = 1; i < starts.size(); i++) starts[i] += starts[i - 1];
+
+  std::vector<unsigned int> order(ids.size());
+  for (unsigned int i = 0; i < ids.size(); i++) {
+    order[starts[ids[i]]++] = i;
+  }
+  return order;
+}
+
+std::tuple<std::vector<BDTime>, std::vector<int>, std::vector<unsigned int>, std::vector<int>>
+  Driver::RecvTranslatedOutputs(unsigned int core_id, bool group, unsigned int timeout_us) {
+
+  std::vector<BDWord> words;
+  std::vector<BDTime> raw_times;
+  std::tie(words, raw_times) = RecvFromEP(core_id, bdpars::FPGAOutputEP::SF_OUTPUT, timeout_us);
+
+  std::vector<BDTime> times;
+  std::vector<int> outputs;
+  std::vector<unsigned int> dims;
+  std::vector<int> counts;
+  times.reserve(words.size());
+  outputs.reserve(words.size());
+  dims.reserve(words.size());
+  counts.reserve(words.size());
+
+  unsigned int num_implausible = 0;
+  {
+    std::unique_lock<std::mutex> lock(translation_lock_);
+    const TranslationTables& table = translation_tables_.at(core_id);
+    if (table.filter_outputs.size() == 0 && words.size() > 0) {
+      cout << "WARNING: RecvTranslatedOutputs: no output table for core " << core_id << ", see SetOutputTable()" << endl;
+    }
+
+    const unsigned int state_width = FieldWidth(FPGASFWORD::STATE);
+    for (unsigned int i = 0; i < words.size(); i++) {
+      unsigned int filt_idx = GetField(words[i], FPGASFWORD::FILTIDX);
+      if (filt_idx >= table.filter_outputs.size() || table.filter_outputs[filt_idx] < 0) continue;
+
+      // the state is a signed count
+      int64_t count = GetField(words[i], FPGASFWORD::STATE);
+      if (count >= (int64_t(1) << (state_width - 1))) {
+        count -= int64_t(1) << state_width;
+      }
+      if (std::abs(count) >= driverpars::SF_MAX_PLAUSIBLE_COUNT) {
+        num_implausible++;
+        count = 0;
+      }
+
+      times.push_back(raw_times[i]);
+      outputs.push_back(table.filter_outputs[filt_idx]);
+      dims.push_back(table.filter_dims[filt_idx]);
+      counts.push_back(count);
+    }
+  }
+
+  if (num_implausible > 0) {
+    cout << "WARNING: RecvTranslatedOutputs: zeroed " << num_implausible <<
+      " absurdly large spike filter values (probably sticky bits, or abuse of tag filter)" << endl;
+  }
+
+  if (group) {
+    std::vector<unsigned int> order = GroupOrder(outputs);
+    return std::make_tuple(Permute(times, order), Permute(outputs, order), Permute(dims, order), Permute(counts, order));
+  }
+  return std::make_tuple(times, outputs, dims, counts);
+}
+
+std::tuple<std::vector<BDTime>, std::vector<int>, std::vector<unsigned int>>
+  Driver::RecvTranslatedSpikes(unsigned int core_id, bool group, unsigned int timeout_us) {
+
+  std::vector<BDWord> words;
+  std::vector<BDTime> raw_times;
+  std::tie(words, raw_times) = RecvFromEP(core_id, bdpars::BDFunnelEP::NRNI, timeout_us);
+
+  std::vector<BDTime> times;
+  std::vector<int> pools;
+  std::vector<unsigned int> nrn_idxs;
+  times.reserve(words.size());
+  pools.reserve(words.size());
+  nrn_idxs.reserve(words.size());
+
+  unsigned int num_unmapped = 0;
+  {
+    std::unique_lock<std::mutex> lock(translation_lock_);
+    const TranslationTables& table = translation_tables_.at(core_id);
+    for (unsigned int i = 0; i < words.size(); i++) {
+      BDWord aer_addr = words[i]; // NRNI words are just the AER address
+      if (aer_addr >= table.soma_pools.size() || table.soma_pools[aer_addr] < 0) {
+        num_unmapped++;
+        continue;
+      }
+      times.push_back(raw_times[i]);
+      pools.push_back(table.soma_pools[aer_addr]);
+      nrn_idxs.push_back(table.soma_nrn_idxs[aer_addr]);
+    }
+  }
 
-  // send all tag values to DCT FIF0 to dirty them so they flush
-  std::vector<BDWord> all_tag_vals;
-  for (unsigned int i = 0; i < kBDPars_.mem_info_.at(bdpars::BDMemId::FIFO_DCT).size; i++) {
-    all_tag_vals.push_back(PackWord<FIFOInputTag>({{FIFOInputTag::TAG, i}}));
+  if (num_unmapped > 0) {
+    cout << "WARNING: RecvTranslatedSpikes: dropped " << num_unmapped <<
+      " spikes from neurons in no pool (probably sticky bits)" << endl;
   }
-  SendToEP(core_id, bdpars::BDHornEP::INIT_FIFO_DCT, all_tag_vals);
-  Flush();
 
-  // resume traffic will wait for the traffic drain timer before turning traffic regs back on
-  std::this_thread::sleep_for(std::chrono::microseconds(1000000));
+  if (group) {
+    std::vector<unsigned int> order = GroupOrder(pools);
+    return std::make_tuple(Permute(times, order), Permute(pools, order), Permute(nrn_idxs, order));
+  }
+  return std::make_tuple(times, pools, nrn_idxs);
+}
 
-  ResumeTraffic(core_id);
+TagBinner Driver::RecvBinnedTags(unsigned int core_id, const std::vector<BDTime>& bin_edges, unsigned int timeout_us) {
+  TagBinner binner(bin_edges);
+  RecvTagsInto(core_id, &binner, timeout_us);
+  return binner;
+}
 
-  // turn traffic on, dumps off
-  //SetToggle(core_id , bdpars::BDHornEP::TOGGLE_POST_FIFO0 , true, true);
-  //SetToggle(core_id , bdpars::BDHornEP::TOGGLE_POST_FIFO1 , true, true);
-  //cout << "fifo valves configured to pass traffic"  << endl;
+TagBinner Driver::RecvBinnedTags(unsigned int core_id, BDTime t0_ns, BDTime bin_ns, unsigned int num_bins, unsigned int timeout_us) {
+  TagBinner binner(t0_ns, bin_ns, num_bins);
+  RecvTagsInto(core_id, &binner, timeout_us);
+  return binner;
 }
 
+void Driver::RecvTagsInto(unsigned int core_id, TagBinner *binner, unsigned int timeout_us) {
+  auto recvd = RecvFromEPs(core_id, {
+      kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::RO_ACC),
+      kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::RO_TAT)}, timeout_us);
+  binner->Add(std::get<1>(recvd), std::get<2>(recvd));
+}
 
-int Driver::Start() {
-  // start all worker threads
-  enc_->Start();
-  dec_->Start();
-  cout << "enc and dec started" << endl;
+void Driver::StartTagBinning(unsigned int core_id, const std::vector<BDTime>& bin_edges) {
+  std::unique_lock<std::mutex> lock(tag_binning_lock_);
+  auto binning = std::make_shared<TagBinning>(bin_edges);
+  tag_binnings_.at(core_id) = binning;
 
-  int comm_state = 0;
+  const BDTime ns_per_unit = ns_per_unit_;
+  for (bdpars::BDFunnelEP ep : {bdpars::BDFunnelEP::RO_ACC, bdpars::BDFunnelEP::RO_TAT}) {
+    dec_->SetOutputHook(core_id, kBDPars_.UpEPCodeFor(ep), "tag_binning", [binning, ns_per_unit](const std::vector<DecOutput>& outputs) {
+      std::unique_lock<std::mutex> lock(binning->lock);
+      binning->binner.Add(outputs, ns_per_unit);
+      return true; // binned tags don't pile up in the output buffers
+    });
+  }
+}
 
-#ifdef BD_COMM_TYPE_OPALKELLY
-  // Initialize Opal Kelly Board
-  comm_state = static_cast<comm::CommOK*>(comm_)->Init(ok_pars_.ok_bitfile, ok_pars_.ok_serial);
-#endif
+TagBinner Driver::GetTagBinning(unsigned int core_id, bool stop) {
+  std::unique_lock<std::mutex> lock(tag_binning_lock_);
+  std::shared_ptr<TagBinning> binning = tag_binnings_.at(core_id);
+  if (!binning) {
+    cout << "WARNING: GetTagBinning: core " << core_id << " isn't binning tags, see StartTagBinning()" << endl;
+    return TagBinner(0, 1, 1);
+  }
 
-  if (comm_state >= 0) {
-    comm_->StartStreaming();
+  if (stop) {
+    for (bdpars::BDFunnelEP ep : {bdpars::BDFunnelEP::RO_ACC, bdpars::BDFunnelEP::RO_TAT}) {
+      dec_->SetOutputHook(core_id, kBDPars_.UpEPCodeFor(ep), "tag_binning", Decoder::OutputHook());
+    }
+    tag_binnings_.at(core_id).reset();
   }
 
-  return comm_state;
+  std::unique_lock<std::mutex> binning_lock(binning->lock);
+  return binning->binner;
 }
 
-void Driver::Stop() {
-  enc_->Stop();
-  dec_->Stop();
-  comm_->StopStreaming();
-}
+bool Driver::StartHostSpikeFilters(unsigned int core_id, unsigned int decay, unsigned int increment, BDTime sample_ns, bool spikes) {
+  const unsigned int num_tags = 1 << FieldWidth(TATOutputTag::TAG);
+  const unsigned int num_filters = num_tags + (spikes ? 1 << FieldWidth(OutputSpike::NEURON_ADDRESS) : 0);
+  const BDTime sample_units = NsToUnits(sample_ns);
+  if (decay > (1u << 27) || sample_units == 0) {
+    cout << "WARNING: StartHostSpikeFilters: the decay constant is at most 2^27 (0.27 fixed point), " <<
+      "and samples must be at least one FPGA time unit apart" << endl;
+    return false;
+  }
 
-void Driver::Flush() {
+  StopHostSpikeFilters(core_id);
 
+  const unsigned int max_samples = std::max(1u, driverpars::HOST_SF_MAX_QUEUED_STATES / num_filters);
+  auto bank = std::make_shared<SpikeFilterBank>(num_filters, SpikeFilterBank::DecayFromConst(decay), increment,
+                                                units_per_HB_, sample_units, max_samples);
 
-  // pushes a special ep_code
+  std::unique_lock<std::mutex> lock(host_filter_lock_);
+  host_filter_banks_.at(core_id) = bank;
 
-  // XXX note that the order that the user makes timed vs sequenced downstream calls is lost!
-  //
-  // If I call:
-  // SendSpikes(), SetMem(), SendSpikes(), Flush()
-  // there's no guarantee that the memory is going to be set after the first batch of spikes is sent
-  //
-  // If you really want that, do this:
-  // SendSpikes(), Flush(),
-  // SetMem(), Flush(),
-  // SendSpikes(), Flush()
-  //
-  // The order of sequenced calls is conserved, and, of course, the timing is correct
-  //
-  // If I call:
-  // SendSpikes(a), SetMem(x), SendSpikes(b), SetMem(y), Flush()
-  //
-  // then SetMem(x) is guaranteed to occur before SetMem(y)
-  // and the traffic of SendSpikes(a) is interleaved with SendSpikes(b) as necessary
+  for (bdpars::BDFunnelEP ep : {bdpars::BDFunnelEP::RO_ACC, bdpars::BDFunnelEP::RO_TAT}) {
+    dec_->SetOutputHook(core_id, kBDPars_.UpEPCodeFor(ep), "host_spike_filters", [bank](const std::vector<DecOutput>& outputs) {
+      std::vector<SpikeFilterBank::Event> events(outputs.size());
+      for (unsigned int i = 0; i < outputs.size(); i++) {
+        events[i] = {outputs[i].time, static_cast<unsigned int>(GetField(outputs[i].payload, TATOutputTag::TAG)),
+                     TagBinner::DecodeCount(outputs[i].payload)};
+      }
+      bank->Queue(events);
+      return false;
+    });
+  }
+  if (spikes) {
+    dec_->SetOutputHook(core_id, kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::NRNI), "host_spike_filters", [bank, num_tags](const std::vector<DecOutput>& outputs) {
+      std::vector<SpikeFilterBank::Event> events(outputs.size());
+      for (unsigned int i = 0; i < outputs.size(); i++) {
+        events[i] = {outputs[i].time, num_tags + static_cast<unsigned int>(GetField(outputs[i].payload, OutputSpike::NEURON_ADDRESS)), 1};
+      }
+      bank->Queue(events);
+      return false;
+    });
+  }
+  // the bank applies what's been queued once it's seen everything up to the frame's HB
+  dec_->SetFrameHook(core_id, "host_spike_filters", [bank](BDTime time) { bank->Flush(time); });
+  return true;
+}
 
+void Driver::StopHostSpikeFilters(unsigned int core_id) {
+  std::unique_lock<std::mutex> lock(host_filter_lock_);
+  std::shared_ptr<SpikeFilterBank> bank = host_filter_banks_.at(core_id);
+  if (!bank) return;
 
-  // sequenced traffic first, many sequenced commands are treated as "ASAP"
-  
-  while (!sequenced_queue_.empty()) {
-    enc_buf_in_->Push(std::move(sequenced_queue_.front()));
-    sequenced_queue_.pop();
+  dec_->SetFrameHook(core_id, "host_spike_filters", Decoder::FrameHook());
+  for (bdpars::BDFunnelEP ep : {bdpars::BDFunnelEP::RO_ACC, bdpars::BDFunnelEP::RO_TAT}) {
+    dec_->SetOutputHook(core_id, kBDPars_.UpEPCodeFor(ep), "host_spike_filters", Decoder::OutputHook());
+  }
+  if (bank->GetNumFilters() > (1u << FieldWidth(TATOutputTag::TAG))) {
+    dec_->SetOutputHook(core_id, kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::NRNI), "host_spike_filters", Decoder::OutputHook());
   }
+  host_filter_banks_.at(core_id).reset();
+}
 
-  // now send the timed traffic 
-  
-  // sort times
-  std::sort(timed_queue_.begin(), timed_queue_.end()); // (operator< is defined for EncInput)
-  // now reset curr_sequence_num_ so it doesn't overflow
-  curr_sequence_num_ = 0;
+std::pair<std::vector<BDTime>, std::vector<float>> Driver::RecvHostSpikeFilterStates(unsigned int core_id) {
+  std::shared_ptr<SpikeFilterBank> bank;
+  {
+    std::unique_lock<std::mutex> lock(host_filter_lock_);
+    bank = host_filter_banks_.at(core_id);
+  }
+  std::pair<std::vector<BDTime>, std::vector<float>> times_states;
+  if (!bank) {
+    cout << "WARNING: RecvHostSpikeFilterStates: core " << core_id << " isn't filtering, see StartHostSpikeFilters()" << endl;
+    return times_states;
+  }
 
-  auto from_queue = std::make_unique<std::vector<EncInput>>();
-  from_queue->swap(timed_queue_);
+  auto samples = bank->PopSamples();
+  times_states.second.reserve(samples.size() * bank->GetNumFilters());
+  for (auto& it : samples) {
+    times_states.first.push_back(UnitsToNs(it->time));
+    times_states.second.insert(times_states.second.end(), it->states.begin(), it->states.end());
+  }
+  return times_states;
+}
 
-  enc_buf_in_->Push(std::move(from_queue));
+std::pair<BDTime, std::vector<float>> Driver::GetHostSpikeFilterSnapshot(unsigned int core_id) {
+  std::shared_ptr<SpikeFilterBank> bank;
+  {
+    std::unique_lock<std::mutex> lock(host_filter_lock_);
+    bank = host_filter_banks_.at(core_id);
+  }
+  if (!bank) {
+    cout << "WARNING: GetHostSpikeFilterSnapshot: core " << core_id << " isn't filtering, see StartHostSpikeFilters()" << endl;
+    return {0, {}};
+  }
 
+  std::shared_ptr<const SpikeFilterBank::Sample> latest = bank->GetLatest();
+  if (!latest) return {0, {}};
+  return {UnitsToNs(latest->time), latest->states};
+}
 
-  // now send two extra words
-  // Call phantom DAC to push two other words into BD to
-  // circumvent the synchronizer bug
+bool Driver::SetRealTimeMode(const RealTimeConfig& config) {
+  bool success = true;
 
-  BDWord word = PackWord<DACWord>({{DACWord::DAC_VALUE, 1}, {DACWord::DAC_TO_ADC_CONN, 0}});
-  for(unsigned int _core_id = 0; _core_id < kBDPars_.NumCores; _core_id ++){
-      SetBDRegister(_core_id, bdpars::BDHornEP::DAC_UNUSED, word, false);
-      SetBDRegister(_core_id, bdpars::BDHornEP::DAC_UNUSED, word, false);
-  }
-  while (!sequenced_queue_.empty()) {
-    enc_buf_in_->Push(std::move(sequenced_queue_.front()));
-    sequenced_queue_.pop();
+  // pinning several spinning threads to one CPU starves them
+  if (config.spin_us > 0 && config.fifo_priority > 0 &&
+      (config.comm_cpu < 0 || config.enc_cpu < 0 || config.dec_cpu < 0 ||
+       config.comm_cpu == config.enc_cpu || config.comm_cpu == config.dec_cpu || config.enc_cpu == config.dec_cpu)) {
+    cout << "WARNING: Driver::SetRealTimeMode: spinning SCHED_FIFO threads should each get their own CPU" << endl;
   }
 
-  // then the encoder flush codes (so it knows to pad up and finish the USB frame)
+  dec_buf_in_->SetSpinUs(config.spin_us);
+  enc_buf_in_->SetSpinUs(config.spin_us);
+  enc_bulk_buf_in_->SetSpinUs(config.spin_us);
+  enc_->SetSpinUs(config.spin_us);
+  enc_buf_out_->SetSpinUs(config.spin_us);
 
-  EncInput flush;
-  flush.FPGA_ep_code = EncInput::kFlushCode;
-  flush.core_id = 0; // don't care about the other fields
-  flush.payload = 0;
-  flush.time = 0;
+  success &= enc_->SetThreadConfig(config.enc_cpu, config.fifo_priority);
+  success &= dec_->SetThreadConfig(config.dec_cpu, config.fifo_priority);
+  success &= comm_->SetThreadConfig(config.comm_cpu, config.fifo_priority, config.spin_us);
 
-  auto flush_vect = std::make_unique<std::vector<EncInput>>(1, flush);
-  enc_buf_in_->Push(std::move(flush_vect));
+  if (config.lock_memory != realtime_config_.lock_memory) {
+    success &= LockProcessMemory(config.lock_memory);
+  }
 
+  realtime_config_ = config;
+  return success;
 }
 
 /// Set toggle traffic_en only, keep dump_en the same, returns previous traffic_en.
@@ -589,7 +1795,9 @@ void Driver::SetSpikeDumpState(unsigned int core_id, bool en, bool flush) {
 }
 
 void Driver::PauseTraffic(unsigned int core_id) {
+  if (capturing_image_) return; // the image load pauses once for everything
   assert(last_traffic_state_[core_id].size() == 0 && "called PauseTraffic twice before calling ResumeTraffic");
+  pause_start_[core_id] = std::chrono::high_resolution_clock::now();
   last_traffic_state_[core_id] = {};
   for (auto& reg_id : kTrafficRegs) {
     bool last_state = SetToggleTraffic(core_id, reg_id, false);
@@ -600,6 +1808,7 @@ void Driver::PauseTraffic(unsigned int core_id) {
 }
 
 void Driver::ResumeTraffic(unsigned int core_id) {
+  if (capturing_image_) return;
   assert(last_traffic_state_[core_id].size() > 0 && "called ResumeTraffic before calling PauseTraffic");
   unsigned int i = 0;
   for (auto& reg_id : kTrafficRegs) {
@@ -608,6 +1817,8 @@ void Driver::ResumeTraffic(unsigned int core_id) {
   }
   last_traffic_state_[core_id] = {};
   Flush();
+  traffic_paused_ns_[core_id] += std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::high_resolution_clock::now() - pause_start_[core_id]).count();
 }
 
 
@@ -624,16 +1835,21 @@ std::vector<BDWord> Driver::GetPreFIFODump(unsigned int core_id) {
 std::pair<std::vector<BDWord>, std::vector<BDWord> > Driver::GetPostFIFODump(unsigned int core_id) {
   std::vector<BDWord> tags0, tags1;
 
-  tags0 = RecvFromEP(core_id, bdpars::BDFunnelEP::DUMP_POST_FIFO0, 1000).first;
-  tags1 = RecvFromEP(core_id, bdpars::BDFunnelEP::DUMP_POST_FIFO1, 1000).first;
+  const uint8_t code0 = kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::DUMP_POST_FIFO0);
+  auto recvd = RecvFromEPs(core_id, {code0, kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::DUMP_POST_FIFO1)}, 1000);
+  for (unsigned int i = 0; i < std::get<0>(recvd).size(); i++) {
+    (std::get<0>(recvd)[i] == code0 ? tags0 : tags1).push_back(std::get<1>(recvd)[i]);
+  }
 
   return std::make_pair(tags0, tags1);
 }
 
 std::pair<unsigned int, unsigned int> Driver::GetFIFOOverflowCounts(unsigned int core_id) {
-  std::vector<BDWord> ovflw0 = RecvFromEP(core_id, bdpars::BDFunnelEP::OVFLW0, 1000).first;
-  std::vector<BDWord> ovflw1 = RecvFromEP(core_id, bdpars::BDFunnelEP::OVFLW1, 1000).first;
-  return {ovflw0.size(), ovflw1.size()};
+  const uint8_t code0 = kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::OVFLW0);
+  auto recvd = RecvFromEPs(core_id, {code0, kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::OVFLW1)}, 1000);
+  const std::vector<uint8_t> &ep_codes = std::get<0>(recvd);
+  unsigned int ovflw0 = std::count(ep_codes.begin(), ep_codes.end(), code0);
+  return {ovflw0, ep_codes.size() - ovflw0};
 }
 
 void Driver::SetDACCount(unsigned int core_id, bdpars::BDHornEP signal_id, unsigned int value, bool flush) {
@@ -872,6 +2088,26 @@ void Driver::SetMem(
   // update BDState
   bd_state_.at(core_id).SetMem(mem_id, start_addr, data);
 
+  std::vector<BDWord> encapsulated_words = PackMemWords(mem_id, data, start_addr);
+
+  // transmit to horn
+  PauseTraffic(core_id);
+  bdpars::BDHornEP horn_ep = kBDPars_.mem_info_.at(mem_id).prog_leaf;
+  SendToEP(core_id, horn_ep, encapsulated_words);
+  ResumeTraffic(core_id);
+
+  Flush();
+
+  if (mem_id == bdpars::BDMemId::AM) { // if we're programming the AM, we're also dumping the AM, need to sink what comes back
+    if (capturing_image_) {
+      image_AM_dump_words_.at(core_id) += data.size();
+    } else {
+      SinkAMDump(core_id, data.size());
+    }
+  }
+}
+
+std::vector<BDWord> Driver::PackMemWords(bdpars::BDMemId mem_id, const std::vector<BDWord> &data, unsigned int start_addr) {
   // depending on which memory this is, encapsulate differently
   std::vector<BDWord> encapsulated_words;
   if (mem_id == bdpars::BDMemId::PAT) {
@@ -893,45 +2129,133 @@ void Driver::SetMem(
     encapsulated_words = PackAMMMWord<AMEncapsulation>(encapsulated_words);
   }
 
-  // transmit to horn
-  PauseTraffic(core_id);
-  bdpars::BDHornEP horn_ep = kBDPars_.mem_info_.at(mem_id).prog_leaf;
-  SendToEP(core_id, horn_ep, encapsulated_words);
-  ResumeTraffic(core_id);
+  return encapsulated_words;
+}
 
-  Flush();
+int Driver::AllocMem(unsigned int core_id, bdpars::BDMemId mem_id, unsigned int count) {
+  return mem_allocs_.at(core_id).at(mem_id).Alloc(count);
+}
 
-  if (mem_id == bdpars::BDMemId::AM) { // if we're programming the AM, we're also dumping the AM, need to sink what comes back
-    bdpars::BDFunnelEP funnel_ep = kBDPars_.mem_info_.at(mem_id).dump_leaf;
+bool Driver::ReserveMem(unsigned int core_id, bdpars::BDMemId mem_id, unsigned int start, unsigned int count, bool live) {
+  return mem_allocs_.at(core_id).at(mem_id).Reserve(start, count, live);
+}
 
-    // pop out the last two words
-    IssuePushWords();
+std::vector<BDStateRange> Driver::GetFreeMem(unsigned int core_id, bdpars::BDMemId mem_id) const {
+  return mem_allocs_.at(core_id).at(mem_id).FreeRanges();
+}
+
+bool Driver::StageMem(unsigned int core_id, bdpars::BDMemId mem_id, const std::vector<BDWord> &data, unsigned int start_addr) {
+  if (!mem_allocs_.at(core_id).at(mem_id).IsStaged(start_addr, data.size())) {
+    // the running network may be using them
+    cout << "WARNING: StageMem: entries weren't claimed for the next network with AllocMem()/ReserveMem(), not staging" << endl;
+    return false;
+  }
+
+  bd_state_.at(core_id).SetMem(mem_id, start_addr, data);
+
+  // the running network never reads these entries, traffic can keep flowing
+  SendToEP(core_id, kBDPars_.mem_info_.at(mem_id).prog_leaf, PackMemWords(mem_id, data, start_addr));
+  Flush();
 
-    double timeout_s = 2; // keep reading for 2s
-    auto start = std::chrono::high_resolution_clock::now();
-    auto now = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> diff = now - start;
+  // sinking what comes back from the AM takes push words, which pause traffic.
+  // SwapNetwork() sends them during its pause instead
+  if (mem_id == bdpars::BDMemId::AM) {
+    staged_AM_dump_words_.at(core_id) += data.size();
+  }
+  return true;
+}
 
-    unsigned int n_recvd = 0;
-    while (n_recvd < data.size() && diff.count() < timeout_s) {
-      std::pair<std::vector<BDWord>, std::vector<BDTime>> recvd = RecvFromEP(core_id, funnel_ep, 10000);
-      n_recvd += recvd.first.size();
-      now = std::chrono::high_resolution_clock::now();
-      diff = now - start;
+void Driver::SwapNetwork(unsigned int core_id,
+    const std::vector<BDWord> &PAT_data,
+    unsigned int PAT_start,
+    const std::vector<std::pair<unsigned int, BDWord>> &TAT0_entries,
+    const std::vector<std::pair<unsigned int, BDWord>> &TAT1_entries) {
+
+  // pack everything before pausing, so the pause only covers sending it
+  std::vector<std::pair<bdpars::BDMemId, std::vector<BDWord>>> to_send;
+  if (PAT_data.size() > 0) {
+    to_send.push_back({bdpars::BDMemId::PAT, PackMemWords(bdpars::BDMemId::PAT, PAT_data, PAT_start)});
+  }
+  for (auto &tat : {std::make_pair(bdpars::BDMemId::TAT0, &TAT0_entries), std::make_pair(bdpars::BDMemId::TAT1, &TAT1_entries)}) {
+    std::vector<BDWord> words;
+    for (auto &it : *tat.second) {
+      std::vector<BDWord> entry_words = PackMemWords(tat.first, {it.second}, it.first);
+      words.insert(words.end(), entry_words.begin(), entry_words.end());
     }
-    if (diff.count() > timeout_s) {
-      cout << "WARNING! while programming AM, got fewer words than we expected" << endl;
-      cout << "  got " << n_recvd << " vs " << data.size() << endl;
+    if (words.size() > 0) {
+      to_send.push_back({tat.first, words});
     }
-    if (n_recvd > data.size()) {
-      cout << "WARNING! while programming AM, got more words than we expected" << endl;
-      cout << "  got " << n_recvd << " vs " << data.size() << endl;
+  }
+
+  PauseTraffic(core_id);
+  for (auto &it : to_send) {
+    SendToEP(core_id, kBDPars_.mem_info_.at(it.first).prog_leaf, it.second);
+  }
+  if (staged_AM_dump_words_.at(core_id) > 0) {
+    // same as IssuePushWords(), but inside this pause
+    SendToEP(core_id, kBDPars_.mem_info_.at(bdpars::BDMemId::PAT).prog_leaf, PackDumpWords(core_id, bdpars::BDMemId::PAT, 0, 2));
+    num_pushs_pending_ += 2;
+  }
+  ResumeTraffic(core_id);
+
+  if (staged_AM_dump_words_.at(core_id) > 0) {
+    SinkAMDump(core_id, staged_AM_dump_words_.at(core_id), false);
+    staged_AM_dump_words_.at(core_id) = 0;
+  }
+
+  bd_state_.at(core_id).SetMem(bdpars::BDMemId::PAT, PAT_start, PAT_data);
+  for (auto &it : TAT0_entries) {
+    bd_state_.at(core_id).SetMem(bdpars::BDMemId::TAT0, it.first, {it.second});
+  }
+  for (auto &it : TAT1_entries) {
+    bd_state_.at(core_id).SetMem(bdpars::BDMemId::TAT1, it.first, {it.second});
+  }
+
+  for (auto &it : mem_allocs_.at(core_id)) {
+    it.second.Commit();
+  }
+
+  // the TAT entry points were just rewritten for the new network,
+  // wherever they are, they aren't free with the rest of the old one's entries
+  for (auto &tat : {std::make_pair(bdpars::BDMemId::TAT0, &TAT0_entries), std::make_pair(bdpars::BDMemId::TAT1, &TAT1_entries)}) {
+    for (auto &it : *tat.second) {
+      mem_allocs_.at(core_id).at(tat.first).Reserve(it.first, 1, true); // fails harmlessly if it was staged, it's live now
     }
   }
 }
 
+void Driver::SinkAMDump(unsigned int core_id, unsigned int num_words, bool issue_pushs) {
+  bdpars::BDFunnelEP funnel_ep = kBDPars_.mem_info_.at(bdpars::BDMemId::AM).dump_leaf;
+
+  // pop out the last two words
+  if (issue_pushs) {
+    IssuePushWords();
+  }
+
+  double timeout_s = 2; // keep reading for 2s
+  auto start = std::chrono::high_resolution_clock::now();
+  auto now = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> diff = now - start;
+
+  unsigned int n_recvd = 0;
+  while (n_recvd < num_words && diff.count() < timeout_s) {
+    std::pair<std::vector<BDWord>, std::vector<BDTime>> recvd = RecvFromEP(core_id, funnel_ep, 10000);
+    n_recvd += recvd.first.size();
+    now = std::chrono::high_resolution_clock::now();
+    diff = now - start;
+  }
+  if (diff.count() > timeout_s) {
+    cout << "WARNING! while programming AM, got fewer words than we expected" << endl;
+    cout << "  got " << n_recvd << " vs " << num_words << endl;
+  }
+  if (n_recvd > num_words) {
+    cout << "WARNING! while programming AM, got more words than we expected" << endl;
+    cout << "  got " << n_recvd << " vs " << num_words << endl;
+  }
+}
+
 /// helper for DumpMem
-void Driver::DumpMemSend(unsigned int core_id, bdpars::BDMemId mem_id, unsigned int start_addr, unsigned int end_addr) {
+std::vector<BDWord> Driver::PackDumpWords(unsigned int core_id, bdpars::BDMemId mem_id, unsigned int start_addr, unsigned int end_addr) {
   // make dump words
 
   assert(start_addr >= 0);
@@ -964,6 +2288,12 @@ void Driver::DumpMemSend(unsigned int core_id, bdpars::BDMemId mem_id, unsigned
     encapsulated_words = PackAMMMWord<AMEncapsulation>(encapsulated_words);
   }
 
+  return encapsulated_words;
+}
+
+void Driver::DumpMemSend(unsigned int core_id, bdpars::BDMemId mem_id, unsigned int start_addr, unsigned int end_addr) {
+  std::vector<BDWord> encapsulated_words = PackDumpWords(core_id, mem_id, start_addr, end_addr);
+
   // transmit read words, then block until all dump words have been received
   // XXX if something goes terribly wrong and not all the words come back, this will hang
   bdpars::BDHornEP horn_ep = kBDPars_.mem_info_.at(mem_id).prog_leaf;
@@ -1180,12 +2510,14 @@ std::pair<std::vector<unsigned int>, std::vector<float>> Driver::RecvXYSpikesMas
     auto aer_times = spikes.second;
     std::vector<unsigned int> xy_addresses(4096, 0);
     std::vector<float> xy_times(4096, 0);
+    std::vector<unsigned int> xys(aer_addresses.size());
+    kBDPars_.GetSomaXYAddrs(aer_addresses.data(), xys.data(), aer_addresses.size());
     for(unsigned int idx = 0; idx < aer_addresses.size(); ++idx){
         // bug in synchronizer can result in out of bond aer addresses
         // due to the bit-flipping bug
         auto _addr = aer_addresses[idx];
         if (_addr < 4096) {
-            auto _xy = kBDPars_.GetSomaXYAddr(aer_addresses[idx]);
+            auto _xy = xys[idx];
             xy_addresses[_xy] = 1;
             xy_times[_xy] = static_cast<float>(aer_times[idx]) * 1e-9;
         } else {
@@ -1227,6 +2559,10 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int>
     unsigned int curr_bin_idx = 0;
     unsigned int curr_base_addr = 0;
 
+    // translate everything up front, bad addresses are squashed below
+    std::vector<unsigned int> yx_addrs(num_spikes);
+    kBDPars_.GetSomaXYAddrs(aer_addresses.data(), yx_addrs.data(), num_spikes);
+
     for(unsigned int idx = 0; idx < num_spikes; idx++){
         auto _addr = aer_addresses[idx];
         BDTime time = aer_times[idx];
@@ -1239,7 +2575,7 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int>
 
         // squash bad spikes without report, this call is all about performance
         if (_addr < kNumNeurons) {
-            unsigned int yx_addr = kBDPars_.GetSomaXYAddr(_addr);
+            unsigned int yx_addr = yx_addrs[idx];
             unsigned int binned_spikes_addr = curr_base_addr + yx_addr;
             binned_spikes[binned_spikes_addr]++;
         }
@@ -1256,26 +2592,79 @@ void Driver::SendTags(unsigned int core_id, const std::vector<BDWord>& tags, con
   if (flush) Flush();
 }
 
-void Driver::SendSGEns(unsigned int core_id, BDTime time) {
-  // send all SG enables
+unsigned int Driver::SendSGEns(unsigned int core_id, BDTime time) {
+  // send the SG enable words that changed
   assert(max_num_SG_ <= 256); // that's what this was written for
-  uint16_t en_word;
-  for (unsigned int gen_idx = 0; gen_idx < SG_en_.at(core_id).size(); gen_idx++) {
-    unsigned int bit_idx = gen_idx % 16;
-    uint16_t bit_sel = 1 << bit_idx;
-
-    if (bit_idx == 0) en_word = 0;
-
-    if (SG_en_[core_id][gen_idx]) {
-      en_word |= bit_sel;
+  auto& en_sent = SG_en_words_sent_.at(core_id);
+  bool sent_valid = SG_en_words_sent_valid_.at(core_id);
+  unsigned int num_sent = 0;
+
+  for (unsigned int word_idx = 0; word_idx < num_SG_en_words_; word_idx++) {
+    uint16_t en_word = 0;
+    for (unsigned int bit_idx = 0; bit_idx < 16; bit_idx++) {
+      if (SG_en_[core_id][word_idx * 16 + bit_idx]) {
+        en_word |= 1 << bit_idx;
+      }
     }
 
-    if (bit_idx == 15) {
-      bdpars::FPGARegEP SG_reg_ep = kBDPars_.GenIdxToSG_GENS_EN(gen_idx);
+    if (!sent_valid || en_word != en_sent[word_idx]) {
+      bdpars::FPGARegEP SG_reg_ep = kBDPars_.GenIdxToSG_GENS_EN(word_idx * 16);
       //cout << "enable" << en_word << endl;
       SendToEP(core_id, kBDPars_.DnEPCodeFor(SG_reg_ep), {en_word}, {time});
+      en_sent[word_idx] = en_word;
+      num_sent++;
     }
   }
+  SG_en_words_sent_valid_.at(core_id) = true;
+
+  // set number of SGs used
+  int gens_used = GetHighestSGEn(core_id) + 1;
+  if (gens_used != SG_gens_used_sent_.at(core_id)) {
+    SendToEP(core_id, kBDPars_.DnEPCodeFor(bdpars::FPGARegEP::SG_GENS_USED), {static_cast<unsigned int>(gens_used)}, {time});
+    SG_gens_used_sent_.at(core_id) = gens_used;
+    num_sent++;
+    //cout << "number of generators: " << gens_used << endl;
+  }
+
+  num_SG_words_sent_.at(core_id) += num_sent;
+  return num_sent;
+}
+
+namespace {
+
+// <rate> governed at <scale>, never all the way to 0: that would change the SG enables
+int ScaleSGRate(int rate, double scale) {
+  if (rate == 0) return 0;
+  int scaled = static_cast<int>(std::lround(rate * scale));
+  if (scaled == 0) return rate > 0 ? 1 : -1;
+  return scaled;
+}
+
+}  // anonymous namespace
+
+BDWord Driver::PackSGProgWord(unsigned int gen_idx, unsigned int tag, int signed_rate) const {
+
+  unsigned int units_per_sec = 1e9 / ns_per_unit_;
+
+  // (period in time units) = (units/sec) / (rate in 1/sec)
+  const unsigned int max_period = (1 << FieldWidth(FPGASGWORD::PERIOD)) - 1;
+
+  unsigned int rate;
+  unsigned int sign;
+  if(signed_rate >= 0) {
+    rate = signed_rate;
+    sign = 0;
+  } else {
+    rate = -signed_rate;
+    sign = 1;
+  }
+
+  unsigned int period = rate > 0 ? round(double(units_per_sec) / double(rate)) : max_period;
+  period = period >= max_period ? max_period : period; // possible to get a period longer than the max programmable
+  //cout << "programming SG " << gen_idx << " to target tag " << tag << " at rate " << rate << " sign " << sign << endl;
+  //cout << "  period : " << period << " time units" << endl;
+
+  return PackWord<FPGASGWORD>({{FPGASGWORD::TAG, tag}, {FPGASGWORD::PERIOD, period}, {FPGASGWORD::GENIDX, gen_idx}, {FPGASGWORD::SIGN, sign}});
 }
 
 void Driver::SetSpikeGeneratorRates(
@@ -1288,46 +2677,28 @@ void Driver::SetSpikeGeneratorRates(
 
   assert(tags.size() == rates.size());
 
-  std::vector<BDWord> SG_prog_words;
-
-  unsigned int units_per_sec = 1e9 / ns_per_unit_;
+  std::unique_lock<std::mutex> lock(governor_lock_);
+  RateGoverning *governing = governings_.at(core_id).get();
+  const bool governed = governing != nullptr && governing->active;
 
-  // program periods/tag output idxs
+  // program periods/tag output idxs, always sent: the caller asked for them
+  std::vector<BDWord> SG_prog_words;
   for (unsigned int i = 0; i < tags.size(); i++) {
-
     unsigned int gen_idx = gen_idxs.at(i);
-    unsigned int tag = tags.at(i);
-
-    // (period in time units) = (units/sec) / (rate in 1/sec)
-    const unsigned int max_period = (1 << FieldWidth(FPGASGWORD::PERIOD)) - 1;
-
-    unsigned int rate;
-    unsigned int sign;
-    if(rates.at(i) >= 0) {
-      rate = rates.at(i);
-      sign = 0;
-    } else {
-      rate = -rates.at(i);
-      sign = 1;
+    int rate = rates.at(i);
+    if (governed) {
+      governing->requested[gen_idx] = std::make_tuple(tags.at(i), rate, time);
+      rate = ScaleSGRate(rate, governing->governor.GetScale());
     }
-
-    unsigned int period = rate > 0 ? round(double(units_per_sec) / double(rate)) : max_period;
-    period = period >= max_period ? max_period : period; // possible to get a period longer than the max programmable
-    //cout << "programming SG " << gen_idx << " to target tag " << tag << " at rate " << rate << " sign " << sign << endl;
-    //cout << "  period : " << period << " time units" << endl;
-    //cout << "  starting at : " << time << " ns" << endl << endl;
-
-    SG_prog_words.push_back(PackWord<FPGASGWORD>({{FPGASGWORD::TAG, tag}, {FPGASGWORD::PERIOD, period}, {FPGASGWORD::GENIDX, gen_idx}, {FPGASGWORD::SIGN, sign}}));
+    BDWord prog_word = PackSGProgWord(gen_idx, tags.at(i), rate);
+    SG_prog_words.push_back(prog_word);
+    SG_prog_sent_.at(core_id).at(gen_idx) = prog_word;
   }
 
-  //std::vector<BDTime> SG_prog_times(SG_prog_words.size(), time);
-
-  std::vector<BDTime> SG_prog_times;
-  for (unsigned int i = 0; i < SG_prog_words.size(); i++) {
-    SG_prog_times.push_back(time);
-  }
+  std::vector<BDTime> SG_prog_times(SG_prog_words.size(), time);
 
   SendToEP(core_id, kBDPars_.DnEPCodeFor(bdpars::FPGAChannelEP::SG_PROGRAM_MEM), SG_prog_words, SG_prog_times);
+  num_SG_words_sent_.at(core_id) += SG_prog_words.size();
 
   // update generator enable states
   for (unsigned int i = 0; i < tags.size(); i++) {
@@ -1339,35 +2710,176 @@ void Driver::SetSpikeGeneratorRates(
     SG_en_[core_id][gen_idx] = new_state;
   }
 
-  // send all SG enables, regardless if only one was changed
+  // send the SG enables and number of SGs used, if they changed
   SendSGEns(core_id, time);
 
-  // set number of SGs used
-  int highest_used = GetHighestSGEn(core_id);
-  SendToEP(core_id, kBDPars_.DnEPCodeFor(bdpars::FPGARegEP::SG_GENS_USED), {static_cast<unsigned int>(highest_used+1)}, {time});
-  //cout << "number of generators: " << highest_used + 1 << endl;
+  if (flush) Flush();
+
+}
+
+unsigned int Driver::SetSpikeGeneratorRateSchedule(
+    unsigned int core_id,
+    const std::vector<BDTime>& times,
+    const std::vector<unsigned int>& gen_idxs,
+    const std::vector<unsigned int>& tags,
+    const std::vector<int>& rates,
+    bool flush) {
+
+  assert(times.size() == gen_idxs.size() && times.size() == tags.size() && times.size() == rates.size());
+
+  std::unique_lock<std::mutex> lock(governor_lock_);
+  RateGoverning *governing = governings_.at(core_id).get();
+  if (governing != nullptr) {
+    // scheduled rates are programmed as they are
+    for (auto& it : gen_idxs) {
+      governing->requested.erase(it);
+    }
+  }
+
+  auto& prog_sent = SG_prog_sent_.at(core_id);
+  unsigned int num_sent = 0;
+
+  std::vector<BDWord> SG_prog_words;
+  std::vector<BDTime> SG_prog_times;
+
+  // one time step at a time: program words that changed, then the enable words that changed
+  unsigned int i = 0;
+  while (i < times.size()) {
+    BDTime time = times[i];
+
+    SG_prog_words.clear();
+    for (; i < times.size() && times[i] == time; i++) {
+      unsigned int gen_idx = gen_idxs[i];
+      assert(gen_idx < max_num_SG_);
+
+      BDWord prog_word = PackSGProgWord(gen_idx, tags[i], rates[i]);
+      if (prog_word != prog_sent.at(gen_idx)) {
+        SG_prog_words.push_back(prog_word);
+        prog_sent[gen_idx] = prog_word;
+      }
+      SG_en_[core_id][gen_idx] = rates[i] != 0;
+    }
+    assert((i == times.size() || times[i] > time) && "times must be non-decreasing");
+
+    if (SG_prog_words.size() > 0) {
+      SG_prog_times.assign(SG_prog_words.size(), time);
+      SendToEP(core_id, kBDPars_.DnEPCodeFor(bdpars::FPGAChannelEP::SG_PROGRAM_MEM), SG_prog_words, SG_prog_times);
+      num_SG_words_sent_.at(core_id) += SG_prog_words.size();
+      num_sent += SG_prog_words.size();
+    }
+
+    num_sent += SendSGEns(core_id, time);
+  }
 
   if (flush) Flush();
 
+  return num_sent;
 }
 
-std::pair<std::vector<BDWord>,
-          std::vector<BDTime>> Driver::RecvTags(unsigned int core_id, unsigned int timeout_us) {
+void Driver::StartRateGovernor(unsigned int core_id, const RateGovernorConfig& config) {
+  {
+    std::unique_lock<std::mutex> lock(governor_lock_);
+    governings_.at(core_id).reset(new RateGoverning(config));
+  }
+
+  // the decoder calls these inside its hooks_lock_, never the other way around
+  for (bdpars::BDFunnelEP ep : {bdpars::BDFunnelEP::OVFLW0, bdpars::BDFunnelEP::OVFLW1}) {
+    dec_->SetOutputHook(core_id, kBDPars_.UpEPCodeFor(ep), "rate_governor", [this, core_id](const std::vector<DecOutput>& outputs) {
+      std::unique_lock<std::mutex> lock(governor_lock_);
+      RateGoverning *governing = governings_.at(core_id).get();
+      if (governing != nullptr && governing->active) {
+        governing->governor.AddOverflows(outputs.size());
+      }
+      return false;
+    });
+  }
+  dec_->SetFrameHook(core_id, "rate_governor", [this, core_id](BDTime time) { GovernRates(core_id, time); });
+}
 
-  typedef std::pair<std::vector<BDWord>, std::vector<BDTime>> RetType;
+void Driver::StopRateGovernor(unsigned int core_id, bool flush) {
+  dec_->SetFrameHook(core_id, "rate_governor", Decoder::FrameHook());
+  for (bdpars::BDFunnelEP ep : {bdpars::BDFunnelEP::OVFLW0, bdpars::BDFunnelEP::OVFLW1}) {
+    dec_->SetOutputHook(core_id, kBDPars_.UpEPCodeFor(ep), "rate_governor", Decoder::OutputHook());
+  }
 
-  RetType tat_tags;
-  RetType acc_tags;
+  std::unique_lock<std::mutex> lock(governor_lock_);
+  RateGoverning *governing = governings_.at(core_id).get();
+  if (governing == nullptr || !governing->active) return;
+  governing->active = false;
 
-  // XXX need to have a timeout, otherwise we can hang even when we have something to send
-  tat_tags = RecvFromEP(core_id, bdpars::BDFunnelEP::RO_TAT, timeout_us);
-  acc_tags = RecvFromEP(core_id, bdpars::BDFunnelEP::RO_ACC, timeout_us);
+  // back to what was asked for (rates set for later still get programmed then, scaled)
+  std::vector<BDWord> SG_prog_words;
+  for (auto& it : governing->requested) {
+    BDWord prog_word = PackSGProgWord(it.first, std::get<0>(it.second), std::get<1>(it.second));
+    SG_prog_words.push_back(prog_word);
+    SG_prog_sent_.at(core_id).at(it.first) = prog_word;
+  }
+  governing->requested.clear();
+  if (SG_prog_words.size() > 0) {
+    SendToEP(core_id, kBDPars_.DnEPCodeFor(bdpars::FPGAChannelEP::SG_PROGRAM_MEM), SG_prog_words);
+    num_SG_words_sent_.at(core_id) += SG_prog_words.size();
+    if (flush) Flush();
+  }
+}
+
+double Driver::GetRateGovernorScale(unsigned int core_id) {
+  std::unique_lock<std::mutex> lock(governor_lock_);
+  RateGoverning *governing = governings_.at(core_id).get();
+  return governing != nullptr && governing->active ? governing->governor.GetScale() : 1;
+}
+
+std::vector<RateGovernorAdjustment> Driver::GetRateGovernorLog(unsigned int core_id) {
+  std::unique_lock<std::mutex> lock(governor_lock_);
+  RateGoverning *governing = governings_.at(core_id).get();
+  return governing != nullptr ? governing->governor.GetLog() : std::vector<RateGovernorAdjustment>();
+}
+
+void Driver::GovernRates(unsigned int core_id, BDTime time) {
+  std::unique_lock<std::mutex> lock(governor_lock_);
+  RateGoverning *governing = governings_.at(core_id).get();
+  if (governing == nullptr || !governing->active) return;
+
+  const double queue_fill = static_cast<double>(dec_->GetDSQueueWords()) * Decoder::BYTES_PER_WORD / driverpars::WRITE_FIFO_DEPTH;
+  governing->governor.AddQueueFill(queue_fill);
+  const BDTime time_ns = UnitsToNs(time);
+  if (!governing->governor.Update(time_ns)) return;
+
+  // reprogram the governed SGs now. SendToEP() isn't thread-safe,
+  // so serialize like it does and push straight to the encoder, like closed-loop callbacks
+  const uint8_t SG_code = kBDPars_.DnEPCodeFor(bdpars::FPGAChannelEP::SG_PROGRAM_MEM);
+  const double scale = governing->governor.GetScale();
+  auto to_send = std::make_unique<std::vector<EncInput>>();
+  for (auto& it : governing->requested) {
+    if (std::get<2>(it.second) > time_ns) continue; // not programmed yet, gets the scale it was set with
+
+    BDWord prog_word = PackSGProgWord(it.first, std::get<0>(it.second), ScaleSGRate(std::get<1>(it.second), scale));
+    SG_prog_sent_.at(core_id).at(it.first) = prog_word;
+    num_SG_words_sent_.at(core_id)++;
+    for (FOURFPGAREGS field : {FOURFPGAREGS::W0, FOURFPGAREGS::W1, FOURFPGAREGS::W2, FOURFPGAREGS::W3}) {
+      EncInput in;
+      in.core_id      = core_id;
+      in.FPGA_ep_code = SG_code;
+      in.payload      = GetField(prog_word, field);
+      in.time         = 0;
+      in.sequence_num = 0;
+      to_send->push_back(in);
+    }
+  }
+  if (to_send->size() == 0) return;
+
+  // finish the block so the words go out now
+  Encoder::AppendFlush(to_send.get(), &kBDPars_);
+
+  enc_buf_in_->Push(std::move(to_send));
+}
 
-  // concatenate
-  tat_tags.first.insert(tat_tags.first.end()   , acc_tags.first.begin()  , acc_tags.first.end());
-  tat_tags.second.insert(tat_tags.second.end() , acc_tags.second.begin() , acc_tags.second.end());
+std::pair<std::vector<BDWord>,
+          std::vector<BDTime>> Driver::RecvTags(unsigned int core_id, unsigned int timeout_us) {
 
-  return tat_tags;
+  // XXX need to have a timeout, otherwise we can hang even when we have something to send
+  auto recvd = RecvFromEPs(core_id,
+      {kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::RO_TAT), kBDPars_.UpEPCodeFor(bdpars::BDFunnelEP::RO_ACC)}, timeout_us);
+  return {std::move(std::get<1>(recvd)), std::move(std::get<2>(recvd))};
 }
 
 std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int> 
@@ -1437,7 +2949,8 @@ void Driver::SendToEP(unsigned int core_id,
       FieldWidth(FPGAIO::PAYLOAD)
     : FieldWidth(THREEFPGAREGS::W0);
 
-  const unsigned int ep_data_size = kBDPars_.Dn_EP_size_.at(ep_code);
+  const unsigned int ep_data_size = kBDPars_.Dn_EP_size_[ep_code];
+  assert(ep_data_size > 0 && "sending to unused downstream ep code");
   const unsigned int D = ep_data_size % FPGA_serialization_width == 0 ?
       ep_data_size / FPGA_serialization_width
     : ep_data_size / FPGA_serialization_width + 1;
@@ -1511,54 +3024,86 @@ void Driver::SendToEP(unsigned int core_id,
 std::pair<std::vector<BDWord>,
           std::vector<BDTime>>
   Driver::RecvFromEP(unsigned int core_id, uint8_t ep_code, unsigned int timeout_us) {
+  return RecvFromBuf(dec_bufs_out_.at(core_id).at(ep_code), timeout_us);
+}
+
+std::pair<std::vector<BDWord>,
+          std::vector<BDTime>>
+  Driver::RecvFromBuf(MutexBuffer<DecOutput> *buf, unsigned int timeout_us) {
 
-  // get data from buffer
-  MutexBuffer<DecOutput>* this_buf = dec_bufs_out_.at(ep_code);
-  std::vector<std::unique_ptr<std::vector<DecOutput>>> popped_data = this_buf->PopAll(timeout_us);
+  std::vector<std::unique_ptr<std::vector<DecOutput>>> popped_data = buf->PopAll(timeout_us);
 
+  unsigned int total_size = 0;
+  for (auto& it : popped_data) {
+    total_size += it->size();
+  }
+
+  // the decoder already put two-word outputs back together
   std::vector<BDWord> words;
   std::vector<BDTime> times;
+  words.reserve(total_size);
+  times.reserve(total_size);
+  for (auto& rit : popped_data) {
+    for (auto& it : *rit) {
+      words.push_back(it.payload);
+      times.push_back(UnitsToNs(it.time));
+    }
+  }
 
-  // if there's a deserializer, use it
-  for(auto& rit: popped_data){
-    if (up_ep_deserializers_.count(ep_code) > 0) {
-      auto& deserializer = up_ep_deserializers_.at(ep_code);
-      deserializer->NewInput(std::move(rit));
-
-      // read first word
-      std::vector<DecOutput> deserialized; // continuosly write into here
-      deserializer->GetOneOutput(&deserialized);
-      while (deserialized.size() > 0) {
-        // for now, D == 2 for all deserializers, so we can do this hack
-        // if the width of a single data object returned from the FPGA ever
-        // exceeds 64 bits, we may need to rethink this
-        assert(deserialized.size() == 2); // the only case to deal with for now
-
-        uint32_t payload_lsb = deserialized.at(0).payload;
-        uint32_t payload_msb = deserialized.at(1).payload;
-        BDTime   time        = deserialized.at(1).time; // take time on second word
-
-        // concatenate lsb and msb to make output word
-        BDWord payload_all = PackWord<TWOFPGAPAYLOADS>({{TWOFPGAPAYLOADS::LSB, payload_lsb}, {TWOFPGAPAYLOADS::MSB, payload_msb}});
-        words.push_back(payload_all);
-        times.push_back(UnitsToNs(time));
-
-        deserializer->GetOneOutput(&deserialized);
-      }
-    } else {
+  return {words, times};
+}
 
-      // otherwise, not much to do
-      for (auto& it : *(rit.get())) {
-        uint32_t payload = it.payload;
-        BDTime   time    = it.time; // take time on second word
+std::tuple<std::vector<uint8_t>,
+           std::vector<BDWord>,
+           std::vector<BDTime>>
+  Driver::RecvFromEPs(unsigned int core_id, const std::vector<uint8_t> &ep_codes, unsigned int timeout_us) {
 
-        words.push_back(payload);
-        times.push_back(UnitsToNs(time));
+  std::vector<MutexBuffer<DecOutput>*> bufs;
+  for (auto& it : ep_codes) {
+    bufs.push_back(dec_bufs_out_.at(core_id).at(it));
+  }
+
+  // one deadline for all of them: sleep until any of the core's buffers is pushed to
+  auto any_ready = [&bufs] {
+    for (auto& it : bufs) {
+      if (!it->IsEmpty()) return true;
+    }
+    return false;
+  };
+  dec_bufs_out_signals_.at(core_id)->Wait(any_ready, timeout_us);
+
+  // each ep's outputs are already in time order
+  std::vector<std::vector<DecOutput>> streams(bufs.size());
+  unsigned int total_size = 0;
+  for (unsigned int i = 0; i < bufs.size(); i++) {
+    if (bufs[i]->IsEmpty()) continue;
+    for (auto& it : bufs[i]->PopAll(1)) {
+      streams[i].insert(streams[i].end(), it->begin(), it->end());
+    }
+    total_size += streams[i].size();
+  }
+
+  // k-way merge, k is small, so just scan the heads
+  std::tuple<std::vector<uint8_t>, std::vector<BDWord>, std::vector<BDTime>> merged;
+  std::get<0>(merged).reserve(total_size);
+  std::get<1>(merged).reserve(total_size);
+  std::get<2>(merged).reserve(total_size);
+  std::vector<unsigned int> heads(streams.size(), 0);
+  for (unsigned int n = 0; n < total_size; n++) {
+    unsigned int next = streams.size();
+    for (unsigned int i = 0; i < streams.size(); i++) {
+      if (heads[i] < streams[i].size() &&
+          (next == streams.size() || streams[i][heads[i]].time < streams[next][heads[next]].time)) {
+        next = i;
       }
     }
+    const DecOutput &out = streams[next][heads[next]++];
+    std::get<0>(merged).push_back(ep_codes[next]);
+    std::get<1>(merged).push_back(out.payload);
+    std::get<2>(merged).push_back(UnitsToNs(out.time));
   }
 
-  return {words, times};
+  return merged;
 }
 
 void Driver::SetBDRegister(unsigned int core_id, bdpars::BDHornEP reg_id, BDWord word, bool flush) {
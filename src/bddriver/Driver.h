@@ -10,9 +10,21 @@
 #include "common/BDPars.h"
 #include "common/BDWord.h"
 #include "common/BDState.h"
+#include "common/DriverPars.h"
+#include "common/MemAllocator.h"
 #include "common/MutexBuffer.h"
+#include "common/NetworkImage.h"
+#include "common/OutputStore.h"
+#include "common/RateGovernor.h"
+#include "common/RateMap.h"
+#include "common/RealTime.h"
+#include "common/ShmRing.h"
+#include "common/SpikeFilterBank.h"
+#include "common/TagBinner.h"
 #include "decoder/Decoder.h"
 #include "encoder/Encoder.h"
+#include "encoder/SpikeTrainGenerator.h"
+#include "encoder/TimedFeeder.h"
 
 /*
  * TODO LIST: funnel/horn leaves that still need their calls finished
@@ -33,7 +45,8 @@ struct OKPars {
 };
 
 /**
- * \class Driver is a singleton; There should only be one instance of this.
+ * \class Driver There should only be one instance of this per board
+ * (see DriverManager for running several boards).
  *
  */
 
@@ -51,7 +64,7 @@ struct OKPars {
 ///  [private fns, e.g. PackWords]   |        [XXXX private fns, e.g. UnpackWords XXXX]
 ///          |        |              |             A                           A
 ///          V        V           [BDState]        |                           |
-///   [MutexBuffer:enc_buf_in_]      |      [M.B.:dec_buf_out_[0]]    [M.B.:dec_buf_out_[0]] ...
+///   [M.B.:enc_(bulk_)buf_in_]      |      [M.B.:dec_buf_out_[0]]    [M.B.:dec_buf_out_[0]] ...
 ///              |                   |                   A                   A
 ///              |                   |                   |                   |
 ///   ----------------------------[BDPars]------------------------------------------- funnel/horn payloads,
@@ -106,7 +119,9 @@ struct OKPars {
 class Driver {
  public:
   /// can supply your own comm if you're doing something funky
-  Driver();
+  /// <num_cores> > 1 drives a BrainDrizzle stack (see BDPars). So far only the
+  /// BDModel comm supports that, Start() fails with the Opal Kelly comm
+  Driver(unsigned int num_cores = 1);
   ~Driver();
 
   /// Return a global instance of bddriver
@@ -122,9 +137,9 @@ class Driver {
   ////////////////////////////////////////////////////////////////////////////
 
   /// starts child workers, e.g. encoder and decoder
-  /// returns 0 if successful, -1 if comm init fails
+  /// returns 0 if successful, -1 if comm init fails (or the comm can't drive NumCores cores)
   int Start();
-  /// stops the child workers
+  /// stops the child workers, dropping (with a warning) timed traffic the encoder is still holding
   void Stop();
 
   /// Sets the FPGA time resolution (also is the interval that FPGA updates SG values)
@@ -139,16 +154,22 @@ class Driver {
   float GetFPGATimeSec(){
       return static_cast<float>(GetFPGATime()) * 1e-9;
   }
+  /// Time of the most recent upstream HB (ns). Unlike GetFPGATime(), doesn't consume anything
+  BDTime GetLatestHBTime() { return UnitsToNs(dec_->GetLatestHB()); }
   /// Returns driver (PC) time in ns
   BDTime GetDriverTime() const;
   // Set the Opal Kelly bitfile location
   void SetOKBitFile(std::string bitfile);
+  /// Set which Opal Kelly board to open (by serial number), empty for the first one found
+  void SetOKSerial(std::string serial);
   /// Cycles BD pReset/sReset
   /// Useful for testing, but leaves memories in an indeterminate state
   void ResetBD();
   /// Clears BD FIFOs
   /// Calls Flush immediately
   void InitFIFO(unsigned int core_id);
+  /// InitFIFO() for several cores at once, they share the wait for the FIFOs to clear
+  void InitFIFOs(const std::vector<unsigned int> &core_ids);
   /// Inits the DACs to default values
   void InitDAC(unsigned int core_id, bool flush=true);
   /// Initializes BD hardware state
@@ -157,6 +178,34 @@ class Driver {
   void InitBD();
   /// Initializes FPGA state
   void InitFPGA();
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Warm start
+  //
+  // InitBD() takes seconds: a reset cycle, FIFO init, and reprogramming every
+  // memory and all the neuron config. If the chip hasn't been power cycled since
+  // SaveAttachState() was called, AttachBD() can take over where it left off.
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// file format: header, then a fingerprint and a BDState per core, see SaveAttachState()
+  static constexpr char kAttachFileMagic[4] = {'B', 'D', 'A', 'T'};
+  static constexpr uint32_t kAttachFileVersion = 1;
+
+  /// Save the driver's view of the chip, for AttachBD(). Returns false on failure
+  bool SaveAttachState(const std::string &filename) const;
+  /// Use instead of InitBD(): installs the BDStates saved by SaveAttachState(), then checks
+  /// them against the chip by dumping <samples_per_mem> windows of each memory.
+  /// BD registers can't be read back, they're re-sent from the saved state. Neither can the
+  /// neuron config, which isn't re-sent or checked: it's assumed to be what was saved.
+  /// AM/MM/TAT entries that differ from InitBD()'s defaults are claimed for the running network
+  /// (see ReserveMem()), entries it left at the defaults have to be reserved again.
+  /// <saved_fingerprints> (BDState::Fingerprint(), one per core, if given) only checks that the
+  /// file holds the configuration the caller expects, not the chip.
+  /// If the file can't be read, doesn't match <saved_fingerprints>, or the chip's memories
+  /// don't match, falls back to InitBD(). Returns true if InitBD() was skipped
+  bool AttachBD(const std::string &filename,
+      const std::vector<uint64_t> &saved_fingerprints = {},
+      unsigned int samples_per_mem = driverpars::ATTACH_SAMPLES_PER_MEM);
   /// Empties all driver output queues
   void ClearOutputs();
 
@@ -168,8 +217,281 @@ class Driver {
   /// Commits queued-up messages (sends enough nops to flush the USB)
   /// By default, many configuration calls will call Flush()
   /// Notably, the Neuron config calls do not call Flush()
+  /// Untimed traffic (and timed traffic at time 0) takes the encoder's priority lane, and goes out ahead of
+  /// timed traffic from earlier Flush()es that hasn't been sent yet, see SetBulkLead()
   void Flush();
 
+  ////////////////////////////////////////////////////////////////////////////
+  // Streaming timed input
+  //
+  // For long experiments, instead of Flush()ing all the timed traffic at once
+  // (which fills the FPGA's downstream queue and blocks untimed traffic until
+  // the last input's time), queue it up as usual with flush=false, then call
+  // FlushStreamed(). A feeder thread releases the timed traffic to the FPGA
+  // at most the stream window ahead of the latest FPGA time.
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// Like Flush(), but timed traffic goes to the feeder instead of straight to the FPGA.
+  /// Untimed traffic is sent immediately.
+  void FlushStreamed();
+  /// Write the queued-up timed traffic to a schedule file instead of sending it.
+  /// Clears the timed queue. Returns false if the file couldn't be written
+  bool SaveTimedInputs(const std::string &filename);
+  /// Stream a schedule file written by SaveTimedInputs(), read lazily as FPGA time advances.
+  /// Returns false if the file couldn't be read
+  bool StreamTimedInputsFromFile(const std::string &filename);
+  /// Set how far ahead of FPGA time (in ns) the feeder and the spike train generator
+  /// may release timed traffic
+  void SetStreamWindow(BDTime window_ns);
+  BDTime GetStreamWindow() const { return stream_window_ns_; }
+  /// Drop streamed timed traffic that hasn't been released yet, and the timed traffic
+  /// the encoder is holding back for the FPGA (see SetBulkLead())
+  void ClearStreamedInputs();
+  /// Hold encoded timed traffic on the host until it's due within <lead_ns> of FPGA time.
+  /// The FPGA stalls its downstream queue on inputs that aren't due yet, so this keeps untimed
+  /// traffic (traffic toggles, DAC changes, ...) from being stuck behind a long timed schedule.
+  /// 0 (the default) only holds timed traffic while comm is backed up
+  void SetBulkLead(BDTime lead_ns);
+  BDTime GetBulkLead() const { return bulk_lead_ns_; }
+  /// Encoded timed traffic that's being held back, in bytes
+  uint64_t GetNumHeldBulkBytes() const { return enc_->GetNumHeldBytes(); }
+  /// How far the feeder ran ahead of/behind FPGA time, times in ns
+  TimedFeederStats GetStreamStats();
+  void ResetStreamStats() { feeder_->ResetStats(); }
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Precompiled network images
+  //
+  // Loading the same network repeatedly re-packs and re-encodes every memory word
+  // and pauses traffic once per memory. Instead, capture the load once:
+  //   BeginNetworkImage(), <configuration calls>, EndNetworkImage().Save(filename)
+  // and replay it with LoadNetworkImage(filename).
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// Start capturing: until EndNetworkImage(), untimed downstream traffic is recorded
+  /// instead of sent. Traffic toggle changes aren't recorded, they're applied at the end
+  /// of the load. BDState is updated as usual, EndNetworkImage() puts it back.
+  void BeginNetworkImage();
+  /// Stop capturing, return what was captured, encoded, with the resulting BDStates
+  NetworkImage EndNetworkImage();
+  /// Pause traffic, send <image>'s blocks straight to comm, install its BDStates,
+  /// then set the traffic toggles the way the image has them
+  void LoadNetworkImage(const NetworkImage &image);
+  /// LoadNetworkImage() from a file written by NetworkImage::Save(), returns false if it can't be read
+  bool LoadNetworkImage(const std::string &filename);
+  bool IsCapturingNetworkImage() const { return capturing_image_; }
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Network hot-swap
+  //
+  // Reprogramming a running network with SetMem() pauses traffic once per call.
+  // Instead, stage the next network's AM/MM/TAT entries in regions the running
+  // network doesn't use, while it keeps running, then repoint the PAT and the TAT
+  // entry points in one short pause:
+  //   ReserveMem(..., live=true) the running network's regions (once),
+  //   AllocMem()/ReserveMem() then StageMem() the next network, SwapNetwork().
+  // After the swap, the old network's regions are free for the one after.
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// Claim the first free run of <count> entries of <mem_id> (AM, MM, TAT0 or TAT1)
+  /// for the next network. Returns its start address, or -1 if there's no room
+  int AllocMem(unsigned int core_id, bdpars::BDMemId mem_id, unsigned int count);
+  /// Claim [start, start + count) of <mem_id> for the next network (or, with <live>,
+  /// for the running one). Returns false if any of it is already claimed
+  bool ReserveMem(unsigned int core_id, bdpars::BDMemId mem_id, unsigned int start, unsigned int count, bool live=false);
+  /// Runs of <mem_id> that neither network has claimed
+  std::vector<BDStateRange> GetFreeMem(unsigned int core_id, bdpars::BDMemId mem_id) const;
+  /// Like SetMem(), but doesn't pause traffic.
+  /// The range must have been claimed for the next network, returns false (and writes nothing) if it wasn't
+  bool StageMem(unsigned int core_id, bdpars::BDMemId mem_id, const std::vector<BDWord> &data, unsigned int start_addr);
+  /// Switch to the staged network: in one traffic pause, write <PAT_data> from <PAT_start>
+  /// and the (address, word) TAT entries. Then the next network's regions become
+  /// the running network's, and the old ones are freed, except for the TAT entries just written
+  void SwapNetwork(unsigned int core_id,
+      const std::vector<BDWord> &PAT_data,
+      unsigned int PAT_start = 0,
+      const std::vector<std::pair<unsigned int, BDWord>> &TAT0_entries = {},
+      const std::vector<std::pair<unsigned int, BDWord>> &TAT1_entries = {});
+  /// Total time (ns) traffic has been paused on <core_id>, the window in which inputs and outputs are lost
+  BDTime GetTrafficPausedTime(unsigned int core_id) const { return traffic_paused_ns_.at(core_id); }
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Host-generated spike trains
+  //
+  // For more input tag streams than the FPGA's spike generators can provide, or
+  // Poisson statistics. Spike trains are generated on the host a stream window
+  // ahead of FPGA time, and sent as timed tags.
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// Start one spike train per input tag word in <tags>.
+  /// <rates>[i][j] is train i's rate (in Hz) from <times>[j] until <times>[j+1] (ns),
+  /// the last rate holds until <stop_time> (ns). A constant rate is a single-entry table.
+  /// Poisson trains with a changing rate are inhomogeneous Poisson processes.
+  void AddSpikeTrains(
+      unsigned int core_id,
+      const std::vector<BDWord>& tags,
+      SpikeTrainType type,
+      const std::vector<BDTime>& times,
+      const std::vector<std::vector<double>>& rates,
+      BDTime stop_time);
+  /// Stop all host-generated spike trains (already-sent spikes still go out)
+  void ClearSpikeTrains() { spike_gen_->Clear(); }
+  /// How far the spike train generator is ahead of FPGA time, times in ns
+  SpikeTrainGeneratorStats GetSpikeTrainStats();
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Closed-loop I/O
+  //
+  // For experiments where the host responds to upstream traffic. A native
+  // callback runs in the decoder thread and injects its response tags
+  // straight into the encoder, skipping the Recv/Send/Flush round trip.
+  // SetRealTimeMode() cuts the thread handoff latency.
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// Gets <words>/<times> (ns) decoded from an upstream ep, appends tags (InputTag words) to send
+  typedef std::function<void(const std::vector<BDWord>& words,
+                             const std::vector<BDTime>& times,
+                             std::vector<BDWord>* response_tags)> ClosedLoopCallback;
+
+  /// Call <callback> from the decoder thread for every batch of words from <up_ep_code>.
+  /// Response tags are sent to core <core_id> untimed, right away.
+  /// If <consume>, the words don't go on to the ep's output buffer (RecvFromEP etc. won't see them).
+  /// The callback holds up decoding, keep it short.
+  void SetClosedLoopCallback(unsigned int core_id, uint8_t up_ep_code, ClosedLoopCallback callback, bool consume = false);
+  void ClearClosedLoopCallback(unsigned int core_id, uint8_t up_ep_code) { dec_->SetOutputHook(core_id, up_ep_code, "closed_loop", Decoder::OutputHook()); }
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Upstream broadcast
+  //
+  // Recv* calls pop outputs, so only one consumer sees them. The decoder can
+  // also publish everything it decodes to a shared memory ring that any number
+  // of local processes (recorders, GUIs) read from without disturbing the driver,
+  // see ShmRingReader and pystorm/hal/shm_ring.py.
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// Publish decoded upstream words to shared memory segment <name>, keeping the last <capacity>.
+  /// Replaces any previous broadcast. Returns false if the segment couldn't be created
+  bool StartBroadcast(const std::string& name, unsigned int capacity = driverpars::SHM_RING_DEFAULT_CAPACITY);
+  /// Stop publishing and remove the segment
+  void StopBroadcast();
+  /// Records published since StartBroadcast(), 0 if not broadcasting
+  uint64_t GetBroadcastCount() const { return broadcast_ ? broadcast_->GetWriteSeq() : 0; }
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Live rate map
+  //
+  // The decoder can also keep an exponentially weighted rate estimate for every
+  // neuron, without popping any spikes. It's double buffered, so polling it never
+  // holds up decoding. With a shared memory name, other processes can poll it too,
+  // see RateMapReader and pystorm/hal/rate_map.py. Spikes an NRNI subscription
+  // drops are still counted, unless it drops them before_taps.
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// Estimate <core_id>'s neurons' rates with time constant <tau_ns>, refreshed every <refresh_ns>
+  /// (at the first upstream HB after). Rates are in Hz, in XY order (y * 64 + x).
+  /// If <shm_name> isn't empty, the map is also published in that shared memory segment.
+  /// Replaces any previous map. Returns false if the segment couldn't be created
+  bool StartRateMap(unsigned int core_id, BDTime tau_ns, BDTime refresh_ns, const std::string& shm_name = "");
+  /// Stop estimating, and remove the shared memory segment
+  void StopRateMap(unsigned int core_id);
+  /// The newest rate map, returns {time (ns), rates}. Empty if there isn't one yet
+  std::pair<BDTime, std::vector<float>> GetRateMap(unsigned int core_id);
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Upstream retention
+  //
+  // Also keeps the recent history of an upstream ep in the driver, so it can
+  // be read by time range (any number of times) instead of drained and
+  // re-sliced. Retained outputs still go to the ep's output buffer as usual.
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// Keep the last <horizon_ns> of <core_id>'s <up_ep_code> outputs, 0 stops keeping them.
+  /// Memory goes with the horizon times the ep's rate
+  void SetRetention(unsigned int core_id, uint8_t up_ep_code, BDTime horizon_ns);
+  /// Retained words/times (ns) from <up_ep_code> in [<t0_ns>, <t1_ns>), oldest first.
+  /// Nothing is consumed, see ReleaseRetained()
+  std::pair<std::vector<BDWord>,
+            std::vector<BDTime>> GetRetained(unsigned int core_id, uint8_t up_ep_code, BDTime t0_ns, BDTime t1_ns);
+  /// Counts of retained outputs in <num_bins> bins of <bin_ns> from <t0_ns>, per neuron (soma XY address)
+  /// for NRNI, per tag for RO_ACC/RO_TAT, otherwise just per bin.
+  /// returns {counts (bin major, num_bins * num_keys), num_keys}
+  std::pair<std::vector<uint32_t>, unsigned int> GetRetainedBinned(
+      unsigned int core_id, uint8_t up_ep_code, BDTime t0_ns, BDTime bin_ns, unsigned int num_bins);
+  /// Drop retained outputs before <t_ns>, once they've been read
+  void ReleaseRetained(unsigned int core_id, uint8_t up_ep_code, BDTime t_ns);
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Subscriptions
+  //
+  // Drop upstream outputs nobody wants instead of queueing, copying and
+  // translating them. An output's key is its neuron (AER) address for NRNI,
+  // its tag for RO_ACC/RO_TAT, and its filter index for SF_OUTPUT, other eps
+  // can't be filtered. Key ranges are [first, last) pairs. Kept outputs can
+  // also be routed to named queues, e.g. one per pool. By default, only the
+  // queues lose the dropped outputs: the rate map, retention, the broadcast
+  // ring and output hooks still see everything. With before_taps, they're
+  // dropped as they're decoded, and nothing else sees them either.
+  ////////////////////////////////////////////////////////////////////////////
+
+  typedef std::vector<std::pair<unsigned int, unsigned int>> KeyRanges;
+
+  /// Only queue <core_id>'s <up_ep_code> outputs with keys in <keep>, drop the rest
+  /// <before_taps> (see above). Returns false if <up_ep_code> can't be filtered
+  bool SetSubscription(unsigned int core_id, uint8_t up_ep_code, const KeyRanges& keep, bool before_taps=false);
+  /// Send kept outputs with keys in <keys> to queue <queue> instead of the ep's output buffer.
+  /// Returns false if <up_ep_code> can't be filtered
+  bool RouteSubscription(unsigned int core_id, uint8_t up_ep_code, const std::string& queue, const KeyRanges& keys);
+  /// Keep and queue everything from <up_ep_code> as usual again
+  void ClearSubscription(unsigned int core_id, uint8_t up_ep_code);
+  /// Receive from a queue made by RouteSubscription(), waiting up to <timeout_us> (0 = forever).
+  /// returns {words, times}
+  std::pair<std::vector<BDWord>,
+            std::vector<BDTime>> RecvFromQueue(const std::string& queue, unsigned int timeout_us=1000);
+  /// Outputs dropped by subscriptions
+  uint64_t GetNumFilteredOutputs() const { return dec_->GetNumFilteredOutputs(); }
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Translation tables
+  //
+  // The HAL registers, once per mapped network, which output/dimension each
+  // spike filter reports and which pool/neuron each soma is. Receive calls
+  // can then hand back translated arrays made in one pass, instead of raw
+  // words translated element by element in Python. Pools and outputs are
+  // whatever ids the HAL gives them.
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// Spike filter i of <core_id> reports dimension <dims>[i] of output <outputs>[i], output < 0 if it's unused
+  void SetOutputTable(unsigned int core_id, const std::vector<int>& outputs, const std::vector<unsigned int>& dims);
+  /// The soma of <core_id> at AER address a is neuron <nrn_idxs>[a] of pool <pools>[a], pool < 0 if it's in none
+  void SetPoolTable(unsigned int core_id, const std::vector<int>& pools, const std::vector<unsigned int>& nrn_idxs);
+
+  /// Receive spike filter states as signed counts, translated with SetOutputTable()'s table.
+  /// States from unused filters are dropped. In time order, or if <group>, grouped by output (in time order within each).
+  /// returns {times, outputs, dims, counts}
+  std::tuple<std::vector<BDTime>,
+             std::vector<int>,
+             std::vector<unsigned int>,
+             std::vector<int>> RecvTranslatedOutputs(unsigned int core_id, bool group=false, unsigned int timeout_us=1000);
+  /// Receive spikes translated with SetPoolTable()'s table. Spikes from somas in no pool are dropped.
+  /// In time order, or if <group>, grouped by pool (in time order within each).
+  /// returns {times, pools, neuron indices}
+  std::tuple<std::vector<BDTime>,
+             std::vector<int>,
+             std::vector<unsigned int>> RecvTranslatedSpikes(unsigned int core_id, bool group=false, unsigned int timeout_us=1000);
+
+  /// Record every frame the comm reads from and writes to the board, with host timestamps,
+  /// to trace file <path> (see Comm::StartCapture()). Play it back with ReplayDriver.
+  /// Returns false if the file couldn't be opened
+  bool StartCapture(const std::string& path) { return comm_->StartCapture(path); }
+  /// Stop recording, returns the number of frames recorded
+  uint64_t StopCapture() { return comm_->StopCapture(); }
+
+  /// Pin the comm/encoder/decoder threads, optionally run them under SCHED_FIFO and lock memory,
+  /// and make them busy-poll. RealTimeConfig() restores the normal mode.
+  /// Returns false if any part of <config> couldn't be applied (see the warnings)
+  bool SetRealTimeMode(const RealTimeConfig& config);
+  const RealTimeConfig& GetRealTimeMode() const { return realtime_config_; }
+
   /// Control tag traffic
   void SetTagTrafficState(unsigned int core_id, bool en, bool flush=true);
 
@@ -618,8 +940,8 @@ class Driver {
 
     std::vector<BDWord> packed(size);
     for (unsigned int i = 0; i < size; i++) {
-      unsigned int addr0 = kBDPars_.GetSynAERAddr(synapse_xs[2*i  ], synapse_ys[2*i  ]);
-      unsigned int addr1 = kBDPars_.GetSynAERAddr(synapse_xs[2*i+1], synapse_ys[2*i+1]);
+      unsigned int addr0 = bdpars::BDPars::GetSynAERAddr(synapse_xs[2*i  ], synapse_ys[2*i  ]);
+      unsigned int addr1 = bdpars::BDPars::GetSynAERAddr(synapse_xs[2*i+1], synapse_ys[2*i+1]);
       unsigned int sign0 = synapse_signs[2*i  ];
       unsigned int sign1 = synapse_signs[2*i+1];
       packed[i] = PackWord<TATSpikeWord>({
@@ -832,13 +1154,15 @@ class Driver {
 
     std::vector<unsigned int> xy_addresses(num_spikes, 0);
 
-    for(unsigned int idx = 0; idx < num_spikes; ++idx){
-        auto _addr = aer_addresses[idx];
-        if (_addr < 4096) {
-            xy_addresses[idx] = kBDPars_.GetSomaXYAddr(aer_addresses[idx]);
-        } else {
-            cout << "WARNING: Invalid spike address: " << _addr << endl;
-        }
+    unsigned int num_bad = kBDPars_.GetSomaXYAddrs(aer_addresses.data(), xy_addresses.data(), num_spikes);
+    if (num_bad > 0) {
+      for(unsigned int idx = 0; idx < num_spikes; ++idx){
+          auto _addr = aer_addresses[idx];
+          if (_addr >= 4096) {
+              xy_addresses[idx] = 0;
+              cout << "WARNING: Invalid spike address: " << _addr << endl;
+          }
+      }
     }
     return {xy_addresses, aer_times};
   }
@@ -856,12 +1180,13 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int>
     std::vector<unsigned int> xy_addresses(num_spikes, 0);
     std::vector<float> xy_times(num_spikes, 0);
 
+    kBDPars_.GetSomaXYAddrs(aer_addresses.data(), xy_addresses.data(), num_spikes);
     for(unsigned int idx = 0; idx < num_spikes; ++idx){
         auto _addr = aer_addresses[idx];
         if (_addr < 4096) {
-            xy_addresses[idx] = kBDPars_.GetSomaXYAddr(aer_addresses[idx]);
             xy_times[idx] = static_cast<float>(aer_times[idx]) * 1e-9;
         } else {
+            xy_addresses[idx] = 0;
             cout << "WARNING: Invalid spike address: " << _addr << endl;
         }
     }
@@ -879,8 +1204,16 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int>
       const std::vector<BDTime> times={},
       bool flush=true);
 
+  /// Receive from several upstream eps of <core_id> at once, e.g. both tag output leaves.
+  /// Waits up to <timeout_us> (0 = forever) for any of <ep_codes> to have something, then takes
+  /// everything all of them have, merged in time order. Ties keep <ep_codes> order.
+  /// returns {ep codes, words, times}
+  std::tuple<std::vector<uint8_t>,
+             std::vector<BDWord>,
+             std::vector<BDTime>> RecvFromEPs(unsigned int core_id, const std::vector<uint8_t> &ep_codes, unsigned int timeout_us=1000);
+
   /// Receive a stream of tags
-  /// receive from both tag output leaves, the Acc and TAT
+  /// receive from both tag output leaves, the Acc and TAT, merged in time order
   std::pair<std::vector<BDWord>,
             std::vector<BDTime>> RecvTags(unsigned int core_id, unsigned int timeout_us=1000);
 
@@ -902,6 +1235,18 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int>
     return {counts, tags, routes, tags_times.second};
   }
 
+  /// Receive tags from both tag output leaves, summing their signed counts into (bin, tag) cells.
+  /// Bins are [<bin_edges>[i], <bin_edges>[i + 1]) (ns), tags outside them are dropped
+  TagBinner RecvBinnedTags(unsigned int core_id, const std::vector<BDTime>& bin_edges, unsigned int timeout_us=1000);
+  /// Same, with <num_bins> bins of <bin_ns> from <t0_ns>
+  TagBinner RecvBinnedTags(unsigned int core_id, BDTime t0_ns, BDTime bin_ns, unsigned int num_bins, unsigned int timeout_us=1000);
+  /// Bin tags as they're decoded instead: until GetTagBinning(stop=true), both leaves' tags go
+  /// to a binner with <bin_edges> (ns) instead of the output buffers. Other hooks on the tag eps
+  /// (closed-loop callbacks, host spike filters) still see them
+  void StartTagBinning(unsigned int core_id, const std::vector<BDTime>& bin_edges);
+  /// What StartTagBinning() has binned so far, and stop binning if <stop>
+  TagBinner GetTagBinning(unsigned int core_id, bool stop=true);
+
   //////////////////////////////////////////////////////////////////////////
   // FPGA tag IO
   //////////////////////////////////////////////////////////////////////////
@@ -920,6 +1265,38 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int>
     BDTime time = 0,
     bool flush = true);
 
+  /// Schedule many SG rate changes at once, e.g. for a rate sweep.
+  /// Entry i sets generator <gen_idxs[i]> to output <tags[i]> at <rates[i]> Hz at <times[i]> (ns).
+  /// <times> must be non-decreasing. At each time step, only the SG program words and
+  /// SG_GENS_EN words that actually change are sent.
+  /// Returns the number of downstream words queued.
+  unsigned int SetSpikeGeneratorRateSchedule(
+    unsigned int core_id,
+    const std::vector<BDTime>& times,
+    const std::vector<unsigned int>& gen_idxs,
+    const std::vector<unsigned int>& tags,
+    const std::vector<int>& rates,
+    bool flush = true);
+
+  /// Number of SG program/enable/used words queued since the Driver was created
+  uint64_t GetNumSGWordsSent(unsigned int core_id) const {
+    std::unique_lock<std::mutex> lock(governor_lock_);
+    return num_SG_words_sent_.at(core_id);
+  }
+
+  /// Govern <core_id>'s SG rates: watch FIFO overflows (OVFLW0/1) and the downstream queue as they're
+  /// decoded, and scale what SetSpikeGeneratorRates() programs down when they're over <config>'s targets,
+  /// back up when they aren't, see RateGovernor. Rates already set are reprogrammed as the scale changes.
+  /// SetSpikeGeneratorRateSchedule() rates aren't governed. Overflows still reach GetFIFOOverflowCounts()
+  /// and closed-loop callbacks on the overflow eps
+  void StartRateGovernor(unsigned int core_id, const RateGovernorConfig& config);
+  /// Stop governing, and reprogram the governed SGs at the rates they were set to
+  void StopRateGovernor(unsigned int core_id, bool flush = true);
+  /// Scale that governed rates are programmed at, 1 if not governing
+  double GetRateGovernorScale(unsigned int core_id);
+  /// Every scale change of the latest StartRateGovernor(), to correct results with
+  std::vector<RateGovernorAdjustment> GetRateGovernorLog(unsigned int core_id);
+
   /// Set spike filter increment constant
   void SetSpikeFilterIncrementConst(unsigned int core_id, unsigned int increment, bool flush=true) {
     uint16_t inc_lo = GetField(increment, THREEFPGAREGS::W0);
@@ -971,20 +1348,45 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int>
 /// Requires user to set bin time to upstream time resoultion (heartbeat interval)
 std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int> RecvSpikeFilterStatesArray(unsigned int core_id, unsigned int num_tag_streams);
 
+  /// Filter <core_id>'s tags on the host (filter = tag id, both leaves) and, if <spikes>, its spikes
+  /// (filter = 2048 + neuron address), without the FPGA's limit of max_num_SF_ filters.
+  /// <decay> and <increment> are SetSpikeFilterDecayConst()/IncrementConst()'s constants, and
+  /// states are in the same units, decaying once per upstream HB (the period when this is called).
+  /// States are sampled every <sample_ns>. Tags and spikes still go to their output buffers,
+  /// closed-loop callbacks and tag binning
+  bool StartHostSpikeFilters(unsigned int core_id, unsigned int decay, unsigned int increment, BDTime sample_ns, bool spikes=false);
+  void StopHostSpikeFilters(unsigned int core_id);
+  /// Host filter samples taken since the last call, returns {times, states},
+  /// states is (number of samples) * (number of filters), sample major
+  std::pair<std::vector<BDTime>, std::vector<float>> RecvHostSpikeFilterStates(unsigned int core_id);
+  /// The latest host filter sample, returns {time, states}. Doesn't consume it, or wait on the decoder
+  std::pair<BDTime, std::vector<float>> GetHostSpikeFilterSnapshot(unsigned int core_id);
+
   //////////////////////////////////////////////////////////////////////////
   // Utility
   //////////////////////////////////////////////////////////////////////////
 
-  /// Returns the total number of elements in each output queue
+  /// Returns the total number of elements in each output queue, summed over cores
   /// Useful for debugging FPGA issues
   std::vector<std::pair<uint8_t, unsigned int>> GetOutputQueueCounts() {
     std::vector<std::pair<uint8_t, unsigned int>> retvals;
-    for (auto& ep_buf : dec_bufs_out_) {
-      retvals.push_back({ep_buf.first, ep_buf.second->TotalSize()});
+    for (auto& ep_buf : dec_bufs_out_[0]) {
+      unsigned int count = 0;
+      for (auto& core_bufs : dec_bufs_out_) {
+        count += core_bufs.at(ep_buf.first)->TotalSize();
+      }
+      retvals.push_back({ep_buf.first, count});
     }
     return retvals;
   }
 
+  /// Bytes read from comm that the decoder hasn't gotten to yet.
+  /// If this keeps growing, the decoder can't keep up with the upstream traffic
+  unsigned int GetDecoderQueueBytes() { return dec_buf_in_->TotalSize(); }
+
+  /// Upstream words the decoder dropped because their ep code was unknown (corrupted data)
+  uint64_t GetNumUnknownEPWords() const { return dec_->GetNumUnknownEPWords(); }
+
   /// Returns the hardware identifier
   std::string GetHWID();
 
@@ -1014,7 +1416,7 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int> RecvSpikeFilterStat
   }
 
   /// parameters describing BD hardware
-  static const bdpars::BDPars kBDPars_;
+  const bdpars::BDPars kBDPars_;
  protected:
 
   ////////////////////////////////
@@ -1037,15 +1439,40 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int> RecvSpikeFilterStat
   BDTime last_time_ = 0;
 
 
+  static const unsigned int num_SG_en_words_ = max_num_SG_ / 16; /// number of SG_GENS_EN registers
+  static const BDWord SG_prog_unknown_ = ~BDWord(0); /// wider than any SG program word
+
   /// array mapping SG generator idx -> enabled/disabled
   std::vector<std::array<bool, max_num_SG_>> SG_en_;
   void InitSGEn(unsigned int core_id) {
     for (auto& it : SG_en_.at(core_id)) {
       it = false;
     } 
+    InvalidateSGsSent(core_id);
+  }
+
+  /// What was last sent to the SG registers/program memory, so repeated calls only send changes.
+  /// Reflects call order, like SG_en_. SG_prog_sent_ and num_SG_words_sent_ are guarded by governor_lock_
+  std::vector<std::array<uint16_t, num_SG_en_words_>> SG_en_words_sent_;
+  std::vector<bool> SG_en_words_sent_valid_;
+  std::vector<int> SG_gens_used_sent_; /// -1 if unknown
+  std::vector<std::array<BDWord, max_num_SG_>> SG_prog_sent_; /// SG_prog_unknown_ if unknown
+  std::vector<uint64_t> num_SG_words_sent_;
+
+  /// Forget what was sent, the next SendSGEns() sends everything
+  void InvalidateSGsSent(unsigned int core_id) {
+    SG_en_words_sent_valid_.at(core_id) = false;
+    SG_gens_used_sent_.at(core_id) = -1;
+    std::unique_lock<std::mutex> lock(governor_lock_);
+    SG_prog_sent_.at(core_id).fill(SG_prog_unknown_);
   }
-  /// send current SG_en_ values
-  void SendSGEns(unsigned int core_id, BDTime time);
+
+  /// send SG_en_ words and SG_GENS_USED, if they differ from what was last sent.
+  /// Returns number of words sent. Call with governor_lock_ held
+  unsigned int SendSGEns(unsigned int core_id, BDTime time);
+
+  /// SG program word for one generator
+  BDWord PackSGProgWord(unsigned int gen_idx, unsigned int tag, int signed_rate) const;
 
   /// FPGA time units per microsecond
   inline uint64_t NsToUnits(BDTime   ns)    { return ns / ns_per_unit_; }
@@ -1072,9 +1499,34 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int> RecvSpikeFilterStat
   /// Issues two push words (PAT dumps) to force out the 2 trapped words
   void IssuePushWords();
 
+  /// Programming the AM dumps what was there before. Pushes and drops the <num_words>
+  /// that come back, warns if there are more or fewer.
+  /// <issue_pushs> = false if the push words have already been sent
+  void SinkAMDump(unsigned int core_id, unsigned int num_words, bool issue_pushs=true);
+
+  /// AttachBD() helpers
+  bool ReadAttachState(const std::string &filename, std::vector<BDState> *states) const;
+  /// Dump up to <samples_per_mem> windows of each memory on every core, all of them
+  /// sent before any are received. Returns the number of programmed entries that
+  /// don't match bd_state_
+  unsigned int VerifyMemSamples(unsigned int samples_per_mem);
+  /// Send every valid register in bd_state_ except the traffic toggles
+  void ResendBDRegisters(unsigned int core_id);
+  /// Mark the AM/MM/TAT entries bd_state_ holds something other than InitBD()'s defaults in
+  /// as the running network's, everything else free
+  void RebuildMemAllocs(unsigned int core_id);
+
   /// best-of-driver's-knowledge state of bd hardware
   std::vector<BDState> bd_state_;
 
+  /// per core, which AM/MM/TAT entries the running and the next network use, see StageMem()
+  std::vector<std::unordered_map<bdpars::BDMemId, MemAllocator, EnumClassHash>> mem_allocs_;
+  /// AM words StageMem() dumped that haven't been sunk yet
+  std::vector<unsigned int> staged_AM_dump_words_;
+  /// when PauseTraffic() was last called, and the total time paused, per core
+  std::vector<std::chrono::high_resolution_clock::time_point> pause_start_;
+  std::vector<BDTime> traffic_paused_ns_;
+
   /// parameters describing Opal Kelly hardware
   OKPars ok_pars_;
 
@@ -1087,8 +1539,36 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int> RecvSpikeFilterStat
   std::vector<EncInput> timed_queue_;
   unsigned int curr_sequence_num_ = 0; // reset with each flush
 
+  /// releases streamed timed traffic to enc_bulk_buf_in_ as FPGA time advances
+  TimedFeeder *feeder_;
+  BDTime stream_window_ns_ = driverpars::FEEDER_DEFAULT_WINDOW_NS;
+  /// see SetBulkLead()
+  BDTime bulk_lead_ns_ = 0;
+
+  /// generates host spike trains for feeder_ to release as FPGA time advances
+  SpikeTrainGenerator *spike_gen_;
+
+  /// last SetRealTimeMode() config
+  RealTimeConfig realtime_config_;
+
+  /// upstream shared memory broadcast, see StartBroadcast()
+  ShmRingWriter *broadcast_ = nullptr;
+
+  /// network image capture, see BeginNetworkImage()
+  bool capturing_image_ = false;
+  std::vector<EncInput> image_inputs_;
+  std::vector<BDState> image_start_states_;
+  std::vector<uint32_t> image_AM_dump_words_;
+
+  /// Flush() implementation, <stream_timed> sends the timed traffic to feeder_
+  void FlushQueues(bool stream_timed);
+  /// move sequenced_queue_ to <buf> (or to image_inputs_, while capturing)
+  void PushSequenced(MutexBuffer<EncInput> *buf);
+
   /// thread-safe, MPMC buffer between breadth of downstream driver API and the encoder
   MutexBuffer<EncInput> *enc_buf_in_;
+  /// same, for timed traffic: the encoder's bulk lane
+  MutexBuffer<EncInput> *enc_bulk_buf_in_;
   /// thread-safe, MPMC buffer between the encoder and comm
   MutexBuffer<EncOutput> *enc_buf_out_;
 
@@ -1097,11 +1577,71 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int> RecvSpikeFilterStat
   /// thread-safe, MPMC buffer between comm and decoder
   MutexBuffer<DecInput> *dec_buf_in_;
 
-  /// vector of thread-safe, MPMC buffers between decoder and breadth of upstream driver API
-  std::unordered_map<uint8_t, MutexBuffer<DecOutput> *> dec_bufs_out_;
-
-  /// deserializers for upstream traffic
-  std::unordered_map<uint8_t, VectorDeserializer<DecOutput> *> up_ep_deserializers_;
+  /// thread-safe, MPMC buffers between decoder and breadth of upstream driver API,
+  /// dec_bufs_out_[core_id][ep_code]
+  std::vector<Decoder::OutputBufs> dec_bufs_out_;
+  /// notified by all of a core's dec_bufs_out_, for RecvFromEPs(), dec_bufs_out_signals_[core_id]
+  std::vector<PushSignal *> dec_bufs_out_signals_;
+  /// upstream history the decoder keeps, see SetRetention(), retention_stores_[core_id][ep_code]
+  std::vector<std::unordered_map<uint8_t, OutputStore *>> retention_stores_;
+  /// retention_stores_[core_id] for <up_ep_code>, nullptr if it isn't retained. Hold retention_lock_
+  OutputStore * GetRetentionStore(unsigned int core_id, uint8_t up_ep_code);
+  /// guards retention_stores_ (not the stores)
+  std::mutex retention_lock_;
+
+  /// what's been given to the decoder for each core/ep, see SetSubscription(), subscriptions_[core_id][ep_code]
+  std::vector<std::unordered_map<uint8_t, Decoder::OutputFilter>> subscriptions_;
+  /// RouteSubscription()'s queues by name, kept until the Driver is destroyed
+  std::unordered_map<std::string, MutexBuffer<DecOutput> *> subscription_queues_;
+  /// guards subscriptions_ and subscription_queues_
+  std::mutex subscription_lock_;
+  /// StartTagBinning()'s binner, shared with the decoder hooks feeding it
+  struct TagBinning {
+    std::mutex lock;
+    TagBinner binner;
+    explicit TagBinning(const std::vector<BDTime>& bin_edges) : binner(bin_edges) {}
+  };
+  /// tag_binnings_[core_id], nullptr if not binning. Guarded by tag_binning_lock_
+  std::vector<std::shared_ptr<TagBinning>> tag_binnings_;
+  std::mutex tag_binning_lock_;
+  /// StartHostSpikeFilters()'s banks, nullptr if not filtering. Guarded by host_filter_lock_
+  std::vector<std::shared_ptr<SpikeFilterBank>> host_filter_banks_;
+  std::mutex host_filter_lock_;
+  /// StartRateMap()'s maps, nullptr if not estimating. Guarded by rate_map_lock_, which the decoder never takes
+  std::vector<std::shared_ptr<RateMap>> rate_maps_;
+  std::mutex rate_map_lock_;
+  /// StartRateGovernor()'s state for one core
+  struct RateGoverning {
+    RateGovernor governor;
+    bool active;
+    /// what SetSpikeGeneratorRates() was asked for, by generator: {tag, rate, time (ns)}
+    std::unordered_map<unsigned int, std::tuple<unsigned int, int, BDTime>> requested;
+    explicit RateGoverning(const RateGovernorConfig& config) : governor(config), active(true) {}
+  };
+  /// governings_[core_id], nullptr if never started. Guarded by governor_lock_, which the decoder takes
+  /// inside its hooks_lock_, so don't set hooks while holding it. Also guards SG_prog_sent_ and
+  /// num_SG_words_sent_, which GovernRates() updates from the decoder thread
+  std::vector<std::unique_ptr<RateGoverning>> governings_;
+  mutable std::mutex governor_lock_;
+  /// Frame hook of StartRateGovernor(): feed the governor, and reprogram the governed SGs if the scale changed
+  void GovernRates(unsigned int core_id, BDTime time);
+
+  /// SetOutputTable()/SetPoolTable() tables of one core
+  struct TranslationTables {
+    std::vector<int> filter_outputs;
+    std::vector<unsigned int> filter_dims;
+    std::vector<int> soma_pools;
+    std::vector<unsigned int> soma_nrn_idxs;
+  };
+  std::vector<TranslationTables> translation_tables_;
+  /// guards translation_tables_
+  std::mutex translation_lock_;
+  /// Stable counting sort of [0, <ids>.size()) by <ids> (all >= 0), e.g. to group outputs by pool
+  static std::vector<unsigned int> GroupOrder(const std::vector<int>& ids);
+
+  /// subscriptions_[core_id][up_ep_code], created keeping everything if there isn't one.
+  /// nullptr if <up_ep_code> can't be filtered. Hold subscription_lock_
+  Decoder::OutputFilter * GetSubscription(unsigned int core_id, uint8_t up_ep_code);
 
   /// encodes traffic to BD
   Encoder *enc_;
@@ -1144,8 +1684,9 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int> RecvSpikeFilterStat
   /// associated with a supplied <core_id>.
   ///
   /// If <num_to_recv> is zero, then receive whatever's currently in the buffer.
-  /// Returns vector of deserialized payloads. For payloads that don't need to be deserialized,
-  /// that might come from multiple cores, or that need time_epoch information,
+  /// Returns vector of payloads, outputs that span two FPGA words come back whole
+  /// (the Decoder puts them back together), timed by their second word.
+  /// For payloads that might come from multiple cores, or that need time_epoch information,
   /// This isn't the most effective call.
   std::pair<std::vector<BDWord>,
             std::vector<BDTime>>
@@ -1157,6 +1698,13 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int> RecvSpikeFilterStat
             std::vector<BDTime>>
     RecvFromEP(unsigned int core_id, T ep_enum, unsigned int timeout_us=0) { return RecvFromEP(core_id, kBDPars_.UpEPCodeFor(ep_enum), timeout_us); }
 
+  /// Pop everything in <buf> (an ep's output buffer or a subscription queue), times in ns
+  std::pair<std::vector<BDWord>,
+            std::vector<BDTime>>
+    RecvFromBuf(MutexBuffer<DecOutput> *buf, unsigned int timeout_us);
+  /// Pop both tag output leaves into <binner>
+  void RecvTagsInto(unsigned int core_id, TagBinner *binner, unsigned int timeout_us);
+
   ////////////////////////////////
   // memory programming helpers
 
@@ -1178,7 +1726,13 @@ std::tuple<uint32_t*, uint64_t*, unsigned int, unsigned int> RecvSpikeFilterStat
   template <class AMorMMEncapsulation>
   std::vector<BDWord> PackAMMMWord(const std::vector<BDWord> &payload) const;
 
+  /// SetMem() helper: encapsulated words to send to mem_id's prog leaf
+  std::vector<BDWord> PackMemWords(bdpars::BDMemId mem_id, const std::vector<BDWord> &data, unsigned int start_addr);
+
   // helpers for DumpMem
+  /// words to send to mem_id's prog leaf to dump [start_addr, end_addr)
+  /// (for the AM, this reprograms it with what bd_state_ has)
+  std::vector<BDWord> PackDumpWords(unsigned int core_id, bdpars::BDMemId mem_id, unsigned int start_addr, unsigned int end_addr);
   void DumpMemSend(unsigned int core_id, bdpars::BDMemId mem_id, unsigned int start_addr, unsigned int end_addr);
   std::vector<BDWord> DumpMemRecv(unsigned int core_id, bdpars::BDMemId mem_id, unsigned int dump_first_n, unsigned int wait_for_us);
 
@@ -0,0 +1,198 @@
+#include "DriverManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+
+DriverManager::DriverManager(const std::vector<std::string> &ok_serials) {
+  for (auto &it : ok_serials) {
+    Driver *driver = new Driver();
+    driver->SetOKSerial(it);
+    drivers_.push_back(driver);
+  }
+  offsets_.assign(drivers_.size(), 0);
+}
+
+DriverManager::DriverManager(const std::vector<Driver *> &drivers) : drivers_(drivers) {
+  offsets_.assign(drivers_.size(), 0);
+}
+
+DriverManager::~DriverManager() {
+  for (auto &it : drivers_) {
+    delete it;
+  }
+}
+
+int DriverManager::Start() {
+  int comm_state = 0;
+  for (auto &it : drivers_) {
+    int this_state = it->Start();
+    if (this_state < 0 && comm_state == 0) {
+      comm_state = this_state;
+    }
+  }
+  return comm_state;
+}
+
+void DriverManager::Stop() {
+  for (auto &it : drivers_) it->Stop();
+}
+
+void DriverManager::InitBD() {
+  for (auto &it : drivers_) it->InitBD();
+}
+
+void DriverManager::Flush() {
+  for (auto &it : drivers_) it->Flush();
+}
+
+void DriverManager::SetTimeUnitLen(BDTime ns_per_unit) {
+  for (auto &it : drivers_) it->SetTimeUnitLen(ns_per_unit);
+}
+
+void DriverManager::SetTimePerUpHB(BDTime ns_per_hb) {
+  for (auto &it : drivers_) it->SetTimePerUpHB(ns_per_hb);
+}
+
+void DriverManager::AlignTime(unsigned int num_HBs, unsigned int timeout_us) {
+  const unsigned int N = drivers_.size();
+
+  for (auto &it : drivers_) {
+    it->ResetFPGATime();
+    it->Flush();
+  }
+
+  // host time - HB time, for the HB that got here fastest
+  std::vector<int64_t> min_delay(N, std::numeric_limits<int64_t>::max());
+  std::vector<unsigned int> num_seen(N, 0);
+  std::vector<BDTime> last_HB(N);
+  for (unsigned int i = 0; i < N; i++) {
+    last_HB[i] = drivers_[i]->GetLatestHBTime();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto done = [&] { return std::all_of(num_seen.begin(), num_seen.end(), [num_HBs](unsigned int n) { return n > num_HBs; }); };
+  while (!done() && std::chrono::steady_clock::now() - start < std::chrono::microseconds(timeout_us)) {
+    for (unsigned int i = 0; i < N; i++) {
+      BDTime HB = drivers_[i]->GetLatestHBTime();
+      if (HB == last_HB[i]) continue;
+      int64_t host_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+      last_HB[i] = HB;
+      // the first new HB may have been sent before the reset
+      if (num_seen[i]++ > 0) {
+        min_delay[i] = std::min(min_delay[i], host_ns - static_cast<int64_t>(HB));
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+
+  for (unsigned int i = 0; i < N; i++) {
+    if (num_seen[i] <= 1 || num_seen[0] <= 1) {
+      cout << "WARNING: DriverManager::AlignTime: no HBs from board " << (num_seen[i] <= 1 ? i : 0) <<
+        ", can't estimate board " << i << "'s offset" << endl;
+      offsets_[i] = 0;
+    } else {
+      offsets_[i] = min_delay[i] - min_delay[0];
+    }
+  }
+}
+
+BDTime DriverManager::ToSharedTime(unsigned int board, BDTime board_time) const {
+  int64_t shared = static_cast<int64_t>(board_time) + offsets_.at(board);
+  return shared > 0 ? shared : 0;
+}
+
+BDTime DriverManager::ToBoardTime(unsigned int board, BDTime shared_time) const {
+  int64_t board_time = static_cast<int64_t>(shared_time) - offsets_.at(board);
+  return board_time > 0 ? board_time : 0;
+}
+
+void DriverManager::SendSpikes(unsigned int board, unsigned int core_id, const std::vector<BDWord> &spikes, const std::vector<BDTime> &times, bool flush) {
+  std::vector<BDTime> board_times;
+  for (auto &it : times) board_times.push_back(ToBoardTime(board, it));
+  drivers_.at(board)->SendSpikes(core_id, spikes, board_times, flush);
+}
+
+void DriverManager::SendTags(unsigned int board, unsigned int core_id, const std::vector<BDWord> &tags, const std::vector<BDTime> &times, bool flush) {
+  std::vector<BDTime> board_times;
+  for (auto &it : times) board_times.push_back(ToBoardTime(board, it));
+  drivers_.at(board)->SendTags(core_id, tags, board_times, flush);
+}
+
+DriverManager::Merged DriverManager::RecvSpikes(unsigned int core_id, bool drain) {
+  // read the HBs first: anything a board sends after this is stamped at or after its HB
+  const BDTime watermark = drain ? std::numeric_limits<BDTime>::max() : Watermark();
+  std::vector<std::pair<std::vector<BDWord>, std::vector<BDTime>>> per_board;
+  for (auto &it : drivers_) {
+    per_board.push_back(it->RecvSpikes(core_id));
+  }
+  return Merge(per_board, watermark, &held_spikes_[core_id]);
+}
+
+DriverManager::Merged DriverManager::RecvTags(unsigned int core_id, unsigned int timeout_us, bool drain) {
+  const BDTime watermark = drain ? std::numeric_limits<BDTime>::max() : Watermark();
+  std::vector<std::pair<std::vector<BDWord>, std::vector<BDTime>>> per_board;
+  for (auto &it : drivers_) {
+    per_board.push_back(it->RecvTags(core_id, timeout_us));
+  }
+  return Merge(per_board, watermark, &held_tags_[core_id]);
+}
+
+BDTime DriverManager::Watermark() const {
+  BDTime watermark = std::numeric_limits<BDTime>::max();
+  for (unsigned int i = 0; i < drivers_.size(); i++) {
+    watermark = std::min(watermark, ToSharedTime(i, drivers_[i]->GetLatestHBTime()));
+  }
+  return watermark;
+}
+
+DriverManager::Merged DriverManager::Merge(const std::vector<std::pair<std::vector<BDWord>, std::vector<BDTime>>> &per_board,
+                                           BDTime watermark, std::vector<Held> *held) const {
+  held->resize(per_board.size());
+
+  std::vector<unsigned int> boards;
+  std::vector<BDWord> words;
+  std::vector<BDTime> times;
+  for (unsigned int i = 0; i < per_board.size(); i++) {
+    Held &board_held = held->at(i);
+    board_held.words.insert(board_held.words.end(), per_board[i].first.begin(), per_board[i].first.end());
+    for (auto &it : per_board[i].second) {
+      board_held.times.push_back(ToSharedTime(i, it));
+    }
+
+    // each board's stream is in time order, release the part up to the watermark
+    unsigned int num_ready = std::upper_bound(board_held.times.begin(), board_held.times.end(), watermark) - board_held.times.begin();
+    boards.insert(boards.end(), num_ready, i);
+    words.insert(words.end(), board_held.words.begin(), board_held.words.begin() + num_ready);
+    times.insert(times.end(), board_held.times.begin(), board_held.times.begin() + num_ready);
+    board_held.words.erase(board_held.words.begin(), board_held.words.begin() + num_ready);
+    board_held.times.erase(board_held.times.begin(), board_held.times.begin() + num_ready);
+  }
+
+  // a stable sort keeps each board's order (and puts lower boards first on ties)
+  std::vector<unsigned int> order(words.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&times](unsigned int a, unsigned int b) { return times[a] < times[b]; });
+
+  Merged merged;
+  for (auto idx : order) {
+    std::get<0>(merged).push_back(boards[idx]);
+    std::get<1>(merged).push_back(words[idx]);
+    std::get<2>(merged).push_back(times[idx]);
+  }
+  return merged;
+}
+
+}  // bddriver
+}  // pystorm
@@ -0,0 +1,113 @@
+#ifndef DRIVERMANAGER_H
+#define DRIVERMANAGER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Driver.h"
+#include "common/BDWord.h"
+#include "common/DriverTypes.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// DriverManager runs several boards from one process.
+///
+/// Each board gets its own Driver, so its own comm, encoder/decoder threads, and BDStates.
+/// Calls for one board go through Board(i). The calls here fan out to every board, or
+/// merge their upstream streams.
+///
+/// Each FPGA counts time from its own ResetFPGATime(), and the boards can't all be reset
+/// at the same instant. AlignTime() resets them back to back, then estimates each board's
+/// clock offset from when its heartbeats arrive. Times going in and out of the manager are
+/// on a shared time base, board 0's clock.
+///
+/// A board's upstream words are only handed out once every board's latest HB has passed
+/// their time, so a slower board can't deliver words older than ones already returned.
+class DriverManager {
+ public:
+  /// One Driver per Opal Kelly serial number
+  DriverManager(const std::vector<std::string> &ok_serials);
+  /// Takes ownership of <drivers> (e.g. BDModelDrivers, for testing)
+  DriverManager(const std::vector<Driver *> &drivers);
+  ~DriverManager();
+
+  unsigned int NumBoards() const { return drivers_.size(); }
+  Driver *Board(unsigned int board) { return drivers_.at(board); }
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Calls made on every board
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// Start every board. Returns 0 if they all started, otherwise the first failing comm state
+  int Start();
+  void Stop();
+  void InitBD();
+  void Flush();
+  void SetTimeUnitLen(BDTime ns_per_unit);
+  void SetTimePerUpHB(BDTime ns_per_hb);
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Shared time base
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// Reset every board's FPGA clock, back to back, then estimate the clock offsets from
+  /// <num_HBs> upstream HBs per board (waits at most <timeout_us>).
+  /// A board's offset is the smallest (arrival time - HB time) seen, minus board 0's:
+  /// the HB that arrives fastest is the best estimate of when it was sent
+  void AlignTime(unsigned int num_HBs = 8, unsigned int timeout_us = 1000000);
+  /// board time + offset = shared time (ns)
+  int64_t GetTimeOffset(unsigned int board) const { return offsets_.at(board); }
+  BDTime ToSharedTime(unsigned int board, BDTime board_time) const;
+  BDTime ToBoardTime(unsigned int board, BDTime shared_time) const;
+
+  ////////////////////////////////////////////////////////////////////////////
+  // Merged streams, times on the shared time base
+  ////////////////////////////////////////////////////////////////////////////
+
+  /// Send spikes/tags to one board
+  void SendSpikes(unsigned int board, unsigned int core_id, const std::vector<BDWord> &spikes, const std::vector<BDTime> &times, bool flush=true);
+  void SendTags(unsigned int board, unsigned int core_id, const std::vector<BDWord> &tags, const std::vector<BDTime> &times, bool flush=true);
+
+  /// Spikes from every board, in time order, up to the oldest board's latest HB.
+  /// Later spikes are held for the next call, <drain> returns them too (e.g. once the boards are stopped).
+  /// Returns {boards, spikes, times}
+  std::tuple<std::vector<unsigned int>,
+             std::vector<BDWord>,
+             std::vector<BDTime>> RecvSpikes(unsigned int core_id, bool drain=false);
+  /// Tags from every board, in time order, up to the oldest board's latest HB (see RecvSpikes).
+  /// Returns {boards, tags, times}
+  std::tuple<std::vector<unsigned int>,
+             std::vector<BDWord>,
+             std::vector<BDTime>> RecvTags(unsigned int core_id, unsigned int timeout_us=1000, bool drain=false);
+
+ private:
+  std::vector<Driver *> drivers_;
+  std::vector<int64_t> offsets_;
+
+  /// one board's words (shared times) that came in past the watermark
+  struct Held {
+    std::vector<BDWord> words;
+    std::vector<BDTime> times;
+  };
+  /// per core, per board
+  std::map<unsigned int, std::vector<Held>> held_spikes_;
+  std::map<unsigned int, std::vector<Held>> held_tags_;
+
+  /// oldest latest HB over the boards, in shared time
+  BDTime Watermark() const;
+
+  typedef std::tuple<std::vector<unsigned int>, std::vector<BDWord>, std::vector<BDTime>> Merged;
+  /// per_board[i] is board i's {words, times}: convert the times, add them to <held>,
+  /// and merge what's at or before <watermark>
+  Merged Merge(const std::vector<std::pair<std::vector<BDWord>, std::vector<BDTime>>> &per_board,
+               BDTime watermark, std::vector<Held> *held) const;
+};
+
+}  // bddriver
+}  // pystorm
+
+#endif
@@ -5,11 +5,13 @@
 #include <deque>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
-//#include <string>
 
+#include "comm/CommTrace.h"
 #include "common/MutexBuffer.h"
 
 namespace pystorm {
@@ -65,6 +67,8 @@ typedef std::vector<COMMWord> COMMWordStream;
 ///
 class Comm {
  public:
+  virtual ~Comm() {}
+
   /// Sets the Comm to a streaming state where words can read and written
   virtual void StartStreaming() = 0;
 
@@ -83,6 +87,51 @@ class Comm {
 
   /// Returns a unique identifier of the attached communications hardware
   virtual std::string GetHWID() = 0;
+
+  /// Pin the comm thread to <cpu> (-1 for any), run it under SCHED_FIFO at <fifo_priority>
+  /// (0 for the default scheduler), and busy-poll for <spin_us> instead of sleeping between polls.
+  /// See Driver::SetRealTimeMode(). Returns false if unsupported or refused by the OS
+  virtual bool SetThreadConfig(int cpu, int fifo_priority, unsigned int spin_us) {
+    if (cpu >= 0 || fifo_priority > 0 || spin_us > 0) {
+      std::cout << "WARNING: Comm::SetThreadConfig: not supported by this Comm type" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  /// Record every frame read from and written to the device to the trace file <path>
+  /// (see CommTraceWriter), replacing any capture in progress.
+  /// Returns false (with a warning) if the file can't be opened
+  bool StartCapture(const std::string &path) {
+    std::unique_ptr<CommTraceWriter> writer(new CommTraceWriter(path));
+    if (!writer->IsOpen()) return false;
+    std::unique_lock<std::mutex> lock(capture_lock_);
+    capture_ = std::move(writer);
+    capturing_ = true;
+    return true;
+  }
+
+  /// Stop recording and close the trace file. Returns the number of frames recorded
+  uint64_t StopCapture() {
+    std::unique_lock<std::mutex> lock(capture_lock_);
+    uint64_t num_frames = capture_ ? capture_->GetNumFrames() : 0;
+    capture_.reset();
+    capturing_ = false;
+    return num_frames;
+  }
+
+ protected:
+  /// Implementations call this for each frame they move, from their comm thread
+  void CaptureFrame(CommTraceDir dir, const std::vector<COMMWord> &frame) {
+    if (!capturing_) return;
+    std::unique_lock<std::mutex> lock(capture_lock_);
+    if (capture_) capture_->Record(dir, frame.data(), frame.size());
+  }
+
+ private:
+  std::mutex capture_lock_;
+  std::unique_ptr<CommTraceWriter> capture_;
+  std::atomic<bool> capturing_{false}; /// lets CaptureFrame() skip the lock when not capturing
 };
 
 }  // comm namespace
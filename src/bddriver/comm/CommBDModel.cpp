@@ -1,10 +1,15 @@
 #include "CommBDModel.h"
 
+#include <cassert>
 #include <chrono>
 #include <thread>
 #include <memory>
 
+#include "common/RealTime.h"
+#include "common/BDWord.h"
+#include "decoder/Decoder.h"
 #include "encoder/Encoder.h"
+#include "model/BDModelUtil.h"
 
 #include <iostream>
 using std::cout;
@@ -15,13 +20,15 @@ namespace bddriver {
 namespace comm {
 
 CommBDModel::CommBDModel(
-    bdmodel::BDModel * model,
+    const std::vector<bdmodel::BDModel *> &models,
     MutexBuffer<COMMWord>* read_buffer,
     MutexBuffer<COMMWord>* write_buffer) {
-  model_ = model;
+  assert(models.size() > 0);
+  models_ = models;
   read_buffer_ = read_buffer;
   write_buffer_ = write_buffer;
   stream_state_ = CommStreamState::STOPPED;
+  spin_us_ = 0;
 }
 
 CommBDModel::~CommBDModel() {
@@ -30,29 +37,88 @@ CommBDModel::~CommBDModel() {
 
 void CommBDModel::RunOnce() {
   // pop from MB
-  unsigned int try_for_us = driverpars::BDMODELCOMM_TRY_FOR_US;
+  // when spinning, come back around quickly to pick up new upstream traffic
+  unsigned int try_for_us = spin_us_ > 0 ? 1 : driverpars::BDMODELCOMM_TRY_FOR_US;
   std::vector<std::unique_ptr<std::vector<COMMWord>>> inputs = write_buffer_->PopAll(try_for_us);
 
   // shouldn't need a deserializer, there's no USB to break up the transmission
 
   // parse inputs
   for (auto& input : inputs) {
-    model_->ParseInput(*input);
+    CaptureFrame(CommTraceDir::DOWN, *input);
+    if (models_.size() == 1) {
+      models_[0]->ParseInput(*input);
+    } else {
+      RouteInput(*input);
+    }
   }
 
   // get outputs
   std::unique_ptr<std::vector<COMMWord>> outputs(new std::vector<COMMWord>);
-  *outputs = model_->GenerateOutputs();
+  *outputs = models_.size() == 1 ? models_[0]->GenerateOutputs() : MergeOutputs();
 
   // push to MB
-  read_buffer_->Push(std::move(outputs));
+  if (outputs->size() > 0) {
+    CaptureFrame(CommTraceDir::UP, *outputs);
+    read_buffer_->Push(std::move(outputs));
+  }
+}
+
+void CommBDModel::RouteInput(const std::vector<COMMWord> &input) {
+  const bdpars::BDPars *pars = models_[0]->GetBDPars();
+  std::vector<uint32_t> words = bdmodel::FPGAInput(input, pars);
+  assert(words.size() % 2 == 0);
+
+  // each packet is a word and its route word, like the router FPGA's deserializer sees it
+  std::vector<std::vector<uint32_t>> core_words(models_.size());
+  for (unsigned int i = 0; i < words.size(); i += 2) {
+    unsigned int hops = GetField<FPGARoute>(words[i+1], FPGARoute::HOPS);
+    assert(hops >= 1 && hops <= models_.size());
+    core_words[hops - 1].push_back(words[i]);
+  }
+
+  for (unsigned int i = 0; i < models_.size(); i++) {
+    if (core_words[i].size() > 0) {
+      models_[i]->ParseInput(bdmodel::FPGAOutput(core_words[i], pars));
+    }
+  }
+}
+
+std::vector<COMMWord> CommBDModel::MergeOutputs() {
+  // each model pads its output with nops, but the decoder stops reading a block at the
+  // first nop: strip them, and pad the merged output instead
+  const bdpars::BDPars *pars = models_[0]->GetBDPars();
+  const uint8_t nop_code = pars->UpEPCodeFor(bdpars::FPGAOutputEP::NOP);
+  const uint8_t core_code = pars->UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_CORE);
+
+  std::vector<uint32_t> merged;
+  for (unsigned int i = 0; i < models_.size(); i++) {
+    bool header_sent = false;
+    for (auto& it : bdmodel::FPGAInput(models_[i]->GenerateOutputs(), pars)) {
+      if (GetField<FPGAIO>(it, FPGAIO::EP_CODE) == nop_code) continue;
+      if (!header_sent) {
+        merged.push_back(PackWord<FPGAIO>({{FPGAIO::EP_CODE, core_code}, {FPGAIO::PAYLOAD, i}}));
+        header_sent = true;
+      }
+      merged.push_back(it);
+    }
+  }
+
+  const unsigned int kWordsPerBlock = driverpars::READ_BLOCK_SIZE / Decoder::BYTES_PER_WORD;
+  const unsigned int to_complete_block = (kWordsPerBlock - merged.size() % kWordsPerBlock) % kWordsPerBlock;
+  uint32_t nop = PackWord<FPGAIO>({{FPGAIO::EP_CODE, nop_code}, {FPGAIO::PAYLOAD, 0}});
+  merged.insert(merged.end(), to_complete_block, nop);
+
+  return bdmodel::FPGAOutput(merged, pars);
 }
 
 void CommBDModel::Run() {
   while (GetStreamState() == CommStreamState::STARTED) {
     RunOnce();
-    unsigned int sleep_for_us = driverpars::BDMODELCOMM_SLEEP_FOR_US;
-    std::this_thread::sleep_for(std::chrono::microseconds(sleep_for_us));
+    if (spin_us_ == 0) {
+      unsigned int sleep_for_us = driverpars::BDMODELCOMM_SLEEP_FOR_US;
+      std::this_thread::sleep_for(std::chrono::microseconds(sleep_for_us));
+    }
   }
 }
 
@@ -60,7 +126,20 @@ void CommBDModel::StartStreaming() {
   if (GetStreamState() == CommStreamState::STOPPED) {
     stream_state_ = CommStreamState::STARTED;
     thread_ = std::thread(&CommBDModel::Run, this);
+    if (cpu_ >= 0 || fifo_priority_ > 0) {
+      ConfigureThread(&thread_, cpu_, fifo_priority_);
+    }
+  }
+}
+
+bool CommBDModel::SetThreadConfig(int cpu, int fifo_priority, unsigned int spin_us) {
+  cpu_ = cpu;
+  fifo_priority_ = fifo_priority;
+  spin_us_ = spin_us;
+  if (GetStreamState() == CommStreamState::STARTED) {
+    return ConfigureThread(&thread_, cpu_, fifo_priority_);
   }
+  return true;
 }
 
 void CommBDModel::StopStreaming() {
@@ -6,6 +6,7 @@
 #include "Comm.h"
 
 #include <atomic>
+#include <vector>
 
 #include "model/BDModel.h"
 #include "common/MutexBuffer.h"
@@ -19,12 +20,22 @@ namespace comm {
 /// traffic streams as if they were from the BD hardware.
 /// Takes BDModel ptr as an argument, user controls BDModel directly to 
 /// create upstream traffic.
+///
+/// With one model per core, CommBDModel also plays the BrainDrizzle router:
+/// downstream packets go to the model their route word names, and each model's
+/// upstream words go out behind an UPSTREAM_CORE word.
 class CommBDModel : public Comm {
  public:
 
   CommBDModel(
       bdmodel::BDModel * model,
       MutexBuffer<COMMWord>* read_buffer,
+      MutexBuffer<COMMWord>* write_buffer) : CommBDModel(std::vector<bdmodel::BDModel *>(1, model), read_buffer, write_buffer) {};
+
+  /// <models>[i] is core i
+  CommBDModel(
+      const std::vector<bdmodel::BDModel *> &models,
+      MutexBuffer<COMMWord>* read_buffer,
       MutexBuffer<COMMWord>* write_buffer);
   ~CommBDModel();
 
@@ -37,13 +48,19 @@ class CommBDModel : public Comm {
 
   /// Create getter function for HW ID, which in the case of the OK, is a serial number
   std::string GetHWID();
+
+  bool SetThreadConfig(int cpu, int fifo_priority, unsigned int spin_us);
  private:
   // I can't think of how this would be subclassed, so private
   
   std::thread thread_; /// worker thread 
   
   std::atomic<CommStreamState> stream_state_; // atomic because StartStreaming/StopStreaming don't gain lock
-  bdmodel::BDModel * model_;
+
+  int cpu_ = -1; // see SetThreadConfig()
+  int fifo_priority_ = 0;
+  std::atomic<unsigned int> spin_us_; // if > 0, don't sleep between polls
+  std::vector<bdmodel::BDModel *> models_;
 
   MutexBuffer<COMMWord>* read_buffer_; /// output buffer
   MutexBuffer<COMMWord>* write_buffer_; /// input buffer
@@ -51,6 +68,10 @@ class CommBDModel : public Comm {
   // feed write_buffer_ into BDModel, use BDModel to feed read_buffer_
   void Run();
   void RunOnce();
+
+  // multi-core: split downstream packets by route, merge upstream words by core
+  void RouteInput(const std::vector<COMMWord> &input);
+  std::vector<COMMWord> MergeOutputs();
 };
 
 }  // comm namespace
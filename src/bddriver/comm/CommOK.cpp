@@ -1,4 +1,5 @@
 #include "CommOK.h"
+#include "common/RealTime.h"
 #include <chrono>
 #include <iostream>
 //#include <string>
@@ -67,7 +68,19 @@ void CommOK::StartStreaming() {
   if (CommStreamState::STOPPED == GetStreamState()) {
     m_state = CommStreamState::STARTED;
     m_control_thread = std::thread(&CommOK::CommController, this);
+    if (m_cpu >= 0 || m_fifo_priority > 0) {
+      ConfigureThread(&m_control_thread, m_cpu, m_fifo_priority);
+    }
+  }
+}
+
+bool CommOK::SetThreadConfig(int cpu, int fifo_priority, unsigned int spin_us) {
+  m_cpu = cpu;
+  m_fifo_priority = fifo_priority;
+  if (CommStreamState::STARTED == GetStreamState()) {
+    return ConfigureThread(&m_control_thread, m_cpu, m_fifo_priority);
   }
+  return true;
 }
 
 void CommOK::StopStreaming() {
@@ -108,6 +121,8 @@ int CommOK::WriteToDevice() {
     assert(blocks->size() % driverpars::WRITE_BLOCK_SIZE == 0);
     assert(blocks->size() <= driverpars::MAX_WRITE_SIZE);
 
+    CaptureFrame(CommTraceDir::DOWN, *blocks);
+
     //auto start = std::chrono::high_resolution_clock::now();
     
     int last_status = dev.WriteToBlockPipeIn(PIPE_IN_ADDR, driverpars::WRITE_BLOCK_SIZE, blocks->size(), blocks->data());
@@ -151,6 +166,7 @@ int CommOK::ReadFromDevice() {
     assert(num_bytes == driverpars::READ_SIZE);
 
     if (num_bytes > 0) {
+      CaptureFrame(CommTraceDir::UP, *read_buffer);
       m_read_buffer->Push(std::move(read_buffer));
     }
     return num_bytes;
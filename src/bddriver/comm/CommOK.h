@@ -48,11 +48,16 @@ public:
     /// Create getter function for HW ID, which in the case of the OK, is a serial number
     std::string GetHWID();
 
+    /// The controller loop never sleeps, so <spin_us> doesn't matter
+    bool SetThreadConfig(int cpu, int fifo_priority, unsigned int spin_us);
+
 protected:
   MutexBuffer<COMMWord>* m_read_buffer;
   MutexBuffer<COMMWord>* m_write_buffer;
   std::atomic<CommStreamState> m_state;
   std::thread m_control_thread;
+  int m_cpu = -1; // see SetThreadConfig()
+  int m_fifo_priority = 0;
 
   void CommController();
 
@@ -0,0 +1,119 @@
+#include "CommReplay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "common/DriverPars.h"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+namespace comm {
+
+CommReplay::CommReplay(
+    const std::string &trace_path,
+    MutexBuffer<COMMWord>* read_buffer,
+    MutexBuffer<COMMWord>* write_buffer,
+    bool paced)
+  : trace_path_(trace_path),
+  paced_(paced),
+  read_buffer_(read_buffer),
+  write_buffer_(write_buffer),
+  state_(CommStreamState::STOPPED),
+  done_(false),
+  num_frames_replayed_(0),
+  num_bytes_written_(0) {
+}
+
+CommReplay::~CommReplay() {
+  StopStreaming();
+}
+
+void CommReplay::StartStreaming() {
+  if (GetStreamState() == CommStreamState::STOPPED) {
+    state_ = CommStreamState::STARTED;
+    thread_ = std::thread(&CommReplay::Run, this);
+  }
+}
+
+void CommReplay::StopStreaming() {
+  if (GetStreamState() == CommStreamState::STARTED) {
+    state_ = CommStreamState::STOPPED;
+  }
+
+  if (thread_.joinable()) thread_.join();
+}
+
+std::string CommReplay::GetHWID() {
+  return "replay:" + trace_path_;
+}
+
+void CommReplay::DrainWrites(unsigned int try_for_us) {
+  if (try_for_us == 0 && write_buffer_->TotalSize() == 0) return;
+
+  for (auto& frame : write_buffer_->PopAll(std::max(try_for_us, 1u))) {
+    CaptureFrame(CommTraceDir::DOWN, *frame);
+    num_bytes_written_ += frame->size();
+  }
+}
+
+void CommReplay::Run() {
+  done_ = false;
+  num_frames_replayed_ = 0;
+
+  CommTraceReader reader(trace_path_);
+  CommTraceFrame next;
+  bool have_next = false;
+  uint64_t first_time_ns = 0;
+  bool first = true;
+
+  auto start = std::chrono::steady_clock::now();
+  while (GetStreamState() == CommStreamState::STARTED) {
+
+    // find the next upstream frame
+    while (!have_next && reader.Next(&next)) {
+      have_next = next.dir == CommTraceDir::UP;
+    }
+    if (!have_next) {
+      done_ = true;
+      DrainWrites(driverpars::REPLAY_POLL_US);
+      continue;
+    }
+    if (first) {
+      first_time_ns = next.time_ns;
+      first = false;
+    }
+
+    if (paced_) {
+      // wait for the frame's time, picking up writes in the meantime
+      auto due = start + std::chrono::nanoseconds(next.time_ns - first_time_ns);
+      auto now = std::chrono::steady_clock::now();
+      if (now < due) {
+        unsigned int until_due_us = std::chrono::duration_cast<std::chrono::microseconds>(due - now).count();
+        DrainWrites(std::min(until_due_us, driverpars::REPLAY_POLL_US));
+        continue;
+      }
+    } else if (read_buffer_->TotalSize() > driverpars::REPLAY_MAX_QUEUED_BYTES) {
+      // don't outrun the decoder by more than a little
+      DrainWrites(driverpars::REPLAY_POLL_US);
+      continue;
+    }
+
+    CaptureFrame(CommTraceDir::UP, next.data);
+    read_buffer_->Push(std::make_unique<std::vector<COMMWord>>(std::move(next.data)));
+    num_frames_replayed_++;
+    have_next = false;
+
+    DrainWrites(0);
+  }
+}
+
+}  // comm namespace
+}  // bddriver namespace
+}  // pystorm namespace
@@ -0,0 +1,72 @@
+#ifndef COMMREPLAY_H
+#define COMMREPLAY_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "Comm.h"
+#include "CommTrace.h"
+#include "common/MutexBuffer.h"
+
+namespace pystorm {
+namespace bddriver {
+namespace comm {
+
+/// CommReplay plays a trace recorded with Comm::StartCapture() back to the driver,
+/// so the whole stack can be run against a real workload without a board.
+///
+/// The trace's upstream frames go to the decoder, either at their recorded pacing
+/// or as fast as the decoder takes them. Its downstream frames are skipped: whatever
+/// the driver writes is popped and dropped, or recorded if StartCapture() was called
+/// on the CommReplay, to compare against the original downstream traffic.
+class CommReplay : public Comm {
+ public:
+  /// <paced>: feed frames at their recorded times (relative to StartStreaming()),
+  /// otherwise as fast as possible
+  CommReplay(
+      const std::string &trace_path,
+      MutexBuffer<COMMWord>* read_buffer,
+      MutexBuffer<COMMWord>* write_buffer,
+      bool paced = true);
+  ~CommReplay();
+  CommReplay(const CommReplay&) = delete;
+
+  /// Starts the replay from the beginning of the trace
+  void StartStreaming();
+  void StopStreaming();
+  CommStreamState GetStreamState() { return state_; }
+  MutexBuffer<COMMWord>* getReadBuffer() { return read_buffer_; }
+  MutexBuffer<COMMWord>* getWriteBuffer() { return write_buffer_; }
+
+  std::string GetHWID();
+
+  /// Whether every upstream frame in the trace has been handed to the decoder
+  bool IsDone() const { return done_; }
+  /// Upstream frames handed to the decoder so far
+  uint64_t GetNumFramesReplayed() const { return num_frames_replayed_; }
+  /// Downstream bytes the driver has written so far
+  uint64_t GetNumBytesWritten() const { return num_bytes_written_; }
+
+ private:
+  std::string trace_path_;
+  bool paced_;
+  MutexBuffer<COMMWord>* read_buffer_;  /// to the decoder
+  MutexBuffer<COMMWord>* write_buffer_; /// from the encoder
+
+  std::atomic<CommStreamState> state_;
+  std::atomic<bool> done_;
+  std::atomic<uint64_t> num_frames_replayed_;
+  std::atomic<uint64_t> num_bytes_written_;
+  std::thread thread_;
+
+  void Run();
+  /// Pop whatever the driver has written, waiting up to <try_for_us> if there's nothing
+  void DrainWrites(unsigned int try_for_us);
+};
+
+}  // comm namespace
+}  // bddriver namespace
+}  // pystorm namespace
+#endif
@@ -0,0 +1,266 @@
+#include "CommSynthetic.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "common/BDWord.h"
+#include "common/DriverPars.h"
+#include "decoder/Decoder.h"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+namespace comm {
+
+CommSynthetic::CommSynthetic(
+    const bdpars::BDPars *pars,
+    MutexBuffer<COMMWord>* read_buffer,
+    MutexBuffer<COMMWord>* write_buffer,
+    BDTime ns_per_unit,
+    unsigned int units_per_HB)
+  : pars_(pars),
+  read_buffer_(read_buffer),
+  write_buffer_(write_buffer),
+  state_(CommStreamState::STOPPED),
+  rng_(load_.seed),
+  ns_per_unit_(ns_per_unit),
+  units_per_HB_(units_per_HB) {
+
+  // any code the decoder has no output buffer for, and that isn't special-cased
+  unknown_ep_code_ = 0;
+  for (unsigned int code = 0; code < bdpars::BDPars::NumEPCodes; code++) {
+    if (pars_->Up_EP_size_[code] == 0 &&
+        code != pars_->DnEPCodeFor(bdpars::BDHornEP::RI) &&
+        code != pars_->UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_CORE)) {
+      unknown_ep_code_ = code;
+      break;
+    }
+  }
+}
+
+CommSynthetic::~CommSynthetic() {
+  StopStreaming();
+}
+
+void CommSynthetic::StartStreaming() {
+  if (GetStreamState() == CommStreamState::STOPPED) {
+    state_ = CommStreamState::STARTED;
+    thread_ = std::thread(&CommSynthetic::Run, this);
+  }
+}
+
+void CommSynthetic::StopStreaming() {
+  if (GetStreamState() == CommStreamState::STARTED) {
+    state_ = CommStreamState::STOPPED;
+  }
+
+  if (thread_.joinable()) thread_.join();
+}
+
+void CommSynthetic::SetLoad(const SyntheticLoad &load) {
+  std::unique_lock<std::mutex> lock(lock_);
+  if (load.seed != load_.seed) rng_.seed(load.seed);
+  load_ = load;
+}
+
+SyntheticLoad CommSynthetic::GetLoad() {
+  std::unique_lock<std::mutex> lock(lock_);
+  return load_;
+}
+
+void CommSynthetic::SetTiming(BDTime ns_per_unit, unsigned int units_per_HB) {
+  std::unique_lock<std::mutex> lock(lock_);
+  if (ns_per_unit == ns_per_unit_ && units_per_HB == units_per_HB_) return;
+  ns_per_unit_ = ns_per_unit;
+  units_per_HB_ = units_per_HB;
+  // the FPGA's clock keeps counting, the next HB comes one new period from now
+  next_HB_units_ = elapsed_ns_ / ns_per_unit_ + units_per_HB_;
+}
+
+SyntheticStats CommSynthetic::GetStats() {
+  std::unique_lock<std::mutex> lock(lock_);
+  SyntheticStats stats = stats_;
+  stats.backlog_words = pending_.size() - pending_start_;
+  return stats;
+}
+
+void CommSynthetic::Run() {
+  const auto poll = std::chrono::microseconds(driverpars::SYNTHETIC_POLL_US);
+  const auto start = std::chrono::steady_clock::now();
+  auto next_poll = start;
+
+  while (GetStreamState() == CommStreamState::STARTED) {
+    // the board consumes whatever was written
+    unsigned int bytes_written = 0;
+    if (write_buffer_->TotalSize() > 0) {
+      for (auto& it : write_buffer_->PopAll()) {
+        CaptureFrame(CommTraceDir::DOWN, *it);
+        bytes_written += it->size();
+      }
+    }
+
+    std::unique_ptr<std::vector<COMMWord>> frame;
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      auto now = std::chrono::steady_clock::now();
+      Generate(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+      DS_queue_words_ = std::min(bytes_written / Decoder::BYTES_PER_WORD, driverpars::WRITE_FIFO_DEPTH / Decoder::BYTES_PER_WORD);
+      frame = MakeFrame();
+      stats_.num_frames++;
+    }
+
+    CaptureFrame(CommTraceDir::UP, *frame);
+    read_buffer_->Push(std::move(frame));
+
+    // like a USB read, frames can't come faster than the poll, and don't catch up if we fell behind
+    next_poll += poll;
+    auto now = std::chrono::steady_clock::now();
+    if (now < next_poll) {
+      std::this_thread::sleep_until(next_poll);
+    } else {
+      next_poll = now;
+    }
+  }
+}
+
+void CommSynthetic::Generate(uint64_t until_ns) {
+  // outputs between HBs carry the earlier HB's time, so generate each HB period separately
+  while (units_per_HB_ > 0 && next_HB_units_ * ns_per_unit_ < until_ns) {
+    uint64_t HB_ns = next_HB_units_ * ns_per_unit_;
+    if (HB_ns > elapsed_ns_) {
+      GenerateEvents(HB_ns - elapsed_ns_);
+      elapsed_ns_ = HB_ns;
+    }
+    PushOutput(pars_->UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_HB_LSB), next_HB_units_ & 0xFFFFFF, 1);
+    PushOutput(pars_->UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_HB_MSB), next_HB_units_ >> 24, 1);
+    stats_.num_HBs++;
+    next_HB_units_ += units_per_HB_;
+  }
+  if (until_ns > elapsed_ns_) {
+    GenerateEvents(until_ns - elapsed_ns_);
+    elapsed_ns_ = until_ns;
+  }
+}
+
+void CommSynthetic::GenerateEvents(uint64_t duration_ns) {
+  const double duration_s = duration_ns * 1e-9;
+  auto draw_count = [this, duration_s](double rate) -> uint64_t {
+    if (rate <= 0) return 0;
+    std::poisson_distribution<uint64_t> count(rate * duration_s);
+    return count(rng_);
+  };
+  auto draw_index = [this](unsigned int n) -> unsigned int {
+    return std::uniform_int_distribution<unsigned int>(0, std::max(n, 1u) - 1)(rng_);
+  };
+
+  uint64_t num_spikes    = draw_count(load_.spike_rate);
+  uint64_t num_acc_tags  = draw_count(load_.acc_tag_rate);
+  uint64_t num_tat_tags  = draw_count(load_.tat_tag_rate);
+  uint64_t num_sf_states = draw_count(load_.sf_state_rate);
+  uint64_t num_malformed = draw_count(load_.malformed_rate);
+  uint64_t num_overflows = draw_count(load_.overflow_rate);
+
+  // a full FPGA FIFO drops what comes in
+  uint64_t num_words = num_spikes + 2 * (num_acc_tags + num_tat_tags + num_sf_states) + num_malformed + num_overflows;
+  if (pending_.size() - pending_start_ + num_words > driverpars::SYNTHETIC_MAX_BACKLOG_WORDS) {
+    stats_.num_dropped_words += num_words;
+    return;
+  }
+
+  const uint8_t NRNI_code = pars_->UpEPCodeFor(bdpars::BDFunnelEP::NRNI);
+  for (uint64_t i = 0; i < num_spikes; i++) {
+    PushOutput(NRNI_code, PackWord<OutputSpike>({{OutputSpike::NEURON_ADDRESS, draw_index(load_.num_neurons)}}), 1);
+  }
+  const uint8_t acc_code = pars_->UpEPCodeFor(bdpars::BDFunnelEP::RO_ACC);
+  for (uint64_t i = 0; i < num_acc_tags; i++) {
+    PushOutput(acc_code, PackWord<AccOutputTag>(
+          {{AccOutputTag::COUNT, 1}, {AccOutputTag::TAG, draw_index(load_.num_tags)}, {AccOutputTag::GLOBAL_ROUTE, 0}}), 2);
+  }
+  const uint8_t tat_code = pars_->UpEPCodeFor(bdpars::BDFunnelEP::RO_TAT);
+  for (uint64_t i = 0; i < num_tat_tags; i++) {
+    PushOutput(tat_code, PackWord<TATOutputTag>(
+          {{TATOutputTag::COUNT, 1}, {TATOutputTag::TAG, draw_index(load_.num_tags)}, {TATOutputTag::GLOBAL_ROUTE, 0}}), 2);
+  }
+  const uint8_t SF_code = pars_->UpEPCodeFor(bdpars::FPGAOutputEP::SF_OUTPUT);
+  for (uint64_t i = 0; i < num_sf_states; i++) {
+    PushOutput(SF_code, PackWord<FPGASFWORD>(
+          {{FPGASFWORD::STATE, draw_index(1 << 16)}, {FPGASFWORD::FILTIDX, draw_index(load_.num_filters)}}), 2);
+  }
+
+  // alternate between words nobody decodes and words that throw off a deserializer
+  for (uint64_t i = 0; i < num_malformed; i++) {
+    if (next_malformed_unpaired_) {
+      PushOutput(tat_code, draw_index(1 << 24), 1);
+    } else {
+      PushOutput(unknown_ep_code_, draw_index(1 << 24), 1);
+    }
+    next_malformed_unpaired_ = !next_malformed_unpaired_;
+  }
+
+  const uint8_t ovflw_code = pars_->UpEPCodeFor(bdpars::BDFunnelEP::OVFLW0);
+  for (uint64_t i = 0; i < num_overflows; i++) {
+    PushOutput(ovflw_code, 0, 1);
+  }
+
+  stats_.num_spikes    += num_spikes;
+  stats_.num_acc_tags  += num_acc_tags;
+  stats_.num_tat_tags  += num_tat_tags;
+  stats_.num_sf_states += num_sf_states;
+  stats_.num_malformed += num_malformed;
+  stats_.num_overflows += num_overflows;
+}
+
+void CommSynthetic::PushOutput(uint8_t ep_code, uint64_t payload, unsigned int num_words) {
+  // multi-word outputs go LSBs first, like the FPGA serializes them
+  for (unsigned int i = 0; i < num_words; i++) {
+    uint32_t word_payload = (payload >> (i * FieldWidth(FPGAIO::PAYLOAD))) & 0xFFFFFF;
+    pending_.push_back(PackWord<FPGAIO>({{FPGAIO::EP_CODE, ep_code}, {FPGAIO::PAYLOAD, word_payload}}));
+  }
+}
+
+std::unique_ptr<std::vector<COMMWord>> CommSynthetic::MakeFrame() {
+  const unsigned int kWordsPerBlock = driverpars::READ_BLOCK_SIZE / Decoder::BYTES_PER_WORD;
+  const unsigned int kNumBlocks = driverpars::READ_SIZE / driverpars::READ_BLOCK_SIZE;
+  const uint32_t queue_ct = PackWord<FPGAIO>(
+      {{FPGAIO::EP_CODE, pars_->UpEPCodeFor(bdpars::FPGAOutputEP::DS_QUEUE_CT)}, {FPGAIO::PAYLOAD, DS_queue_words_}});
+  const uint32_t nop = PackWord<FPGAIO>(
+      {{FPGAIO::EP_CODE, pars_->UpEPCodeFor(bdpars::FPGAOutputEP::NOP)}, {FPGAIO::PAYLOAD, 0}});
+
+  std::unique_ptr<std::vector<COMMWord>> frame(new std::vector<COMMWord>(driverpars::READ_SIZE));
+  COMMWord *bytes = frame->data();
+  auto put = [&bytes](uint32_t word) {
+    bytes[0] = word & 0xFF;
+    bytes[1] = (word >> 8) & 0xFF;
+    bytes[2] = (word >> 16) & 0xFF;
+    bytes[3] = (word >> 24) & 0xFF;
+    bytes += Decoder::BYTES_PER_WORD;
+  };
+
+  for (unsigned int block = 0; block < kNumBlocks; block++) {
+    put(queue_ct);
+    for (unsigned int i = 1; i < kWordsPerBlock; i++) {
+      put(pending_start_ < pending_.size() ? pending_[pending_start_++] : nop);
+    }
+  }
+
+  // reclaim the sent words now and then
+  if (pending_start_ == pending_.size()) {
+    pending_.clear();
+    pending_start_ = 0;
+  } else if (pending_start_ > pending_.size() / 2) {
+    pending_.erase(pending_.begin(), pending_.begin() + pending_start_);
+    pending_start_ = 0;
+  }
+
+  return frame;
+}
+
+}  // comm namespace
+}  // bddriver namespace
+}  // pystorm namespace
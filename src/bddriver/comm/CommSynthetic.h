@@ -0,0 +1,123 @@
+#ifndef COMMSYNTHETIC_H
+#define COMMSYNTHETIC_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Comm.h"
+#include "common/BDPars.h"
+#include "common/DriverTypes.h"
+#include "common/MutexBuffer.h"
+
+namespace pystorm {
+namespace bddriver {
+namespace comm {
+
+/// What CommSynthetic generates. Rates are events/s, summed over all neurons/tags/filters.
+/// Each event lands at a uniformly random neuron/tag/filter, so the per-item streams are Poisson too
+struct SyntheticLoad {
+  double spike_rate      = 0; /// NRNI spikes
+  unsigned int num_neurons = 4096;
+  double acc_tag_rate    = 0; /// RO_ACC tags
+  double tat_tag_rate    = 0; /// RO_TAT tags
+  unsigned int num_tags  = 2048;
+  double sf_state_rate   = 0; /// SF_OUTPUT states
+  unsigned int num_filters = 256;
+  double malformed_rate  = 0; /// bad words: unknown ep codes and unpaired halves of two-word outputs
+  double overflow_rate   = 0; /// OVFLW0 words, as if the chip's FIFO were overflowing
+  unsigned int seed      = 0;
+};
+
+/// Counts of what CommSynthetic has generated
+struct SyntheticStats {
+  uint64_t num_frames    = 0; /// READ_SIZE frames pushed to the decoder
+  uint64_t num_spikes    = 0;
+  uint64_t num_acc_tags  = 0;
+  uint64_t num_tat_tags  = 0;
+  uint64_t num_sf_states = 0;
+  uint64_t num_malformed = 0;
+  uint64_t num_overflows = 0;
+  uint64_t num_HBs       = 0;
+  uint64_t backlog_words = 0; /// generated but not yet sent, grows if the load doesn't fit in the frames
+  uint64_t num_dropped_words = 0; /// not generated because the backlog was full, like an FPGA FIFO overflowing
+};
+
+/// CommSynthetic stands in for a fully loaded board: it generates well-formed upstream
+/// frames at the rates in a SyntheticLoad, for stress-testing the host side without a chip.
+///
+/// Every SYNTHETIC_POLL_US it hands the decoder one READ_SIZE frame, like CommOK's
+/// read loop: READ_BLOCK_SIZE blocks, each starting with a DS_QUEUE_CT word and padded
+/// with nops. Upstream HBs go out every <units_per_HB> FPGA time units of host time,
+/// and outputs are timestamped by the HB before them, like the real FPGA's.
+/// Whatever the driver writes is popped and dropped, its size shows up in the queue counts.
+/// Only core 0's traffic is generated.
+class CommSynthetic : public Comm {
+ public:
+  CommSynthetic(
+      const bdpars::BDPars *pars,
+      MutexBuffer<COMMWord>* read_buffer,
+      MutexBuffer<COMMWord>* write_buffer,
+      BDTime ns_per_unit,
+      unsigned int units_per_HB);
+  ~CommSynthetic();
+  CommSynthetic(const CommSynthetic&) = delete;
+
+  void StartStreaming();
+  void StopStreaming();
+  CommStreamState GetStreamState() { return state_; }
+  MutexBuffer<COMMWord>* getReadBuffer() { return read_buffer_; }
+  MutexBuffer<COMMWord>* getWriteBuffer() { return write_buffer_; }
+
+  std::string GetHWID() { return "synthetic"; }
+
+  /// Change the load, takes effect at the next poll. Thread-safe
+  void SetLoad(const SyntheticLoad &load);
+  SyntheticLoad GetLoad();
+  /// Match the FPGA timing the driver programmed. Thread-safe
+  void SetTiming(BDTime ns_per_unit, unsigned int units_per_HB);
+
+  SyntheticStats GetStats();
+
+ private:
+  const bdpars::BDPars *pars_;
+  MutexBuffer<COMMWord>* read_buffer_;  /// to the decoder
+  MutexBuffer<COMMWord>* write_buffer_; /// from the encoder
+
+  std::atomic<CommStreamState> state_;
+  std::thread thread_;
+
+  std::mutex lock_; /// guards everything below, the comm thread holds it for each poll
+  SyntheticLoad load_;
+  std::mt19937 rng_;
+  BDTime ns_per_unit_;
+  unsigned int units_per_HB_;
+  SyntheticStats stats_;
+
+  // generator state
+  std::vector<uint32_t> pending_;   /// FPGA words waiting for room in a frame
+  unsigned int pending_start_ = 0;
+  uint64_t elapsed_ns_ = 0;         /// host time generated up to
+  uint64_t next_HB_units_ = 0;
+  uint32_t DS_queue_words_ = 0;     /// what goes in this frame's DS_QUEUE_CT words
+  uint8_t unknown_ep_code_;         /// for malformed words
+  bool next_malformed_unpaired_ = false;
+
+  void Run();
+  /// Generate traffic for host times [elapsed_ns_, <until_ns>)
+  void Generate(uint64_t until_ns);
+  /// Draw the outputs for <duration_ns> of traffic
+  void GenerateEvents(uint64_t duration_ns);
+  void PushOutput(uint8_t ep_code, uint64_t payload, unsigned int num_words);
+  /// Pack up to a frame's worth of pending words into a READ_SIZE frame
+  std::unique_ptr<std::vector<COMMWord>> MakeFrame();
+};
+
+}  // comm namespace
+}  // bddriver namespace
+}  // pystorm namespace
+#endif
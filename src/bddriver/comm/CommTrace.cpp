@@ -0,0 +1,124 @@
+#include "CommTrace.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/DriverPars.h"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+namespace comm {
+
+static_assert(sizeof(CommTraceHeader) == 8, "CommTraceHeader layout changed");
+
+constexpr char CommTraceWriter::kMagic[4];
+constexpr uint32_t CommTraceWriter::kVersion;
+constexpr uint32_t CommTraceWriter::kDownBit;
+
+CommTraceWriter::CommTraceWriter(const std::string &path)
+  : file_buf_(driverpars::COMM_TRACE_FILE_BUF_BYTES),
+  start_(std::chrono::steady_clock::now()) {
+
+  // the comm thread writes to this, so buffer generously
+  file_.rdbuf()->pubsetbuf(file_buf_.data(), file_buf_.size());
+  file_.open(path, std::ios::binary | std::ios::trunc);
+  if (!file_.is_open()) {
+    cout << "WARNING: CommTraceWriter: couldn't open " << path << " for writing" << endl;
+    return;
+  }
+
+  CommTraceHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+CommTraceWriter::~CommTraceWriter() {
+  if (file_.is_open()) file_.close();
+}
+
+void CommTraceWriter::Record(CommTraceDir dir, const COMMWord *data, unsigned int size) {
+  if (!file_.is_open()) return;
+
+  // frame headers are written field by field, 12 bytes, no padding
+  uint64_t time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+  uint32_t size_and_dir = size | (dir == CommTraceDir::DOWN ? kDownBit : 0);
+  file_.write(reinterpret_cast<const char *>(&time_ns), sizeof(time_ns));
+  file_.write(reinterpret_cast<const char *>(&size_and_dir), sizeof(size_and_dir));
+  file_.write(reinterpret_cast<const char *>(data), size);
+
+  num_frames_++;
+  num_bytes_ += size;
+}
+
+CommTraceReader::CommTraceReader(const std::string &path) {
+  file_.open(path, std::ios::binary);
+  if (!file_.is_open()) {
+    cout << "WARNING: CommTraceReader: couldn't open " << path << endl;
+    return;
+  }
+
+  CommTraceHeader header;
+  file_.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file_ ||
+      std::memcmp(header.magic, CommTraceWriter::kMagic, sizeof(header.magic)) != 0 ||
+      header.version != CommTraceWriter::kVersion) {
+    cout << "WARNING: CommTraceReader: " << path << " isn't a version " << CommTraceWriter::kVersion << " comm trace" << endl;
+    file_.close();
+    return;
+  }
+
+  std::streampos frames_start = file_.tellg();
+  file_.seekg(0, std::ios::end);
+  file_size_ = file_.tellg();
+  file_.seekg(frames_start);
+}
+
+bool CommTraceReader::Next(CommTraceFrame *frame) {
+  if (!file_.is_open()) return false;
+
+  uint64_t time_ns;
+  uint32_t size_and_dir;
+  file_.read(reinterpret_cast<char *>(&time_ns), sizeof(time_ns));
+  file_.read(reinterpret_cast<char *>(&size_and_dir), sizeof(size_and_dir));
+  if (!file_) return false;
+
+  // a corrupt size would have us allocate up to 2GB
+  uint32_t size = size_and_dir & ~CommTraceWriter::kDownBit;
+  std::streamoff bytes_left = file_size_ - static_cast<std::streamoff>(file_.tellg());
+  if (size > bytes_left) {
+    cout << "WARNING: CommTraceReader: frame of " << size << " bytes runs past the end of the trace" << endl;
+    return false;
+  }
+
+  frame->time_ns = time_ns;
+  frame->dir = size_and_dir & CommTraceWriter::kDownBit ? CommTraceDir::DOWN : CommTraceDir::UP;
+  frame->data.resize(size);
+  file_.read(reinterpret_cast<char *>(frame->data.data()), frame->data.size());
+  if (!file_) {
+    cout << "WARNING: CommTraceReader: trace ends in the middle of a frame" << endl;
+    return false;
+  }
+  return true;
+}
+
+std::vector<CommTraceFrame> LoadCommTrace(const std::string &path) {
+  std::vector<CommTraceFrame> frames;
+  CommTraceReader reader(path);
+  CommTraceFrame frame;
+  while (reader.Next(&frame)) {
+    frames.push_back(std::move(frame));
+  }
+  return frames;
+}
+
+}  // comm namespace
+}  // bddriver namespace
+}  // pystorm namespace
@@ -0,0 +1,93 @@
+#ifndef COMMTRACE_H
+#define COMMTRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace pystorm {
+namespace bddriver {
+namespace comm {
+
+typedef unsigned char COMMWord;
+
+/// Which way a traced frame went
+enum class CommTraceDir { UP = 0, DOWN = 1 };
+
+/// Trace file layout: CommTraceHeader, then one CommTraceFrameHeader + <size> bytes per frame
+struct CommTraceHeader {
+  char magic[4];
+  uint32_t version;
+};
+
+struct CommTraceFrameHeader {
+  uint64_t time_ns;      /// host time since the capture started
+  uint32_t size_and_dir; /// frame size in bytes, top bit set for downstream frames
+};
+
+/// A frame read back from a trace
+struct CommTraceFrame {
+  uint64_t time_ns;
+  CommTraceDir dir;
+  std::vector<COMMWord> data;
+};
+
+/// CommTraceWriter records the frames a Comm reads from and writes to the device,
+/// timestamped with the host clock, see Comm::StartCapture().
+/// Upstream frames are what the comm pushed to the decoder, downstream frames are
+/// what the encoder handed the comm, so CommReplay can feed the upstream ones back
+/// to the rest of the driver.
+/// Not thread-safe, Comm serializes calls.
+class CommTraceWriter {
+ public:
+  static constexpr char kMagic[4] = {'B', 'D', 'C', 'T'};
+  static constexpr uint32_t kVersion = 1;
+  static constexpr uint32_t kDownBit = 1u << 31;
+
+  /// Create (or overwrite) <path>. Check IsOpen(), prints a warning on failure
+  CommTraceWriter(const std::string &path);
+  /// flushes and closes the file
+  ~CommTraceWriter();
+
+  bool IsOpen() const { return file_.is_open(); }
+
+  /// Append a frame, timestamped now
+  void Record(CommTraceDir dir, const COMMWord *data, unsigned int size);
+
+  uint64_t GetNumFrames() const { return num_frames_; }
+  uint64_t GetNumBytes() const { return num_bytes_; }
+
+ private:
+  std::ofstream file_;
+  std::vector<char> file_buf_;
+  std::chrono::steady_clock::time_point start_;
+  uint64_t num_frames_ = 0;
+  uint64_t num_bytes_ = 0;
+};
+
+/// CommTraceReader walks a trace written by CommTraceWriter, one frame at a time
+class CommTraceReader {
+ public:
+  /// Check IsOpen(), prints a warning if <path> can't be read or isn't a trace
+  CommTraceReader(const std::string &path);
+
+  bool IsOpen() const { return file_.is_open(); }
+
+  /// Read the next frame into <frame>. False at the end of the trace (or if it's truncated,
+  /// or a frame claims to be bigger than what's left of the file)
+  bool Next(CommTraceFrame *frame);
+
+ private:
+  std::ifstream file_;
+  std::streamoff file_size_ = 0;
+};
+
+/// Read a whole trace, empty (with a warning) if it can't be read
+std::vector<CommTraceFrame> LoadCommTrace(const std::string &path);
+
+}  // comm namespace
+}  // bddriver namespace
+}  // pystorm namespace
+#endif
@@ -0,0 +1,42 @@
+#ifndef REPLAYDRIVER_H
+#define REPLAYDRIVER_H
+
+#include <string>
+
+#include "Driver.h"
+#include "comm/CommReplay.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// Specialization of Driver that runs on a recorded trace (see Driver::StartCapture())
+/// instead of a board, for benchmarking and regression-testing the stack offline.
+/// Start() begins the replay. StartCapture() records what the driver writes back,
+/// to compare against the trace's downstream frames.
+class ReplayDriver : public Driver {
+
+ public:
+  /// <paced>: feed the trace's upstream frames at their recorded times,
+  /// otherwise as fast as the decoder takes them
+  ReplayDriver(const std::string &trace_path, bool paced = true, unsigned int num_cores = 1) : Driver(num_cores) {
+    delete comm_;
+    replay_ = new comm::CommReplay( // overwrite comm_ assignment from base constructor
+        trace_path,
+        dec_buf_in_,
+        enc_buf_out_,
+        paced);
+    comm_ = replay_;
+  }
+
+  /// Whether every upstream frame in the trace has gone to the decoder
+  bool IsReplayDone() const { return replay_->IsDone(); }
+  uint64_t GetNumFramesReplayed() const { return replay_->GetNumFramesReplayed(); }
+
+ private:
+  comm::CommReplay *replay_; /// same as comm_, deleted by Driver
+};
+
+}  // bddriver namespace
+}  // pystorm namespace
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SYNTHETICDRIVER_H
+#define SYNTHETICDRIVER_H
+
+#include "Driver.h"
+#include "comm/CommSynthetic.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// Specialization of Driver that runs on CommSynthetic's generated upstream load
+/// instead of a board, to find out how much traffic the host side can take.
+class SyntheticDriver : public Driver {
+
+ public:
+  SyntheticDriver(unsigned int num_cores = 1) : Driver(num_cores) {
+    delete comm_;
+    synthetic_ = new comm::CommSynthetic( // overwrite comm_ assignment from base constructor
+        GetBDPars(),
+        dec_buf_in_,
+        enc_buf_out_,
+        ns_per_unit_,
+        units_per_HB_);
+    comm_ = synthetic_;
+  }
+
+  /// Change the generated load. Also picks up the FPGA timing last set with
+  /// SetTimeUnitLen()/SetTimePerUpHB(), so HBs come at the programmed rate
+  void SetLoad(const comm::SyntheticLoad &load) {
+    synthetic_->SetTiming(ns_per_unit_, units_per_HB_);
+    synthetic_->SetLoad(load);
+  }
+  comm::SyntheticLoad GetLoad() { return synthetic_->GetLoad(); }
+  comm::SyntheticStats GetSyntheticStats() { return synthetic_->GetStats(); }
+
+ private:
+  comm::CommSynthetic *synthetic_; /// same as comm_, deleted by Driver
+};
+
+}  // bddriver namespace
+}  // pystorm namespace
+
+#endif
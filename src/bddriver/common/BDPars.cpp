@@ -1,5 +1,6 @@
 #include "BDPars.h"
 
+#include <cassert>
 #include <string>
 #include <unordered_map>
 #include <array>
@@ -10,7 +11,7 @@ namespace bdpars {
 
 constexpr unsigned int BDPars::NumNeurons;
 constexpr unsigned int BDPars::NumSynapses;
-constexpr unsigned int BDPars::NumCores;
+constexpr unsigned int BDPars::MaxCores;
 constexpr unsigned int BDPars::DnEPFPGARegOffset;
 constexpr unsigned int BDPars::DnEPFPGANumReg;
 constexpr unsigned int BDPars::DnEPFPGAChannelOffset;
@@ -19,6 +20,7 @@ constexpr unsigned int BDPars::DnEPFPGABitsPerReg;
 constexpr unsigned int BDPars::DnEPFPGABitsPerChannel;
 constexpr unsigned int BDPars::DnWordsPerFrame;
 constexpr unsigned int BDPars::DnTimeUnitsPerHB;
+constexpr unsigned int BDPars::NumEPCodes;
 
 // clang-format off
 
@@ -43,7 +45,14 @@ std::unordered_map<DiffusorCutLocationId, std::vector<unsigned int>> BDPars::con
   {bdpars::DiffusorCutLocationId::WEST_BOTTOM , {43}}  ,
 };
 
-BDPars::BDPars() {
+BDPars::BDPars(unsigned int num_cores) : NumCores(num_cores) {
+  assert(num_cores >= 1 && num_cores <= MaxCores);
+
+  // unused codes/entries stay 0
+  Dn_EP_size_.fill(0);
+  Up_EP_size_.fill(0);
+  dac_info_.data.fill({0, 0});
+
   //////////////////////////////////////////////////////
   // FPGA downstream endpoints
   // BD inputs, registers, and channels
@@ -124,6 +133,7 @@ BDPars::BDPars() {
 
   Up_EP_size_[UpEPCodeFor(FPGAOutputEP::UPSTREAM_HB_LSB)] = 24;
   Up_EP_size_[UpEPCodeFor(FPGAOutputEP::UPSTREAM_HB_MSB)] = 24;
+  // UPSTREAM_CORE is consumed by the Decoder, so it gets no output buffer (size stays 0)
   Up_EP_size_[UpEPCodeFor(FPGAOutputEP::SF_OUTPUT)]       = 48;
   Up_EP_size_[UpEPCodeFor(FPGAOutputEP::NOP)]             = 24;
   Up_EP_size_[UpEPCodeFor(FPGAOutputEP::DS_QUEUE_CT)]     = 24;
@@ -157,11 +167,17 @@ BDPars::BDPars() {
   dac_info_[BDHornEP::DAC_DIFF_R]      = {1  , 1024}; // roughly 1pA to 1nA
   dac_info_[BDHornEP::DAC_SOMA_OFFSET] = {4  , 2}; // roughly 250fA to 250pA 
   dac_info_[BDHornEP::DAC_SOMA_REF]    = {1  , 10}; // roughly 1pA to 1nA
+}
 
-  //Init maps for AER address translation
-  BDPars::InitAERToXY<12>(soma_aer_to_xy_, soma_xy_to_aer_);
-  BDPars::InitAERToXY<10>(syn_aer_to_xy_, syn_xy_to_aer_);
-  BDPars::InitAERToXY<8>(mem_aer_to_xy_, mem_xy_to_aer_);
+const BDPars::AERTables &BDPars::AER() {
+  static const AERTables tables = [] {
+    AERTables t;
+    InitAERToXY<12>(t.soma_aer_to_xy, t.soma_xy_to_aer);
+    InitAERToXY<10>(t.syn_aer_to_xy, t.syn_xy_to_aer);
+    InitAERToXY<8>(t.mem_aer_to_xy, t.mem_xy_to_aer);
+    return t;
+  }();
+  return tables;
 }
 
 // D is binary tree depth, not 4-ary tree depth, must be even
@@ -11,6 +11,7 @@
 #include <typeindex>
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 
 using std::cout;
 using std::endl;
@@ -31,6 +32,21 @@ struct EnumClassHash
   }
 };
 
+/// Dense array keyed by an enum class with a COUNT member.
+/// Replaces unordered_map<Enum, T, EnumClassHash> for small, fixed enums:
+/// lookups are a single indexed load instead of a hash + bucket walk.
+/// at() keeps the map-like call sites working.
+template <class E, class T, std::size_t N = static_cast<std::size_t>(E::COUNT)>
+struct EnumArray {
+  std::array<T, N> data;
+
+  T& operator[](E e) { return data[static_cast<std::size_t>(e)]; }
+  const T& operator[](E e) const { return data[static_cast<std::size_t>(e)]; }
+  T& at(E e) { return data.at(static_cast<std::size_t>(e)); }
+  const T& at(E e) const { return data.at(static_cast<std::size_t>(e)); }
+  static constexpr std::size_t size() { return N; }
+};
+
 namespace pystorm {
 namespace bddriver {
 namespace bdpars {
@@ -180,6 +196,7 @@ enum class FPGAOutputEP {
   UPSTREAM_HB_LSB = 15,  // Upstream report of FPGA clock
   UPSTREAM_HB_MSB = 16,  // Upstream report of FPGA clock
   NOP             = 64,  // NOP, inserted to pad output pipe
+  UPSTREAM_CORE   = 17,  // multi-core only: the words after this come from core <payload>
   DS_QUEUE_CT     = 128, // first word of each block
   COUNT           = 4    // XXX hardcoded, be careful
 };
@@ -254,6 +271,12 @@ enum class DiffusorCutLocationId { NORTH_LEFT, NORTH_RIGHT, WEST_TOP, WEST_BOTTO
 /// The enums refer to particular hardware elements or concepts, such as the name of a memory,
 /// register, or a particular type of programming word.
 /// BDPars is fully public, but Driver only has a const reference.
+///
+/// With more than one core, the cores are a BrainDrizzle stack behind a router FPGA
+/// (FPGA/src/router): each downstream word goes out with a route word holding the
+/// signed hop count to its core (see FPGARoute), and upstream words are grouped behind
+/// UPSTREAM_CORE words naming the core they came from. The router FPGA doesn't send
+/// UPSTREAM_CORE words yet, so only the BDModel comm drives more than one core.
 
 class BDPars {
 
@@ -261,7 +284,7 @@ class BDPars {
   // misc constants
   static constexpr unsigned int NumNeurons             = 4096;
   static constexpr unsigned int NumSynapses            = 1024;
-  static constexpr unsigned int NumCores               = 1;
+  static constexpr unsigned int MaxCores               = 511; // route hop count is a 10-bit signed value
   static constexpr unsigned int DnEPFPGARegOffset      = 128;
   static constexpr unsigned int DnEPFPGANumReg         = 64;
   static constexpr unsigned int DnEPFPGAChannelOffset  = 192;
@@ -271,54 +294,82 @@ class BDPars {
   static constexpr unsigned int DnWordsPerFrame        = 256; // FPGAIO words per USB frame XXX same as OKComm's WRITE_SIZE*4, should get from here
   static constexpr unsigned int DnTimeUnitsPerHB       = 1; // Send FPGA downstream heartbeat every <this many time units>
 
-  // downstream endpoint info
-  std::unordered_map<uint8_t , unsigned int> Dn_EP_size_;
+  static constexpr unsigned int NumEPCodes             = 256; // EP codes are 8 bits
+
+  const unsigned int NumCores; // set at construction
 
-  // upstream endpoint info
-  std::unordered_map<uint8_t , unsigned int> Up_EP_size_;
+  // downstream endpoint info, indexed by ep code, 0 means unused code
+  std::array<unsigned int, NumEPCodes> Dn_EP_size_;
+
+  // upstream endpoint info, indexed by ep code, 0 means unused code
+  std::array<unsigned int, NumEPCodes> Up_EP_size_;
 
   // memory info
-  std::unordered_map<BDMemId, MemInfo, EnumClassHash> mem_info_;
+  EnumArray<BDMemId, MemInfo> mem_info_;
   
-  // DAC info
-  std::unordered_map<BDHornEP, DACInfo, EnumClassHash> dac_info_;
-  unsigned int GetDACDefaultCount(BDHornEP signal_id) { return dac_info_.at(signal_id).default_count; };
-
-  // maps for AER address translation
-  std::array<unsigned int, 4096> soma_xy_to_aer_;
-  std::array<unsigned int, 4096> soma_aer_to_xy_;
-  std::array<unsigned int, 1024> syn_xy_to_aer_;
-  std::array<unsigned int, 1024> syn_aer_to_xy_;
-  std::array<unsigned int, 256> mem_xy_to_aer_;
-  std::array<unsigned int, 256> mem_aer_to_xy_;
+  // DAC info (only the DAC_* entries are meaningful)
+  EnumArray<BDHornEP, DACInfo> dac_info_;
+  unsigned int GetDACDefaultCount(BDHornEP signal_id) { return dac_info_[signal_id].default_count; };
+
+  // maps for AER address translation, the same for every BDPars
+  struct AERTables {
+    std::array<unsigned int, 4096> soma_xy_to_aer;
+    std::array<unsigned int, 4096> soma_aer_to_xy;
+    std::array<unsigned int, 1024> syn_xy_to_aer;
+    std::array<unsigned int, 1024> syn_aer_to_xy;
+    std::array<unsigned int, 256> mem_xy_to_aer;
+    std::array<unsigned int, 256> mem_aer_to_xy;
+  };
+  /// Built on first use, shared by every BDPars (they don't depend on the core count)
+  static const AERTables &AER();
   
   ////////////////////////////////////////////////////////////////////////////
   // AER Address <-> Y,X mapping static member fns
   ////////////////////////////////////////////////////////////////////////////
   /// Given flat xy_addr (addr scan along x then y) config memory (16-neuron tile) address, get AER address
-  unsigned int GetMemAERAddr(unsigned int xy_addr) const { return mem_xy_to_aer_.at(xy_addr); }
+  static unsigned int GetMemAERAddr(unsigned int xy_addr) { return AER().mem_xy_to_aer.at(xy_addr); }
   /// Given x, y config memory (16-neuron tile) address, get AER address
-  unsigned int GetMemAERAddr(unsigned int x, unsigned int y) const { return GetMemAERAddr(y*16 + x); }
+  static unsigned int GetMemAERAddr(unsigned int x, unsigned int y) { return GetMemAERAddr(y*16 + x); }
   /// Given flat xy_addr (addr scan along x then y) synapse address, get AER address
-  unsigned int GetSynAERAddr(unsigned int xy_addr) const { return syn_xy_to_aer_.at(xy_addr); }
+  static unsigned int GetSynAERAddr(unsigned int xy_addr) { return AER().syn_xy_to_aer.at(xy_addr); }
   /// Given x, y synapse address, get AER address
-  unsigned int GetSynAERAddr(unsigned int x, unsigned int y) const { return GetSynAERAddr(y*32 + x); }
+  static unsigned int GetSynAERAddr(unsigned int x, unsigned int y) { return GetSynAERAddr(y*32 + x); }
   /// Given flat xy_addr soma address, get AER address
-  unsigned int GetSomaAERAddr(unsigned int xy_addr) const { return soma_xy_to_aer_.at(xy_addr); }
+  static unsigned int GetSomaAERAddr(unsigned int xy_addr) { return AER().soma_xy_to_aer.at(xy_addr); }
   /// Given x, y soma address, get AER address
-  unsigned int GetSomaAERAddr(unsigned int x, unsigned int y) const { return GetSomaAERAddr(y*64 + x); }
+  static unsigned int GetSomaAERAddr(unsigned int x, unsigned int y) { return GetSomaAERAddr(y*64 + x); }
   /// Given AER synapse address, get flat xy_addr (addr scan along x then y)
-  unsigned int GetSomaXYAddr(unsigned int aer_addr) const { return soma_aer_to_xy_.at(aer_addr); }
+  static unsigned int GetSomaXYAddr(unsigned int aer_addr) { return AER().soma_aer_to_xy.at(aer_addr); }
+
+  /// Bulk soma AER -> XY translation over raw arrays.
+  /// Out-of-range addresses are masked into range (their output is garbage)
+  /// and counted; the caller decides what to do about them.
+  /// Returns the number of bad addresses.
+  template <class T>
+  static unsigned int GetSomaXYAddrs(const T* aer_addrs, unsigned int* xy_addrs, unsigned int n) {
+    return TranslateAddrs(AER().soma_aer_to_xy, aer_addrs, xy_addrs, n);
+  }
+  /// Bulk soma XY -> AER translation, see GetSomaXYAddrs
+  template <class T>
+  static unsigned int GetSomaAERAddrs(const T* xy_addrs, unsigned int* aer_addrs, unsigned int n) {
+    return TranslateAddrs(AER().soma_xy_to_aer, xy_addrs, aer_addrs, n);
+  }
+  /// Bulk synapse XY -> AER translation, see GetSomaXYAddrs
+  template <class T>
+  static unsigned int GetSynAERAddrs(const T* xy_addrs, unsigned int* aer_addrs, unsigned int n) {
+    return TranslateAddrs(AER().syn_xy_to_aer, xy_addrs, aer_addrs, n);
+  }
 
   /// Utility function to process spikes a little more quickly
-  std::vector<unsigned int> GetSomaXYAddrs(const std::vector<unsigned int>& aer_addrs) const {
-    std::vector<unsigned int> to_return(aer_addrs.size());;
-    for (unsigned int i = 0; i < aer_addrs.size(); i++) {
-      unsigned int addr = aer_addrs[i];
-      if (addr < 4096) {
-        to_return[i] = soma_aer_to_xy_.at(addr);
-      } else {
-        cout << "WARNING: supplied bad AER addr to GetSomaXYAddrs: " << addr << endl;
+  static std::vector<unsigned int> GetSomaXYAddrs(const std::vector<unsigned int>& aer_addrs) {
+    std::vector<unsigned int> to_return(aer_addrs.size());
+    unsigned int num_bad = GetSomaXYAddrs(aer_addrs.data(), to_return.data(), aer_addrs.size());
+    if (num_bad > 0) {
+      for (unsigned int i = 0; i < aer_addrs.size(); i++) {
+        if (aer_addrs[i] >= NumNeurons) {
+          to_return[i] = 0;
+          cout << "WARNING: supplied bad AER addr to GetSomaXYAddrs: " << aer_addrs[i] << endl;
+        }
       }
     }
     return to_return;
@@ -338,7 +389,7 @@ class BDPars {
   /// Setting 1 cuts the diffusor at the location.
   static std::unordered_map<DiffusorCutLocationId, std::vector<unsigned int>> config_diff_cut_mem_;
 
-  BDPars();
+  BDPars(unsigned int num_cores = 1);
 
   // functions for info derived from other pars
 
@@ -351,6 +402,9 @@ class BDPars {
   inline uint8_t UpEPCodeFor(BDFunnelEP ep)   const { return static_cast<uint8_t>(ep); }
   inline uint8_t UpEPCodeFor(FPGAOutputEP ep) const { return static_cast<uint8_t>(ep); }
 
+  /// route word hop count for <core_id>: the router FPGA has no BD, so core 0 is one hop up
+  inline unsigned int RouteHopsFor(unsigned int core_id) const { return core_id + 1; }
+
   // downstream ep code -> ep type
   inline bool DnEPCodeIsBDHornEP(uint8_t ep)      const { return ep < DnEPFPGARegOffset; }
   inline bool DnEPCodeIsFPGARegEP(uint8_t ep)     const { return ep >= DnEPFPGARegOffset && ep < DnEPFPGAChannelOffset; }
@@ -363,8 +417,10 @@ class BDPars {
   // get used up ep codes
   std::vector<uint8_t> GetUpEPs() const {
     std::vector<uint8_t> codes;
-    for (auto& it : Up_EP_size_) {
-      codes.push_back(it.first);
+    for (unsigned int code = 0; code < NumEPCodes; code++) {
+      if (Up_EP_size_[code] > 0) {
+        codes.push_back(code);
+      }
     }
     return codes;
   }
@@ -399,9 +455,8 @@ class BDPars {
   
   std::vector<BDHornEP> GetBDRegs() const {
     std::vector<BDHornEP> retval;
-    for (auto& it : Dn_EP_size_) {
-      uint8_t code = it.first;
-      if (DnEPCodeIsBDHornEP(code)) {
+    for (unsigned int code = 0; code < NumEPCodes; code++) {
+      if (Dn_EP_size_[code] > 0 && DnEPCodeIsBDHornEP(code)) {
         BDHornEP ep = static_cast<BDHornEP>(code);
         if (BDHornEPIsReg(ep)) {
           retval.push_back(ep);
@@ -417,7 +472,32 @@ class BDPars {
 
   // D is binary tree depth, not 4-ary tree depth, must be even
   template <int D>
-  void InitAERToXY(std::array<unsigned int, (1<<D)> &aer_to_xy, std::array<unsigned int, (1<<D)> &xy_to_aer);
+  static void InitAERToXY(std::array<unsigned int, (1<<D)> &aer_to_xy, std::array<unsigned int, (1<<D)> &xy_to_aer);
+
+ private:
+  /// Inner loop of the bulk translations. N is a power of 2, so masking
+  /// keeps the table gather in bounds and the loop branch-free. Bad addresses
+  /// are rare (synchronizer bit flips), so they're only counted in a second
+  /// pass if the OR of all the inputs says there are any.
+  template <std::size_t N, class T>
+  static unsigned int TranslateAddrs(const std::array<unsigned int, N>& table,
+                                     const T* in, unsigned int* out, unsigned int n) {
+    static_assert((N & (N - 1)) == 0, "translation table size must be a power of 2");
+    uint64_t all_bits = 0;
+    for (unsigned int i = 0; i < n; i++) {
+      const uint64_t addr = static_cast<uint64_t>(in[i]);
+      all_bits |= addr;
+      out[i] = table[addr & (N - 1)];
+    }
+
+    unsigned int num_bad = 0;
+    if (all_bits >= N) {
+      for (unsigned int i = 0; i < n; i++) {
+        num_bad += static_cast<uint64_t>(in[i]) >= N;
+      }
+    }
+    return num_bad;
+  }
 };
 
 
@@ -2,9 +2,11 @@
 
 #include <assert.h>
 #include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include <thread>
 #include <vector>
-#include <unordered_map>
 
 #include "BDPars.h"
 
@@ -15,57 +17,119 @@ namespace bddriver {
 using std::cout;
 using std::endl;
 
+constexpr char BDState::kFileMagic[4];
+constexpr uint32_t BDState::kFileVersion;
+constexpr unsigned int BDState::kConfigUnset;
+
+const std::vector<bdpars::BDHornEP> BDState::kTrafficRegs = {
+  bdpars::BDHornEP::NEURON_DUMP_TOGGLE,
+  bdpars::BDHornEP::TOGGLE_PRE_FIFO,
+  bdpars::BDHornEP::TOGGLE_POST_FIFO0,
+  bdpars::BDHornEP::TOGGLE_POST_FIFO1};
+
+namespace {
+
+/// add <idx> to <ranges>, extending the last range if it's adjacent
+void AddToRanges(std::vector<BDStateRange> *ranges, unsigned int idx) {
+  if (!ranges->empty() && ranges->back().start + ranges->back().count == idx) {
+    ranges->back().count++;
+  } else {
+    ranges->push_back({idx, 1});
+  }
+}
+
+/// ranges of tiles whose config bits (or their valid bits) differ
+template <std::size_t N>
+std::vector<BDStateRange> DiffConfigTiles(
+    const std::bitset<N> &lhs, const std::bitset<N> &lhs_valid,
+    const std::bitset<N> &rhs, const std::bitset<N> &rhs_valid,
+    unsigned int bits_per_tile) {
+  std::vector<BDStateRange> ranges;
+  std::bitset<N> dirty = (lhs_valid ^ rhs_valid) | ((lhs ^ rhs) & lhs_valid & rhs_valid);
+  if (dirty.none()) return ranges;
+
+  for (unsigned int tile = 0; tile < N / bits_per_tile; tile++) {
+    for (unsigned int i = tile * bits_per_tile; i < (tile + 1) * bits_per_tile; i++) {
+      if (dirty[i]) {
+        AddToRanges(&ranges, tile);
+        break;
+      }
+    }
+  }
+  return ranges;
+}
+
+/// bits are packed 8 per byte, LSB first
+template <class Bits>
+void WriteBits(std::ostream &file, const Bits &bits, std::size_t n) {
+  std::vector<char> bytes((n + 7) / 8, 0);
+  for (std::size_t i = 0; i < n; i++) {
+    if (bits[i]) bytes[i / 8] |= 1 << (i % 8);
+  }
+  file.write(bytes.data(), bytes.size());
+}
+
+template <class Bits>
+void ReadBits(std::istream &file, Bits &bits, std::size_t n) {
+  std::vector<char> bytes((n + 7) / 8, 0);
+  file.read(bytes.data(), bytes.size());
+  for (std::size_t i = 0; i < n; i++) {
+    bits[i] = (bytes[i / 8] >> (i % 8)) & 1;
+  }
+}
+
+}  // anonymous namespace
+
+bool BDStateDiff::Empty() const {
+  for (auto &it : mems.data) {
+    if (!it.empty()) return false;
+  }
+  return regs.empty() && soma_config_tiles.empty() && synapse_config_tiles.empty() && diffusor_config_tiles.empty();
+}
+
 BDState::BDState(const bdpars::BDPars* bd_pars) {
   bd_pars_     = bd_pars;
 
   // initialize memory vectors
-  mems_[bdpars::BDMemId::PAT]  = std::vector<BDWord>(bd_pars->mem_info_.at(bdpars::BDMemId::PAT).size,  0);
-  mems_[bdpars::BDMemId::TAT0] = std::vector<BDWord>(bd_pars->mem_info_.at(bdpars::BDMemId::TAT0).size, 0);
-  mems_[bdpars::BDMemId::TAT1] = std::vector<BDWord>(bd_pars->mem_info_.at(bdpars::BDMemId::TAT1).size, 0);
-  mems_[bdpars::BDMemId::AM]   = std::vector<BDWord>(bd_pars->mem_info_.at(bdpars::BDMemId::AM).size,   0);
-  mems_[bdpars::BDMemId::MM]   = std::vector<BDWord>(bd_pars->mem_info_.at(bdpars::BDMemId::MM).size,   0);
-
-  mems_valid_[bdpars::BDMemId::PAT]  = std::vector<bool>(mems_[bdpars::BDMemId::PAT].size(),  false);
-  mems_valid_[bdpars::BDMemId::TAT0] = std::vector<bool>(mems_[bdpars::BDMemId::TAT0].size(), false);
-  mems_valid_[bdpars::BDMemId::TAT1] = std::vector<bool>(mems_[bdpars::BDMemId::TAT1].size(), false);
-  mems_valid_[bdpars::BDMemId::AM]   = std::vector<bool>(mems_[bdpars::BDMemId::AM].size(),   false);
-  mems_valid_[bdpars::BDMemId::MM]   = std::vector<bool>(mems_[bdpars::BDMemId::MM].size(),   false);
+  for (unsigned int i = 0; i < mems_.size(); i++) {
+    bdpars::BDMemId mem_id = static_cast<bdpars::BDMemId>(i);
+    unsigned int size = bd_pars->mem_info_.at(mem_id).size;
+    mems_[mem_id] = std::make_shared<MemState>();
+    mems_[mem_id]->words = std::vector<BDWord>(size, 0);
+    mems_[mem_id]->valid = std::vector<bool>(size, false);
+  }
 
   // initialize BD register vectors
-  for (auto& it : bd_pars_->GetBDRegs()) {
-    reg_[it] = 0;
-    reg_valid_[it] = false;
-  }
+  reg_.data.fill(0);
+  reg_valid_.reset();
 
-  // Valid config values are 0 or 1. 2 => uninitialized
-  soma_config_mem_ = std::vector<std::map<bdpars::ConfigSomaID, std::vector<unsigned int>>>(256, {
-    {bdpars::ConfigSomaID::GAIN_0, std::vector<unsigned int>(16, 2)},
-    {bdpars::ConfigSomaID::GAIN_1, std::vector<unsigned int>(16, 2)},
-    {bdpars::ConfigSomaID::OFFSET_0, std::vector<unsigned int>(16, 2)},
-    {bdpars::ConfigSomaID::OFFSET_1, std::vector<unsigned int>(16, 2)},
-    {bdpars::ConfigSomaID::ENABLE, std::vector<unsigned int>(16, 2)},
-    {bdpars::ConfigSomaID::SUBTRACT_OFFSET, std::vector<unsigned int>(16, 2)}
-  });
+  // all config bits start out unset
+  config_ = std::make_shared<NeuronConfigState>();
+}
 
-  synapse_config_mem_ = std::vector<std::map<bdpars::ConfigSynapseID, std::vector<unsigned int>>>(256, {
-    {bdpars::ConfigSynapseID::SYN_DISABLE, std::vector<unsigned int>(4, 2)},
-    {bdpars::ConfigSynapseID::ADC_DISABLE, std::vector<unsigned int>(4, 2)},
-  });
+BDState::~BDState() {}
 
-  diffusor_config_mem_ = std::vector<std::map<bdpars::DiffusorCutLocationId, std::vector<unsigned int>>>(256, {
-    {bdpars::DiffusorCutLocationId::NORTH_LEFT, std::vector<unsigned int>(1, 2)},
-    {bdpars::DiffusorCutLocationId::NORTH_RIGHT, std::vector<unsigned int>(1, 2)},
-    {bdpars::DiffusorCutLocationId::WEST_TOP, std::vector<unsigned int>(1, 2)},
-    {bdpars::DiffusorCutLocationId::WEST_BOTTOM, std::vector<unsigned int>(1, 2)},
-  });
+BDState::MemState *BDState::MutableMem(bdpars::BDMemId mem_id) {
+  std::shared_ptr<MemState> &mem = mems_.at(mem_id);
+  if (mem.use_count() > 1) {
+    mem = std::make_shared<MemState>(*mem);
+  }
+  return mem.get();
 }
 
-BDState::~BDState() {}
+BDState::NeuronConfigState *BDState::MutableConfig() {
+  if (config_.use_count() > 1) {
+    config_ = std::make_shared<NeuronConfigState>(*config_);
+  }
+  return config_.get();
+}
 
 void BDState::SetMem(bdpars::BDMemId mem_id, unsigned int start_addr, const std::vector<BDWord> &data) {
+  if (data.size() == 0) return;
+  MemState *mem = MutableMem(mem_id);
   for (unsigned int i = 0; i < data.size(); i++) {
-    mems_.at(mem_id).at(start_addr + i) = data[i];
-    mems_valid_.at(mem_id).at(start_addr + i) = true;
+    mem->words.at(start_addr + i) = data[i];
+    mem->valid.at(start_addr + i) = true;
   }
 }
 
@@ -73,8 +137,8 @@ void BDState::SetReg(bdpars::BDHornEP reg_id, BDWord data) {
   // we could have just set a traffic toggle
   bool already_off = AreTrafficRegsOff();
 
-  reg_[reg_id]       = data;
-  reg_valid_[reg_id] = true;
+  reg_.at(reg_id) = data;
+  reg_valid_.set(static_cast<std::size_t>(reg_id));
 
   if (AreTrafficRegsOff() & !already_off) {  // if we just turned the last toggle off, set the timer
     all_traffic_off_start_ = std::chrono::high_resolution_clock::now();
@@ -82,7 +146,92 @@ void BDState::SetReg(bdpars::BDHornEP reg_id, BDWord data) {
 }
 
 const std::pair<const BDWord, bool> BDState::GetReg(bdpars::BDHornEP reg_id) const {
-  return std::make_pair((reg_.at(reg_id)), reg_valid_.at(reg_id));
+  return std::make_pair((reg_.at(reg_id)), reg_valid_.test(static_cast<std::size_t>(reg_id)));
+}
+
+void BDState::SetNeuronConfigMem(unsigned int core_id, unsigned int tile_id, unsigned int elem_id,
+                                 bdpars::ConfigSomaID config_type, unsigned int config_value) {
+  assert(tile_id < kNumTiles && elem_id < kSomasPerTile);
+  unsigned int idx = tile_id * kSomaBitsPerTile + static_cast<unsigned int>(config_type) * kSomasPerTile + elem_id;
+  NeuronConfigState *config = MutableConfig();
+  config->soma[idx] = config_value != 0;
+  config->soma_valid[idx] = true;
+}
+
+void BDState::SetNeuronConfigMem(unsigned int core_id, unsigned int tile_id, unsigned int elem_id,
+                                 bdpars::ConfigSynapseID config_type, unsigned int config_value) {
+  assert(tile_id < kNumTiles && elem_id < kSynapsesPerTile);
+  unsigned int idx = tile_id * kSynapseBitsPerTile + static_cast<unsigned int>(config_type) * kSynapsesPerTile + elem_id;
+  NeuronConfigState *config = MutableConfig();
+  config->synapse[idx] = config_value != 0;
+  config->synapse_valid[idx] = true;
+}
+
+void BDState::SetNeuronConfigMem(unsigned int core_id, unsigned int tile_id, unsigned int elem_id,
+                                 bdpars::DiffusorCutLocationId config_type, unsigned int config_value) {
+  // one diffusor cut of each type per tile, elem_id is always 0
+  assert(tile_id < kNumTiles && elem_id == 0);
+  unsigned int idx = tile_id * kDiffusorBitsPerTile + static_cast<unsigned int>(config_type);
+  NeuronConfigState *config = MutableConfig();
+  config->diffusor[idx] = config_value != 0;
+  config->diffusor_valid[idx] = true;
+}
+
+unsigned int BDState::GetNeuronConfigMem(unsigned int core_id, unsigned int tile_id, unsigned int elem_id,
+                                         bdpars::ConfigSomaID config_type) const {
+  unsigned int idx = tile_id * kSomaBitsPerTile + static_cast<unsigned int>(config_type) * kSomasPerTile + elem_id;
+  return config_->soma_valid.test(idx) ? config_->soma.test(idx) : kConfigUnset;
+}
+
+unsigned int BDState::GetNeuronConfigMem(unsigned int core_id, unsigned int tile_id, unsigned int elem_id,
+                                         bdpars::ConfigSynapseID config_type) const {
+  unsigned int idx = tile_id * kSynapseBitsPerTile + static_cast<unsigned int>(config_type) * kSynapsesPerTile + elem_id;
+  return config_->synapse_valid.test(idx) ? config_->synapse.test(idx) : kConfigUnset;
+}
+
+unsigned int BDState::GetNeuronConfigMem(unsigned int core_id, unsigned int tile_id, unsigned int elem_id,
+                                         bdpars::DiffusorCutLocationId config_type) const {
+  unsigned int idx = tile_id * kDiffusorBitsPerTile + static_cast<unsigned int>(config_type);
+  return config_->diffusor_valid.test(idx) ? config_->diffusor.test(idx) : kConfigUnset;
+}
+
+std::vector<std::map<bdpars::ConfigSomaID, std::vector<unsigned int>>> BDState::GetSomaConfigMem() const {
+  std::vector<std::map<bdpars::ConfigSomaID, std::vector<unsigned int>>> to_return(kNumTiles);
+  for (unsigned int tile = 0; tile < kNumTiles; tile++) {
+    for (unsigned int type = 0; type < kNumSomaConfigs; type++) {
+      bdpars::ConfigSomaID config_type = static_cast<bdpars::ConfigSomaID>(type);
+      std::vector<unsigned int> &vals = to_return[tile][config_type];
+      for (unsigned int elem = 0; elem < kSomasPerTile; elem++) {
+        vals.push_back(GetNeuronConfigMem(0, tile, elem, config_type));
+      }
+    }
+  }
+  return to_return;
+}
+
+std::vector<std::map<bdpars::ConfigSynapseID, std::vector<unsigned int>>> BDState::GetSynapseConfigMem() const {
+  std::vector<std::map<bdpars::ConfigSynapseID, std::vector<unsigned int>>> to_return(kNumTiles);
+  for (unsigned int tile = 0; tile < kNumTiles; tile++) {
+    for (unsigned int type = 0; type < kNumSynapseConfigs; type++) {
+      bdpars::ConfigSynapseID config_type = static_cast<bdpars::ConfigSynapseID>(type);
+      std::vector<unsigned int> &vals = to_return[tile][config_type];
+      for (unsigned int elem = 0; elem < kSynapsesPerTile; elem++) {
+        vals.push_back(GetNeuronConfigMem(0, tile, elem, config_type));
+      }
+    }
+  }
+  return to_return;
+}
+
+std::vector<std::map<bdpars::DiffusorCutLocationId, std::vector<unsigned int>>> BDState::GetDiffusorConfigMem() const {
+  std::vector<std::map<bdpars::DiffusorCutLocationId, std::vector<unsigned int>>> to_return(kNumTiles);
+  for (unsigned int tile = 0; tile < kNumTiles; tile++) {
+    for (unsigned int type = 0; type < kNumDiffusorConfigs; type++) {
+      bdpars::DiffusorCutLocationId config_type = static_cast<bdpars::DiffusorCutLocationId>(type);
+      to_return[tile][config_type] = {GetNeuronConfigMem(0, tile, 0, config_type)};
+    }
+  }
+  return to_return;
 }
 
 void BDState::SetToggle(bdpars::BDHornEP reg_id, bool traffic_en, bool dump_en) {
@@ -96,7 +245,7 @@ std::tuple<bool, bool, bool> BDState::GetToggle(bdpars::BDHornEP reg_id) const
   BDWord word = reg_.at(reg_id);
   return std::make_tuple(GetField<ToggleWord>(word, ToggleWord::TRAFFIC_ENABLE), 
                          GetField<ToggleWord>(word, ToggleWord::DUMP_ENABLE),
-                         reg_valid_.at(reg_id));
+                         reg_valid_.test(static_cast<std::size_t>(reg_id)));
 }
 
 bool BDState::AreTrafficRegsOff() const
@@ -144,10 +293,174 @@ void BDState::WaitForTrafficOff() const {
   }
 }
 
+void BDState::Restore(const BDState &snapshot) {
+  assert(snapshot.bd_pars_ == bd_pars_);
+  bool already_off = AreTrafficRegsOff();
+
+  reg_       = snapshot.reg_;
+  reg_valid_ = snapshot.reg_valid_;
+  mems_      = snapshot.mems_;
+  config_    = snapshot.config_;
+
+  // same as SetReg(): restoring can turn the last toggle off
+  if (AreTrafficRegsOff() & !already_off) {
+    all_traffic_off_start_ = std::chrono::high_resolution_clock::now();
+  }
+}
+
+BDStateDiff BDState::Diff(const BDState &other) const {
+  BDStateDiff diff;
+
+  for (unsigned int i = 0; i < mems_.size(); i++) {
+    bdpars::BDMemId mem_id = static_cast<bdpars::BDMemId>(i);
+    const MemState *lhs = mems_[mem_id].get();
+    const MemState *rhs = other.mems_[mem_id].get();
+    if (lhs == rhs) continue; // still shared, nothing to do
+
+    assert(lhs->words.size() == rhs->words.size());
+    std::vector<BDStateRange> &ranges = diff.mems[mem_id];
+    for (unsigned int addr = 0; addr < lhs->words.size(); addr++) {
+      if (lhs->valid[addr] != rhs->valid[addr] || lhs->words[addr] != rhs->words[addr]) {
+        AddToRanges(&ranges, addr);
+      }
+    }
+  }
+
+  for (auto& it : bd_pars_->GetBDRegs()) {
+    if (GetReg(it) != other.GetReg(it)) {
+      diff.regs.push_back(it);
+    }
+  }
+
+  if (config_ != other.config_) {
+    const NeuronConfigState &lhs = *config_;
+    const NeuronConfigState &rhs = *other.config_;
+    diff.soma_config_tiles     = DiffConfigTiles(lhs.soma, lhs.soma_valid, rhs.soma, rhs.soma_valid, kSomaBitsPerTile);
+    diff.synapse_config_tiles  = DiffConfigTiles(lhs.synapse, lhs.synapse_valid, rhs.synapse, rhs.synapse_valid, kSynapseBitsPerTile);
+    diff.diffusor_config_tiles = DiffConfigTiles(lhs.diffusor, lhs.diffusor_valid, rhs.diffusor, rhs.diffusor_valid, kDiffusorBitsPerTile);
+  }
+
+  return diff;
+}
+
+uint64_t BDState::Fingerprint() const {
+  std::ostringstream bytes;
+  Write(bytes);
+  uint64_t hash = 14695981039346656037ull; // FNV-1a offset basis
+  for (char c : bytes.str()) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ull; // FNV prime
+  }
+  return hash;
+}
+
+bool BDState::Save(const std::string &filename) const {
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    cout << "WARNING: BDState: couldn't open " << filename << " for writing" << endl;
+    return false;
+  }
+  return Write(file);
+}
+
+bool BDState::Load(const std::string &filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    cout << "WARNING: BDState: couldn't open state file " << filename << endl;
+    return false;
+  }
+  return Read(file);
+}
+
+bool BDState::Write(std::ostream &file) const {
+  uint32_t num_mems = mems_.size();
+  file.write(kFileMagic, 4);
+  file.write(reinterpret_cast<const char *>(&kFileVersion), sizeof(kFileVersion));
+  file.write(reinterpret_cast<const char *>(&num_mems), sizeof(num_mems));
+
+  // each memory: size, words, valid bits
+  for (auto &mem : mems_.data) {
+    uint32_t size = mem->words.size();
+    file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char *>(mem->words.data()), size * sizeof(BDWord));
+    WriteBits(file, mem->valid, size);
+  }
+
+  uint32_t num_regs = reg_.size();
+  file.write(reinterpret_cast<const char *>(&num_regs), sizeof(num_regs));
+  file.write(reinterpret_cast<const char *>(reg_.data.data()), num_regs * sizeof(BDWord));
+  WriteBits(file, reg_valid_, num_regs);
+
+  WriteBits(file, config_->soma,           config_->soma.size());
+  WriteBits(file, config_->soma_valid,     config_->soma_valid.size());
+  WriteBits(file, config_->synapse,        config_->synapse.size());
+  WriteBits(file, config_->synapse_valid,  config_->synapse_valid.size());
+  WriteBits(file, config_->diffusor,       config_->diffusor.size());
+  WriteBits(file, config_->diffusor_valid, config_->diffusor_valid.size());
+
+  return file.good();
+}
+
+bool BDState::Read(std::istream &file) {
+  char magic[4];
+  uint32_t version, num_mems;
+  file.read(magic, 4);
+  file.read(reinterpret_cast<char *>(&version), sizeof(version));
+  file.read(reinterpret_cast<char *>(&num_mems), sizeof(num_mems));
+
+  if (!file.good() || std::memcmp(magic, kFileMagic, 4) != 0 || version != kFileVersion || num_mems != mems_.size()) {
+    cout << "WARNING: BDState: not a BDState (version " << kFileVersion << ")" << endl;
+    return false;
+  }
+
+  // read into a fresh state, only take it if everything checks out
+  BDState loaded(bd_pars_);
+  for (auto &mem : loaded.mems_.data) {
+    uint32_t size;
+    file.read(reinterpret_cast<char *>(&size), sizeof(size));
+    if (!file.good() || size != mem->words.size()) {
+      cout << "WARNING: BDState: memory of size " << size << ", expected " << mem->words.size() << endl;
+      return false;
+    }
+    file.read(reinterpret_cast<char *>(mem->words.data()), size * sizeof(BDWord));
+    ReadBits(file, mem->valid, size);
+  }
+
+  uint32_t num_regs;
+  file.read(reinterpret_cast<char *>(&num_regs), sizeof(num_regs));
+  if (!file.good() || num_regs != reg_.size()) {
+    cout << "WARNING: BDState: " << num_regs << " registers, expected " << reg_.size() << endl;
+    return false;
+  }
+  file.read(reinterpret_cast<char *>(loaded.reg_.data.data()), num_regs * sizeof(BDWord));
+  ReadBits(file, loaded.reg_valid_, num_regs);
+
+  NeuronConfigState *config = loaded.config_.get();
+  ReadBits(file, config->soma,           config->soma.size());
+  ReadBits(file, config->soma_valid,     config->soma_valid.size());
+  ReadBits(file, config->synapse,        config->synapse.size());
+  ReadBits(file, config->synapse_valid,  config->synapse_valid.size());
+  ReadBits(file, config->diffusor,       config->diffusor.size());
+  ReadBits(file, config->diffusor_valid, config->diffusor_valid.size());
+
+  if (!file.good()) {
+    cout << "WARNING: BDState: truncated state" << endl;
+    return false;
+  }
+
+  Restore(loaded);
+  return true;
+}
+
 bool BDState::CompareTo(const BDState & other_state_obj) const {
   return *this == other_state_obj;
 }
 
+/// memory contents match, cheap if they're still shared
+static bool SameMem(const BDState &lhs, const BDState &rhs, bdpars::BDMemId mem_id) {
+  return lhs.GetMem(mem_id) == rhs.GetMem(mem_id) || *lhs.GetMem(mem_id) == *rhs.GetMem(mem_id);
+}
+
 /// Compare BDStates to see if all the fields match.
 /// Useful for testing when using BDModel. Can compare Driver's
 /// BDState to the BDModels BDState
@@ -157,15 +470,15 @@ bool operator==(const BDState& lhs, const BDState& rhs)
   // comparison of vectors works as expected if the comparators for the underlying stored objects is defined.
 
   // check memories
-  bool AM_matches = *lhs.GetMem(bdpars::BDMemId::AM) == *rhs.GetMem(bdpars::BDMemId::AM);
+  bool AM_matches = SameMem(lhs, rhs, bdpars::BDMemId::AM);
   if (!AM_matches) cout << "AM didn't match" << endl;
-  bool MM_matches = *lhs.GetMem(bdpars::BDMemId::MM) == *rhs.GetMem(bdpars::BDMemId::MM);
+  bool MM_matches = SameMem(lhs, rhs, bdpars::BDMemId::MM);
   if (!MM_matches) cout << "MM didn't match" << endl;
-  bool TAT0_matches = *lhs.GetMem(bdpars::BDMemId::TAT0) == *rhs.GetMem(bdpars::BDMemId::TAT0);
+  bool TAT0_matches = SameMem(lhs, rhs, bdpars::BDMemId::TAT0);
   if (!TAT0_matches) cout << "TAT0 didn't match" << endl;
-  bool TAT1_matches = *lhs.GetMem(bdpars::BDMemId::TAT1) == *rhs.GetMem(bdpars::BDMemId::TAT1);
+  bool TAT1_matches = SameMem(lhs, rhs, bdpars::BDMemId::TAT1);
   if (!TAT1_matches) cout << "TAT1 didn't match" << endl;
-  bool PAT_matches = *lhs.GetMem(bdpars::BDMemId::PAT) == *rhs.GetMem(bdpars::BDMemId::PAT);
+  bool PAT_matches = SameMem(lhs, rhs, bdpars::BDMemId::PAT);
   if (!PAT_matches) cout << "PAT didn't match" << endl;
   bool mems_match = AM_matches && MM_matches && TAT0_matches && TAT1_matches && PAT_matches;
 
@@ -1,10 +1,14 @@
 #ifndef BDSTATE_H
 #define BDSTATE_H
 
+#include <bitset>
 #include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
-#include <unordered_map>
 
 #include "BDPars.h"
 #include "BDWord.h"
@@ -14,6 +18,26 @@
 namespace pystorm {
 namespace bddriver {
 
+/// [start, start + count): a run of entries that differ between two BDStates
+struct BDStateRange {
+  unsigned int start;
+  unsigned int count;
+};
+
+/// Everything that differs between two BDStates, see BDState::Diff().
+/// A memory word differs if its value or whether it's been programmed differs,
+/// neuron config is reported by tile.
+struct BDStateDiff {
+  EnumArray<bdpars::BDMemId, std::vector<BDStateRange>> mems; /// address ranges, per memory
+  std::vector<bdpars::BDHornEP> regs;
+  std::vector<BDStateRange> soma_config_tiles;
+  std::vector<BDStateRange> synapse_config_tiles;
+  std::vector<BDStateRange> diffusor_config_tiles;
+
+  const std::vector<BDStateRange> &MemRanges(bdpars::BDMemId mem_id) const { return mems[mem_id]; }
+  bool Empty() const;
+};
+
 /// Keeps track of currently set register values, toggle states, memory values, etc.
 ///
 /// Also encodes timing assumptions: e.g. as soon as the traffic toggles are turned
@@ -21,47 +45,66 @@ namespace bddriver {
 /// there is some amount of time that we must wait for the traffic to drain completely.
 /// the length of this delay is kept in DriverPars, and is used by BDState to implement
 /// an interface that the driver can use to block until it is safe.
+///
+/// Memories and neuron config are held copy-on-write: copying a BDState (or Snapshot())
+/// only copies pointers, and a memory is only duplicated when one of the copies writes to it.
+/// Diff() skips anything that's still shared.
 class BDState {
  public:
+  /// file format: header, then memories, registers, and neuron config, see Save()
+  static constexpr char kFileMagic[4] = {'B', 'D', 'S', 'T'};
+  static constexpr uint32_t kFileVersion = 1;
+
+  /// neuron config layout
+  static constexpr unsigned int kNumTiles            = 256;
+  static constexpr unsigned int kSomasPerTile        = 16;
+  static constexpr unsigned int kSynapsesPerTile     = 4;
+  static constexpr unsigned int kNumSomaConfigs      = static_cast<unsigned int>(bdpars::ConfigSomaID::SUBTRACT_OFFSET) + 1;
+  static constexpr unsigned int kNumSynapseConfigs   = static_cast<unsigned int>(bdpars::ConfigSynapseID::ADC_DISABLE) + 1;
+  static constexpr unsigned int kNumDiffusorConfigs  = static_cast<unsigned int>(bdpars::DiffusorCutLocationId::WEST_BOTTOM) + 1;
+  static constexpr unsigned int kSomaBitsPerTile     = kNumSomaConfigs * kSomasPerTile;
+  static constexpr unsigned int kSynapseBitsPerTile  = kNumSynapseConfigs * kSynapsesPerTile;
+  static constexpr unsigned int kDiffusorBitsPerTile = kNumDiffusorConfigs;
+
+  /// GetNeuronConfigMem() value of config bits that haven't been set
+  static constexpr unsigned int kConfigUnset = 2;
+
   BDState(const bdpars::BDPars *bd_pars);
   ~BDState();
 
   void SetMem(bdpars::BDMemId mem_id, unsigned int start_addr, const std::vector<BDWord> &data);
-  inline const std::vector<BDWord> *GetMem(bdpars::BDMemId mem_id) const { return &mems_.at(mem_id); }
+  inline const std::vector<BDWord> *GetMem(bdpars::BDMemId mem_id) const { return &mems_.at(mem_id)->words; }
+  /// whether mem_id[addr] has been programmed
+  inline bool IsMemValid(bdpars::BDMemId mem_id, unsigned int addr) const { return mems_.at(mem_id)->valid.at(addr); }
 
   void SetReg(bdpars::BDHornEP reg_id, BDWord data);
   const std::pair<const BDWord, bool> GetReg(bdpars::BDHornEP reg_id) const;
 
-
   void SetNeuronConfigMem(unsigned int core_id,
                           unsigned int tile_id,
                           unsigned int elem_id,
                           bdpars::ConfigSomaID config_type,
-                          unsigned int config_value){
-    soma_config_mem_[tile_id][config_type][elem_id] = config_value;
-  }
-
-  std::vector<std::map<bdpars::ConfigSomaID, std::vector<unsigned int>>> GetSomaConfigMem() const { return soma_config_mem_; }
-
+                          unsigned int config_value);
   void SetNeuronConfigMem(unsigned int core_id,
                           unsigned int tile_id,
                           unsigned int elem_id,
                           bdpars::ConfigSynapseID config_type,
-                          unsigned int config_value){
-    synapse_config_mem_[tile_id][config_type][elem_id] = config_value;
-  }
-
-  std::vector<std::map<bdpars::ConfigSynapseID, std::vector<unsigned int>>> GetSynapseConfigMem() const { return synapse_config_mem_; }
-
+                          unsigned int config_value);
   void SetNeuronConfigMem(unsigned int core_id,
                           unsigned int tile_id,
                           unsigned int elem_id,
                           bdpars::DiffusorCutLocationId config_type,
-                          unsigned int config_value){
-    diffusor_config_mem_[tile_id][config_type][elem_id] = config_value;
-  }
+                          unsigned int config_value);
+
+  /// Single config bit: 0 or 1, kConfigUnset if it hasn't been set
+  unsigned int GetNeuronConfigMem(unsigned int core_id, unsigned int tile_id, unsigned int elem_id, bdpars::ConfigSomaID config_type) const;
+  unsigned int GetNeuronConfigMem(unsigned int core_id, unsigned int tile_id, unsigned int elem_id, bdpars::ConfigSynapseID config_type) const;
+  unsigned int GetNeuronConfigMem(unsigned int core_id, unsigned int tile_id, unsigned int elem_id, bdpars::DiffusorCutLocationId config_type) const;
 
-  std::vector<std::map<bdpars::DiffusorCutLocationId, std::vector<unsigned int>>> GetDiffusorConfigMem() const { return diffusor_config_mem_; }
+  /// Whole config memories, [tile_id][config_type][elem_id], built on each call (e.g. for YAML export)
+  std::vector<std::map<bdpars::ConfigSomaID, std::vector<unsigned int>>> GetSomaConfigMem() const;
+  std::vector<std::map<bdpars::ConfigSynapseID, std::vector<unsigned int>>> GetSynapseConfigMem() const;
+  std::vector<std::map<bdpars::DiffusorCutLocationId, std::vector<unsigned int>>> GetDiffusorConfigMem() const;
 
   // A toggle is a special case of register
   void SetToggle(bdpars::BDHornEP reg_id, bool traffic_en, bool dump_en);
@@ -71,51 +114,59 @@ class BDState {
   bool IsTrafficOff() const;       /// has AreTrafficRegsOff been true for traffic_drain_us
   void WaitForTrafficOff() const;  /// Busy wait until IsTrafficOff()
 
+  /// Cheap copy, shares everything with this state until either is written to
+  BDState Snapshot() const { return *this; }
+  /// Go back to <snapshot>'s contents (software state only, nothing is sent to the chip)
+  void Restore(const BDState &snapshot);
+  /// What differs between this state and <other>
+  BDStateDiff Diff(const BDState &other) const;
+
+  /// Write the state to a binary file, returns false on failure
+  bool Save(const std::string &filename) const;
+  /// Read a state written by Save(). Returns false and leaves the state alone
+  /// if the file can't be read or was written for different memory sizes
+  bool Load(const std::string &filename);
+  /// Save()/Load() to/from a stream (e.g. when a BDState is part of a larger file)
+  bool Write(std::ostream &file) const;
+  bool Read(std::istream &file);
+  /// 64-bit FNV-1a hash of everything Write() writes, identifies a configuration
+  uint64_t Fingerprint() const;
+
   // only private so we can get to it in the == operator function
   const bdpars::BDPars *bd_pars_;
 
   bool CompareTo(const BDState & other_state_obj) const;
 
  private:
+  /// contents of one memory, and whether each entry has been programmed
+  struct MemState {
+    std::vector<BDWord> words;
+    std::vector<bool> valid;
+  };
+
+  /// neuron config bits, [tile_id][config_type][elem_id] flattened
+  struct NeuronConfigState {
+    std::bitset<kNumTiles * kSomaBitsPerTile> soma, soma_valid;
+    std::bitset<kNumTiles * kSynapseBitsPerTile> synapse, synapse_valid;
+    std::bitset<kNumTiles * kDiffusorBitsPerTile> diffusor, diffusor_valid;
+  };
 
   // register contents
-  std::unordered_map<bdpars::BDHornEP, BDWord, EnumClassHash> reg_;
-  std::unordered_map<bdpars::BDHornEP, bool, EnumClassHash>   reg_valid_;
-
-  // memory contents
-  std::unordered_map<bdpars::BDMemId, std::vector<BDWord>, EnumClassHash> mems_; // conceptually, should be map of different-sized arrays
-
-  // binary vectors denote whether memory entries have been programmed
-  std::unordered_map<bdpars::BDMemId, std::vector<bool>, EnumClassHash> mems_valid_;
-
-  //////////////////////////////////////////////////////////////////////
-  /// Neuron state
-  //////////////////////////////////////////////////////////////////////
+  EnumArray<bdpars::BDHornEP, BDWord> reg_;
+  std::bitset<static_cast<std::size_t>(bdpars::BDHornEP::COUNT)> reg_valid_;
 
-  //////////////////////////////////////////////////////////////////////
-  /// Soma State Memory
-  //////////////////////////////////////////////////////////////////////
-  // soma_config_mem_[tile_id][bdpars::ConfigSomaID][soma_id]
-  std::vector<std::map<bdpars::ConfigSomaID, std::vector<unsigned int>>> soma_config_mem_;
+  // memory contents, shared between snapshots until written
+  EnumArray<bdpars::BDMemId, std::shared_ptr<MemState>> mems_;
 
-  //////////////////////////////////////////////////////////////////////
-  /// Synapse State Memory
-  //////////////////////////////////////////////////////////////////////
-  // synapse_config_mem_[tile_id][bdpars::ConfigSynapseID][synapse_id]
-  std::vector<std::map<bdpars::ConfigSynapseID, std::vector<unsigned int>>> synapse_config_mem_;
+  // neuron config, shared between snapshots until written
+  std::shared_ptr<NeuronConfigState> config_;
 
-  //////////////////////////////////////////////////////////////////////
-  /// Diffusor State Memory
-  //////////////////////////////////////////////////////////////////////
-  // diffusor_config_mem_[tile_id][bdpars::DiffusorCutLocationId][0]
-  std::vector<std::map<bdpars::DiffusorCutLocationId, std::vector<unsigned int>>> diffusor_config_mem_;
+  /// copy mem_id/config_ if another BDState still points to it
+  MemState *MutableMem(bdpars::BDMemId mem_id);
+  NeuronConfigState *MutableConfig();
 
   // I iterate through these a lot, this is for convenience
-  const std::vector<bdpars::BDHornEP> kTrafficRegs = {
-    bdpars::BDHornEP::NEURON_DUMP_TOGGLE, 
-    bdpars::BDHornEP::TOGGLE_PRE_FIFO,
-    bdpars::BDHornEP::TOGGLE_POST_FIFO0, 
-    bdpars::BDHornEP::TOGGLE_POST_FIFO1};
+  static const std::vector<bdpars::BDHornEP> kTrafficRegs;
 
   // timing: when certain things happened
   std::chrono::high_resolution_clock::time_point all_traffic_off_start_;
@@ -233,6 +233,12 @@ DEFWORD(FPGAIO,
     FIELDS(PAYLOAD , EP_CODE ) ,
     WIDTHS(24      , 8       )   )
 
+// multi-core only: sent after each FPGAIO word, the BrainDrizzle routers decrement HOPS
+// on the way up the stack and hand the word to the BD where it reaches 0
+DEFWORD(FPGARoute,
+    FIELDS(HOPS ) ,
+    WIDTHS(10   )   )
+
 DEFWORD(FPGABYTES,
     FIELDS(B0 , B1 , B2 , B3 ) ,
     WIDTHS(8  , 8  , 8  , 8  )   )
@@ -338,6 +344,16 @@ uint64_t PackWordVectorized(std::vector<std::pair<T, uint64_t> > & fields) {
   return retval;
 }
 
+/// Position of <field>'s LSB in a T word
+template <class T>
+unsigned int FieldShift(T field) {
+  unsigned int shift = 0;
+  for (unsigned int i = 0; i < static_cast<unsigned int>(field); i++) {
+    shift += FieldWidth(static_cast<T>(i));
+  }
+  return shift;
+}
+
 template <class T>
 uint64_t GetField(uint64_t word, T field) {
 
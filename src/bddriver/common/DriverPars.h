@@ -3,6 +3,7 @@
 
 #include <unordered_map>
 #include <string>
+#include <cstdint>
 
 namespace pystorm {
 namespace bddriver {
@@ -29,9 +30,39 @@ namespace driverpars {
   constexpr unsigned int BDMODELCOMM_TRY_FOR_US = 1 * ms;
   constexpr unsigned int BDMODELCOMM_SLEEP_FOR_US = 1 * ms;
 
+  constexpr unsigned int COMM_TRACE_FILE_BUF_BYTES = 1 << 20;  // file buffer for Comm::StartCapture() traces
+  constexpr unsigned int REPLAY_POLL_US = 100;                 // longest CommReplay waits between checks
+  constexpr unsigned int REPLAY_MAX_QUEUED_BYTES = 1 << 20;    // unpaced replay stays this far ahead of the decoder
+
+  constexpr unsigned int SYNTHETIC_POLL_US = 100;                // CommSynthetic sends a READ_SIZE frame this often
+  constexpr unsigned int SYNTHETIC_MAX_BACKLOG_WORDS = 1 << 22;  // past this, CommSynthetic drops what it generates
+
   constexpr unsigned int ENC_TIMEOUT_US = 1 * ms;
+  constexpr unsigned int ENC_BULK_POLL_US = 100;                          // how often held bulk blocks are reconsidered
+  constexpr unsigned int ENC_MAX_QUEUED_BULK_BYTES = 2 * MAX_WRITE_SIZE;  // bulk blocks wait while comm has this much queued
   constexpr unsigned int DEC_TIMEOUT_US = 1 * ms;
 
+  constexpr unsigned int FEEDER_POLL_US = 1 * ms;     // how often the timed input feeder checks FPGA time
+  constexpr unsigned int FEEDER_FILE_CHUNK = 4096;    // max records read from a schedule file per poll
+  constexpr uint64_t FEEDER_DEFAULT_WINDOW_NS = 100 * ms * 1000; // 100 ms lookahead
+
+  constexpr unsigned int SHM_RING_DEFAULT_CAPACITY = 1 << 20; // records in an upstream broadcast ring (32 MB)
+
+  constexpr unsigned int OUTPUT_STORE_SEGMENT_SIZE = 4096; // outputs per segment of a retention store
+
+  constexpr int SF_MAX_PLAUSIBLE_COUNT = 10000; // larger spike filter counts are sticky bits, translated to 0
+  constexpr unsigned int HOST_SF_MAX_QUEUED_STATES = 1 << 24; // host spike filter states kept until received (64 MB)
+
+  constexpr const char * DAEMON_SOCKET_PATH = "/tmp/bddriverd.sock"; // where bddriverd listens by default
+  constexpr uint64_t DAEMON_SHM_BYTES = 64 * 1024 * 1024; // each client's data segment for bulk payloads
+  constexpr uint64_t DAEMON_SHM_MIN_BYTES = 4096;         // smaller payloads just go over the socket
+  constexpr uint64_t DAEMON_MAX_FRAME_BYTES = 1ull << 30; // sanity limit on socket payloads
+  constexpr unsigned int DAEMON_POLL_MS = 100;            // how often server threads check whether to stop
+
+  constexpr unsigned int ATTACH_SAMPLES_PER_MEM = 16;  // windows of each memory Driver::AttachBD() dumps
+  constexpr unsigned int ATTACH_SAMPLE_WORDS = 16;     // words per window
+  constexpr unsigned int ATTACH_TIMEOUT_US = 2000 * ms; // how long to wait for all the dumps to come back
+
 }  // driverpars
 }  // bddriver
 }  // pystorm
@@ -15,8 +15,9 @@ namespace bddriver {
 typedef uint64_t BDTime;
 
 // decoder
+// outputs that span two FPGA words come out of the decoder already put back together
 struct DecOutput {
-  uint32_t     payload;
+  uint64_t     payload;
   BDTime       time;
 };
 typedef uint8_t DecInput;
@@ -26,6 +27,9 @@ struct EncInput {
 
   // if the encoder gets this, it finishes the block it's on
   const static unsigned int kFlushCode = UINT8_MAX;
+  // if the encoder gets this, it finishes the block it's on and sends the next
+  // already-encoded block given to Encoder::PushEncoded()
+  const static unsigned int kEncodedBlockCode = UINT8_MAX - 1;
 
   unsigned int core_id;
   uint8_t      FPGA_ep_code;
@@ -0,0 +1,72 @@
+#include "MemAllocator.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace pystorm {
+namespace bddriver {
+
+MemAllocator::MemAllocator(unsigned int size) : owners_(size, Owner::FREE) {}
+
+int MemAllocator::Alloc(unsigned int count) {
+  if (count == 0) return -1;
+  unsigned int run = 0;
+  for (unsigned int i = 0; i < owners_.size(); i++) {
+    run = owners_[i] == Owner::FREE ? run + 1 : 0;
+    if (run == count) {
+      unsigned int start = i + 1 - count;
+      std::fill(owners_.begin() + start, owners_.begin() + start + count, Owner::STAGED);
+      return start;
+    }
+  }
+  return -1;
+}
+
+bool MemAllocator::Reserve(unsigned int start, unsigned int count, bool live) {
+  if (start + count > owners_.size()) return false;
+  auto first = owners_.begin() + start;
+  auto last = first + count;
+  if (std::any_of(first, last, [](Owner owner) { return owner != Owner::FREE; })) return false;
+  std::fill(first, last, live ? Owner::LIVE : Owner::STAGED);
+  return true;
+}
+
+bool MemAllocator::IsStaged(unsigned int start, unsigned int count) const {
+  if (start + count > owners_.size()) return false;
+  auto first = owners_.begin() + start;
+  return std::all_of(first, first + count, [](Owner owner) { return owner == Owner::STAGED; });
+}
+
+void MemAllocator::Commit() {
+  for (auto &it : owners_) {
+    if (it == Owner::LIVE) {
+      it = Owner::FREE;
+    } else if (it == Owner::STAGED) {
+      it = Owner::LIVE;
+    }
+  }
+}
+
+void MemAllocator::Clear() {
+  std::fill(owners_.begin(), owners_.end(), Owner::FREE);
+}
+
+unsigned int MemAllocator::NumFree() const {
+  return std::count(owners_.begin(), owners_.end(), Owner::FREE);
+}
+
+std::vector<BDStateRange> MemAllocator::Ranges(Owner owner) const {
+  std::vector<BDStateRange> ranges;
+  for (unsigned int i = 0; i < owners_.size(); i++) {
+    if (owners_[i] != owner) continue;
+    if (ranges.size() > 0 && ranges.back().start + ranges.back().count == i) {
+      ranges.back().count++;
+    } else {
+      ranges.push_back({i, 1});
+    }
+  }
+  return ranges;
+}
+
+}  // bddriver
+}  // pystorm
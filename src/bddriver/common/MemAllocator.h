@@ -0,0 +1,51 @@
+#ifndef MEMALLOCATOR_H
+#define MEMALLOCATOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include "BDState.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// Tracks which entries of one BD memory (AM, MM, TAT) belong to which network,
+/// for the Driver's network hot-swap (see Driver::StageMem()).
+///
+/// Entries are free, live (the running network uses them), or staged (the next
+/// network is being written there). Commit() makes the staged entries live and
+/// frees the old live ones, so two networks take turns in the same memory.
+class MemAllocator {
+ public:
+  MemAllocator(unsigned int size);
+
+  /// Stage the first free run of <count> entries, returns its start, or -1 if there's no room
+  int Alloc(unsigned int count);
+  /// Mark [start, start + count) staged (or live). Returns false, and marks nothing, if any of it is taken
+  bool Reserve(unsigned int start, unsigned int count, bool live = false);
+  /// Whether every entry in [start, start + count) is staged
+  bool IsStaged(unsigned int start, unsigned int count) const;
+  /// Staged entries become live, live entries are freed
+  void Commit();
+  /// Free everything
+  void Clear();
+
+  std::vector<BDStateRange> FreeRanges() const   { return Ranges(Owner::FREE); }
+  std::vector<BDStateRange> LiveRanges() const   { return Ranges(Owner::LIVE); }
+  std::vector<BDStateRange> StagedRanges() const { return Ranges(Owner::STAGED); }
+  unsigned int NumFree() const;
+  unsigned int Size() const { return owners_.size(); }
+
+ private:
+  enum class Owner : uint8_t { FREE, LIVE, STAGED };
+
+  /// one per entry, the MM (the biggest memory) is only 64K
+  std::vector<Owner> owners_;
+
+  std::vector<BDStateRange> Ranges(Owner owner) const;
+};
+
+}  // bddriver
+}  // pystorm
+
+#endif
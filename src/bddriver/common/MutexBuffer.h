@@ -1,9 +1,11 @@
 #ifndef MUTEXBUFFER_H
 #define MUTEXBUFFER_H
 
+#include <atomic>
 #include <condition_variable>
 #include <chrono>  // duration, for wait_for
 #include <mutex>
+#include <thread>
 #include <deque>
 #include <vector>
 #include <memory>
@@ -16,6 +18,32 @@ using std::endl;
 namespace pystorm {
 namespace bddriver {
 
+/// Lets one consumer wait on several MutexBuffers with a single deadline:
+/// every buffer it's attached to (MutexBuffer::SetPushSignal()) notifies it on Push()
+class PushSignal {
+ private:
+  std::mutex lock_;
+  std::condition_variable pushed_;
+
+ public:
+  void Notify() {
+    std::unique_lock<std::mutex> ulock(lock_);
+    pushed_.notify_all();
+  }
+
+  /// Block until <ready>() is true, for at most <try_for_us> (0 = forever).
+  /// <ready> should check the attached buffers, e.g. with IsEmpty(). Returns <ready>()
+  template <class Pred>
+  bool Wait(Pred ready, unsigned int try_for_us) {
+    std::unique_lock<std::mutex> ulock(lock_);
+    if (try_for_us == 0) {
+      pushed_.wait(ulock, ready);
+      return true;
+    }
+    return pushed_.wait_for(ulock, std::chrono::microseconds(try_for_us), ready);
+  }
+};
+
 // thread-safe deque of vectors
 template <class T>
 class MutexBuffer {
@@ -30,32 +58,81 @@ class MutexBuffer {
   // CONTENTS of the vectors Pop()ed/Push()ed
   std::mutex lock_;
 
+  // vals_.size(), so spinning consumers can poll without the lock
+  std::atomic<unsigned int> num_vals_;
+
+  // how long consumers busy-poll before sleeping, 0 to not spin
+  std::atomic<unsigned int> spin_us_;
+
+  // also notified on Push(), for consumers waiting on several buffers
+  std::atomic<PushSignal *> push_signal_;
+
+  // busy-poll until something is pushed, for at most min(spin_us_, try_for_us) us.
+  // Returns the number of us that are left of try_for_us for the normal wait (0 = all used up)
+  unsigned int Spin(unsigned int try_for_us) {
+    unsigned int spin_us = spin_us_;
+    if (spin_us == 0) return try_for_us;
+    if (try_for_us != 0 && try_for_us < spin_us) spin_us = try_for_us;
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::microseconds(spin_us);
+    while (num_vals_.load(std::memory_order_acquire) == 0) {
+      if (std::chrono::steady_clock::now() >= deadline) break;
+      std::this_thread::yield(); // lets the producer run if we share a CPU
+    }
+
+    if (try_for_us == 0) return 0;
+    unsigned int spent_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    return spent_us >= try_for_us ? 1 : try_for_us - spent_us; // 0 would mean forever
+  }
+
  public:
 
-  MutexBuffer() {};
+  MutexBuffer() : num_vals_(0), spin_us_(0), push_signal_(nullptr) {};
   ~MutexBuffer() {};
 
+  /// Consumers busy-poll for up to <spin_us> before sleeping on the condition variable.
+  /// Lower handoff latency for more CPU, see Driver::SetRealTimeMode()
+  void SetSpinUs(unsigned int spin_us) { spin_us_ = spin_us; }
+
+  /// Also notify <signal> (nullptr for none) on every Push(). Several buffers can share one
+  void SetPushSignal(PushSignal *signal) { push_signal_ = signal; }
+
+  /// Whether there's nothing to pop, without taking the lock
+  bool IsEmpty() const { return num_vals_.load(std::memory_order_acquire) == 0; }
+
   // simple vector interface, the slowest option
 
   /// Push() pushes the elements in <input> to the back of the buffer.
   /// Blocks until it can gain the lock (shouldn't take long)
   void Push(std::unique_ptr<std::vector<T>> input) {
-    // gain lock, release it when we fall out of scope
-    std::unique_lock<std::mutex> ulock(lock_);
+    {
+      // gain lock, release it when we fall out of scope
+      std::unique_lock<std::mutex> ulock(lock_);
 
-    assert(input.get() != nullptr);
+      assert(input.get() != nullptr);
 
-    // push (move) vector pointer to back of queue
-    vals_.emplace_back(std::move(input));
+      // push (move) vector pointer to back of queue
+      vals_.emplace_back(std::move(input));
+      num_vals_.store(vals_.size(), std::memory_order_release);
+
+      // let the sleeping threads know they can wake up
+      just_pushed_.notify_all();
+    }
 
-    // let the sleeping threads know they can wake up
-    just_pushed_.notify_all();
+    // after num_vals_ is updated, so a PushSignal waiter checking IsEmpty() can't miss it
+    PushSignal *signal = push_signal_.load();
+    if (signal != nullptr) {
+      signal->Notify();
+    }
   }
 
   /// Pop() gets a vector of elements from the front of the buffer
   /// Blocks until the lock can be gained and there is somethign to pop
   /// Optionally can time out, returns empty vector in that case
   std::unique_ptr<std::vector<T>> Pop(unsigned int try_for_us=0) {
+    try_for_us = Spin(try_for_us);
+
     // gain lock, release it when we fall out of scope or go to sleep
     std::unique_lock<std::mutex> ulock(lock_);
 
@@ -76,12 +153,15 @@ class MutexBuffer {
     // return front vector pointer
     std::unique_ptr<std::vector<T>> front_vect = std::move(vals_.front());
     vals_.pop_front();
+    num_vals_.store(vals_.size(), std::memory_order_release);
 
     return front_vect;
   }
 
   /// PopAll() works similar to Pop(), except it pops everything available
   std::vector<std::unique_ptr<std::vector<T>>> PopAll(unsigned int try_for_us=1) {
+    try_for_us = Spin(try_for_us);
+
     // gain lock, release it when we fall out of scope or go to sleep
     std::unique_lock<std::mutex> ulock(lock_);
 
@@ -107,6 +187,7 @@ class MutexBuffer {
         buf_out.emplace_back(std::move(vals_.front()));
         vals_.pop_front();
     }
+    num_vals_.store(0, std::memory_order_release);
 
     return buf_out;
   }
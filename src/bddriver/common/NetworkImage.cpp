@@ -0,0 +1,123 @@
+#include "NetworkImage.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "DriverPars.h"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+
+constexpr char NetworkImage::kFileMagic[4];
+constexpr uint32_t NetworkImage::kFileVersion;
+
+NetworkImage::NetworkImage(const bdpars::BDPars *bd_pars) {
+  for (unsigned int i = 0; i < bd_pars->NumCores; i++) {
+    states.push_back(BDState(bd_pars));
+  }
+  num_AM_dump_words.resize(bd_pars->NumCores, 0);
+}
+
+uint64_t NetworkImage::NumBytes() const {
+  uint64_t num_bytes = 0;
+  for (auto &it : blocks) {
+    num_bytes += it.size();
+  }
+  return num_bytes;
+}
+
+bool NetworkImage::Save(const std::string &filename) const {
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    cout << "WARNING: NetworkImage: couldn't open " << filename << " for writing" << endl;
+    return false;
+  }
+
+  uint32_t block_size = driverpars::WRITE_BLOCK_SIZE;
+  uint32_t max_write_size = driverpars::MAX_WRITE_SIZE;
+  uint32_t num_cores = states.size();
+  file.write(kFileMagic, 4);
+  file.write(reinterpret_cast<const char *>(&kFileVersion), sizeof(kFileVersion));
+  file.write(reinterpret_cast<const char *>(&block_size), sizeof(block_size));
+  file.write(reinterpret_cast<const char *>(&max_write_size), sizeof(max_write_size));
+  file.write(reinterpret_cast<const char *>(&num_cores), sizeof(num_cores));
+
+  for (unsigned int i = 0; i < num_cores; i++) {
+    file.write(reinterpret_cast<const char *>(&num_AM_dump_words.at(i)), sizeof(uint32_t));
+    states[i].Write(file);
+  }
+
+  uint64_t num_blocks = blocks.size();
+  file.write(reinterpret_cast<const char *>(&num_blocks), sizeof(num_blocks));
+  for (auto &it : blocks) {
+    uint32_t size = it.size();
+    file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char *>(it.data()), size);
+  }
+  return file.good();
+}
+
+bool NetworkImage::Load(const std::string &filename, const bdpars::BDPars *bd_pars) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    cout << "WARNING: NetworkImage: couldn't open image file " << filename << endl;
+    return false;
+  }
+
+  char magic[4];
+  uint32_t version, block_size, max_write_size, num_cores;
+  file.read(magic, 4);
+  file.read(reinterpret_cast<char *>(&version), sizeof(version));
+  file.read(reinterpret_cast<char *>(&block_size), sizeof(block_size));
+  file.read(reinterpret_cast<char *>(&max_write_size), sizeof(max_write_size));
+  file.read(reinterpret_cast<char *>(&num_cores), sizeof(num_cores));
+
+  if (!file.good() || std::memcmp(magic, kFileMagic, 4) != 0 || version != kFileVersion) {
+    cout << "WARNING: NetworkImage: " << filename << " is not a network image file (version " << kFileVersion << ")" << endl;
+    return false;
+  }
+  if (block_size != driverpars::WRITE_BLOCK_SIZE || max_write_size != driverpars::MAX_WRITE_SIZE || num_cores != bd_pars->NumCores) {
+    cout << "WARNING: NetworkImage: " << filename << " was compiled for a different configuration: " <<
+      block_size << "B blocks, " << max_write_size << "B writes, " << num_cores << " cores" << endl;
+    return false;
+  }
+
+  NetworkImage loaded(bd_pars);
+  for (unsigned int i = 0; i < num_cores; i++) {
+    file.read(reinterpret_cast<char *>(&loaded.num_AM_dump_words[i]), sizeof(uint32_t));
+    if (!loaded.states[i].Read(file)) {
+      cout << "WARNING: NetworkImage: bad BDState for core " << i << " in " << filename << endl;
+      return false;
+    }
+  }
+
+  uint64_t num_blocks;
+  file.read(reinterpret_cast<char *>(&num_blocks), sizeof(num_blocks));
+  for (uint64_t i = 0; i < num_blocks && file.good(); i++) {
+    uint32_t size;
+    file.read(reinterpret_cast<char *>(&size), sizeof(size));
+    if (size % block_size != 0 || size > max_write_size) {
+      cout << "WARNING: NetworkImage: bad block size " << size << " in " << filename << endl;
+      return false;
+    }
+    std::vector<EncOutput> block(size);
+    file.read(reinterpret_cast<char *>(block.data()), size);
+    loaded.blocks.push_back(std::move(block));
+  }
+
+  if (!file.good()) {
+    cout << "WARNING: NetworkImage: " << filename << " is truncated" << endl;
+    return false;
+  }
+
+  *this = std::move(loaded);
+  return true;
+}
+
+}  // bddriver
+}  // pystorm
@@ -0,0 +1,54 @@
+#ifndef NETWORKIMAGE_H
+#define NETWORKIMAGE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BDPars.h"
+#include "BDState.h"
+#include "DriverTypes.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// A precompiled network load, made by Driver::BeginNetworkImage()/EndNetworkImage().
+///
+/// Holds the encoded downstream stream that a sequence of configuration calls
+/// (memories, neuron config, DACs, SG programming, ...) produced, and the BDState
+/// each core was left in. Driver::LoadNetworkImage() sends the blocks straight to
+/// comm and installs the states, so reloading a known network skips the packing,
+/// encoding, and per-memory traffic pauses.
+///
+/// An image is a change from the state it was captured from: load it onto a chip
+/// in that same state (e.g. right after InitBD()).
+struct NetworkImage {
+  /// file format: header, then per core: AM dump count and BDState, then the blocks
+  static constexpr char kFileMagic[4] = {'B', 'D', 'N', 'I'};
+  static constexpr uint32_t kFileVersion = 1;
+
+  NetworkImage() {};
+  NetworkImage(const bdpars::BDPars *bd_pars);
+
+  /// encoded downstream traffic, each block a multiple of WRITE_BLOCK_SIZE
+  /// and at most MAX_WRITE_SIZE bytes
+  std::vector<std::vector<EncOutput>> blocks;
+  /// state of each core once the blocks are sent
+  std::vector<BDState> states;
+  /// AM programming is read-modify-write: words that come back upstream per core
+  std::vector<uint32_t> num_AM_dump_words;
+
+  /// total bytes in blocks
+  uint64_t NumBytes() const;
+
+  /// Write the image to a binary file, returns false on failure
+  bool Save(const std::string &filename) const;
+  /// Read an image written by Save(). Returns false and leaves the image alone
+  /// if the file can't be read or doesn't match <bd_pars>/the driver's block sizes
+  bool Load(const std::string &filename, const bdpars::BDPars *bd_pars);
+};
+
+}  // bddriver
+}  // pystorm
+
+#endif
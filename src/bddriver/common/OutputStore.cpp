@@ -0,0 +1,144 @@
+#include "OutputStore.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+
+OutputStore::OutputStore(BDTime horizon, unsigned int segment_size)
+  : segment_size_(segment_size), horizon_(horizon), num_stored_(0) {
+  assert(segment_size_ > 0);
+}
+
+void OutputStore::Append(const std::vector<DecOutput> &outputs) {
+  if (outputs.size() == 0) return;
+
+  std::unique_lock<std::mutex> lock(lock_);
+  for (auto &it : outputs) {
+    if (segments_.size() > 0 && it.time < segments_.back().times.back()) {
+      cout << "WARNING: OutputStore: time went from " << segments_.back().times.back() << " back to " << it.time <<
+        ", FPGA time was reset? Dropping what was stored" << endl;
+      segments_.clear();
+      num_stored_ = 0;
+    }
+
+    if (segments_.size() == 0 || segments_.back().times.size() == segment_size_) {
+      segments_.emplace_back();
+      segments_.back().times.reserve(segment_size_);
+      segments_.back().words.reserve(segment_size_);
+    }
+    segments_.back().times.push_back(it.time);
+    segments_.back().words.push_back(it.payload);
+    num_stored_++;
+  }
+  Trim();
+}
+
+void OutputStore::Trim() {
+  const BDTime newest = segments_.back().times.back();
+  while (segments_.size() > 1 && newest - segments_.front().times.back() > horizon_) {
+    num_stored_ -= segments_.front().times.size();
+    segments_.pop_front();
+  }
+}
+
+std::pair<unsigned int, unsigned int> OutputStore::Seek(BDTime t) const {
+  // first segment that ends at or after t, then the first output at or after t in it
+  auto seg = std::lower_bound(segments_.begin(), segments_.end(), t,
+      [](const Segment &s, BDTime t) { return s.times.back() < t; });
+  if (seg == segments_.end()) {
+    return {segments_.size(), 0};
+  }
+  unsigned int idx = std::lower_bound(seg->times.begin(), seg->times.end(), t) - seg->times.begin();
+  return {static_cast<unsigned int>(seg - segments_.begin()), idx};
+}
+
+std::pair<std::vector<BDWord>, std::vector<BDTime>> OutputStore::Query(BDTime t0, BDTime t1) {
+  std::pair<std::vector<BDWord>, std::vector<BDTime>> result;
+  std::unique_lock<std::mutex> lock(lock_);
+  if (t1 <= t0) return result;
+
+  for (auto pos = Seek(t0); pos.first < segments_.size(); pos = {pos.first + 1, 0}) {
+    const Segment &seg = segments_[pos.first];
+    unsigned int end = std::lower_bound(seg.times.begin() + pos.second, seg.times.end(), t1) - seg.times.begin();
+    result.first.insert(result.first.end(), seg.words.begin() + pos.second, seg.words.begin() + end);
+    result.second.insert(result.second.end(), seg.times.begin() + pos.second, seg.times.begin() + end);
+    if (end < seg.times.size()) break; // the rest is at or after t1
+  }
+  return result;
+}
+
+std::vector<uint32_t> OutputStore::Bin(BDTime t0, unsigned int num_bins, BDTime bin_len,
+                                       const std::function<unsigned int(BDWord)> &key, unsigned int num_keys) {
+  std::vector<uint32_t> counts(static_cast<uint64_t>(num_bins) * num_keys, 0);
+  assert(bin_len > 0);
+  const BDTime t1 = t0 + num_bins * bin_len;
+
+  std::unique_lock<std::mutex> lock(lock_);
+  for (auto pos = Seek(t0); pos.first < segments_.size(); pos = {pos.first + 1, 0}) {
+    const Segment &seg = segments_[pos.first];
+    unsigned int i = pos.second;
+    for (; i < seg.times.size() && seg.times[i] < t1; i++) {
+      unsigned int k = key(seg.words[i]);
+      if (k < num_keys) {
+        counts[(seg.times[i] - t0) / bin_len * num_keys + k]++;
+      }
+    }
+    if (i < seg.times.size()) break;
+  }
+  return counts;
+}
+
+void OutputStore::Release(BDTime t) {
+  std::unique_lock<std::mutex> lock(lock_);
+  auto pos = Seek(t);
+  for (unsigned int i = 0; i < pos.first; i++) {
+    num_stored_ -= segments_.front().times.size();
+    segments_.pop_front();
+  }
+  if (segments_.size() > 0 && pos.second > 0) {
+    Segment &front = segments_.front();
+    front.times.erase(front.times.begin(), front.times.begin() + pos.second);
+    front.words.erase(front.words.begin(), front.words.begin() + pos.second);
+    num_stored_ -= pos.second;
+  }
+}
+
+void OutputStore::Clear() {
+  std::unique_lock<std::mutex> lock(lock_);
+  segments_.clear();
+  num_stored_ = 0;
+}
+
+void OutputStore::SetHorizon(BDTime horizon) {
+  std::unique_lock<std::mutex> lock(lock_);
+  horizon_ = horizon;
+  if (segments_.size() > 0) Trim();
+}
+
+BDTime OutputStore::GetHorizon() {
+  std::unique_lock<std::mutex> lock(lock_);
+  return horizon_;
+}
+
+uint64_t OutputStore::GetNumStored() {
+  std::unique_lock<std::mutex> lock(lock_);
+  return num_stored_;
+}
+
+std::pair<BDTime, BDTime> OutputStore::GetTimeRange() {
+  std::unique_lock<std::mutex> lock(lock_);
+  if (segments_.size() == 0) return {0, 0};
+  return {segments_.front().times.front(), segments_.back().times.back()};
+}
+
+}  // bddriver namespace
+}  // pystorm namespace
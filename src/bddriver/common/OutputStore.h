@@ -0,0 +1,82 @@
+#ifndef OUTPUTSTORE_H
+#define OUTPUTSTORE_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "common/BDWord.h"
+#include "common/DriverPars.h"
+#include "common/DriverTypes.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// OutputStore keeps the recent history of one upstream stream (one core's ep),
+/// so it can be read by time range, any number of times, instead of popped.
+///
+/// Outputs are kept in time order, in columnar segments of <segment_size> outputs
+/// (times and words in separate arrays). Segments more than <horizon> behind the
+/// newest output are dropped as outputs come in, so memory goes with the horizon,
+/// not with how long the store has been running. Seeking to a time is a binary
+/// search over segments, then within one.
+///
+/// Times are whatever the appender uses (the Decoder's are FPGA time units).
+/// Append() is called from one thread (the Decoder's), everything else is thread-safe.
+class OutputStore {
+ public:
+  /// Keep outputs up to <horizon> behind the newest one
+  OutputStore(BDTime horizon, unsigned int segment_size = driverpars::OUTPUT_STORE_SEGMENT_SIZE);
+
+  /// Add <outputs>, whose times must be non-decreasing and not before what's already stored.
+  /// A time going backwards (the FPGA clock was reset) clears the store first
+  void Append(const std::vector<DecOutput> &outputs);
+
+  /// Words and times of the outputs in [<t0>, <t1>), oldest first
+  std::pair<std::vector<BDWord>, std::vector<BDTime>> Query(BDTime t0, BDTime t1);
+
+  /// Count the outputs in [<t0>, <t0> + num_bins * <bin_len>), by bin and by <key>(word).
+  /// Returns num_bins * <num_keys> counts, bin major. Outputs with keys >= <num_keys> aren't counted
+  std::vector<uint32_t> Bin(BDTime t0, unsigned int num_bins, BDTime bin_len,
+                            const std::function<unsigned int(BDWord)> &key, unsigned int num_keys);
+
+  /// Drop the outputs before <t>, e.g. once they've been read
+  void Release(BDTime t);
+  /// Drop everything
+  void Clear();
+
+  void SetHorizon(BDTime horizon);
+  BDTime GetHorizon();
+
+  /// Outputs currently held
+  uint64_t GetNumStored();
+  /// Times of the oldest and newest outputs held, {0, 0} if empty
+  std::pair<BDTime, BDTime> GetTimeRange();
+
+ private:
+  /// a run of outputs, oldest first
+  struct Segment {
+    std::vector<BDTime> times;
+    std::vector<BDWord> words;
+  };
+
+  const unsigned int segment_size_;
+
+  std::mutex lock_; /// guards everything below
+  BDTime horizon_;
+  std::deque<Segment> segments_; /// oldest first, none empty
+  uint64_t num_stored_;
+
+  /// Drop segments that are entirely more than horizon_ behind the newest output
+  void Trim();
+  /// Position of the first output at or after <t>: {segment index, index within it}
+  std::pair<unsigned int, unsigned int> Seek(BDTime t) const;
+};
+
+}  // bddriver namespace
+}  // pystorm namespace
+
+#endif
@@ -0,0 +1,55 @@
+#include "RateGovernor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace pystorm {
+namespace bddriver {
+
+RateGovernor::RateGovernor(const RateGovernorConfig &config)
+  : config_(config),
+  scale_(1),
+  started_(false),
+  interval_start_(0),
+  num_overflows_(0),
+  interval_overflows_(0),
+  interval_fill_(0) {
+  assert(config_.decrease > 0 && config_.decrease < 1);
+  assert(config_.increase >= 1);
+  assert(config_.min_scale > 0 && config_.min_scale <= 1);
+  assert(config_.interval_ns > 0);
+}
+
+bool RateGovernor::Update(BDTime time_ns) {
+  if (!started_ || time_ns < interval_start_) { // first call, or the FPGA time was reset
+    started_ = true;
+    interval_start_ = time_ns;
+    interval_overflows_ = 0;
+    interval_fill_ = 0;
+    return false;
+  }
+  if (time_ns - interval_start_ < config_.interval_ns) return false;
+
+  const double loss_rate = interval_overflows_ / ((time_ns - interval_start_) * 1e-9);
+  const double fill = interval_fill_;
+  interval_start_ = time_ns;
+  interval_overflows_ = 0;
+  interval_fill_ = 0;
+
+  double scale = scale_;
+  if (loss_rate > config_.target_loss_rate || fill > config_.queue_high) {
+    scale = std::max(scale_ * config_.decrease, config_.min_scale);
+  } else if (loss_rate == 0 && fill < config_.queue_high / 2) {
+    scale = std::min(scale_ * config_.increase, 1.0);
+  }
+  if (scale == scale_) return false;
+
+  scale_ = scale;
+  log_.push_back({time_ns, scale_, loss_rate, fill});
+  return true;
+}
+
+}  // bddriver namespace
+}  // pystorm namespace
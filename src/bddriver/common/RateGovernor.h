@@ -0,0 +1,65 @@
+#ifndef RATEGOVERNOR_H
+#define RATEGOVERNOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include "common/DriverTypes.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// How a RateGovernor reacts, see Driver::StartRateGovernor()
+struct RateGovernorConfig {
+  double target_loss_rate = 1;     /// FIFO overflows/s to stay under
+  double queue_high = 0.75;        /// downstream queue fill (fraction of WRITE_FIFO_DEPTH) that also counts as overloaded
+  double decrease = 0.8;           /// scale *= decrease when overloaded
+  double increase = 1.05;          /// scale *= increase (up to 1) when there were no overflows and the queue was below queue_high / 2
+  double min_scale = 0.01;
+  BDTime interval_ns = 10000000;   /// how often the scale is reconsidered
+};
+
+/// One change of the scale
+struct RateGovernorAdjustment {
+  BDTime time;         /// ns, FPGA time the new scale was applied
+  double scale;        /// programmed rates are requested rates * scale from here on
+  double loss_rate;    /// overflows/s over the interval that prompted it
+  double queue_fill;   /// fullest the downstream queue got in that interval
+};
+
+/// RateGovernor decides how much to scale input rates by to keep FIFO overflows
+/// under a target rate: multiplicatively down when an interval had too many
+/// overflows (or the downstream queue got too full), slowly back up when it had none.
+/// Every change is logged, so what was actually programmed can be worked out later.
+/// Not thread-safe
+class RateGovernor {
+ public:
+  explicit RateGovernor(const RateGovernorConfig &config);
+
+  /// Count <num> overflow events
+  void AddOverflows(unsigned int num) { num_overflows_ += num; interval_overflows_ += num; }
+  /// Note the downstream queue fill (0 to 1)
+  void AddQueueFill(double fill) { if (fill > interval_fill_) interval_fill_ = fill; }
+  /// At <time_ns>, reconsider the scale if an interval is up. Returns true if it changed
+  bool Update(BDTime time_ns);
+
+  double GetScale() const { return scale_; }
+  const RateGovernorConfig &GetConfig() const { return config_; }
+  const std::vector<RateGovernorAdjustment> &GetLog() const { return log_; }
+  uint64_t GetNumOverflows() const { return num_overflows_; }
+
+ private:
+  const RateGovernorConfig config_;
+  double scale_;
+  bool started_;
+  BDTime interval_start_;
+  uint64_t num_overflows_;
+  uint64_t interval_overflows_;
+  double interval_fill_;
+  std::vector<RateGovernorAdjustment> log_;
+};
+
+}  // bddriver namespace
+}  // pystorm namespace
+
+#endif
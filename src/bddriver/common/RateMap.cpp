@@ -0,0 +1,239 @@
+#include "RateMap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+
+// the numpy reader hard-codes this layout
+static_assert(sizeof(RateMapHeader) == 128, "RateMapHeader layout changed");
+static_assert(sizeof(RateMapBuffer) == 64, "RateMapBuffer layout changed");
+
+constexpr char RateMap::kMagic[4];
+constexpr uint32_t RateMap::kVersion;
+
+namespace {
+
+// POSIX shm names start with a single '/'
+std::string ShmName(const std::string &name) {
+  return name.size() > 0 && name[0] == '/' ? name : "/" + name;
+}
+
+// a reader that keeps losing the race to the writer gives up after this many tries
+constexpr unsigned int kMaxReadTries = 8;
+
+}  // anonymous namespace
+
+size_t RateMap::BufferOffset(unsigned int num_neurons, unsigned int idx) {
+  // keep each buffer 8-byte aligned
+  const size_t buffer_size = sizeof(RateMapBuffer) + (num_neurons * sizeof(float) + 7) / 8 * 8;
+  return sizeof(RateMapHeader) + idx * buffer_size;
+}
+
+size_t RateMap::Size(unsigned int num_neurons) {
+  return BufferOffset(num_neurons, 2);
+}
+
+RateMap::RateMap(const std::vector<unsigned int> &aer_to_xy, unsigned int width,
+                 BDTime tau_ns, BDTime refresh_ns, BDTime ns_per_unit, const std::string &name)
+  : aer_to_xy_(aer_to_xy),
+  tau_ns_(tau_ns),
+  refresh_ns_(refresh_ns),
+  ns_per_unit_(ns_per_unit),
+  name_(name.size() > 0 ? ShmName(name) : ""),
+  size_(Size(aer_to_xy.size())),
+  header_(nullptr),
+  counts_(aer_to_xy.size(), 0),
+  rates_(aer_to_xy.size(), 0),
+  started_(false),
+  last_refresh_ns_(0),
+  seq_(0),
+  num_bad_addrs_(0) {
+
+  void *mem;
+  if (name_.size() == 0) {
+    private_mem_.assign((size_ + 7) / 8, 0);
+    mem = private_mem_.data();
+  } else {
+    // start from a fresh segment, readers of an old one keep their mapping
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+      cout << "WARNING: RateMap: couldn't create " << name_ << ": " << std::strerror(errno) << endl;
+      return;
+    }
+    if (ftruncate(fd, size_) != 0) {
+      cout << "WARNING: RateMap: couldn't size " << name_ << ": " << std::strerror(errno) << endl;
+      close(fd);
+      shm_unlink(name_.c_str());
+      return;
+    }
+    mem = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+      cout << "WARNING: RateMap: couldn't map " << name_ << ": " << std::strerror(errno) << endl;
+      shm_unlink(name_.c_str());
+      return;
+    }
+  }
+
+  // zero-filled, so both buffers start out unwritten (seq 0)
+  RateMapHeader *header = new (mem) RateMapHeader;
+  header->version = kVersion;
+  header->num_neurons = aer_to_xy_.size();
+  header->width = width;
+  header->tau_s = tau_ns_ * 1e-9;
+  header->refresh_s = refresh_ns_ * 1e-9;
+  header->seq.store(0);
+  for (unsigned int i = 0; i < 2; i++) {
+    new (static_cast<char *>(mem) + BufferOffset(aer_to_xy_.size(), i)) RateMapBuffer;
+  }
+
+  // magic last: readers that check it see a finished header
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, kMagic, sizeof(kMagic));
+  header_ = header;
+}
+
+RateMap::~RateMap() {
+  if (header_ != nullptr && name_.size() > 0) {
+    munmap(header_, size_);
+    shm_unlink(name_.c_str());
+  }
+}
+
+void RateMap::AddSpikes(const std::vector<DecOutput> &spikes) {
+  for (auto &it : spikes) {
+    // corrupted addresses happen, see RecvXYSpikesMasked()
+    if (it.payload < aer_to_xy_.size()) {
+      counts_[aer_to_xy_[it.payload]]++;
+    } else {
+      num_bad_addrs_++;
+    }
+  }
+}
+
+void RateMap::Update(BDTime time) {
+  const BDTime time_ns = time * ns_per_unit_;
+  if (!started_ || time_ns < last_refresh_ns_) { // first call, or the FPGA time was reset
+    started_ = true;
+    last_refresh_ns_ = time_ns;
+    std::fill(counts_.begin(), counts_.end(), 0);
+    return;
+  }
+  if (time_ns - last_refresh_ns_ < refresh_ns_) return;
+
+  const double dt = (time_ns - last_refresh_ns_) * 1e-9;
+  const float decay = std::exp(-static_cast<double>(time_ns - last_refresh_ns_) / tau_ns_);
+  const float weight = (1 - decay) / dt;
+  const unsigned int num_neurons = rates_.size();
+  float *rates = rates_.data();
+  uint32_t *counts = counts_.data();
+  for (unsigned int i = 0; i < num_neurons; i++) {
+    rates[i] = rates[i] * decay + weight * counts[i];
+    counts[i] = 0;
+  }
+  last_refresh_ns_ = time_ns;
+
+  Publish(time_ns);
+}
+
+void RateMap::Publish(BDTime time_ns) {
+  if (header_ == nullptr) return;
+
+  // the buffer the newest map isn't in, seqlock-style: invalidate, fill in, then stamp
+  seq_++;
+  char *buffer_start = reinterpret_cast<char *>(header_) + BufferOffset(rates_.size(), seq_ % 2);
+  RateMapBuffer *buffer = reinterpret_cast<RateMapBuffer *>(buffer_start);
+  buffer->seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  buffer->time = time_ns;
+  std::memcpy(buffer_start + sizeof(RateMapBuffer), rates_.data(), rates_.size() * sizeof(float));
+  buffer->seq.store(seq_, std::memory_order_release);
+  header_->seq.store(seq_, std::memory_order_release);
+}
+
+bool RateMap::ReadHeader(const RateMapHeader *header, BDTime *time_ns, std::vector<float> *rates) {
+  if (header == nullptr) return false;
+
+  for (unsigned int i = 0; i < kMaxReadTries; i++) {
+    const uint64_t seq = header->seq.load(std::memory_order_acquire);
+    if (seq == 0) return false;
+
+    const char *buffer_start = reinterpret_cast<const char *>(header) + BufferOffset(header->num_neurons, seq % 2);
+    const RateMapBuffer *buffer = reinterpret_cast<const RateMapBuffer *>(buffer_start);
+    if (buffer->seq.load(std::memory_order_acquire) != seq) continue;
+
+    rates->resize(header->num_neurons);
+    std::memcpy(rates->data(), buffer_start + sizeof(RateMapBuffer), header->num_neurons * sizeof(float));
+    *time_ns = buffer->time;
+
+    // the writer got back around to this buffer while we copied it
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (buffer->seq.load(std::memory_order_relaxed) == seq) return true;
+  }
+  return false;
+}
+
+bool RateMapReader::Open(const std::string &name) {
+  Close();
+  const std::string shm_name = ShmName(name);
+  int fd = shm_open(shm_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    cout << "WARNING: RateMapReader: couldn't open " << shm_name << ": " << std::strerror(errno) << endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(RateMapHeader)) {
+    cout << "WARNING: RateMapReader: " << shm_name << " is too small to be a rate map" << endl;
+    close(fd);
+    return false;
+  }
+  void *mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    cout << "WARNING: RateMapReader: couldn't map " << shm_name << ": " << std::strerror(errno) << endl;
+    return false;
+  }
+
+  const RateMapHeader *header = static_cast<const RateMapHeader *>(mem);
+  if (std::memcmp(header->magic, RateMap::kMagic, sizeof(RateMap::kMagic)) != 0 ||
+      header->version != RateMap::kVersion ||
+      static_cast<size_t>(st.st_size) < RateMap::Size(header->num_neurons)) {
+    cout << "WARNING: RateMapReader: " << shm_name << " isn't a version " << RateMap::kVersion << " rate map" << endl;
+    munmap(mem, st.st_size);
+    return false;
+  }
+
+  size_ = st.st_size;
+  header_ = header;
+  return true;
+}
+
+void RateMapReader::Close() {
+  if (header_ != nullptr) {
+    munmap(const_cast<RateMapHeader *>(header_), size_);
+    header_ = nullptr;
+    size_ = 0;
+  }
+}
+
+}  // bddriver namespace
+}  // pystorm namespace
@@ -0,0 +1,126 @@
+#ifndef RATEMAP_H
+#define RATEMAP_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/DriverTypes.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// Start of a rate map's memory, two RateMapBuffers follow at sizeof(RateMapHeader)
+struct RateMapHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t num_neurons;          /// rates per buffer, in XY order (y * width + x)
+  uint32_t width;
+  double tau_s;                  /// time constant of the estimate
+  double refresh_s;              /// how often it's published
+  uint8_t pad0[32];
+  std::atomic<uint64_t> seq;     /// maps published so far, the newest one is in buffer seq % 2
+  uint8_t pad1[56];
+};
+
+/// One of the two buffers, num_neurons floats (Hz) follow at sizeof(RateMapBuffer)
+struct RateMapBuffer {
+  std::atomic<uint64_t> seq;     /// sequence number of the map in this buffer, 0 while it's being written
+  uint64_t time;                 /// ns
+  uint8_t pad[48];
+};
+
+/// RateMap keeps an exponentially weighted firing rate estimate for every neuron,
+/// from the spikes the decoder sees, and publishes it through a double buffer.
+///
+/// The decoder thread counts spikes as they're decoded (AddSpikes()). Every
+/// <refresh_ns> (at the next Update()), the counts go into the estimate,
+/// rate = rate * d + (1 - d) * count / dt, with d = exp(-dt / tau),
+/// which is written to the buffer readers aren't looking at, then published
+/// by bumping a sequence number. Readers never block the writer: they copy
+/// the newest buffer and check its sequence number didn't change meanwhile.
+///
+/// With a <name>, the buffers live in POSIX shared memory (/dev/shm/<name> on Linux),
+/// so other processes can poll the map too (RateMapReader, pystorm/hal/rate_map.py)
+class RateMap {
+ public:
+  static constexpr char kMagic[4] = {'B', 'D', 'R', 'M'};
+  static constexpr uint32_t kVersion = 1;
+
+  /// <aer_to_xy> gives each AER neuron address's XY index, rows of <width> neurons.
+  /// <name> is a shared memory segment to create (or replace), "" keeps the map private.
+  /// Check IsOpen(), prints a warning on failure
+  RateMap(const std::vector<unsigned int> &aer_to_xy, unsigned int width,
+          BDTime tau_ns, BDTime refresh_ns, BDTime ns_per_unit, const std::string &name = "");
+  /// unmaps and unlinks the shared memory, readers that still have it mapped keep what's there
+  ~RateMap();
+
+  bool IsOpen() const { return header_ != nullptr; }
+  const std::string &GetName() const { return name_; }
+  unsigned int GetNumNeurons() const { return aer_to_xy_.size(); }
+
+  /// Count decoded NRNI outputs. Only call from one thread, the same as Update()
+  void AddSpikes(const std::vector<DecOutput> &spikes);
+  /// Fold the counts into the estimate and publish it, if it's been <refresh_ns> since the last time.
+  /// <time> is the latest upstream HB (FPGA units)
+  void Update(BDTime time);
+
+  /// Copy the newest map, from any thread. Returns false if nothing's been published yet
+  bool Read(BDTime *time_ns, std::vector<float> *rates) const { return ReadHeader(header_, time_ns, rates); }
+  /// Maps published so far
+  uint64_t GetSeq() const { return header_ ? header_->seq.load() : 0; }
+
+  /// Read() for any mapped RateMapHeader
+  static bool ReadHeader(const RateMapHeader *header, BDTime *time_ns, std::vector<float> *rates);
+  /// Bytes for <num_neurons>, header and both buffers
+  static size_t Size(unsigned int num_neurons);
+  /// Where buffer <idx> starts, from the header
+  static size_t BufferOffset(unsigned int num_neurons, unsigned int idx);
+
+ private:
+  std::vector<unsigned int> aer_to_xy_;
+  const BDTime tau_ns_;
+  const BDTime refresh_ns_;
+  const BDTime ns_per_unit_;
+  std::string name_;
+  size_t size_;
+  RateMapHeader *header_;
+  std::vector<uint64_t> private_mem_; /// backs header_ if there's no shared memory
+
+  std::vector<uint32_t> counts_;      /// XY order, since the last refresh
+  std::vector<float> rates_;          /// XY order
+  bool started_;
+  BDTime last_refresh_ns_;
+  uint64_t seq_;                      /// local copy, we're the only writer
+  uint64_t num_bad_addrs_;
+
+  void Publish(BDTime time_ns);
+};
+
+/// RateMapReader polls a shared memory RateMap from any process
+class RateMapReader {
+ public:
+  RateMapReader() : size_(0), header_(nullptr) {};
+  ~RateMapReader() { Close(); }
+
+  /// Map segment <name>. Returns false (with a warning) if there's no such map
+  bool Open(const std::string &name);
+  void Close();
+  bool IsOpen() const { return header_ != nullptr; }
+
+  /// Copy the newest map. Returns false if nothing's been published yet
+  bool Read(BDTime *time_ns, std::vector<float> *rates) const { return RateMap::ReadHeader(header_, time_ns, rates); }
+  uint64_t GetSeq() const { return header_ ? header_->seq.load() : 0; }
+  unsigned int GetNumNeurons() const { return header_ ? header_->num_neurons : 0; }
+  unsigned int GetWidth() const { return header_ ? header_->width : 0; }
+
+ private:
+  size_t size_;
+  const RateMapHeader *header_;
+};
+
+}  // bddriver namespace
+}  // pystorm namespace
+
+#endif
@@ -0,0 +1,82 @@
+#include "RealTime.h"
+
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+
+#ifdef __linux__
+
+bool ConfigureThread(std::thread *thread, int cpu, int fifo_priority) {
+  pthread_t handle = thread->native_handle();
+  bool success = true;
+
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  if (cpu < 0) {
+    for (unsigned int i = 0; i < std::thread::hardware_concurrency(); i++) {
+      CPU_SET(i, &cpus);
+    }
+  } else {
+    CPU_SET(cpu, &cpus);
+  }
+  int err = pthread_setaffinity_np(handle, sizeof(cpus), &cpus);
+  if (err != 0) {
+    cout << "WARNING: ConfigureThread: couldn't pin thread to CPU " << cpu << ": " << std::strerror(err) << endl;
+    success = false;
+  }
+
+  sched_param param;
+  param.sched_priority = fifo_priority > 0 ? fifo_priority : 0;
+  err = pthread_setschedparam(handle, fifo_priority > 0 ? SCHED_FIFO : SCHED_OTHER, &param);
+  if (err != 0) {
+    cout << "WARNING: ConfigureThread: couldn't set SCHED_FIFO priority " << fifo_priority << ": " << std::strerror(err) << endl;
+    success = false;
+  }
+
+  return success;
+}
+
+bool LockProcessMemory(bool lock) {
+  int err = lock ? mlockall(MCL_CURRENT | MCL_FUTURE) : munlockall();
+  if (err != 0) {
+    cout << "WARNING: LockProcessMemory: " << (lock ? "mlockall" : "munlockall") << " failed: " << std::strerror(errno) << endl;
+    return false;
+  }
+  return true;
+}
+
+#else
+
+bool ConfigureThread(std::thread *thread, int cpu, int fifo_priority) {
+  if (cpu >= 0 || fifo_priority > 0) {
+    cout << "WARNING: ConfigureThread: thread pinning and SCHED_FIFO are only supported on Linux" << endl;
+    return false;
+  }
+  return true;
+}
+
+bool LockProcessMemory(bool lock) {
+  if (lock) {
+    cout << "WARNING: LockProcessMemory: only supported on Linux" << endl;
+    return false;
+  }
+  return true;
+}
+
+#endif
+
+}  // bddriver
+}  // pystorm
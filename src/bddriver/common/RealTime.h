@@ -0,0 +1,33 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <thread>
+
+namespace pystorm {
+namespace bddriver {
+
+/// Settings for the driver's low-latency (closed-loop) mode, see Driver::SetRealTimeMode().
+/// The defaults are the normal mode.
+struct RealTimeConfig {
+  int comm_cpu      = -1;  /// CPU to pin the comm thread to, -1 for any
+  int enc_cpu       = -1;  /// CPU to pin the encoder thread to, -1 for any
+  int dec_cpu       = -1;  /// CPU to pin the decoder thread to, -1 for any
+  int fifo_priority = 0;   /// > 0: run comm/enc/dec threads under SCHED_FIFO at this priority.
+                           /// Don't combine with spinning unless each thread has its own CPU
+  bool lock_memory  = false; /// mlockall() the process, so page faults can't stall the loop
+  unsigned int spin_us = 0;  /// > 0: threads busy-poll their input buffers for this long
+                             /// before sleeping, instead of waiting on a condition variable
+};
+
+/// Pin <thread> to <cpu> (-1 unpins) and set its scheduling policy:
+/// SCHED_FIFO at <fifo_priority> if it's > 0, the default policy otherwise.
+/// Prints a warning and returns false if the OS refuses (e.g. missing CAP_SYS_NICE)
+bool ConfigureThread(std::thread *thread, int cpu, int fifo_priority);
+
+/// mlockall()/munlockall() the process. Prints a warning and returns false on failure
+bool LockProcessMemory(bool lock);
+
+}  // bddriver
+}  // pystorm
+
+#endif
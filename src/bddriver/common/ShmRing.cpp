@@ -0,0 +1,243 @@
+#include "ShmRing.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+
+// the numpy reader hard-codes this layout
+static_assert(sizeof(ShmRingHeader) == 128, "ShmRingHeader layout changed");
+static_assert(sizeof(ShmRecord) == 32, "ShmRecord layout changed");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared memory atomics must be lock-free");
+
+constexpr char ShmRingWriter::kMagic[4];
+constexpr uint32_t ShmRingWriter::kVersion;
+
+namespace {
+
+// POSIX shm names start with a single '/'
+std::string ShmName(const std::string &name) {
+  return name.size() > 0 && name[0] == '/' ? name : "/" + name;
+}
+
+unsigned int NextPowerOf2(unsigned int n) {
+  unsigned int p = 1;
+  while (p < n) p <<= 1;
+  return p;
+}
+
+}  // anonymous namespace
+
+ShmRingWriter::ShmRingWriter(const std::string &name, unsigned int capacity, BDTime ns_per_unit)
+  : name_(ShmName(name)),
+  capacity_(NextPowerOf2(capacity)),
+  size_(sizeof(ShmRingHeader) + capacity_ * sizeof(ShmRecord)),
+  header_(nullptr),
+  records_(nullptr),
+  write_seq_(0) {
+
+  // start from a fresh segment, readers of an old one keep their mapping
+  shm_unlink(name_.c_str());
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    cout << "WARNING: ShmRingWriter: couldn't create " << name_ << ": " << std::strerror(errno) << endl;
+    return;
+  }
+  if (ftruncate(fd, size_) != 0) {
+    cout << "WARNING: ShmRingWriter: couldn't size " << name_ << ": " << std::strerror(errno) << endl;
+    close(fd);
+    shm_unlink(name_.c_str());
+    return;
+  }
+  void *mem = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    cout << "WARNING: ShmRingWriter: couldn't map " << name_ << ": " << std::strerror(errno) << endl;
+    shm_unlink(name_.c_str());
+    return;
+  }
+
+  // ftruncate zero-fills, so every record starts out unwritten (seq 0)
+  ShmRingHeader *header = new (mem) ShmRingHeader;
+  records_ = reinterpret_cast<ShmRecord *>(static_cast<char *>(mem) + sizeof(ShmRingHeader));
+  header->version = kVersion;
+  header->record_size = sizeof(ShmRecord);
+  header->capacity = capacity_;
+  header->ns_per_unit.store(ns_per_unit);
+  header->write_seq.store(0);
+
+  // magic last: readers that check it see a finished header
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, kMagic, sizeof(kMagic));
+  header_ = header;
+}
+
+ShmRingWriter::~ShmRingWriter() {
+  if (header_ != nullptr) {
+    munmap(header_, size_);
+    shm_unlink(name_.c_str());
+  }
+}
+
+void ShmRingWriter::Publish(unsigned int core_id, uint8_t ep_code, const std::vector<DecOutput> &outputs) {
+  if (header_ == nullptr) return;
+
+  const uint64_t mask = capacity_ - 1;
+  for (auto &it : outputs) {
+    ShmRecord &rec = records_[write_seq_ & mask];
+
+    // seqlock-style: invalidate, fill in, then stamp with the new sequence number
+    rec.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    rec.time    = it.time;
+    rec.payload = it.payload;
+    rec.core_id = core_id;
+    rec.ep_code = ep_code;
+    write_seq_++;
+    rec.seq.store(write_seq_, std::memory_order_release);
+  }
+  header_->write_seq.store(write_seq_, std::memory_order_release);
+}
+
+void ShmRingWriter::SetNsPerUnit(BDTime ns_per_unit) {
+  if (header_ != nullptr) {
+    header_->ns_per_unit.store(ns_per_unit);
+  }
+}
+
+uint64_t ShmRingWriter::GetWriteSeq() const {
+  // write_seq_ is the publishing thread's, other threads go through the header
+  return header_ ? header_->write_seq.load(std::memory_order_acquire) : 0;
+}
+
+bool ShmRingReader::Open(const std::string &name, bool from_oldest) {
+  Close();
+
+  const std::string shm_name = ShmName(name);
+  int fd = shm_open(shm_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    cout << "WARNING: ShmRingReader: couldn't open " << shm_name << ": " << std::strerror(errno) << endl;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ShmRingHeader)) {
+    cout << "WARNING: ShmRingReader: " << shm_name << " is too small to be a ring" << endl;
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  void *mem = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    cout << "WARNING: ShmRingReader: couldn't map " << shm_name << ": " << std::strerror(errno) << endl;
+    return false;
+  }
+
+  const ShmRingHeader *header = static_cast<const ShmRingHeader *>(mem);
+  bool ok = std::memcmp(header->magic, ShmRingWriter::kMagic, sizeof(ShmRingWriter::kMagic)) == 0;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!ok || header->version != ShmRingWriter::kVersion || header->record_size != sizeof(ShmRecord) ||
+      size < sizeof(ShmRingHeader) + header->capacity * sizeof(ShmRecord)) {
+    cout << "WARNING: ShmRingReader: " << shm_name << " isn't a version " << ShmRingWriter::kVersion << " ring" << endl;
+    munmap(mem, size);
+    return false;
+  }
+
+  size_ = size;
+  header_ = header;
+  records_ = reinterpret_cast<const ShmRecord *>(static_cast<const char *>(mem) + sizeof(ShmRingHeader));
+  num_lost_ = 0;
+
+  uint64_t write_seq = GetWriteSeq();
+  cursor_ = from_oldest && write_seq > header_->capacity ? write_seq - header_->capacity
+          : from_oldest ? 0
+          : write_seq;
+  return true;
+}
+
+void ShmRingReader::Close() {
+  if (header_ != nullptr) {
+    munmap(const_cast<ShmRingHeader *>(header_), size_);
+    header_ = nullptr;
+    records_ = nullptr;
+    size_ = 0;
+  }
+}
+
+uint64_t ShmRingReader::GetWriteSeq() const {
+  return header_ ? header_->write_seq.load(std::memory_order_acquire) : 0;
+}
+
+void ShmRingReader::SeekToLatest() {
+  cursor_ = GetWriteSeq();
+}
+
+uint64_t ShmRingReader::Read(std::vector<ShmOutput> *out, unsigned int max_records) {
+  if (header_ == nullptr) return 0;
+
+  const uint64_t capacity = header_->capacity;
+  const uint64_t mask = capacity - 1;
+  uint64_t lost = 0;
+
+  uint64_t write_seq = GetWriteSeq();
+  if (write_seq - cursor_ > capacity) {
+    lost += write_seq - capacity - cursor_;
+    cursor_ = write_seq - capacity;
+  }
+
+  uint64_t end = write_seq;
+  if (max_records > 0 && end - cursor_ > max_records) {
+    end = cursor_ + max_records;
+  }
+
+  out->reserve(out->size() + (end - cursor_));
+  while (cursor_ < end) {
+    const ShmRecord &rec = records_[cursor_ & mask];
+
+    uint64_t seq = rec.seq.load(std::memory_order_acquire);
+    ShmOutput copy;
+    copy.seq     = seq;
+    copy.time    = rec.time;
+    copy.payload = rec.payload;
+    copy.core_id = rec.core_id;
+    copy.ep_code = rec.ep_code;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (seq != cursor_ + 1 || rec.seq.load(std::memory_order_relaxed) != seq) {
+      // the writer lapped us: this record (and everything up to a capacity behind
+      // the writer) is gone. Skip ahead and keep going
+      uint64_t newest = GetWriteSeq();
+      uint64_t resume = newest > capacity ? newest - capacity + 1 : cursor_ + 1;
+      if (resume <= cursor_) resume = cursor_ + 1;
+      lost += resume - cursor_;
+      cursor_ = resume;
+      if (end < cursor_) end = cursor_;
+      continue;
+    }
+
+    out->push_back(copy);
+    cursor_++;
+  }
+
+  num_lost_ += lost;
+  return lost;
+}
+
+}  // bddriver
+}  // pystorm
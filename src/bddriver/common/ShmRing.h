@@ -0,0 +1,132 @@
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/DriverTypes.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// One decoded upstream word, as it sits in the ring.
+/// <seq> is the record's (1-based) sequence number, 0 while it's being written
+struct ShmRecord {
+  std::atomic<uint64_t> seq;
+  uint64_t time;     /// FPGA time units, see ShmRingHeader::ns_per_unit
+  uint64_t payload;  /// two-word outputs are already put back together
+  uint8_t core_id;
+  uint8_t ep_code;   /// upstream ep code
+  uint8_t pad[6];
+};
+
+/// Start of the shared memory segment, records follow at sizeof(ShmRingHeader).
+/// The write sequence number gets its own cache line, readers poll it
+struct ShmRingHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t record_size;               /// sizeof(ShmRecord), checked by readers
+  uint32_t capacity;                  /// records, a power of 2
+  std::atomic<uint64_t> ns_per_unit;  /// multiply record times by this for ns
+  uint8_t pad0[40];
+  std::atomic<uint64_t> write_seq;    /// records published so far
+  uint8_t pad1[56];
+};
+
+/// A decoded record copied out of the ring
+struct ShmOutput {
+  uint64_t seq;
+  BDTime time;
+  uint64_t payload;
+  uint8_t core_id;
+  uint8_t ep_code;
+};
+
+/// ShmRingWriter publishes decoded upstream words into a POSIX shared memory ring,
+/// so any number of local processes can watch the upstream stream without popping it.
+///
+/// There's one writer (the decoder thread) and no back-pressure: the writer never
+/// waits for readers, it overwrites the oldest records. Each reader keeps its own
+/// cursor (a sequence number) and finds out how many records it lost to overrun.
+/// Records carry a sequence number, written last, so readers can also tell when
+/// a record was overwritten while they copied it.
+///
+/// Segment layout: ShmRingHeader, then <capacity> ShmRecords. The segment lives
+/// at /dev/shm/<name> on Linux, see pystorm/hal/shm_ring.py for the numpy reader.
+class ShmRingWriter {
+ public:
+  static constexpr char kMagic[4] = {'B', 'D', 'S', 'R'};
+  static constexpr uint32_t kVersion = 2; /// 2: 64-bit payloads
+
+  /// Create (or replace) segment <name>, holding <capacity> records, rounded up to a power of 2.
+  /// Check IsOpen(), prints a warning on failure
+  ShmRingWriter(const std::string &name, unsigned int capacity, BDTime ns_per_unit);
+  /// unmaps and unlinks the segment, readers that still have it mapped keep what's there
+  ~ShmRingWriter();
+
+  bool IsOpen() const { return header_ != nullptr; }
+  const std::string &GetName() const { return name_; }
+  unsigned int GetCapacity() const { return capacity_; }
+
+  /// Append <outputs> from <core_id>'s <ep_code>. Only call from one thread
+  void Publish(unsigned int core_id, uint8_t ep_code, const std::vector<DecOutput> &outputs);
+
+  /// Tell readers how long an FPGA time unit is
+  void SetNsPerUnit(BDTime ns_per_unit);
+
+  /// Records published so far, safe to call from any thread
+  uint64_t GetWriteSeq() const;
+
+ private:
+  std::string name_;
+  unsigned int capacity_;
+  size_t size_;
+  ShmRingHeader *header_;
+  ShmRecord *records_;
+  uint64_t write_seq_; /// local copy, we're the only writer
+};
+
+/// ShmRingReader taps a ShmRingWriter's ring from any process.
+/// Reading never disturbs the writer or the other readers
+class ShmRingReader {
+ public:
+  ShmRingReader() : size_(0), header_(nullptr), records_(nullptr), cursor_(0), num_lost_(0) {};
+  ~ShmRingReader() { Close(); }
+
+  /// Map segment <name>. The cursor starts at the newest record, unless <from_oldest>,
+  /// then it starts at the oldest one still in the ring.
+  /// Returns false (with a warning) if there's no such ring
+  bool Open(const std::string &name, bool from_oldest = false);
+  void Close();
+  bool IsOpen() const { return header_ != nullptr; }
+
+  /// Copy up to <max_records> (0 for no limit) records after the cursor to <out>, advancing it.
+  /// Returns the number of records lost to overrun since the last Read()
+  uint64_t Read(std::vector<ShmOutput> *out, unsigned int max_records = 0);
+
+  /// Skip to the newest record
+  void SeekToLatest();
+
+  /// Sequence number of the next record Read() returns
+  uint64_t GetCursor() const { return cursor_; }
+  /// Records published so far, safe to call from any thread
+  uint64_t GetWriteSeq() const;
+  /// Records lost to overrun since Open()
+  uint64_t GetNumLost() const { return num_lost_; }
+  unsigned int GetCapacity() const { return header_ ? header_->capacity : 0; }
+  BDTime GetNsPerUnit() const { return header_ ? header_->ns_per_unit.load() : 0; }
+
+ private:
+  size_t size_;
+  const ShmRingHeader *header_;
+  const ShmRecord *records_;
+  uint64_t cursor_;
+  uint64_t num_lost_;
+};
+
+}  // bddriver
+}  // pystorm
+
+#endif
@@ -0,0 +1,153 @@
+#include "SpikeFilterBank.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+
+namespace {
+// past this, states_ is rebased before it loses range (a small decay grows the scale quickly)
+constexpr double kMaxInvScale = 1e64;
+}
+
+SpikeFilterBank::SpikeFilterBank(unsigned int num_filters, double decay, double increment,
+                                 BDTime update_len, BDTime sample_len, unsigned int max_queued_samples)
+  : num_filters_(num_filters),
+    decay_(decay),
+    increment_(increment),
+    update_len_(update_len),
+    sample_len_(sample_len),
+    max_queued_samples_(max_queued_samples),
+    states_(num_filters, 0),
+    ref_update_(0),
+    scale_update_(0),
+    inv_scale_(1),
+    started_(false),
+    last_time_(0),
+    next_sample_(0),
+    num_events_(0),
+    num_dropped_events_(0),
+    num_dropped_samples_(0) {
+  assert(decay_ >= 0 && decay_ <= 1);
+  assert(update_len_ > 0 && sample_len_ > 0);
+  assert(max_queued_samples_ > 0);
+}
+
+void SpikeFilterBank::Queue(const std::vector<Event> &events) {
+  const unsigned int mid = queued_.size();
+  queued_.insert(queued_.end(), events.begin(), events.end());
+  std::inplace_merge(queued_.begin(), queued_.begin() + mid, queued_.end(),
+      [](const Event &a, const Event &b) { return a.time < b.time; });
+}
+
+void SpikeFilterBank::Flush(BDTime time) {
+  for (auto &it : queued_) {
+    Advance(it.time);
+    Apply(it);
+  }
+  queued_.clear();
+  Advance(time);
+}
+
+void SpikeFilterBank::Advance(BDTime time) {
+  if (started_ && time < last_time_) {
+    cout << "WARNING: SpikeFilterBank: time went from " << last_time_ << " back to " << time <<
+      ", FPGA time was reset? Zeroing the filters" << endl;
+    std::fill(states_.begin(), states_.end(), 0);
+    started_ = false;
+  }
+
+  if (!started_) {
+    started_ = true;
+    next_sample_ = (time / sample_len_ + 1) * sample_len_;
+    ref_update_ = scale_update_ = time / update_len_;
+    inv_scale_ = 1;
+  }
+  last_time_ = time;
+
+  if (time < next_sample_) return;
+
+  // after a long gap, only the newest samples would be kept anyway
+  const uint64_t num_samples = (time - next_sample_) / sample_len_ + 1;
+  if (num_samples > max_queued_samples_) {
+    num_dropped_samples_ += num_samples - max_queued_samples_;
+    next_sample_ += (num_samples - max_queued_samples_) * sample_len_;
+  }
+  for (; next_sample_ <= time; next_sample_ += sample_len_) {
+    TakeSample(next_sample_);
+  }
+}
+
+void SpikeFilterBank::TakeSample(BDTime time) {
+  // the states just before the update at <time>
+  const uint64_t update = (time - 1) / update_len_;
+  assert(update >= ref_update_);
+  const double scale = std::pow(decay_, static_cast<double>(update - ref_update_));
+
+  std::shared_ptr<Sample> sample = std::make_shared<Sample>();
+  sample->time = time;
+  sample->states.resize(num_filters_);
+  const double *in = states_.data();
+  float *out = sample->states.data();
+  for (unsigned int i = 0; i < num_filters_; i++) {
+    out[i] = static_cast<float>(in[i] * scale);
+  }
+
+  std::shared_ptr<const Sample> published = sample;
+  std::atomic_store(&latest_, published);
+
+  std::unique_lock<std::mutex> lock(samples_lock_);
+  samples_.push_back(published);
+  if (samples_.size() > max_queued_samples_) {
+    samples_.pop_front();
+    num_dropped_samples_++;
+  }
+}
+
+void SpikeFilterBank::Apply(const Event &event) {
+  if (event.filter >= num_filters_) {
+    num_dropped_events_++;
+    return;
+  }
+
+  const uint64_t update = event.time / update_len_;
+  if (update != scale_update_) {
+    inv_scale_ = std::pow(decay_, -static_cast<double>(update - ref_update_));
+    if (!(inv_scale_ <= kMaxInvScale)) { // also catches inf, from decay_ == 0
+      Rebase(update);
+    }
+    scale_update_ = update;
+  }
+
+  states_[event.filter] += event.count * increment_ * inv_scale_;
+  num_events_++;
+}
+
+void SpikeFilterBank::Rebase(uint64_t update) {
+  const double scale = std::pow(decay_, static_cast<double>(update - ref_update_));
+  double *states = states_.data();
+  for (unsigned int i = 0; i < num_filters_; i++) {
+    states[i] *= scale;
+  }
+  ref_update_ = update;
+  inv_scale_ = 1;
+}
+
+std::vector<std::shared_ptr<const SpikeFilterBank::Sample>> SpikeFilterBank::PopSamples() {
+  std::unique_lock<std::mutex> lock(samples_lock_);
+  std::vector<std::shared_ptr<const Sample>> popped(samples_.begin(), samples_.end());
+  samples_.clear();
+  return popped;
+}
+
+}  // bddriver namespace
+}  // pystorm namespace
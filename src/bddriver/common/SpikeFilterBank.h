@@ -0,0 +1,106 @@
+#ifndef SPIKEFILTERBANK_H
+#define SPIKEFILTERBANK_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "common/DriverTypes.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// SpikeFilterBank is a host-side SpikeFilterArray (the FPGA's spike filters),
+/// without the FPGA's limit on the number of filters.
+///
+/// Like the FPGA, each event adds count * increment to its filter, and states
+/// are multiplied by decay once every <update_len> time units. A sample taken
+/// at time T is the states just before the update at T (so decay = 0 counts).
+///
+/// States are kept relative to a reference update, so an event only touches its
+/// own filter, and decay is one scale over all states when they're sampled.
+/// States are sampled every <sample_len>, into a queue (PopSamples()) and a
+/// snapshot (GetLatest()), which other threads can read while events are added.
+/// Queue() and Flush() must be called from a single thread.
+class SpikeFilterBank {
+ public:
+  struct Event {
+    BDTime time;
+    unsigned int filter;
+    int count;
+  };
+
+  struct Sample {
+    BDTime time;
+    std::vector<float> states;
+  };
+
+  /// Keeps at most <max_queued_samples> samples that haven't been popped, dropping the oldest
+  SpikeFilterBank(unsigned int num_filters, double decay, double increment,
+                  BDTime update_len, BDTime sample_len, unsigned int max_queued_samples);
+
+  /// An FPGA decay constant (0.27 fixed point) as a factor
+  static double DecayFromConst(unsigned int decay_const) { return decay_const / static_cast<double>(1 << 27); }
+
+  /// Queue <events>, which are in time order (e.g. one ep's outputs), for the next Flush()
+  void Queue(const std::vector<Event> &events);
+  /// Apply what's queued and take samples up to <time>, in time order.
+  /// Events before <time> must all have been queued by now
+  void Flush(BDTime time);
+
+  /// Samples taken since the last call, oldest first
+  std::vector<std::shared_ptr<const Sample>> PopSamples();
+  /// The most recent sample, nullptr if there hasn't been one. Doesn't consume it
+  std::shared_ptr<const Sample> GetLatest() const { return std::atomic_load(&latest_); }
+
+  unsigned int GetNumFilters() const { return num_filters_; }
+  BDTime GetSampleLen() const { return sample_len_; }
+  uint64_t GetNumEvents() const { return num_events_.load(); }
+  /// Events whose filter was >= GetNumFilters()
+  uint64_t GetNumDroppedEvents() const { return num_dropped_events_.load(); }
+  /// Samples dropped because nobody popped them
+  uint64_t GetNumDroppedSamples() const { return num_dropped_samples_.load(); }
+
+ private:
+  const unsigned int num_filters_;
+  const double decay_;
+  const double increment_;
+  const BDTime update_len_;
+  const BDTime sample_len_;
+  const unsigned int max_queued_samples_;
+
+  /// states at ref_update_, the real states are states_ * decay_^(update - ref_update_)
+  std::vector<double> states_;
+  uint64_t ref_update_;
+  /// decay_^-(scale_update_ - ref_update_), cached because events come in runs with the same time
+  uint64_t scale_update_;
+  double inv_scale_;
+
+  std::vector<Event> queued_;
+  bool started_;
+  BDTime last_time_;
+  BDTime next_sample_;
+
+  std::mutex samples_lock_;
+  std::deque<std::shared_ptr<const Sample>> samples_;
+  std::shared_ptr<const Sample> latest_; /// only accessed with std::atomic_load/store
+
+  std::atomic<uint64_t> num_events_;
+  std::atomic<uint64_t> num_dropped_events_;
+  std::atomic<uint64_t> num_dropped_samples_;
+
+  /// take the samples at or before <time>
+  void Advance(BDTime time);
+  void TakeSample(BDTime time);
+  void Apply(const Event &event);
+  /// move ref_update_ to <update>
+  void Rebase(uint64_t update);
+};
+
+}  // bddriver namespace
+}  // pystorm namespace
+
+#endif
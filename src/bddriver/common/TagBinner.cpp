@@ -0,0 +1,82 @@
+#include "TagBinner.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace pystorm {
+namespace bddriver {
+
+TagBinner::TagBinner(const std::vector<BDTime> &edges, unsigned int num_tags)
+  : edges_(edges), num_tags_(num_tags), bin_len_(0), num_dropped_(0) {
+  assert(edges_.size() >= 2);
+  assert(std::is_sorted(edges_.begin(), edges_.end()));
+
+  // evenly spaced edges skip the search
+  bin_len_ = edges_[1] - edges_[0];
+  for (unsigned int i = 1; i < edges_.size(); i++) {
+    if (edges_[i] - edges_[i - 1] != bin_len_) {
+      bin_len_ = 0;
+      break;
+    }
+  }
+
+  counts_.assign(static_cast<uint64_t>(GetNumBins()) * num_tags_, 0);
+}
+
+TagBinner::TagBinner(BDTime t0, BDTime bin_len, unsigned int num_bins, unsigned int num_tags)
+  : TagBinner([t0, bin_len, num_bins]() {
+      std::vector<BDTime> edges;
+      for (unsigned int i = 0; i <= num_bins; i++) {
+        edges.push_back(t0 + i * bin_len);
+      }
+      return edges;
+    }(), num_tags) {}
+
+inline void TagBinner::AddOne(BDWord tag, BDTime time) {
+  unsigned int tag_id = GetField(tag, TATOutputTag::TAG);
+  if (time < edges_.front() || time >= edges_.back() || tag_id >= num_tags_) {
+    num_dropped_++;
+    return;
+  }
+
+  unsigned int bin;
+  if (bin_len_ > 0) {
+    bin = (time - edges_.front()) / bin_len_;
+  } else {
+    bin = std::upper_bound(edges_.begin(), edges_.end(), time) - edges_.begin() - 1;
+  }
+  counts_[bin * num_tags_ + tag_id] += DecodeCount(tag);
+}
+
+void TagBinner::Add(const std::vector<BDWord> &tags, const std::vector<BDTime> &times) {
+  assert(tags.size() == times.size());
+  for (unsigned int i = 0; i < tags.size(); i++) {
+    AddOne(tags[i], times[i]);
+  }
+}
+
+void TagBinner::Add(const std::vector<DecOutput> &outputs, BDTime time_scale) {
+  for (auto& it : outputs) {
+    AddOne(it.payload, it.time * time_scale);
+  }
+}
+
+std::tuple<std::vector<unsigned int>, std::vector<unsigned int>, std::vector<int32_t>> TagBinner::GetSparse() const {
+  std::vector<unsigned int> bins;
+  std::vector<unsigned int> tags;
+  std::vector<int32_t> counts;
+  for (unsigned int i = 0; i < counts_.size(); i++) {
+    if (counts_[i] != 0) {
+      bins.push_back(i / num_tags_);
+      tags.push_back(i % num_tags_);
+      counts.push_back(counts_[i]);
+    }
+  }
+  return std::make_tuple(bins, tags, counts);
+}
+
+}  // bddriver namespace
+}  // pystorm namespace
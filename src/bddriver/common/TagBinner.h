@@ -0,0 +1,65 @@
+#ifndef TAGBINNER_H
+#define TAGBINNER_H
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "common/BDWord.h"
+#include "common/DriverTypes.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// TagBinner sums the signed counts of output tags (RO_ACC/RO_TAT words)
+/// into dense (bin, tag) cells.
+///
+/// Bins are [edges[i], edges[i + 1]). Evenly spaced edges are found by
+/// division, others by binary search. Tags outside the bins are dropped.
+/// Not thread-safe.
+class TagBinner {
+ public:
+  /// <edges> must be increasing, at least two of them
+  TagBinner(const std::vector<BDTime> &edges, unsigned int num_tags = 1 << FieldWidth(TATOutputTag::TAG));
+  /// <num_bins> bins of <bin_len> from <t0>
+  TagBinner(BDTime t0, BDTime bin_len, unsigned int num_bins, unsigned int num_tags = 1 << FieldWidth(TATOutputTag::TAG));
+
+  /// A tag's count field, which is two's complement
+  static int DecodeCount(BDWord tag) {
+    const unsigned int width = FieldWidth(TATOutputTag::COUNT);
+    int count = GetField(tag, TATOutputTag::COUNT);
+    return count >= (1 << (width - 1)) ? count - (1 << width) : count;
+  }
+
+  /// Add <tags> at <times>
+  void Add(const std::vector<BDWord> &tags, const std::vector<BDTime> &times);
+  /// Add decoded outputs, whose times are in units of <time_scale>
+  void Add(const std::vector<DecOutput> &outputs, BDTime time_scale = 1);
+
+  unsigned int GetNumBins() const { return edges_.size() - 1; }
+  unsigned int GetNumTags() const { return num_tags_; }
+  const std::vector<BDTime>& GetEdges() const { return edges_; }
+  /// Tags that were outside the bins, or had tag ids >= num_tags
+  uint64_t GetNumDropped() const { return num_dropped_; }
+
+  /// Summed counts, GetNumBins() * GetNumTags(), bin major
+  const std::vector<int32_t>& GetCounts() const { return counts_; }
+  /// The nonzero cells only, returns {bins, tags, counts}
+  std::tuple<std::vector<unsigned int>,
+             std::vector<unsigned int>,
+             std::vector<int32_t>> GetSparse() const;
+
+ private:
+  std::vector<BDTime> edges_;
+  unsigned int num_tags_;
+  BDTime bin_len_; /// if the edges are evenly spaced, 0 otherwise
+  std::vector<int32_t> counts_;
+  uint64_t num_dropped_;
+
+  inline void AddOne(BDWord tag, BDTime time);
+};
+
+}  // bddriver namespace
+}  // pystorm namespace
+
+#endif
@@ -3,6 +3,8 @@
 #include <atomic>
 #include <thread>
 
+#include "RealTime.h"
+
 #include <iostream>
 using std::cout;
 using std::endl;
@@ -13,6 +15,8 @@ namespace bddriver {
 Xcoder::Xcoder() {
   do_run_ = false;
   thread_ = nullptr;
+  cpu_ = -1;
+  fifo_priority_ = 0;
 }
 
 Xcoder::~Xcoder() {
@@ -30,6 +34,18 @@ void Xcoder::Run() {
 void Xcoder::Start() {
   do_run_ = true;
   thread_ = new std::thread([this] { this->Run(); });
+  if (cpu_ >= 0 || fifo_priority_ > 0) {
+    ConfigureThread(thread_, cpu_, fifo_priority_);
+  }
+}
+
+bool Xcoder::SetThreadConfig(int cpu, int fifo_priority) {
+  cpu_ = cpu;
+  fifo_priority_ = fifo_priority;
+  if (do_run_ && thread_ != nullptr) {
+    return ConfigureThread(thread_, cpu_, fifo_priority_);
+  }
+  return true;
 }
 
 void Xcoder::Stop() {
@@ -39,6 +55,7 @@ void Xcoder::Stop() {
       thread_->join();
     }
     delete thread_;
+    thread_ = nullptr;
   }
 }
 
@@ -16,10 +16,18 @@ class Xcoder {
   void Start();
   void Stop();
 
+  /// Pin the thread to <cpu> (-1 for any), and run it under SCHED_FIFO at <fifo_priority>
+  /// (0 for the default scheduler). Applied now if running, otherwise at Start().
+  /// Returns false if the OS refused
+  bool SetThreadConfig(int cpu, int fifo_priority);
+
  protected:
   std::thread *thread_;       // pointer to thread which will be launched with Start()
   std::atomic<bool> do_run_;  // used to join thread on destruction
 
+  int cpu_;            // see SetThreadConfig()
+  int fifo_priority_;
+
   void Run();
   virtual void RunOnce() = 0;
 };
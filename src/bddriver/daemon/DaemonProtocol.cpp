@@ -0,0 +1,122 @@
+#include "DaemonProtocol.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/DriverPars.h"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+
+constexpr uint32_t DaemonFrame::kInShm;
+
+bool SendAll(int fd, const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  while (size > 0) {
+    ssize_t n = send(fd, bytes, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    bytes += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool RecvAll(int fd, void *data, size_t size) {
+  uint8_t *bytes = static_cast<uint8_t *>(data);
+  while (size > 0) {
+    ssize_t n = recv(fd, bytes, size, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    bytes += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool SendFrame(int fd, uint32_t call, const DaemonWriter &payload, uint8_t *shm, size_t shm_size) {
+  DaemonFrame frame;
+  frame.call = call;
+  frame.size = payload.Size();
+  frame.flags = 0;
+  if (shm != nullptr && payload.Size() >= driverpars::DAEMON_SHM_MIN_BYTES && payload.Size() <= shm_size) {
+    frame.flags = DaemonFrame::kInShm;
+    std::memcpy(shm, payload.Data(), payload.Size());
+  }
+
+  if (!SendAll(fd, &frame, sizeof(frame))) return false;
+  if (frame.flags & DaemonFrame::kInShm) return true;
+  return SendAll(fd, payload.Data(), payload.Size());
+}
+
+bool RecvFrame(int fd, DaemonFrame *frame, std::vector<uint8_t> *storage, const uint8_t **data,
+               const uint8_t *shm, size_t shm_size) {
+  if (!RecvAll(fd, frame, sizeof(*frame))) return false;
+
+  if (frame->flags & DaemonFrame::kInShm) {
+    if (shm == nullptr || frame->size > shm_size) {
+      cout << "WARNING: bddriver daemon: got a shared memory frame that doesn't fit the data segment" << endl;
+      return false;
+    }
+    *data = shm;
+    return true;
+  }
+
+  if (frame->size > driverpars::DAEMON_MAX_FRAME_BYTES) {
+    cout << "WARNING: bddriver daemon: got a " << frame->size << " byte frame, dropping the connection" << endl;
+    return false;
+  }
+  storage->resize(frame->size);
+  *data = storage->data();
+  return RecvAll(fd, storage->data(), frame->size);
+}
+
+uint8_t *MapDataSegment(const std::string &name, size_t size, bool create) {
+  int fd = shm_open(name.c_str(), create ? O_CREAT | O_EXCL | O_RDWR : O_RDWR, 0600);
+  if (fd < 0) {
+    cout << "WARNING: bddriver daemon: couldn't open data segment " << name << ": " << std::strerror(errno) << endl;
+    return nullptr;
+  }
+  struct stat st;
+  if (!create && (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < size)) {
+    cout << "WARNING: bddriver daemon: data segment " << name << " is smaller than " << size << " bytes" << endl;
+    close(fd);
+    return nullptr;
+  }
+  if (create && ftruncate(fd, size) != 0) {
+    cout << "WARNING: bddriver daemon: couldn't size data segment " << name << ": " << std::strerror(errno) << endl;
+    close(fd);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+  void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    cout << "WARNING: bddriver daemon: couldn't map data segment " << name << ": " << std::strerror(errno) << endl;
+    if (create) shm_unlink(name.c_str());
+    return nullptr;
+  }
+  return static_cast<uint8_t *>(mem);
+}
+
+void UnmapDataSegment(uint8_t *mem, size_t size) {
+  if (mem != nullptr) {
+    munmap(mem, size);
+  }
+}
+
+}  // bddriver
+}  // pystorm
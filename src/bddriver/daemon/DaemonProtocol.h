@@ -0,0 +1,183 @@
+#ifndef DAEMONPROTOCOL_H
+#define DAEMONPROTOCOL_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace pystorm {
+namespace bddriver {
+
+/// Calls a DriverClient can make on the DriverServer, one per Driver method.
+/// Append only: the numbers are the wire format
+enum class DaemonCall : uint32_t {
+  HELLO = 0,              /// maps the client's data segment, replies with the number of cores
+  PING,
+  INIT_BD,
+  INIT_FPGA,
+  RESET_BD,
+  FLUSH,
+  SET_TIME_UNIT_LEN,
+  SET_TIME_PER_UP_HB,
+  RESET_FPGA_TIME,
+  GET_FPGA_TIME,
+  GET_DRIVER_TIME,
+  SET_TAG_TRAFFIC_STATE,
+  SET_SPIKE_TRAFFIC_STATE,
+  SET_SPIKE_DUMP_STATE,
+  SET_DAC_COUNT,
+  SET_DAC_VALUE,
+  SET_SOMA_ENABLE_STATUS,
+  SET_MEM,
+  DUMP_MEM,
+  SEND_SPIKES,
+  SEND_TAGS,
+  RECV_SPIKES,
+  RECV_TAGS,
+  SET_SPIKE_GENERATOR_RATES,
+  SET_NUM_SPIKE_FILTERS,
+  RECV_SPIKE_FILTER_STATES,
+  GET_FIFO_OVERFLOW_COUNTS,
+  START_BROADCAST,
+  STOP_BROADCAST,
+  NUM_CALLS
+};
+
+/// Status of a reply
+enum class DaemonStatus : uint32_t {
+  OK = 0,
+  BAD_CALL,     /// unknown call number
+  BAD_REQUEST,  /// request payload didn't parse
+};
+
+/// Every request and reply starts with a frame header, followed by <size> payload bytes.
+/// If <flags> has kInShm, the payload is at the start of the client's data segment
+/// instead, and nothing follows the header
+struct DaemonFrame {
+  static constexpr uint32_t kInShm = 1;
+
+  uint32_t call;   /// DaemonCall for requests, DaemonStatus for replies
+  uint32_t flags;
+  uint64_t size;
+};
+
+/// Builds a request/reply payload: PODs as their bytes, vectors and strings
+/// as a uint64 count followed by their elements
+class DaemonWriter {
+ public:
+  template <class T>
+  DaemonWriter &Put(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value, "only PODs go on the wire");
+    Append(&value, sizeof(T));
+    return *this;
+  }
+
+  template <class T>
+  DaemonWriter &PutVector(const std::vector<T> &values) {
+    static_assert(std::is_trivially_copyable<T>::value, "only PODs go on the wire");
+    Put<uint64_t>(values.size());
+    Append(values.data(), values.size() * sizeof(T));
+    return *this;
+  }
+
+  DaemonWriter &PutString(const std::string &str) {
+    Put<uint64_t>(str.size());
+    Append(str.data(), str.size());
+    return *this;
+  }
+
+  const uint8_t *Data() const { return buf_.data(); }
+  size_t Size() const { return buf_.size(); }
+  void Clear() { buf_.clear(); }
+
+ private:
+  std::vector<uint8_t> buf_;
+
+  void Append(const void *bytes, size_t n) {
+    if (n == 0) return;
+    size_t pos = buf_.size();
+    buf_.resize(pos + n);
+    std::memcpy(buf_.data() + pos, bytes, n);
+  }
+};
+
+/// Parses a payload written by DaemonWriter. Reading past the end (or a count
+/// that doesn't fit) returns zeros/empty and makes Ok() false
+class DaemonReader {
+ public:
+  DaemonReader(const uint8_t *data, size_t size) : data_(data), size_(size), pos_(0), ok_(true) {};
+
+  template <class T>
+  T Get() {
+    static_assert(std::is_trivially_copyable<T>::value, "only PODs go on the wire");
+    T value;
+    if (!Take(sizeof(T))) {
+      std::memset(&value, 0, sizeof(T));
+      return value;
+    }
+    std::memcpy(&value, data_ + pos_ - sizeof(T), sizeof(T));
+    return value;
+  }
+
+  template <class T>
+  std::vector<T> GetVector() {
+    static_assert(std::is_trivially_copyable<T>::value, "only PODs go on the wire");
+    uint64_t count = Get<uint64_t>();
+    if (count > (size_ - pos_) / sizeof(T) || !Take(count * sizeof(T))) {
+      ok_ = false;
+      return {};
+    }
+    std::vector<T> values(count);
+    std::memcpy(values.data(), data_ + pos_ - count * sizeof(T), count * sizeof(T));
+    return values;
+  }
+
+  std::string GetString() {
+    uint64_t count = Get<uint64_t>();
+    if (count > size_ - pos_ || !Take(count)) {
+      ok_ = false;
+      return "";
+    }
+    return std::string(reinterpret_cast<const char *>(data_ + pos_ - count), count);
+  }
+
+  bool Ok() const { return ok_; }
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+  size_t pos_;
+  bool ok_;
+
+  bool Take(size_t n) {
+    if (!ok_ || n > size_ - pos_) {
+      ok_ = false;
+      return false;
+    }
+    pos_ += n;
+    return true;
+  }
+};
+
+/// Write/read all of <size> bytes to/from socket <fd>, false if the connection broke
+bool SendAll(int fd, const void *data, size_t size);
+bool RecvAll(int fd, void *data, size_t size);
+
+/// Send a frame, putting the payload in <shm> (of <shm_size> bytes) if it's big enough to be worth it
+/// and fits, on the socket otherwise
+bool SendFrame(int fd, uint32_t call, const DaemonWriter &payload, uint8_t *shm, size_t shm_size);
+/// Receive a frame. Socket payloads go to <storage>, *data points at the payload either way
+bool RecvFrame(int fd, DaemonFrame *frame, std::vector<uint8_t> *storage, const uint8_t **data,
+               const uint8_t *shm, size_t shm_size);
+
+/// Map/unmap POSIX shared memory segment <name> read/write, nullptr (with a warning) on failure.
+/// <create> makes a new segment of <size> bytes
+uint8_t *MapDataSegment(const std::string &name, size_t size, bool create);
+void UnmapDataSegment(uint8_t *mem, size_t size);
+
+}  // bddriver
+}  // pystorm
+
+#endif
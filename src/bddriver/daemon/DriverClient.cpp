@@ -0,0 +1,301 @@
+#include "DriverClient.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+
+DriverClient::DriverClient()
+  : fd_(-1),
+  shm_(nullptr),
+  shm_size_(0),
+  pars_(new bdpars::BDPars()) {}
+
+DriverClient::~DriverClient() {
+  Disconnect();
+}
+
+bool DriverClient::Connect(const std::string &socket_path, uint64_t shm_bytes) {
+  Disconnect();
+
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+    cout << "WARNING: DriverClient: couldn't connect to " << socket_path << ": " << std::strerror(errno) << endl;
+    if (fd >= 0) close(fd);
+    return false;
+  }
+  fd_ = fd;
+
+  // the segment only needs a name until the server has mapped it
+  std::string shm_name;
+  if (shm_bytes > 0) {
+    static std::atomic<unsigned int> num_segments(0);
+    shm_name = "/bddriverd." + std::to_string(getpid()) + "." + std::to_string(num_segments++);
+    shm_ = MapDataSegment(shm_name, shm_bytes, true);
+    if (shm_ == nullptr) {
+      shm_name = "";
+    } else {
+      shm_size_ = shm_bytes;
+    }
+  }
+
+  DaemonWriter hello;
+  hello.PutString(shm_name).Put<uint64_t>(shm_size_);
+  unsigned int num_cores = 0;
+  bool server_mapped = false;
+  // the segment isn't in use until the server says so
+  uint8_t *shm = shm_;
+  shm_ = nullptr;
+  bool ok = Call(DaemonCall::HELLO, hello, [&](DaemonReader &reply) {
+      num_cores = reply.Get<uint32_t>();
+      server_mapped = reply.Get<uint8_t>();
+    });
+  if (shm_name.size() > 0) {
+    shm_unlink(shm_name.c_str());
+  }
+
+  if (!ok || num_cores == 0) {
+    UnmapDataSegment(shm, shm_size_);
+    shm_size_ = 0;
+    Disconnect();
+    return false;
+  }
+
+  if (server_mapped) {
+    shm_ = shm;
+  } else {
+    UnmapDataSegment(shm, shm_size_);
+    shm_size_ = 0;
+  }
+  pars_.reset(new bdpars::BDPars(num_cores));
+  return true;
+}
+
+void DriverClient::Disconnect() {
+  std::unique_lock<std::mutex> ulock(call_lock_);
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  UnmapDataSegment(shm_, shm_size_);
+  shm_ = nullptr;
+  shm_size_ = 0;
+}
+
+bool DriverClient::Call(DaemonCall call, const DaemonWriter &req, std::function<void(DaemonReader &)> parse) {
+  std::unique_lock<std::mutex> ulock(call_lock_);
+  if (fd_ < 0) {
+    cout << "WARNING: DriverClient: not connected" << endl;
+    return false;
+  }
+
+  DaemonFrame frame;
+  const uint8_t *data;
+  if (!SendFrame(fd_, static_cast<uint32_t>(call), req, shm_, shm_size_) ||
+      !RecvFrame(fd_, &frame, &storage_, &data, shm_, shm_size_)) {
+    cout << "WARNING: DriverClient: lost the connection to the server" << endl;
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+
+  if (static_cast<DaemonStatus>(frame.call) != DaemonStatus::OK) {
+    cout << "WARNING: DriverClient: server rejected call " << static_cast<uint32_t>(call) <<
+      " with status " << frame.call << endl;
+    return false;
+  }
+
+  if (parse) {
+    DaemonReader reply(data, frame.size);
+    parse(reply);
+    if (!reply.Ok()) {
+      cout << "WARNING: DriverClient: bad reply to call " << static_cast<uint32_t>(call) << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DriverClient::Ping() {
+  return IsConnected() && Call(DaemonCall::PING);
+}
+
+void DriverClient::InitBD() { Call(DaemonCall::INIT_BD); }
+void DriverClient::InitFPGA() { Call(DaemonCall::INIT_FPGA); }
+void DriverClient::ResetBD() { Call(DaemonCall::RESET_BD); }
+void DriverClient::Flush() { Call(DaemonCall::FLUSH); }
+
+void DriverClient::SetTimeUnitLen(BDTime ns_per_unit) {
+  Call(DaemonCall::SET_TIME_UNIT_LEN, DaemonWriter().Put<BDTime>(ns_per_unit));
+}
+
+void DriverClient::SetTimePerUpHB(BDTime ns_per_hb) {
+  Call(DaemonCall::SET_TIME_PER_UP_HB, DaemonWriter().Put<BDTime>(ns_per_hb));
+}
+
+void DriverClient::ResetFPGATime() { Call(DaemonCall::RESET_FPGA_TIME); }
+
+BDTime DriverClient::GetFPGATime() {
+  BDTime time = 0;
+  Call(DaemonCall::GET_FPGA_TIME, DaemonWriter(), [&](DaemonReader &reply) { time = reply.Get<BDTime>(); });
+  return time;
+}
+
+BDTime DriverClient::GetDriverTime() {
+  BDTime time = 0;
+  Call(DaemonCall::GET_DRIVER_TIME, DaemonWriter(), [&](DaemonReader &reply) { time = reply.Get<BDTime>(); });
+  return time;
+}
+
+void DriverClient::SetTagTrafficState(unsigned int core_id, bool en, bool flush) {
+  Call(DaemonCall::SET_TAG_TRAFFIC_STATE, DaemonWriter().Put<uint32_t>(core_id).Put<uint8_t>(en).Put<uint8_t>(flush));
+}
+
+void DriverClient::SetSpikeTrafficState(unsigned int core_id, bool en, bool flush) {
+  Call(DaemonCall::SET_SPIKE_TRAFFIC_STATE, DaemonWriter().Put<uint32_t>(core_id).Put<uint8_t>(en).Put<uint8_t>(flush));
+}
+
+void DriverClient::SetSpikeDumpState(unsigned int core_id, bool en, bool flush) {
+  Call(DaemonCall::SET_SPIKE_DUMP_STATE, DaemonWriter().Put<uint32_t>(core_id).Put<uint8_t>(en).Put<uint8_t>(flush));
+}
+
+void DriverClient::SetDACCount(unsigned int core_id, bdpars::BDHornEP signal_id, unsigned int value, bool flush) {
+  Call(DaemonCall::SET_DAC_COUNT, DaemonWriter()
+      .Put<uint32_t>(core_id)
+      .Put<uint32_t>(static_cast<uint32_t>(signal_id))
+      .Put<uint32_t>(value)
+      .Put<uint8_t>(flush));
+}
+
+void DriverClient::SetDACValue(unsigned int core_id, bdpars::BDHornEP signal_id, float value, bool flush) {
+  Call(DaemonCall::SET_DAC_VALUE, DaemonWriter()
+      .Put<uint32_t>(core_id)
+      .Put<uint32_t>(static_cast<uint32_t>(signal_id))
+      .Put<float>(value)
+      .Put<uint8_t>(flush));
+}
+
+void DriverClient::SetSomaEnableStatus(unsigned int core_id, unsigned int soma_id, bdpars::SomaStatusId status) {
+  Call(DaemonCall::SET_SOMA_ENABLE_STATUS, DaemonWriter()
+      .Put<uint32_t>(core_id)
+      .Put<uint32_t>(soma_id)
+      .Put<uint32_t>(static_cast<uint32_t>(status)));
+}
+
+void DriverClient::SetMem(unsigned int core_id, bdpars::BDMemId mem_id, const std::vector<BDWord> &data, unsigned int start_addr) {
+  Call(DaemonCall::SET_MEM, DaemonWriter()
+      .Put<uint32_t>(core_id)
+      .Put<uint32_t>(static_cast<uint32_t>(mem_id))
+      .Put<uint32_t>(start_addr)
+      .PutVector(data));
+}
+
+std::vector<BDWord> DriverClient::DumpMem(unsigned int core_id, bdpars::BDMemId mem_id) {
+  std::vector<BDWord> data;
+  Call(DaemonCall::DUMP_MEM, DaemonWriter().Put<uint32_t>(core_id).Put<uint32_t>(static_cast<uint32_t>(mem_id)),
+      [&](DaemonReader &reply) { data = reply.GetVector<BDWord>(); });
+  return data;
+}
+
+void DriverClient::SendSpikes(unsigned int core_id, const std::vector<BDWord> &spikes, const std::vector<BDTime> times, bool flush) {
+  Call(DaemonCall::SEND_SPIKES, DaemonWriter().Put<uint32_t>(core_id).Put<uint8_t>(flush).PutVector(spikes).PutVector(times));
+}
+
+void DriverClient::SendTags(unsigned int core_id, const std::vector<BDWord> &tags, const std::vector<BDTime> times, bool flush) {
+  Call(DaemonCall::SEND_TAGS, DaemonWriter().Put<uint32_t>(core_id).Put<uint8_t>(flush).PutVector(tags).PutVector(times));
+}
+
+std::pair<std::vector<BDWord>, std::vector<BDTime>> DriverClient::RecvSpikes(unsigned int core_id) {
+  std::pair<std::vector<BDWord>, std::vector<BDTime>> words_times;
+  Call(DaemonCall::RECV_SPIKES, DaemonWriter().Put<uint32_t>(core_id).Put<uint32_t>(0),
+      [&](DaemonReader &reply) {
+        words_times.first = reply.GetVector<BDWord>();
+        words_times.second = reply.GetVector<BDTime>();
+      });
+  return words_times;
+}
+
+std::pair<std::vector<BDWord>, std::vector<BDTime>> DriverClient::RecvTags(unsigned int core_id, unsigned int timeout_us) {
+  std::pair<std::vector<BDWord>, std::vector<BDTime>> words_times;
+  Call(DaemonCall::RECV_TAGS, DaemonWriter().Put<uint32_t>(core_id).Put<uint32_t>(timeout_us),
+      [&](DaemonReader &reply) {
+        words_times.first = reply.GetVector<BDWord>();
+        words_times.second = reply.GetVector<BDTime>();
+      });
+  return words_times;
+}
+
+void DriverClient::SetSpikeGeneratorRates(
+    unsigned int core_id,
+    const std::vector<unsigned int> &gen_idxs,
+    const std::vector<unsigned int> &tags,
+    const std::vector<int> &rates,
+    BDTime time,
+    bool flush) {
+  Call(DaemonCall::SET_SPIKE_GENERATOR_RATES, DaemonWriter()
+      .Put<uint32_t>(core_id)
+      .PutVector(gen_idxs)
+      .PutVector(tags)
+      .PutVector(rates)
+      .Put<BDTime>(time)
+      .Put<uint8_t>(flush));
+}
+
+void DriverClient::SetNumSpikeFilters(unsigned int core_id, unsigned int num, bool flush) {
+  Call(DaemonCall::SET_NUM_SPIKE_FILTERS, DaemonWriter().Put<uint32_t>(core_id).Put<uint32_t>(num).Put<uint8_t>(flush));
+}
+
+std::tuple<std::vector<unsigned int>,
+           std::vector<unsigned int>,
+           std::vector<BDTime>> DriverClient::RecvSpikeFilterStates(unsigned int core_id, unsigned int timeout_us) {
+  std::tuple<std::vector<unsigned int>, std::vector<unsigned int>, std::vector<BDTime>> ids_states_times;
+  Call(DaemonCall::RECV_SPIKE_FILTER_STATES, DaemonWriter().Put<uint32_t>(core_id).Put<uint32_t>(timeout_us),
+      [&](DaemonReader &reply) {
+        std::get<0>(ids_states_times) = reply.GetVector<unsigned int>();
+        std::get<1>(ids_states_times) = reply.GetVector<unsigned int>();
+        std::get<2>(ids_states_times) = reply.GetVector<BDTime>();
+      });
+  return ids_states_times;
+}
+
+std::pair<unsigned int, unsigned int> DriverClient::GetFIFOOverflowCounts(unsigned int core_id) {
+  std::pair<unsigned int, unsigned int> counts(0, 0);
+  Call(DaemonCall::GET_FIFO_OVERFLOW_COUNTS, DaemonWriter().Put<uint32_t>(core_id),
+      [&](DaemonReader &reply) {
+        counts.first = reply.Get<uint32_t>();
+        counts.second = reply.Get<uint32_t>();
+      });
+  return counts;
+}
+
+bool DriverClient::StartBroadcast(const std::string &name, unsigned int capacity) {
+  bool started = false;
+  Call(DaemonCall::START_BROADCAST, DaemonWriter().PutString(name).Put<uint32_t>(capacity),
+      [&](DaemonReader &reply) { started = reply.Get<uint8_t>(); });
+  return started;
+}
+
+void DriverClient::StopBroadcast() { Call(DaemonCall::STOP_BROADCAST); }
+
+}  // bddriver
+}  // pystorm
@@ -0,0 +1,116 @@
+#ifndef DRIVERCLIENT_H
+#define DRIVERCLIENT_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "common/BDPars.h"
+#include "common/BDWord.h"
+#include "common/DriverPars.h"
+#include "common/DriverTypes.h"
+#include "daemon/DaemonProtocol.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// DriverClient talks to a Driver owned by another process (bddriverd, or anything
+/// running a DriverServer). The calls have the same signatures as Driver's, so code
+/// written against a Driver can use a DriverClient instead.
+///
+/// Only part of the Driver API goes over the wire so far, see DaemonCall.
+/// If the connection breaks, calls print a warning and return empty results.
+/// Calls are thread-safe, but go out one at a time.
+class DriverClient {
+ public:
+  DriverClient();
+  ~DriverClient();
+
+  /// Connect to the server at <socket_path>. Bulk payloads go through a <shm_bytes>
+  /// shared memory data segment (0 sends everything over the socket).
+  /// Returns false (with a warning) if there's no server
+  bool Connect(const std::string &socket_path = driverpars::DAEMON_SOCKET_PATH,
+               uint64_t shm_bytes = driverpars::DAEMON_SHM_BYTES);
+  void Disconnect();
+  bool IsConnected() const { return fd_ >= 0; }
+  /// Whether bulk payloads are going through shared memory
+  bool HasDataSegment() const { return shm_ != nullptr; }
+  /// Round trip to the server without touching the Driver, false if disconnected
+  bool Ping();
+
+  /// The server's Driver is already running, these only check the connection
+  int Start() { return IsConnected() ? 0 : -1; }
+  void Stop() {}
+
+  const bdpars::BDPars *GetBDPars() const { return pars_.get(); }
+
+  void InitBD();
+  void InitFPGA();
+  void ResetBD();
+  void Flush();
+
+  void SetTimeUnitLen(BDTime ns_per_unit);
+  void SetTimePerUpHB(BDTime ns_per_hb);
+  void ResetFPGATime();
+  BDTime GetFPGATime();
+  BDTime GetDriverTime();
+
+  void SetTagTrafficState(unsigned int core_id, bool en, bool flush=true);
+  void SetSpikeTrafficState(unsigned int core_id, bool en, bool flush=true);
+  void SetSpikeDumpState(unsigned int core_id, bool en, bool flush=true);
+
+  void SetDACCount(unsigned int core_id, bdpars::BDHornEP signal_id, unsigned int value, bool flush=true);
+  void SetDACValue(unsigned int core_id, bdpars::BDHornEP signal_id, float value, bool flush=true);
+  void SetSomaEnableStatus(unsigned int core_id, unsigned int soma_id, bdpars::SomaStatusId status);
+
+  void SetMem(unsigned int core_id, bdpars::BDMemId mem_id, const std::vector<BDWord> &data, unsigned int start_addr);
+  std::vector<BDWord> DumpMem(unsigned int core_id, bdpars::BDMemId mem_id);
+
+  void SendSpikes(unsigned int core_id, const std::vector<BDWord> &spikes, const std::vector<BDTime> times, bool flush=true);
+  void SendTags(unsigned int core_id, const std::vector<BDWord> &tags, const std::vector<BDTime> times={}, bool flush=true);
+  std::pair<std::vector<BDWord>, std::vector<BDTime>> RecvSpikes(unsigned int core_id);
+  std::pair<std::vector<BDWord>, std::vector<BDTime>> RecvTags(unsigned int core_id, unsigned int timeout_us=1000);
+
+  void SetSpikeGeneratorRates(
+    unsigned int core_id,
+    const std::vector<unsigned int> &gen_idxs,
+    const std::vector<unsigned int> &tags,
+    const std::vector<int> &rates,
+    BDTime time = 0,
+    bool flush = true);
+
+  void SetNumSpikeFilters(unsigned int core_id, unsigned int num, bool flush=true);
+  std::tuple<std::vector<unsigned int>,
+             std::vector<unsigned int>,
+             std::vector<BDTime>> RecvSpikeFilterStates(unsigned int core_id, unsigned int timeout_us);
+  std::pair<unsigned int, unsigned int> GetFIFOOverflowCounts(unsigned int core_id);
+
+  /// Have the server's Driver publish upstream traffic to a shared memory ring
+  /// (see Driver::StartBroadcast()), so every client can read all of it
+  bool StartBroadcast(const std::string &name, unsigned int capacity = driverpars::SHM_RING_DEFAULT_CAPACITY);
+  void StopBroadcast();
+
+ private:
+  int fd_;
+  uint8_t *shm_;
+  uint64_t shm_size_;
+  std::unique_ptr<bdpars::BDPars> pars_;
+
+  std::mutex call_lock_;
+  std::vector<uint8_t> storage_; /// socket replies land here
+
+  /// Make <call> with payload <req>, then hand the reply to <parse>.
+  /// Returns false (with a warning) if the call failed
+  bool Call(DaemonCall call, const DaemonWriter &req = DaemonWriter(),
+            std::function<void(DaemonReader &)> parse = nullptr);
+};
+
+}  // bddriver
+}  // pystorm
+
+#endif
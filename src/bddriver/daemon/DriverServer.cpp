@@ -0,0 +1,385 @@
+#include "DriverServer.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "common/DriverPars.h"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+
+DriverServer::DriverServer(Driver *driver, const std::string &socket_path)
+  : driver_(driver),
+  socket_path_(socket_path),
+  listen_fd_(-1),
+  do_run_(false),
+  accept_thread_(nullptr),
+  num_clients_(0),
+  num_calls_(0) {}
+
+DriverServer::~DriverServer() {
+  Stop();
+}
+
+bool DriverServer::Start() {
+  if (accept_thread_ != nullptr) return true;
+
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socket_path_.size() >= sizeof(addr.sun_path)) {
+    cout << "WARNING: DriverServer: socket path " << socket_path_ << " is too long" << endl;
+    return false;
+  }
+  std::strncpy(addr.sun_path, socket_path_.c_str(), sizeof(addr.sun_path) - 1);
+
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    cout << "WARNING: DriverServer: couldn't create socket: " << std::strerror(errno) << endl;
+    return false;
+  }
+
+  // a daemon that died without cleaning up leaves its socket behind
+  unlink(socket_path_.c_str());
+  if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(listen_fd_, 8) != 0) {
+    cout << "WARNING: DriverServer: couldn't listen on " << socket_path_ << ": " << std::strerror(errno) << endl;
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+
+  do_run_ = true;
+  accept_thread_ = new std::thread([this] { AcceptLoop(); });
+  return true;
+}
+
+void DriverServer::Stop() {
+  if (accept_thread_ == nullptr) return;
+
+  do_run_ = false;
+  accept_thread_->join();
+  delete accept_thread_;
+  accept_thread_ = nullptr;
+
+  // client threads notice within DAEMON_POLL_MS
+  std::unique_lock<std::mutex> ulock(clients_lock_);
+  for (auto &it : clients_) {
+    it.thread.join();
+  }
+  clients_.clear();
+
+  close(listen_fd_);
+  listen_fd_ = -1;
+  unlink(socket_path_.c_str());
+}
+
+void DriverServer::AcceptLoop() {
+  while (do_run_) {
+    pollfd pfd = {listen_fd_, POLLIN, 0};
+    if (poll(&pfd, 1, driverpars::DAEMON_POLL_MS) <= 0) continue;
+
+    int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) continue;
+
+    std::unique_lock<std::mutex> ulock(clients_lock_);
+    for (auto it = clients_.begin(); it != clients_.end();) {
+      if (it->done) {
+        it->thread.join();
+        it = clients_.erase(it);
+      } else {
+        it++;
+      }
+    }
+
+    num_clients_++;
+    clients_.emplace_back();
+    Client &client = clients_.back();
+    client.done = false;
+    client.thread = std::thread([this, fd, &client] { Serve(fd, &client.done); });
+  }
+}
+
+void DriverServer::Serve(int fd, std::atomic<bool> *done) {
+  uint8_t *shm = nullptr;
+  size_t shm_size = 0;
+  std::vector<uint8_t> storage;
+  DaemonWriter reply;
+
+  while (do_run_) {
+    pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, driverpars::DAEMON_POLL_MS) <= 0) continue;
+
+    DaemonFrame frame;
+    const uint8_t *data;
+    if (!RecvFrame(fd, &frame, &storage, &data, shm, shm_size)) break; // client went away
+
+    DaemonReader req(data, frame.size);
+    reply.Clear();
+    DaemonStatus status;
+
+    if (static_cast<DaemonCall>(frame.call) == DaemonCall::HELLO) {
+      std::string shm_name = req.GetString();
+      uint64_t size = req.Get<uint64_t>();
+      status = req.Ok() ? DaemonStatus::OK : DaemonStatus::BAD_REQUEST;
+      if (status == DaemonStatus::OK && shm_name.size() > 0) {
+        UnmapDataSegment(shm, shm_size);
+        shm = MapDataSegment(shm_name, size, false);
+        shm_size = shm ? size : 0;
+      }
+      // no segment just means everything goes over the socket
+      reply.Put<uint32_t>(driver_->GetBDPars()->NumCores);
+      reply.Put<uint8_t>(shm != nullptr);
+    } else {
+      status = Dispatch(static_cast<DaemonCall>(frame.call), req, &reply);
+    }
+    num_calls_++;
+
+    if (!SendFrame(fd, static_cast<uint32_t>(status), reply, shm, shm_size)) break;
+  }
+
+  UnmapDataSegment(shm, shm_size);
+  close(fd);
+  num_clients_--;
+  *done = true;
+}
+
+DaemonStatus DriverServer::Dispatch(DaemonCall call, DaemonReader &req, DaemonWriter *reply) {
+  if (call >= DaemonCall::NUM_CALLS) {
+    cout << "WARNING: DriverServer: unknown call " << static_cast<uint32_t>(call) << endl;
+    return DaemonStatus::BAD_CALL;
+  }
+  if (call == DaemonCall::PING) {
+    return DaemonStatus::OK;
+  }
+
+  const bool is_recv =
+    call == DaemonCall::RECV_SPIKES ||
+    call == DaemonCall::RECV_TAGS ||
+    call == DaemonCall::RECV_SPIKE_FILTER_STATES;
+  std::unique_lock<std::mutex> driver_ulock(driver_lock_, std::defer_lock);
+  std::unique_lock<std::mutex> recv_ulock(recv_lock_, std::defer_lock);
+  if (call == DaemonCall::GET_FPGA_TIME) {
+    std::lock(driver_ulock, recv_ulock); // reads the time settings and pops the HB buffers
+  } else if (is_recv) {
+    recv_ulock.lock();
+  } else {
+    driver_ulock.lock();
+  }
+
+  const bdpars::BDPars *pars = driver_->GetBDPars();
+  auto core_ok = [pars](uint32_t core_id) { return core_id < pars->NumCores; };
+  auto dac_ok = [](bdpars::BDHornEP signal_id) {
+    return signal_id >= bdpars::BDHornEP::DAC_DIFF_G && signal_id <= bdpars::BDHornEP::DAC_SYN_EXC;
+  };
+  auto mem_ok = [](bdpars::BDMemId mem_id) { return mem_id < bdpars::BDMemId::COUNT; };
+
+  // parse all of the arguments first, calls only happen on a good request.
+  // The Driver calls assert (or throw) on ids out of range, so those are checked here too
+  #define BDDRIVERD_CHECK_REQ(in_range) \
+    if (!req.Ok() || !(in_range)) { \
+      cout << "WARNING: DriverServer: bad request for call " << static_cast<uint32_t>(call) << endl; \
+      return DaemonStatus::BAD_REQUEST; \
+    }
+
+  switch (call) {
+    case DaemonCall::INIT_BD: {
+      driver_->InitBD();
+      break;
+    }
+    case DaemonCall::INIT_FPGA: {
+      driver_->InitFPGA();
+      break;
+    }
+    case DaemonCall::RESET_BD: {
+      driver_->ResetBD();
+      break;
+    }
+    case DaemonCall::FLUSH: {
+      driver_->Flush();
+      break;
+    }
+    case DaemonCall::SET_TIME_UNIT_LEN: {
+      BDTime ns_per_unit = req.Get<BDTime>();
+      BDDRIVERD_CHECK_REQ(ns_per_unit > 0);
+      driver_->SetTimeUnitLen(ns_per_unit);
+      break;
+    }
+    case DaemonCall::SET_TIME_PER_UP_HB: {
+      BDTime ns_per_hb = req.Get<BDTime>();
+      BDDRIVERD_CHECK_REQ(ns_per_hb > 0);
+      driver_->SetTimePerUpHB(ns_per_hb);
+      break;
+    }
+    case DaemonCall::RESET_FPGA_TIME: {
+      driver_->ResetFPGATime();
+      break;
+    }
+    case DaemonCall::GET_FPGA_TIME: {
+      reply->Put<BDTime>(driver_->GetFPGATime());
+      break;
+    }
+    case DaemonCall::GET_DRIVER_TIME: {
+      reply->Put<BDTime>(driver_->GetDriverTime());
+      break;
+    }
+    case DaemonCall::SET_TAG_TRAFFIC_STATE:
+    case DaemonCall::SET_SPIKE_TRAFFIC_STATE:
+    case DaemonCall::SET_SPIKE_DUMP_STATE: {
+      uint32_t core_id = req.Get<uint32_t>();
+      bool en = req.Get<uint8_t>();
+      bool flush = req.Get<uint8_t>();
+      BDDRIVERD_CHECK_REQ(core_ok(core_id));
+      if (call == DaemonCall::SET_TAG_TRAFFIC_STATE) {
+        driver_->SetTagTrafficState(core_id, en, flush);
+      } else if (call == DaemonCall::SET_SPIKE_TRAFFIC_STATE) {
+        driver_->SetSpikeTrafficState(core_id, en, flush);
+      } else {
+        driver_->SetSpikeDumpState(core_id, en, flush);
+      }
+      break;
+    }
+    case DaemonCall::SET_DAC_COUNT: {
+      uint32_t core_id = req.Get<uint32_t>();
+      auto signal_id = static_cast<bdpars::BDHornEP>(req.Get<uint32_t>());
+      uint32_t value = req.Get<uint32_t>();
+      bool flush = req.Get<uint8_t>();
+      BDDRIVERD_CHECK_REQ(core_ok(core_id) && dac_ok(signal_id) && value >= 1 && value <= bdpars::DACInfo::DAC_MAX_COUNT);
+      driver_->SetDACCount(core_id, signal_id, value, flush);
+      break;
+    }
+    case DaemonCall::SET_DAC_VALUE: {
+      uint32_t core_id = req.Get<uint32_t>();
+      auto signal_id = static_cast<bdpars::BDHornEP>(req.Get<uint32_t>());
+      float value = req.Get<float>();
+      bool flush = req.Get<uint8_t>();
+      BDDRIVERD_CHECK_REQ(core_ok(core_id) && dac_ok(signal_id));
+      driver_->SetDACValue(core_id, signal_id, value, flush);
+      break;
+    }
+    case DaemonCall::SET_SOMA_ENABLE_STATUS: {
+      uint32_t core_id = req.Get<uint32_t>();
+      uint32_t soma_id = req.Get<uint32_t>();
+      auto status = static_cast<bdpars::SomaStatusId>(req.Get<uint32_t>());
+      BDDRIVERD_CHECK_REQ(core_ok(core_id) && soma_id < bdpars::BDPars::NumNeurons &&
+                          (status == bdpars::SomaStatusId::DISABLED || status == bdpars::SomaStatusId::ENABLED));
+      driver_->SetSomaEnableStatus(core_id, soma_id, status);
+      break;
+    }
+    case DaemonCall::SET_MEM: {
+      uint32_t core_id = req.Get<uint32_t>();
+      auto mem_id = static_cast<bdpars::BDMemId>(req.Get<uint32_t>());
+      uint32_t start_addr = req.Get<uint32_t>();
+      std::vector<BDWord> data = req.GetVector<BDWord>();
+      BDDRIVERD_CHECK_REQ(core_ok(core_id) && mem_ok(mem_id) &&
+                          start_addr <= pars->mem_info_[mem_id].size &&
+                          data.size() <= pars->mem_info_[mem_id].size - start_addr);
+      driver_->SetMem(core_id, mem_id, data, start_addr);
+      break;
+    }
+    case DaemonCall::DUMP_MEM: {
+      uint32_t core_id = req.Get<uint32_t>();
+      auto mem_id = static_cast<bdpars::BDMemId>(req.Get<uint32_t>());
+      BDDRIVERD_CHECK_REQ(core_ok(core_id) && mem_ok(mem_id));
+      reply->PutVector(driver_->DumpMem(core_id, mem_id));
+      break;
+    }
+    case DaemonCall::SEND_SPIKES:
+    case DaemonCall::SEND_TAGS: {
+      uint32_t core_id = req.Get<uint32_t>();
+      bool flush = req.Get<uint8_t>();
+      std::vector<BDWord> words = req.GetVector<BDWord>();
+      std::vector<BDTime> times = req.GetVector<BDTime>();
+      BDDRIVERD_CHECK_REQ(core_ok(core_id) && words.size() == times.size());
+      if (call == DaemonCall::SEND_SPIKES) {
+        driver_->SendSpikes(core_id, words, times, flush);
+      } else {
+        driver_->SendTags(core_id, words, times, flush);
+      }
+      break;
+    }
+    case DaemonCall::RECV_SPIKES:
+    case DaemonCall::RECV_TAGS: {
+      uint32_t core_id = req.Get<uint32_t>();
+      uint32_t timeout_us = req.Get<uint32_t>();
+      BDDRIVERD_CHECK_REQ(core_ok(core_id));
+      auto words_times = call == DaemonCall::RECV_SPIKES ?
+          driver_->RecvSpikes(core_id)
+        : driver_->RecvTags(core_id, timeout_us);
+      reply->PutVector(words_times.first);
+      reply->PutVector(words_times.second);
+      break;
+    }
+    case DaemonCall::SET_SPIKE_GENERATOR_RATES: {
+      uint32_t core_id = req.Get<uint32_t>();
+      std::vector<unsigned int> gen_idxs = req.GetVector<unsigned int>();
+      std::vector<unsigned int> tags = req.GetVector<unsigned int>();
+      std::vector<int> rates = req.GetVector<int>();
+      BDTime time = req.Get<BDTime>();
+      bool flush = req.Get<uint8_t>();
+      BDDRIVERD_CHECK_REQ(core_ok(core_id) && gen_idxs.size() == tags.size() && tags.size() == rates.size());
+      driver_->SetSpikeGeneratorRates(core_id, gen_idxs, tags, rates, time, flush);
+      break;
+    }
+    case DaemonCall::SET_NUM_SPIKE_FILTERS: {
+      uint32_t core_id = req.Get<uint32_t>();
+      uint32_t num = req.Get<uint32_t>();
+      bool flush = req.Get<uint8_t>();
+      BDDRIVERD_CHECK_REQ(core_ok(core_id));
+      driver_->SetNumSpikeFilters(core_id, num, flush);
+      break;
+    }
+    case DaemonCall::RECV_SPIKE_FILTER_STATES: {
+      uint32_t core_id = req.Get<uint32_t>();
+      uint32_t timeout_us = req.Get<uint32_t>();
+      BDDRIVERD_CHECK_REQ(core_ok(core_id));
+      auto ids_states_times = driver_->RecvSpikeFilterStates(core_id, timeout_us);
+      reply->PutVector(std::get<0>(ids_states_times));
+      reply->PutVector(std::get<1>(ids_states_times));
+      reply->PutVector(std::get<2>(ids_states_times));
+      break;
+    }
+    case DaemonCall::GET_FIFO_OVERFLOW_COUNTS: {
+      uint32_t core_id = req.Get<uint32_t>();
+      BDDRIVERD_CHECK_REQ(core_ok(core_id));
+      auto counts = driver_->GetFIFOOverflowCounts(core_id);
+      reply->Put<uint32_t>(counts.first);
+      reply->Put<uint32_t>(counts.second);
+      break;
+    }
+    case DaemonCall::START_BROADCAST: {
+      std::string name = req.GetString();
+      uint32_t capacity = req.Get<uint32_t>();
+      BDDRIVERD_CHECK_REQ(true);
+      reply->Put<uint8_t>(driver_->StartBroadcast(name, capacity));
+      break;
+    }
+    case DaemonCall::STOP_BROADCAST: {
+      driver_->StopBroadcast();
+      break;
+    }
+    default: {
+      return DaemonStatus::BAD_CALL;
+    }
+  }
+
+  #undef BDDRIVERD_CHECK_REQ
+  return DaemonStatus::OK;
+}
+
+}  // bddriver
+}  // pystorm
@@ -0,0 +1,76 @@
+#ifndef DRIVERSERVER_H
+#define DRIVERSERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Driver.h"
+#include "daemon/DaemonProtocol.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// DriverServer exposes a Driver to other local processes over a Unix domain socket,
+/// so tools that need the board (calibration, the GUI, debugging) don't have to kill
+/// whatever owns it. bddriverd runs one, DriverClient is the other end.
+///
+/// Control calls are small binary frames on the socket (see DaemonProtocol.h).
+/// Each client also maps a shared memory data segment, and bulk payloads (spikes,
+/// tags, SetMem/DumpMem data) are passed through it instead of being copied through
+/// the kernel.
+///
+/// Each client gets a thread. Calls from different clients are serialized on the
+/// Driver, except the Recv* calls, which only touch the (thread-safe) output buffers.
+/// Upstream traffic goes to whichever client pops it first: clients that all want to
+/// see it should read the driver's broadcast ring (START_BROADCAST) instead.
+class DriverServer {
+ public:
+  /// Doesn't take ownership of <driver>, which should already be Start()ed
+  DriverServer(Driver *driver, const std::string &socket_path);
+  ~DriverServer();
+
+  /// Listen on the socket (replacing a stale one) and start accepting clients.
+  /// Returns false (with a warning) if the socket couldn't be set up
+  bool Start();
+  /// Disconnect every client, stop listening and remove the socket
+  void Stop();
+
+  const std::string &GetSocketPath() const { return socket_path_; }
+  unsigned int GetNumClients() const { return num_clients_.load(); }
+  uint64_t GetNumCalls() const { return num_calls_.load(); }
+
+ private:
+  Driver *driver_;
+  const std::string socket_path_;
+  int listen_fd_;
+
+  std::atomic<bool> do_run_;
+  std::thread *accept_thread_;
+  struct Client {
+    std::thread thread;
+    std::atomic<bool> done;
+  };
+  std::mutex clients_lock_;
+  std::list<Client> clients_; /// finished clients are joined at the next accept
+  std::atomic<unsigned int> num_clients_;
+  std::atomic<uint64_t> num_calls_;
+
+  std::mutex driver_lock_; /// held for every call but the Recv* ones (GET_FPGA_TIME holds both)
+  std::mutex recv_lock_;   /// Recv* calls pop several output buffers, one at a time keeps them in step
+
+  void AcceptLoop();
+  void Serve(int fd, std::atomic<bool> *done);
+
+  /// Run <call>, reading its arguments from <req> and writing its results to <reply>
+  DaemonStatus Dispatch(DaemonCall call, DaemonReader &req, DaemonWriter *reply);
+};
+
+}  // bddriver
+}  // pystorm
+
+#endif
@@ -0,0 +1,88 @@
+// bddriverd: owns the board's Driver, and serves it to local processes over a Unix socket.
+//
+// usage: bddriverd [-s socket_path] [-b ok_bitfile] [-n ok_serial] [-c num_cores] [-i]
+//   -i runs InitBD() before accepting clients
+// Stops on SIGINT/SIGTERM.
+
+#include <csignal>
+#include <cstdlib>
+#include <string>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "Driver.h"
+#include "daemon/DriverServer.h"
+#ifdef BD_COMM_TYPE_MODEL
+#include "model/BDModelDriver.h"
+#endif
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+using namespace pystorm::bddriver;
+
+int main(int argc, char *argv[]) {
+  std::string socket_path = driverpars::DAEMON_SOCKET_PATH;
+  std::string bitfile;
+  std::string serial;
+  unsigned int num_cores = 1;
+  bool init_bd = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:b:n:c:i")) != -1) {
+    switch (opt) {
+      case 's': socket_path = optarg; break;
+      case 'b': bitfile = optarg; break;
+      case 'n': serial = optarg; break;
+      case 'c': num_cores = std::atoi(optarg); break;
+      case 'i': init_bd = true; break;
+      default:
+        cout << "usage: " << argv[0] << " [-s socket_path] [-b ok_bitfile] [-n ok_serial] [-c num_cores] [-i]" << endl;
+        return 1;
+    }
+  }
+
+  // block the signals before any threads start, so they all inherit the mask
+  // and only sigwait() below sees them
+  sigset_t stop_signals;
+  sigemptyset(&stop_signals);
+  sigaddset(&stop_signals, SIGINT);
+  sigaddset(&stop_signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+
+#ifdef BD_COMM_TYPE_MODEL
+  Driver *driver = new BDModelDriver(num_cores);
+#else
+  Driver *driver = new Driver(num_cores);
+#endif
+  if (bitfile.size() > 0) driver->SetOKBitFile(bitfile);
+  if (serial.size() > 0) driver->SetOKSerial(serial);
+
+  if (driver->Start() < 0) {
+    cout << "bddriverd: couldn't start the driver" << endl;
+    delete driver;
+    return 1;
+  }
+  if (init_bd) {
+    driver->InitBD();
+  }
+
+  DriverServer server(driver, socket_path);
+  if (!server.Start()) {
+    driver->Stop();
+    delete driver;
+    return 1;
+  }
+  cout << "bddriverd: serving on " << socket_path << endl;
+
+  int sig;
+  sigwait(&stop_signals, &sig);
+  cout << "bddriverd: stopping (" << server.GetNumCalls() << " calls served)" << endl;
+
+  server.Stop();
+  driver->Stop();
+  delete driver;
+  return 0;
+}
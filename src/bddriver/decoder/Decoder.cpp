@@ -1,5 +1,6 @@
 #include "Decoder.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <thread>
 #include <unordered_map>
@@ -11,7 +12,6 @@
 #include "common/BDPars.h"
 #include "common/BDWord.h"
 #include "common/MutexBuffer.h"
-#include "common/vector_util.h" // VectorDeserializer
 
 #include <iostream>
 using std::cout;
@@ -20,6 +20,20 @@ using std::endl;
 namespace pystorm {
 namespace bddriver {
 
+std::vector<unsigned int> Decoder::WordsPerOutput(const bdpars::BDPars * bd_pars) {
+  const unsigned int FPGA_payload_width = FieldWidth(FPGAIO::PAYLOAD);
+  std::vector<unsigned int> words_per_output(bdpars::BDPars::NumEPCodes, 1);
+  for (unsigned int ep_code = 0; ep_code < bdpars::BDPars::NumEPCodes; ep_code++) {
+    const unsigned int ep_data_size = bd_pars->Up_EP_size_[ep_code];
+    // if the width of a single output from the FPGA ever exceeds 64 bits, we'll need to rethink this
+    assert(ep_data_size <= 2 * FPGA_payload_width);
+    if (ep_data_size > FPGA_payload_width) {
+      words_per_output[ep_code] = 2;
+    }
+  }
+  return words_per_output;
+}
+
 void Decoder::RunOnce() {
   // we may time out for the Pop, (which can block indefinitely), giving us a chance to be killed
   std::unique_ptr<std::vector<DecInput>> popped_vect = in_buf_->Pop(timeout_us_);
@@ -29,18 +43,146 @@ void Decoder::RunOnce() {
   }
 
   if (popped_vect->size() > 0) {
+    // Decode() applies before_taps filters_, the rest are applied just before pushing
+    std::unique_lock<std::mutex> ulock(hooks_lock_);
     Decode(std::move(popped_vect));
 
     // push to each output vector
-    for (auto& it : decoded_outputs_) {
-      uint8_t ep_code = it.first;
-      std::unique_ptr<std::vector<DecOutput>> &vvect = it.second;
-      out_bufs_.at(ep_code)->Push(std::move(vvect));
+    for (unsigned int core_id = 0; core_id < decoded_outputs_.size(); core_id++) {
+      for (auto& it : decoded_outputs_[core_id]) {
+        uint8_t ep_code = it.first;
+        std::unique_ptr<std::vector<DecOutput>> &vvect = it.second;
+
+        // corrupted upstream data can carry ep codes nothing listens to
+        if (out_bufs_[core_id].count(ep_code) == 0) {
+          if (num_unknown_ep_words_ == 0) {
+            cout << "WARNING: bddriver::Decoder: dropping words with unknown upstream ep code " << static_cast<unsigned int>(ep_code) <<
+              " (only warning once, see GetNumUnknownEPWords())" << endl;
+          }
+          num_unknown_ep_words_ += vvect->size();
+          continue;
+        }
+
+        if (broadcast_ != nullptr) {
+          broadcast_->Publish(core_id, ep_code, *vvect);
+        }
+
+        auto store = stores_[core_id].find(ep_code);
+        if (store != stores_[core_id].end()) {
+          store->second->Append(*vvect);
+        }
+
+        if (rate_maps_[core_id] != nullptr && ep_code == bd_pars_->UpEPCodeFor(bdpars::BDFunnelEP::NRNI)) {
+          rate_maps_[core_id]->AddSpikes(*vvect);
+        }
+
+        auto hooks = output_hooks_[core_id].find(ep_code);
+        if (hooks != output_hooks_[core_id].end()) {
+          bool consumed = false;
+          for (auto& it : hooks->second) {
+            consumed = it.second(*vvect) || consumed;
+          }
+          if (consumed) continue; // a hook consumed the outputs
+        }
+
+        const OutputFilter *filter = filters_[core_id][ep_code].get();
+        if (filter != nullptr && !filter->before_taps) {
+          auto kept_end = std::remove_if(vvect->begin(), vvect->end(),
+              [filter](const DecOutput &out) { return !filter->Keeps(out.payload); });
+          num_filtered_outputs_ += vvect->end() - kept_end;
+          vvect->erase(kept_end, vvect->end());
+          if (vvect->size() == 0) continue;
+        }
+        if (filter != nullptr && filter->route.size() > 0) {
+          Route(*filter, *vvect, out_bufs_[core_id].at(ep_code));
+          continue;
+        }
+
+        out_bufs_[core_id].at(ep_code)->Push(std::move(vvect));
+      }
+    }
+
+    // published only now, so that every output still to come is stamped at or after it
+    latest_HB_.store(curr_HB_recvd_[0]);
+
+    for (unsigned int core_id = 0; core_id < frame_hooks_.size(); core_id++) {
+      if (rate_maps_[core_id] != nullptr) {
+        rate_maps_[core_id]->Update(curr_HB_recvd_[core_id]);
+      }
+      for (auto& it : frame_hooks_[core_id]) {
+        it.second(curr_HB_recvd_[core_id]);
+      }
     }
+  }
+}
 
+void Decoder::SetOutputHook(unsigned int core_id, uint8_t ep_code, const std::string &name, OutputHook hook) {
+  std::unique_lock<std::mutex> ulock(hooks_lock_);
+  auto &ep_hooks = output_hooks_.at(core_id);
+  if (hook) {
+    ep_hooks[ep_code][name] = hook;
+  } else if (ep_hooks.count(ep_code) > 0) {
+    ep_hooks.at(ep_code).erase(name);
+    if (ep_hooks.at(ep_code).empty()) {
+      ep_hooks.erase(ep_code); // eps without hooks skip the lookup
+    }
   }
 }
 
+void Decoder::SetFrameHook(unsigned int core_id, const std::string &name, FrameHook hook) {
+  std::unique_lock<std::mutex> ulock(hooks_lock_);
+  if (hook) {
+    frame_hooks_.at(core_id)[name] = hook;
+  } else {
+    frame_hooks_.at(core_id).erase(name);
+  }
+}
+
+void Decoder::SetRateMap(unsigned int core_id, RateMap *rate_map) {
+  std::unique_lock<std::mutex> ulock(hooks_lock_);
+  rate_maps_.at(core_id) = rate_map;
+}
+
+void Decoder::SetStore(unsigned int core_id, uint8_t ep_code, OutputStore *store) {
+  std::unique_lock<std::mutex> ulock(hooks_lock_);
+  if (store != nullptr) {
+    stores_.at(core_id)[ep_code] = store;
+  } else {
+    stores_.at(core_id).erase(ep_code);
+  }
+}
+
+void Decoder::SetOutputFilter(unsigned int core_id, uint8_t ep_code, const OutputFilter &filter) {
+  assert(filter.keep.size() * 64 >= (1u << filter.key_width));
+  assert(filter.route.size() == 0 || filter.route.size() == (1u << filter.key_width));
+  std::unique_lock<std::mutex> ulock(hooks_lock_);
+  filters_.at(core_id).at(ep_code).reset(new OutputFilter(filter));
+}
+
+void Decoder::ClearOutputFilter(unsigned int core_id, uint8_t ep_code) {
+  std::unique_lock<std::mutex> ulock(hooks_lock_);
+  filters_.at(core_id).at(ep_code).reset();
+}
+
+void Decoder::Route(const OutputFilter &filter, const std::vector<DecOutput> &outputs, MutexBuffer<DecOutput> *ep_buf) {
+  std::vector<std::unique_ptr<std::vector<DecOutput>>> routed(filter.queues.size() + 1);
+  for (auto& it : outputs) {
+    auto &batch = routed[filter.route[filter.Key(it.payload)]];
+    if (!batch) batch = std::make_unique<std::vector<DecOutput>>();
+    batch->push_back(it);
+  }
+
+  if (routed[0]) ep_buf->Push(std::move(routed[0]));
+  for (unsigned int i = 0; i < filter.queues.size(); i++) {
+    if (routed[i + 1]) filter.queues[i]->Push(std::move(routed[i + 1]));
+  }
+}
+
+void Decoder::SetBroadcast(ShmRingWriter *ring) {
+  std::unique_lock<std::mutex> ulock(hooks_lock_);
+  broadcast_ = ring;
+}
+
 void Decoder::Decode(std::unique_ptr<std::vector<DecInput>> input) {
 
   if (input->size() % BYTES_PER_WORD != 0) {
@@ -57,11 +199,14 @@ void Decoder::Decode(std::unique_ptr<std::vector<DecInput>> input) {
   unsigned int bytes_used = 0;
 
   // clear decoded_outputs_
-  decoded_outputs_.clear();
+  for (auto& it : decoded_outputs_) {
+    it.clear();
+  }
 
   DecInput * raw_data = input->data();
 
   unsigned int words_processed = 0;
+  uint64_t num_filtered = 0;
   for (unsigned int block_idx = 0; block_idx < num_blocks; block_idx++) {
     unsigned int start = block_idx * driverpars::READ_BLOCK_SIZE;
     unsigned int end   = (block_idx + 1) * driverpars::READ_BLOCK_SIZE;
@@ -90,26 +235,36 @@ void Decoder::Decode(std::unique_ptr<std::vector<DecInput>> input) {
       // if it's a heartbeat, set last_HB_recvd
       // we send the HBs to the driver too, so it knows the time
       if (ep_code == bd_pars_->UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_HB_LSB)) {
-        last_HB_LSB_recvd_ = payload;
+        last_HB_LSB_recvd_[curr_core_] = payload;
       } else if (ep_code == bd_pars_->UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_HB_MSB)) {
         BDTime this_HB = PackWord<TWOFPGAPAYLOADS>(
             {{TWOFPGAPAYLOADS::MSB, payload},
-             {TWOFPGAPAYLOADS::LSB, last_HB_LSB_recvd_}});
+             {TWOFPGAPAYLOADS::LSB, last_HB_LSB_recvd_[curr_core_]}});
 
-        if (this_HB - curr_HB_recvd_ != curr_HB_recvd_ - last_HB_recvd_) { 
+        BDTime &curr_HB = curr_HB_recvd_[curr_core_];
+        BDTime &last_HB = last_HB_recvd_[curr_core_];
+        if (this_HB - curr_HB != curr_HB - last_HB) { 
           cout << "WARNING: bddriver::Decoder::Decode: possibly missed an upstream HB. Jump was " <<
-            this_HB - curr_HB_recvd_ << ". Last jump was " << curr_HB_recvd_ - last_HB_recvd_ <<
+            this_HB - curr_HB << ". Last jump was " << curr_HB - last_HB <<
             ". Could indicate data loss. Also happens when FPGA timing is modified." << endl;
         }
 
-        last_HB_recvd_ = curr_HB_recvd_;
-        curr_HB_recvd_ = this_HB;
-        //cout << "got HB: " << payload << " curr_HB_ = " << curr_HB_recvd_ << endl;
+        last_HB = curr_HB;
+        curr_HB = this_HB;
+        //cout << "got HB: " << payload << " curr_HB_ = " << curr_HB << endl;
       }
 
-      // ignore queue counts (first word of each block)
+      // queue counts (first word of each block) aren't outputs, just keep the latest
       if (ep_code == bd_pars_->UpEPCodeFor(bdpars::FPGAOutputEP::DS_QUEUE_CT)) {
-        // pass
+        DS_queue_words_.store(payload);
+
+      // the words that follow come from another core
+      } else if (ep_code == bd_pars_->UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_CORE)) {
+        if (payload < out_bufs_.size()) {
+          curr_core_ = payload;
+        } else {
+          cout << "WARNING: bddriver::Decoder: got words from core " << payload << ", only have " << out_bufs_.size() << endl;
+        }
 
       // break on nop
       } else if (ep_code == bd_pars_->UpEPCodeFor(bdpars::FPGAOutputEP::NOP)) {
@@ -129,25 +284,46 @@ void Decoder::Decode(std::unique_ptr<std::vector<DecInput>> input) {
         //cout << "decoder got something that wasn't a HB" << endl;
         //cout << "  ep# = " << ep_code << endl;
         
-        // XXX core id?
-
         //if (had_nop) {
         //  cout << "had real data after nop" << endl;
         //}
 
+        // outputs wider than an FPGA payload come LSB word first, hold on to it until the MSB word
+        int64_t &pending_lsb = pending_lsb_[curr_core_][ep_code];
+        if (words_per_output_[ep_code] > 1 && pending_lsb < 0) {
+          pending_lsb = payload;
+          continue;
+        }
+
         DecOutput to_push;
-        to_push.payload = payload;
+        if (words_per_output_[ep_code] > 1) {
+          to_push.payload = PackWord<TWOFPGAPAYLOADS>(
+              {{TWOFPGAPAYLOADS::LSB, static_cast<uint64_t>(pending_lsb)},
+               {TWOFPGAPAYLOADS::MSB, payload}});
+          pending_lsb = -1;
+        } else {
+          to_push.payload = payload;
+        }
+
+        // before_taps subscriptions reject outputs here, before they cost anything more
+        const OutputFilter *filter = filters_[curr_core_][ep_code].get();
+        if (filter != nullptr && filter->before_taps && !filter->Keeps(to_push.payload)) {
+          num_filtered++;
+          continue;
+        }
 
+        // two-word outputs take the time of the second word
         // update times for "push" output problem
         // edit: for debugging, no attempt at correction
-        to_push.time       = curr_HB_recvd_;
+        to_push.time       = curr_HB_recvd_[curr_core_];
         //word_i_min_2_time_ = word_i_min_1_time_;
         //word_i_min_1_time_ = curr_HB_recvd_;
 
-        if (decoded_outputs_.count(ep_code) == 0) {
-          decoded_outputs_[ep_code] = std::make_unique<std::vector<DecOutput>>();
+        auto &core_outputs = decoded_outputs_[curr_core_];
+        if (core_outputs.count(ep_code) == 0) {
+          core_outputs[ep_code] = std::make_unique<std::vector<DecOutput>>();
         }
-        decoded_outputs_.at(ep_code)->push_back(to_push);
+        core_outputs.at(ep_code)->push_back(to_push);
 
         words_processed++;
       }
@@ -159,6 +335,10 @@ void Decoder::Decode(std::unique_ptr<std::vector<DecInput>> input) {
 
   //cout << "decoder processed " << words_processed * 4 << " bytes" << endl;
 
+  if (num_filtered > 0) {
+    num_filtered_outputs_ += num_filtered;
+  }
+
   if (!had_nop_block && !had_nop) {
     cout << "WARNING: bddriver::Decoder::Decode: read was full of data. Out of upstream throughput. Probable data loss" << endl;
     cout << "  " << bytes_used << " bytes used in frame out of " << driverpars::READ_SIZE << endl;
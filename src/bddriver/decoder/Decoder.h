@@ -1,7 +1,13 @@
 #ifndef DECODER_H
 #define DECODER_H
 
+#include <atomic>
+#include <cassert>
 #include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <utility>
@@ -10,6 +16,9 @@
 #include "common/BDPars.h"
 #include "common/DriverTypes.h"
 #include "common/MutexBuffer.h"
+#include "common/OutputStore.h"
+#include "common/RateMap.h"
+#include "common/ShmRing.h"
 #include "common/Xcoder.h"
 #include "common/vector_util.h"
 
@@ -23,9 +32,13 @@ class Decoder : public Xcoder {
   constexpr static unsigned int BYTES_PER_WORD = 4;
   constexpr static unsigned int bytesPerInput = BYTES_PER_WORD;
 
+  /// one output buffer per upstream ep code
+  typedef std::unordered_map<uint8_t, MutexBuffer<DecOutput> *> OutputBufs;
+
+  /// <out_bufs>[i] are core i's output buffers
   Decoder(
       MutexBuffer<DecInput> *in_buf,
-      const std::unordered_map<uint8_t, MutexBuffer<DecOutput> *> &out_bufs,
+      const std::vector<OutputBufs> &out_bufs,
       const bdpars::BDPars * bd_pars,
       unsigned int timeout_us = 1000)
     : Xcoder(), 
@@ -33,24 +46,139 @@ class Decoder : public Xcoder {
     in_buf_(in_buf),
     out_bufs_(out_bufs),
     bd_pars_(bd_pars),
-    last_HB_LSB_recvd_(0),
-    curr_HB_recvd_(0),
-    last_HB_recvd_(0) {};
+    curr_core_(0),
+    last_HB_LSB_recvd_(out_bufs.size(), 0),
+    curr_HB_recvd_(out_bufs.size(), 0),
+    last_HB_recvd_(out_bufs.size(), 0),
+    latest_HB_(0),
+    DS_queue_words_(0),
+    decoded_outputs_(out_bufs.size()),
+    output_hooks_(out_bufs.size()),
+    frame_hooks_(out_bufs.size()),
+    stores_(out_bufs.size()),
+    rate_maps_(out_bufs.size(), nullptr),
+    filters_(out_bufs.size()),
+    broadcast_(nullptr),
+    num_unknown_ep_words_(0),
+    num_filtered_outputs_(0),
+    words_per_output_(WordsPerOutput(bd_pars)),
+    pending_lsb_(out_bufs.size(), std::vector<int64_t>(bdpars::BDPars::NumEPCodes, -1)) {
+      assert(out_bufs.size() == bd_pars->NumCores);
+      for (auto& it : filters_) {
+        it.resize(bdpars::BDPars::NumEPCodes);
+      }
+    };
+
+  /// single-core
+  Decoder(
+      MutexBuffer<DecInput> *in_buf,
+      const OutputBufs &out_bufs,
+      const bdpars::BDPars * bd_pars,
+      unsigned int timeout_us = 1000)
+    : Decoder(in_buf, std::vector<OutputBufs>(1, out_bufs), bd_pars, timeout_us) {};
 
   ~Decoder() {};
 
+  /// Most recent upstream HB time from core 0 (FPGA time units), safe to call from any thread.
+  /// Unlike Driver::GetFPGATime(), doesn't consume anything from the HB output buffers.
+  /// Updated once the batch it came in has been pushed to the output buffers.
+  BDTime GetLatestHB() const { return latest_HB_.load(); }
+
+  /// Called from the decoder thread with each batch of decoded outputs for <ep_code>
+  /// (two-word outputs already put back together),
+  /// before they're pushed to that ep's output buffer. If it returns true, the batch is dropped.
+  typedef std::function<bool(const std::vector<DecOutput>&)> OutputHook;
+  /// Set <core_id>'s <ep_code> hook called <name>, an empty OutputHook removes it.
+  /// An ep can have several, they're all called (in name order), and the batch is dropped if any returns true
+  void SetOutputHook(unsigned int core_id, uint8_t ep_code, const std::string &name, OutputHook hook);
+
+  /// Called from the decoder thread after all of a read's outputs have been pushed (or hooked),
+  /// with the core's latest upstream HB time. Everything before that time has been seen by then
+  typedef std::function<void(BDTime)> FrameHook;
+  /// Set <core_id>'s frame hook called <name>, an empty FrameHook removes it.
+  /// A core can have several, they're called in name order
+  void SetFrameHook(unsigned int core_id, const std::string &name, FrameHook hook);
+
+  /// Words in the FPGA's downstream queue, from the latest DS_QUEUE_CT word, safe to call from any thread
+  uint32_t GetDSQueueWords() const { return DS_queue_words_.load(); }
+
+  /// Also publish every decoded output (before hooks see it) to <ring>, nullptr stops.
+  /// The caller owns <ring>, and must keep it alive until it's been replaced
+  void SetBroadcast(ShmRingWriter *ring);
+
+  /// Also append <core_id>'s <ep_code> outputs (before hooks see them) to <store>, nullptr stops.
+  /// The caller owns <store>, and must keep it alive until it's been replaced
+  void SetStore(unsigned int core_id, uint8_t ep_code, OutputStore *store);
+
+  /// Also count <core_id>'s spikes (before hooks see them) in <rate_map>, and update it after each read, nullptr stops.
+  /// The caller owns <rate_map>, and must keep it alive until it's been replaced
+  void SetRateMap(unsigned int core_id, RateMap *rate_map);
+
+  /// Words dropped because their upstream ep code isn't one of BDPars' (i.e. corrupted data)
+  uint64_t GetNumUnknownEPWords() const { return num_unknown_ep_words_.load(); }
+
+  /// Which of an ep's outputs are kept, by a key field of their payload (e.g. a spike's neuron address),
+  /// and which queue the kept ones go to
+  struct OutputFilter {
+    unsigned int key_shift = 0;
+    unsigned int key_width = 0;
+    /// bitmap over keys, outputs whose bit isn't set aren't queued
+    std::vector<uint64_t> keep;
+    /// drop them as they're decoded instead, so the broadcast, stores, rate map and hooks don't see them either
+    bool before_taps = false;
+    /// per key, 0: the ep's output buffer, i: queues[i - 1]. Empty if nothing is routed
+    std::vector<uint8_t> route;
+    std::vector<MutexBuffer<DecOutput> *> queues;
+
+    unsigned int Key(BDWord payload) const { return (payload >> key_shift) & ((1u << key_width) - 1); }
+    bool Keeps(BDWord payload) const {
+      unsigned int key = Key(payload);
+      return (keep[key / 64] >> (key % 64)) & 1;
+    }
+  };
+  /// Only queue <core_id>'s <ep_code> outputs that <filter> keeps. The broadcast, stores, rate map
+  /// and hooks still see the rest, unless <filter>.before_taps. The caller owns <filter>'s queues,
+  /// and must keep them alive until the filter's been replaced
+  void SetOutputFilter(unsigned int core_id, uint8_t ep_code, const OutputFilter &filter);
+  void ClearOutputFilter(unsigned int core_id, uint8_t ep_code);
+  /// Outputs dropped by filters
+  uint64_t GetNumFilteredOutputs() const { return num_filtered_outputs_.load(); }
+
  private:
 
   const unsigned int timeout_us_;
   MutexBuffer<DecInput> * in_buf_;
-  std::unordered_map<uint8_t, MutexBuffer<DecOutput> *> out_bufs_;
+  std::vector<OutputBufs> out_bufs_;
   const bdpars::BDPars * bd_pars_;
 
-  uint32_t last_HB_LSB_recvd_;
-  BDTime curr_HB_recvd_;
-  BDTime last_HB_recvd_;
+  unsigned int curr_core_; // set by UPSTREAM_CORE words, carries over between reads
+
+  // per core, each core's FPGA keeps its own time
+  std::vector<uint32_t> last_HB_LSB_recvd_;
+  std::vector<BDTime> curr_HB_recvd_;
+  std::vector<BDTime> last_HB_recvd_;
+  std::atomic<BDTime> latest_HB_; // copy of curr_HB_recvd_[0] for other threads
+  std::atomic<uint32_t> DS_queue_words_;
+
+  std::vector<std::unordered_map<uint8_t, std::unique_ptr<std::vector<DecOutput>>>> decoded_outputs_; 
+
+  std::mutex hooks_lock_;
+  std::vector<std::unordered_map<uint8_t, std::map<std::string, OutputHook>>> output_hooks_;
+  std::vector<std::map<std::string, FrameHook>> frame_hooks_; // guarded by hooks_lock_ too
+  std::vector<std::unordered_map<uint8_t, OutputStore *>> stores_; // guarded by hooks_lock_ too
+  std::vector<RateMap *> rate_maps_; // guarded by hooks_lock_ too
+  std::vector<std::vector<std::unique_ptr<OutputFilter>>> filters_; // [core_id][ep_code], guarded by hooks_lock_ too
+  ShmRingWriter *broadcast_; // guarded by hooks_lock_ too
+  std::atomic<uint64_t> num_unknown_ep_words_;
+  std::atomic<uint64_t> num_filtered_outputs_;
+
+  /// FPGA words per output for each upstream ep code, 2 if the ep is wider than an FPGA payload
+  std::vector<unsigned int> words_per_output_;
+  /// LSB halves of two-word outputs waiting for their MSB word, pending_lsb_[core_id][ep_code].
+  /// -1 if there isn't one. Carries over between reads, a pair can straddle two frames
+  std::vector<std::vector<int64_t>> pending_lsb_;
 
-  std::unordered_map<uint8_t, std::unique_ptr<std::vector<DecOutput>>> decoded_outputs_; 
+  static std::vector<unsigned int> WordsPerOutput(const bdpars::BDPars * bd_pars);
 
   // because of the "push" output problem, we have to shift how we label times by
   // two words: the time that event i actually happened is the time for event i - 2
@@ -60,6 +188,8 @@ class Decoder : public Xcoder {
 
   void RunOnce();
   void Decode(std::unique_ptr<std::vector<DecInput>> input);
+  /// Push <outputs> to <filter>'s queues by key, unrouted ones to <ep_buf>
+  static void Route(const OutputFilter &filter, const std::vector<DecOutput> &outputs, MutexBuffer<DecOutput> *ep_buf);
 
 };
 
@@ -1,5 +1,7 @@
 #include "Encoder.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <thread>
 #include <unordered_map>
@@ -35,63 +37,269 @@ void PrintBinaryAsStr(uint32_t b, unsigned int N) {
 }
 
 void Encoder::RunOnce() {
-  // we may time out for the Pop, (which can block indefinitely), giving us a chance to be killed
-  std::unique_ptr<std::vector<EncInput>> popped_vect = in_buf_->Pop(timeout_us_);
-  if (popped_vect->size() > 0) {
-    Encode(std::move(popped_vect));
+  if (bulk_buf_ == nullptr) {
+    // we may time out for the Pop, (which can block indefinitely), giving us a chance to be killed
+    std::unique_ptr<std::vector<EncInput>> popped_vect = in_buf_->Pop(timeout_us_);
+    if (popped_vect->size() > 0) {
+      Encode(std::move(popped_vect), &priority_);
+    }
+    return;
   }
+
+  auto pushed = [this] { return !in_buf_->IsEmpty() || !bulk_buf_->IsEmpty(); };
+  const unsigned int spin_us = spin_us_;
+  if (spin_us > 0) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(spin_us);
+    while (!pushed() && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::yield(); // lets the producer run if we share a CPU
+    }
+  }
+
+  // held bulk blocks wait on FPGA time and comm, neither of which signals, so poll while there are any
+  const unsigned int wait_us = num_held_blocks_ > 0 ? driverpars::ENC_BULK_POLL_US : timeout_us_;
+  pushed_.Wait(pushed, wait_us);
+
+  EncodePriority();
+  if (!bulk_buf_->IsEmpty()) {
+    std::unique_ptr<std::vector<EncInput>> popped_vect = bulk_buf_->Pop(timeout_us_);
+    // untimed traffic pushed before it (e.g. by the same Driver::Flush()) still goes first
+    EncodePriority();
+    if (popped_vect->size() > 0) {
+      Encode(std::move(popped_vect), &bulk_);
+    }
+  }
+  ReleaseBulk();
 }
 
-inline void Encoder::PushWord(uint32_t word) {
+void Encoder::EncodePriority() {
+  if (in_buf_->IsEmpty()) return;
+  for (auto& it : in_buf_->PopAll(1)) {
+    if (it->size() > 0) {
+      Encode(std::move(it), &priority_);
+    }
+  }
+}
+
+void Encoder::ReleaseBulk() {
+  const BDTime lead = bulk_lead_units_;
+  const BDTime fpga_time = lead > 0 && get_fpga_time_ ? get_fpga_time_() : 0;
+
+  std::unique_lock<std::mutex> ulock(held_lock_);
+  if (held_cleared_) {
+    bulk_HB_stale_ = true;
+    held_cleared_ = false;
+  }
+
+  // consecutive held blocks go to comm together, up to MAX_WRITE_SIZE at a time
+  auto to_send = std::make_unique<std::vector<EncOutput>>();
+  while (held_blocks_.size() > 0) {
+    HeldBlock &next = held_blocks_.front();
+
+    // comm would only queue it up, in the way of priority traffic
+    if (out_buf_->TotalSize() + to_send->size() >= driverpars::ENC_MAX_QUEUED_BULK_BYTES) break;
+    // the FPGA would stall on it, and on everything sent after it
+    if (lead > 0 && next.max_time > fpga_time + lead) break;
+
+    bool moved_HB = next.has_HB;
+    if (bulk_HB_stale_) {
+      // put back the HBs this block was encoded against.
+      // Only priority traffic and ClearHeld() make them stale, so nothing is in to_send yet
+      Lane restore(bd_pars_->NumCores, false);
+      for (unsigned int core_id = 0; core_id < bd_pars_->NumCores; core_id++) {
+        PushHB(&restore, next.start_HB[core_id], core_id);
+      }
+      PadNopsAndFlush(&restore);
+      bulk_HB_stale_ = false;
+      moved_HB = true;
+    }
+
+    if (to_send->size() + next.block->size() > driverpars::MAX_WRITE_SIZE) {
+      out_buf_->Push(std::move(to_send));
+      to_send = std::make_unique<std::vector<EncOutput>>();
+    }
+    to_send->insert(to_send->end(), next.block->begin(), next.block->end());
+
+    num_held_bytes_ -= next.block->size();
+    num_held_blocks_--;
+    held_blocks_.pop_front();
+
+    if (moved_HB) {
+      priority_.HB_valid.assign(bd_pars_->NumCores, false);
+    }
+  }
+
+  if (to_send->size() > 0) {
+    out_buf_->Push(std::move(to_send));
+  }
+}
+
+uint64_t Encoder::ClearHeld() {
+  std::unique_lock<std::mutex> ulock(held_lock_);
+  const uint64_t num_dropped = held_blocks_.size();
+  held_blocks_.clear();
+  num_held_bytes_ = 0;
+  num_held_blocks_ = 0;
+  if (num_dropped > 0) held_cleared_ = true;
+  return num_dropped;
+}
+
+inline void Encoder::PushWord(Lane *lane, uint32_t word) {
 
   uint8_t b0 = GetField<FPGABYTES>(word, FPGABYTES::B0);
   uint8_t b1 = GetField<FPGABYTES>(word, FPGABYTES::B1);
   uint8_t b2 = GetField<FPGABYTES>(word, FPGABYTES::B2);
   uint8_t b3 = GetField<FPGABYTES>(word, FPGABYTES::B3);
 
-  output_block_->push_back(b0);
-  output_block_->push_back(b1);
-  output_block_->push_back(b2);
-  output_block_->push_back(b3);
+  lane->output_block->push_back(b0);
+  lane->output_block->push_back(b1);
+  lane->output_block->push_back(b2);
+  lane->output_block->push_back(b3);
+}
+
+inline void Encoder::PushPacket(Lane *lane, uint32_t word, unsigned int core_id) {
+  PushWord(lane, word);
 
-  // if we've got a lot of blocks, break it up
-  if (output_block_->size() == driverpars::MAX_WRITE_SIZE) {
-    FlushWords();
+  // the router FPGA assembles each packet from two words, LSBs first
+  if (bd_pars_->NumCores > 1) {
+    assert(core_id < bd_pars_->NumCores);
+    PushWord(lane, PackWord<FPGARoute>({{FPGARoute::HOPS, bd_pars_->RouteHopsFor(core_id)}}));
+  }
+
+  // if we've got a lot of blocks, break it up (between packets).
+  // Held blocks are kept small so they can be released close to their times
+  const unsigned int flush_size = lane->held ? driverpars::WRITE_BLOCK_SIZE : driverpars::MAX_WRITE_SIZE;
+  if (lane->output_block->size() == flush_size) {
+    FlushWords(lane);
+  }
+}
+
+inline void Encoder::PushHB(Lane *lane, BDTime time, unsigned int core_id) {
+  lane->last_HB_sent_at[core_id] = time;
+  lane->HB_valid[core_id] = true;
+  lane->sent_HB = true;
+
+  // need to insert three words
+  uint32_t time_chunk[3];
+  time_chunk[0] = GetField<THREEFPGAREGS>(time, THREEFPGAREGS::W0);
+  time_chunk[1] = GetField<THREEFPGAREGS>(time, THREEFPGAREGS::W1);
+  time_chunk[2] = GetField<THREEFPGAREGS>(time, THREEFPGAREGS::W2);
+
+  // manually compute offset from this code
+  uint8_t HB_ep_code[3];
+  HB_ep_code[0] = bd_pars_->DnEPCodeFor(bdpars::FPGARegEP::TM_PC_TIME_ELAPSED0);
+  HB_ep_code[1] = bd_pars_->DnEPCodeFor(bdpars::FPGARegEP::TM_PC_TIME_ELAPSED1);
+  HB_ep_code[2] = bd_pars_->DnEPCodeFor(bdpars::FPGARegEP::TM_PC_TIME_ELAPSED2);
+
+  for (unsigned int i = 0; i < 3; i++) {
+    PushPacket(lane, PackWord<FPGAIO>({{FPGAIO::PAYLOAD, time_chunk[i]}, {FPGAIO::EP_CODE, HB_ep_code[i]}}), core_id);
   }
 }
 
-inline void Encoder::PadNopsAndFlush() {
+inline void Encoder::PadNopsAndFlush(Lane *lane) {
   // figure out how man nops are needed to pad
-  unsigned int curr_size_in_frame = output_block_->size() % driverpars::WRITE_BLOCK_SIZE;
+  unsigned int curr_size_in_frame = lane->output_block->size() % driverpars::WRITE_BLOCK_SIZE;
   unsigned int to_complete_block = (driverpars::WRITE_BLOCK_SIZE - curr_size_in_frame) % driverpars::WRITE_BLOCK_SIZE;
 
   // construct FPGA nop word
   uint8_t nop_code = bd_pars_->DnEPCodeFor(bdpars::FPGARegEP::NOP);
   BDWord nop = PackWord<FPGAIO>({{FPGAIO::PAYLOAD, 0}, {FPGAIO::EP_CODE, nop_code}});
 
-  // push nops
-  for (unsigned int i = 0; i < to_complete_block / 4; i++) { // 4 words per nop, so / 4
-    PushWord(nop);
+  // push nops, to core 0 if they're routed
+  const unsigned int bytes_per_packet = bd_pars_->NumCores > 1 ? 8 : 4;
+  for (unsigned int i = 0; i < to_complete_block / bytes_per_packet; i++) {
+    PushPacket(lane, nop, 0);
   }
 
   // and flush
-  FlushWords();
+  FlushWords(lane);
 }
 
 // flush code, pad nops to complete block
-inline void Encoder::FlushWords() {
+inline void Encoder::FlushWords(Lane *lane) {
 
   assert(driverpars::WRITE_BLOCK_SIZE % 4 == 0);
-  assert(output_block_->size() % driverpars::WRITE_BLOCK_SIZE == 0);
+  assert(lane->output_block->size() % driverpars::WRITE_BLOCK_SIZE == 0);
+
+  // move output_block
+  if (lane->held) {
+    std::unique_lock<std::mutex> ulock(held_lock_);
+    num_held_bytes_ += lane->output_block->size();
+    num_held_blocks_++;
+    held_blocks_.push_back({std::move(lane->output_block), lane->block_start_HB, lane->block_max_time, lane->sent_HB});
+  } else {
+    if (lane->sent_HB) {
+      bulk_HB_stale_ = true;
+    }
+    out_buf_->Push(std::move(lane->output_block)); 
+  }
+
+  // construct new output_block
+  lane->output_block = std::make_unique<std::vector<EncOutput>>();
+  lane->sent_HB = false;
+  lane->block_start_HB = lane->last_HB_sent_at;
+  lane->block_max_time = 0;
+}
+
+void Encoder::PushEncoded(std::unique_ptr<std::vector<EncOutput>> block) {
+  assert(block->size() % driverpars::WRITE_BLOCK_SIZE == 0);
+  assert(block->size() <= driverpars::MAX_WRITE_SIZE);
+
+  EncInput marker;
+  marker.FPGA_ep_code = EncInput::kEncodedBlockCode;
+  marker.core_id = 0; // don't care about the other fields
+  marker.payload = 0;
+  marker.time = 0;
+  marker.sequence_num = 0;
+
+  // markers and blocks have to go in in the same order
+  std::unique_lock<std::mutex> ulock(encoded_lock_);
+  encoded_blocks_.push_back(std::move(block));
+  in_buf_->Push(std::make_unique<std::vector<EncInput>>(1, marker));
+}
+
+std::vector<std::vector<EncOutput>> Encoder::EncodeBlocks(const std::vector<EncInput> &inputs, const bdpars::BDPars *bd_pars) {
+  MutexBuffer<EncOutput> out_buf;
+  Encoder encoder(nullptr, &out_buf, bd_pars);
+
+  auto to_encode = std::make_unique<std::vector<EncInput>>(inputs);
+  AppendFlush(to_encode.get(), bd_pars);
+  encoder.Encode(std::move(to_encode), &encoder.priority_);
+
+  std::vector<std::vector<EncOutput>> blocks;
+  for (auto &it : out_buf.PopAll(1)) {
+    if (it->size() > 0) {
+      blocks.push_back(std::move(*it));
+    }
+  }
+  return blocks;
+}
+
+void Encoder::AppendFlush(std::vector<EncInput> *inputs, const bdpars::BDPars *bd_pars) {
+  std::vector<BDTime> core_times(bd_pars->NumCores, 0);
+  for (auto &it : *inputs) {
+    if (it.FPGA_ep_code != EncInput::kFlushCode && it.FPGA_ep_code != EncInput::kEncodedBlockCode) {
+      core_times.at(it.core_id) = std::max(core_times.at(it.core_id), it.time);
+    }
+  }
 
-  // move output_block_
-  out_buf_->Push(std::move(output_block_)); 
+  const uint8_t DAC_code = bd_pars->DnEPCodeFor(bdpars::BDHornEP::DAC_UNUSED);
+  const BDWord phantom = PackWord<DACWord>({{DACWord::DAC_VALUE, 1}, {DACWord::DAC_TO_ADC_CONN, 0}});
+  for (unsigned int core_id = 0; core_id < bd_pars->NumCores; core_id++) {
+    for (unsigned int i = 0; i < 2; i++) {
+      inputs->push_back({core_id, DAC_code, static_cast<uint32_t>(phantom), core_times[core_id], 0});
+    }
+  }
 
-  // construct new output_block_
-  output_block_ = std::make_unique<std::vector<EncOutput>>();
+  EncInput flush;
+  flush.FPGA_ep_code = EncInput::kFlushCode;
+  flush.core_id = 0; // don't care about the other fields
+  flush.payload = 0;
+  flush.time = 0;
+  flush.sequence_num = 0;
+  inputs->push_back(flush);
 }
 
-void Encoder::Encode(const std::unique_ptr<std::vector<EncInput>> inputs) {
+void Encoder::Encode(const std::unique_ptr<std::vector<EncInput>> inputs, Lane *lane) {
 
   // if multiple flushes are in the same set of inputs, just flush once
   bool flush_pending = false;
@@ -106,10 +314,19 @@ void Encoder::Encode(const std::unique_ptr<std::vector<EncInput>> inputs) {
     if (FPGA_ep_code == EncInput::kFlushCode) {
       flush_pending = true;
 
-    } else {
-      (void)core_id; // XXX this is where you would do something with core_id
-      (void)time;    // XXX this is where you would do something with time
+    } else if (FPGA_ep_code == EncInput::kEncodedBlockCode) {
+      assert(!lane->held && "encoded blocks go in the priority lane");
+      // finish what came before, then pass the block through
+      if (flush_pending || lane->output_block->size() > 0) {
+        PadNopsAndFlush(lane);
+        flush_pending = false;
+      }
+      std::unique_lock<std::mutex> ulock(encoded_lock_);
+      assert(encoded_blocks_.size() > 0);
+      out_buf_->Push(std::move(encoded_blocks_.front()));
+      encoded_blocks_.pop_front();
 
+    } else {
       // pack into 32 bits
       // FPGA word format:
       //  MSB          LSB
@@ -117,30 +334,19 @@ void Encoder::Encode(const std::unique_ptr<std::vector<EncInput>> inputs) {
       // [ code | payload ]
       uint32_t FPGA_encoded = PackWord<FPGAIO>({{FPGAIO::PAYLOAD, payload}, {FPGAIO::EP_CODE, FPGA_ep_code}});
 
+      // a held block is due when its latest input is. The word may end up
+      // at the end of this block or the start of the next, count it in both
+      if (lane->held && time > lane->block_max_time) lane->block_max_time = time;
+
       // if it's been more than DnTimeUnitsPerHB since we last sent a HB, 
-      // package the event's time into a spike
-      if (time - last_HB_sent_at_ >= bd_pars_->DnTimeUnitsPerHB) {
-        last_HB_sent_at_ = time;
-
-        // need to insert two words
-        uint32_t time_chunk[3];
-        time_chunk[0] = GetField<THREEFPGAREGS>(time, THREEFPGAREGS::W0);
-        time_chunk[1] = GetField<THREEFPGAREGS>(time, THREEFPGAREGS::W1);
-        time_chunk[2] = GetField<THREEFPGAREGS>(time, THREEFPGAREGS::W2);
-        
-        // manually compute offset from this code
-        uint8_t HB_ep_code[3];
-        HB_ep_code[0] = bd_pars_->DnEPCodeFor(bdpars::FPGARegEP::TM_PC_TIME_ELAPSED0);
-        HB_ep_code[1] = bd_pars_->DnEPCodeFor(bdpars::FPGARegEP::TM_PC_TIME_ELAPSED1);
-        HB_ep_code[2] = bd_pars_->DnEPCodeFor(bdpars::FPGARegEP::TM_PC_TIME_ELAPSED2);
-
-        for (unsigned int i = 0; i < 3; i++) {
-          PushWord(PackWord<FPGAIO>({{FPGAIO::PAYLOAD, time_chunk[i]}, {FPGAIO::EP_CODE, HB_ep_code[i]}}));
-        }
+      // package the event's time into a spike. Also if the other lane moved the HB
+      if (!lane->HB_valid[core_id] || time - lane->last_HB_sent_at[core_id] >= bd_pars_->DnTimeUnitsPerHB) {
+        PushHB(lane, time, core_id);
       }
 
       // serialize to bytes 
-      PushWord(FPGA_encoded);
+      PushPacket(lane, FPGA_encoded, core_id);
+      if (lane->held && time > lane->block_max_time) lane->block_max_time = time;
 
       //if (FPGA_ep_code != bd_pars_->DnEPCodeFor(bdpars::FPGARegEP::NOP))
       //  PrintBinaryAsStr(FPGA_encoded, 32);
@@ -149,7 +355,7 @@ void Encoder::Encode(const std::unique_ptr<std::vector<EncInput>> inputs) {
 
   if (flush_pending) {
     // pad frame to block size multiple and send to comm
-    PadNopsAndFlush();
+    PadNopsAndFlush(lane);
   }
 }
 
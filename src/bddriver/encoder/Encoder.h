@@ -1,7 +1,11 @@
 #ifndef ENCODER_H
 #define ENCODER_H
 
+#include <atomic>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <thread>
 #include <utility>
 #include <vector>
@@ -15,6 +19,14 @@
 namespace pystorm {
 namespace bddriver {
 
+/// Encoder turns EncInputs into the FPGA's downstream byte stream.
+///
+/// With a <bulk_buf>, there are two lanes: <in_buf> is the priority lane (untimed traffic),
+/// <bulk_buf> is the bulk lane (timed traffic). Bulk blocks are encoded as they come in,
+/// but held in the encoder until comm has room for them and (see SetBulkLead()) the FPGA is
+/// close enough to their times not to stall on them, so priority traffic can go out
+/// ahead of them at any block boundary. Each lane keeps its own HBs: the FPGA's HB is put
+/// back when the other lane has moved it in between
 class Encoder : public Xcoder {
  public:
   const static unsigned int bytesPerOutput = 4;  
@@ -23,31 +35,125 @@ class Encoder : public Xcoder {
       MutexBuffer<EncInput>* in_buf,
       MutexBuffer<EncOutput>* out_buf,
       const bdpars::BDPars * bd_pars,
-      unsigned int timeout_us = 1000)
+      unsigned int timeout_us = 1000,
+      MutexBuffer<EncInput>* bulk_buf = nullptr,
+      std::function<BDTime()> get_fpga_time = std::function<BDTime()>())
     : Xcoder(),
     timeout_us_(timeout_us),
     in_buf_(in_buf),
+    bulk_buf_(bulk_buf),
     out_buf_(out_buf),
     bd_pars_(bd_pars),
-    last_HB_sent_at_(0),
-    output_block_(std::make_unique<std::vector<EncOutput>>()) {};
+    get_fpga_time_(get_fpga_time),
+    spin_us_(0),
+    bulk_lead_units_(0),
+    num_held_bytes_(0),
+    num_held_blocks_(0),
+    priority_(bd_pars->NumCores, false),
+    bulk_(bd_pars->NumCores, true),
+    held_cleared_(false),
+    bulk_HB_stale_(false) {
+      if (bulk_buf_ != nullptr) {
+        in_buf_->SetPushSignal(&pushed_);
+        bulk_buf_->SetPushSignal(&pushed_);
+      }
+    };
 
   ~Encoder(){};
 
+  /// Send an already-encoded <block> to comm, in order with everything pushed to the
+  /// encoder's input so far. <block> must be a multiple of WRITE_BLOCK_SIZE and at most
+  /// MAX_WRITE_SIZE bytes, like the encoder's own output (see EncodeBlocks())
+  void PushEncoded(std::unique_ptr<std::vector<EncOutput>> block);
+
+  /// Encode untimed <inputs> exactly as the encoder thread would, into blocks ready for PushEncoded()
+  static std::vector<std::vector<EncOutput>> EncodeBlocks(const std::vector<EncInput> &inputs, const bdpars::BDPars *bd_pars);
+
+  /// Finish a batch of <inputs> so it goes out now: two phantom DAC_UNUSED writes per core push
+  /// the batch's last words through BD's input synchronizer, then a flush code sends the block.
+  /// Each core's phantom writes take that core's latest time in the batch, so they don't move its HB
+  static void AppendFlush(std::vector<EncInput> *inputs, const bdpars::BDPars *bd_pars);
+
+  /// Only send bulk blocks whose inputs are all due within <lead_units> of the FPGA's time
+  /// (<get_fpga_time>). Anything behind a block the FPGA is holding for a later time waits too,
+  /// so this bounds how long priority traffic can be stuck in the FPGA's queue. 0 sends bulk blocks
+  /// as soon as comm has room for them
+  void SetBulkLead(BDTime lead_units) { bulk_lead_units_ = lead_units; }
+  BDTime GetBulkLead() const { return bulk_lead_units_.load(); }
+
+  /// With two lanes, busy-poll them for up to <spin_us> before sleeping, see MutexBuffer::SetSpinUs()
+  void SetSpinUs(unsigned int spin_us) { spin_us_ = spin_us; }
+
+  /// Encoded bulk traffic the encoder is holding back
+  uint64_t GetNumHeldBytes() const { return num_held_bytes_.load(); }
+  uint64_t GetNumHeldBlocks() const { return num_held_blocks_.load(); }
+  /// Drop the bulk blocks the encoder is holding back, returns how many were dropped.
+  /// The next bulk block puts back the HBs it was encoded against
+  uint64_t ClearHeld();
+
  private:
+  /// One lane's encoding state
+  struct Lane {
+    std::unique_ptr<std::vector<EncOutput>> output_block; // builds up one set of blocks at a time
+    std::vector<BDTime> last_HB_sent_at; // per core, each core's FPGA keeps its own time
+    std::vector<bool> HB_valid;          // per core, false if the other lane may have moved the FPGA's HB since
+    bool held;                           // bulk lane: output blocks wait in held_blocks_
+    bool sent_HB;                        // output_block has a HB in it
+    std::vector<BDTime> block_start_HB;  // held: each core's HB where output_block starts
+    BDTime block_max_time;               // held: latest input time in output_block
+
+    Lane(unsigned int num_cores, bool is_held)
+      : output_block(std::make_unique<std::vector<EncOutput>>()),
+      last_HB_sent_at(num_cores, 0),
+      HB_valid(num_cores, true),
+      held(is_held),
+      sent_HB(false),
+      block_start_HB(num_cores, 0),
+      block_max_time(0) {}
+  };
+
+  /// An encoded bulk block waiting to be sent
+  struct HeldBlock {
+    std::unique_ptr<std::vector<EncOutput>> block;
+    std::vector<BDTime> start_HB;
+    BDTime max_time;
+    bool has_HB;
+  };
+
   const unsigned int timeout_us_;
   MutexBuffer<EncInput>* in_buf_;
+  MutexBuffer<EncInput>* bulk_buf_;
   MutexBuffer<EncOutput>* out_buf_;
   const bdpars::BDPars * bd_pars_;
-  BDTime last_HB_sent_at_;
+  std::function<BDTime()> get_fpga_time_;
+  PushSignal pushed_; // either lane's input was pushed
+
+  std::atomic<unsigned int> spin_us_;
+  std::atomic<BDTime> bulk_lead_units_;
+  std::atomic<uint64_t> num_held_bytes_;
+  std::atomic<uint64_t> num_held_blocks_;
+
+  Lane priority_;
+  Lane bulk_;
+  std::mutex held_lock_; // guards held_blocks_ and held_cleared_, ClearHeld() runs on the caller's thread
+  std::deque<HeldBlock> held_blocks_;
+  bool held_cleared_; // ClearHeld() dropped blocks the bulk lane's HBs assumed were sent
+  bool bulk_HB_stale_; // the priority lane has moved the FPGA's HB since the last bulk block went out
 
-  std::unique_ptr<std::vector<EncOutput>> output_block_; // encoder builds up one set of blocks at a time
+  std::mutex encoded_lock_;
+  std::deque<std::unique_ptr<std::vector<EncOutput>>> encoded_blocks_; // from PushEncoded(), one per kEncodedBlockCode
 
   void RunOnce();
-  inline void PushWord(uint32_t word); // helper for Encode, does serialization into output_block_
-  inline void PadNopsAndFlush(); // pushes nops until the output_block_ is a multiple of WORDS_PER_BLOCK
-  inline void FlushWords(); // flushes words to comm, padding to complete the current block
-  void Encode(const std::unique_ptr<std::vector<EncInput>> inputs);
+  inline void PushWord(Lane *lane, uint32_t word); // helper for PushPacket, does serialization into the lane's output_block
+  inline void PushPacket(Lane *lane, uint32_t word, unsigned int core_id); // word, plus its route word if there's more than one core
+  inline void PushHB(Lane *lane, BDTime time, unsigned int core_id); // the three words setting <core_id>'s HB to <time>
+  inline void PadNopsAndFlush(Lane *lane); // pushes nops until the output_block is a multiple of WORDS_PER_BLOCK
+  inline void FlushWords(Lane *lane); // flushes words to comm (or held_blocks_), padding to complete the current block
+  void Encode(const std::unique_ptr<std::vector<EncInput>> inputs, Lane *lane);
+  /// Encode everything in the priority lane
+  void EncodePriority();
+  /// Send the held bulk blocks that can go now
+  void ReleaseBulk();
 };
 
 }  // bddriver
@@ -0,0 +1,271 @@
+#include "SpikeTrainGenerator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "Encoder.h"
+#include "common/DriverPars.h"
+#include "common/DriverTypes.h"
+
+namespace pystorm {
+namespace bddriver {
+
+namespace {
+
+// push to the encoder in pieces about the size of a USB write, so it can get started
+constexpr unsigned int kMaxBatch = driverpars::MAX_WRITE_SIZE / 4;
+
+// most time units bucketed at once, bounds memory for large horizons
+constexpr BDTime kMaxBuckets = 4096;
+
+}  // anonymous namespace
+
+SpikeTrainGenerator::SpikeTrainGenerator(
+    MutexBuffer<EncInput> *out_buf,
+    const bdpars::BDPars *bd_pars,
+    std::function<BDTime()> get_fpga_time,
+    uint8_t ep_code,
+    BDTime window_units,
+    unsigned int seed,
+    unsigned int poll_us)
+  : Xcoder(),
+  out_buf_(out_buf),
+  bd_pars_(bd_pars),
+  get_fpga_time_(get_fpga_time),
+  ep_code_(ep_code),
+  poll_us_(poll_us),
+  window_units_(window_units),
+  next_unit_(0),
+  rng_(seed),
+  exp_dist_(1.0) {
+  stats_.fpga_time       = 0;
+  stats_.generated_until = 0;
+  stats_.lead            = 0;
+  stats_.num_generated   = 0;
+  stats_.num_active      = 0;
+}
+
+void SpikeTrainGenerator::SetWindow(BDTime window_units) {
+  std::unique_lock<std::mutex> ulock(lock_);
+  window_units_ = window_units;
+  trains_added_.notify_all();
+}
+
+BDTime SpikeTrainGenerator::GetWindow() {
+  std::unique_lock<std::mutex> ulock(lock_);
+  return window_units_;
+}
+
+unsigned int SpikeTrainGenerator::AddTrain(
+    unsigned int core_id,
+    uint32_t tag_word,
+    SpikeTrainType type,
+    const std::vector<BDTime> &times,
+    const std::vector<double> &rates,
+    BDTime stop_time) {
+
+  assert(times.size() > 0 && times.size() == rates.size());
+  assert(std::is_sorted(times.begin(), times.end()));
+
+  std::unique_lock<std::mutex> ulock(lock_);
+
+  Train train;
+  train.core_id   = core_id;
+  train.tag_word  = tag_word;
+  train.poisson   = type == SpikeTrainType::POISSON;
+  train.times     = times;
+  train.rates     = rates;
+  train.stop_time = stop_time;
+  train.bin       = 0;
+  train.t         = times[0];
+
+  // don't generate spikes that are already late, or in units that have already been sent
+  const BDTime start = std::max(stats_.fpga_time, next_unit_);
+  if (train.t < start) {
+    train.t = start;
+    while (train.bin + 1 < times.size() && times[train.bin + 1] <= train.t) {
+      train.bin++;
+    }
+  }
+
+  unsigned int train_idx = trains_.size();
+  trains_.push_back(std::move(train));
+
+  if (Advance(&trains_.back())) {
+    waiting_.push_back(train_idx);
+    stats_.num_active++;
+  }
+
+  trains_added_.notify_all();
+  return train_idx;
+}
+
+void SpikeTrainGenerator::Clear() {
+  std::unique_lock<std::mutex> ulock(lock_);
+  trains_.clear();
+  waiting_.clear();
+  stats_.num_active = 0;
+}
+
+SpikeTrainGeneratorStats SpikeTrainGenerator::GetStats() {
+  std::unique_lock<std::mutex> ulock(lock_);
+  return stats_;
+}
+
+bool SpikeTrainGenerator::Advance(Train *train) {
+  // the next spike comes when the integrated rate since the last one reaches a threshold:
+  // 1 for regular trains, exponentially distributed for Poisson trains.
+  // Walk through the rate table until it does
+  double remaining = train->poisson ? exp_dist_(rng_) : 1.0;
+
+  while (true) {
+    double bin_end = train->bin + 1 < train->times.size() ?
+        std::min(train->times[train->bin + 1], train->stop_time)
+      : train->stop_time;
+    double rate = train->rates[train->bin];
+
+    if (rate > 0) {
+      double t_next = train->t + remaining / rate;
+      if (t_next < bin_end) {
+        train->t = t_next;
+        return true;
+      }
+      remaining -= rate * (bin_end - train->t);
+    }
+
+    train->t = bin_end;
+    if (train->t >= train->stop_time || train->bin + 1 >= train->times.size()) {
+      return false;
+    }
+    train->bin++;
+  }
+}
+
+unsigned int SpikeTrainGenerator::GenerateUntil(BDTime horizon) {
+  std::unique_lock<std::mutex> ulock(lock_);
+  return Generate(horizon);
+}
+
+unsigned int SpikeTrainGenerator::GenerateInto(BDTime fpga_time, BDTime horizon, std::vector<EncInput> *out) {
+  std::unique_lock<std::mutex> ulock(lock_);
+  stats_.fpga_time = fpga_time;
+  if (stats_.num_active == 0) {
+    // nothing to walk through. Trains added later can still spike anywhere up to
+    // <horizon>, the feeder merges them like Append()ed inputs, but not in the past
+    next_unit_ = std::max(next_unit_, fpga_time);
+    if (next_unit_ > 0) stats_.generated_until = next_unit_ - 1;
+    stats_.lead = static_cast<int64_t>(stats_.generated_until) - static_cast<int64_t>(fpga_time);
+    return 0;
+  }
+  return Generate(horizon, out);
+}
+
+unsigned int SpikeTrainGenerator::Generate(BDTime horizon, std::vector<EncInput> *out) {
+  unsigned int num_generated = 0;
+
+  // without <out>, spikes are pushed to the encoder in batches
+  const bool push = out == nullptr;
+  std::unique_ptr<std::vector<EncInput>> to_send;
+  if (push) {
+    to_send = std::make_unique<std::vector<EncInput>>();
+    to_send->reserve(kMaxBatch + 2 * bd_pars_->NumCores + 1); // room for Encoder::AppendFlush()
+    out = to_send.get();
+  }
+
+  while (next_unit_ <= horizon) {
+    const BDTime first = next_unit_;
+    const BDTime last = std::min(horizon, first + kMaxBuckets - 1);
+
+    buckets_.resize(last - first + 1);
+    for (auto &it : buckets_) it.clear();
+
+    // bucket the trains that spike in [first, last]. Trains added since the last
+    // call may be behind, they go out at <first>
+    unsigned int num_waiting = 0;
+    for (auto idx : waiting_) {
+      BDTime unit = static_cast<BDTime>(trains_[idx].t);
+      if (unit <= last) {
+        buckets_[unit > first ? unit - first : 0].push_back(idx);
+      } else {
+        waiting_[num_waiting++] = idx;
+      }
+    }
+    waiting_.resize(num_waiting);
+
+    for (BDTime unit = first; unit <= last; unit++) {
+      std::vector<unsigned int> &bucket = buckets_[unit - first];
+      // trains may spike again in the same unit, bucket can grow while we go
+      for (unsigned int i = 0; i < bucket.size(); i++) {
+        unsigned int idx = bucket[i];
+        Train &train = trains_[idx];
+
+        // the last batch always gets a spike, see below
+        if (push && to_send->size() == kMaxBatch) {
+          out_buf_->Push(std::move(to_send));
+          to_send = std::make_unique<std::vector<EncInput>>();
+          to_send->reserve(kMaxBatch + 2 * bd_pars_->NumCores + 1);
+          out = to_send.get();
+        }
+
+        EncInput spike;
+        spike.core_id      = train.core_id;
+        spike.FPGA_ep_code = ep_code_;
+        spike.payload      = train.tag_word;
+        spike.time         = unit;
+        spike.sequence_num = 0;
+        out->push_back(spike);
+        num_generated++;
+
+        if (Advance(&train)) {
+          // a train that was behind can still be, its next spike goes out at <unit> too
+          BDTime next = std::max(static_cast<BDTime>(train.t), unit);
+          if (next <= last) {
+            buckets_[next - first].push_back(idx);
+          } else {
+            waiting_.push_back(idx);
+          }
+        } else {
+          stats_.num_active--;
+        }
+      }
+    }
+
+    next_unit_ = last + 1;
+  }
+
+  if (push && num_generated > 0) {
+    // finish the block so the spikes go out now. Its phantom words
+    // take the last spike's time, so to_send can't be empty here
+    Encoder::AppendFlush(to_send.get(), bd_pars_);
+    out_buf_->Push(std::move(to_send));
+  }
+
+  stats_.num_generated += num_generated;
+  if (next_unit_ > 0) stats_.generated_until = next_unit_ - 1;
+  stats_.lead = static_cast<int64_t>(stats_.generated_until) - static_cast<int64_t>(stats_.fpga_time);
+
+  return num_generated;
+}
+
+void SpikeTrainGenerator::RunOnce() {
+  BDTime fpga_time = get_fpga_time_();
+
+  std::unique_lock<std::mutex> ulock(lock_);
+
+  stats_.fpga_time = fpga_time;
+  if (stats_.num_active > 0) {
+    Generate(fpga_time + window_units_);
+  }
+
+  // FPGA time only advances with upstream HBs, no point in spinning.
+  // AddTrain() and SetWindow() wake us early.
+  trains_added_.wait_for(ulock, std::chrono::microseconds(poll_us_));
+}
+
+}  // bddriver
+}  // pystorm
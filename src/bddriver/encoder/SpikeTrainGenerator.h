@@ -0,0 +1,141 @@
+#ifndef SPIKETRAINGENERATOR_H
+#define SPIKETRAINGENERATOR_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "common/BDPars.h"
+#include "common/DriverPars.h"
+#include "common/DriverTypes.h"
+#include "common/MutexBuffer.h"
+#include "common/Xcoder.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// Interspike interval statistics of a generated spike train
+enum class SpikeTrainType {
+  REGULAR, /// one spike every 1/rate
+  POISSON  /// exponentially-distributed intervals with mean 1/rate
+};
+
+/// Progress of the generator, times in FPGA time units
+/// (Driver::GetSpikeTrainStats() converts them to ns)
+struct SpikeTrainGeneratorStats {
+  BDTime fpga_time;          /// last FPGA time the generator saw
+  BDTime generated_until;    /// spikes have been generated up to this time
+  int64_t lead;              /// generated_until - fpga_time
+  uint64_t num_generated;    /// spikes handed to the encoder
+  unsigned int num_active;   /// trains that haven't reached their stop time
+};
+
+/// SpikeTrainGenerator synthesizes input tag spike trains on the host, for when the
+/// FPGA's spike generators aren't enough: there are only 256 of them, and they only
+/// make regular trains.
+///
+/// Each train emits one tag word at a time-varying rate, given as a piecewise-constant
+/// rate table. Trains can be regular or Poisson (inhomogeneous, if the rate changes).
+/// Spikes are generated in time order, a window ahead of the FPGA time, and pushed
+/// straight to the encoder as timed EncInputs. Or, with GenerateInto() as a
+/// TimedFeeder's Source, released by the feeder along with its schedule.
+///
+/// Spawns its own thread (not needed when a feeder drives it).
+class SpikeTrainGenerator : public Xcoder {
+ public:
+  SpikeTrainGenerator(
+      MutexBuffer<EncInput> *out_buf,
+      const bdpars::BDPars *bd_pars,
+      std::function<BDTime()> get_fpga_time,
+      uint8_t ep_code,
+      BDTime window_units,
+      unsigned int seed = 0,
+      unsigned int poll_us = driverpars::FEEDER_POLL_US);
+
+  ~SpikeTrainGenerator() {};
+
+  /// Set how many FPGA time units of spikes may be generated ahead of the FPGA
+  void SetWindow(BDTime window_units);
+  BDTime GetWindow();
+
+  /// Add a spike train emitting <tag_word> to core <core_id>.
+  /// The rate is <rates>[i] spikes per time unit from <times>[i] until <times>[i+1],
+  /// the last rate holds until <stop_time>. <times> must be increasing.
+  /// If the train should have started already, it starts at the current FPGA time,
+  /// or after the spikes already generated, if that's later.
+  /// Returns the train's index
+  unsigned int AddTrain(
+      unsigned int core_id,
+      uint32_t tag_word,
+      SpikeTrainType type,
+      const std::vector<BDTime> &times,
+      const std::vector<double> &rates,
+      BDTime stop_time);
+
+  /// Stop and forget all trains
+  void Clear();
+
+  /// Generate every spike up to and including <horizon>, and push them to the encoder.
+  /// Called by the generator's thread with horizon = FPGA time + window.
+  /// Returns the number of spikes generated
+  unsigned int GenerateUntil(BDTime horizon);
+
+  /// Append every spike up to and including <horizon> to <out> instead, with no flush,
+  /// <fpga_time> being the FPGA time the horizon is from. Returns the number of spikes generated
+  unsigned int GenerateInto(BDTime fpga_time, BDTime horizon, std::vector<EncInput> *out);
+
+  SpikeTrainGeneratorStats GetStats();
+
+ private:
+  struct Train {
+    unsigned int core_id;
+    uint32_t tag_word;
+    bool poisson;
+    std::vector<BDTime> times;
+    std::vector<double> rates;
+    BDTime stop_time;
+    unsigned int bin; /// rate table entry we're in
+    double t;         /// time of the last spike (or the start)
+  };
+
+  MutexBuffer<EncInput> *out_buf_;
+  const bdpars::BDPars *bd_pars_;
+  std::function<BDTime()> get_fpga_time_;
+  const uint8_t ep_code_;
+  const unsigned int poll_us_;
+
+  std::mutex lock_;
+  std::condition_variable trains_added_;
+
+  BDTime window_units_;
+  std::vector<Train> trains_;
+
+  /// Spikes are emitted at whole time units, so instead of sorting spikes, trains are
+  /// bucketed by the time unit of their next spike. Generate() works through
+  /// <buckets_>[i] = trains spiking in unit next_unit_ + i. Trains whose next spike
+  /// is past what's being generated wait in <waiting_>
+  std::vector<std::vector<unsigned int>> buckets_;
+  std::vector<unsigned int> waiting_;
+  BDTime next_unit_; /// first time unit that hasn't been generated
+
+  std::mt19937_64 rng_;
+  std::exponential_distribution<double> exp_dist_;
+
+  SpikeTrainGeneratorStats stats_;
+
+  /// move <train> to its next spike, false if it stops first. Call with lock_ held
+  bool Advance(Train *train);
+
+  /// GenerateUntil(), or GenerateInto() if <out> isn't nullptr, with lock_ held
+  unsigned int Generate(BDTime horizon, std::vector<EncInput> *out = nullptr);
+
+  void RunOnce();
+};
+
+}  // bddriver
+}  // pystorm
+
+#endif
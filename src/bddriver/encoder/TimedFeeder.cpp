@@ -0,0 +1,276 @@
+#include "TimedFeeder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "Encoder.h"
+#include "common/DriverPars.h"
+#include "common/DriverTypes.h"
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace pystorm {
+namespace bddriver {
+
+constexpr char TimedFeeder::kFileMagic[4];
+constexpr uint32_t TimedFeeder::kFileVersion;
+
+namespace {
+
+// on-disk record, host byte order:
+// [ time (8B) | payload (4B) | ep_code (1B) | core_id (1B) | unused (2B) ]
+constexpr unsigned int kRecordBytes = 16;
+
+void PackRecord(const EncInput &in, char *rec) {
+  uint64_t time    = in.time;
+  uint32_t payload = in.payload;
+  uint8_t ep_code  = in.FPGA_ep_code;
+  uint8_t core_id  = static_cast<uint8_t>(in.core_id);
+  std::memset(rec, 0, kRecordBytes);
+  std::memcpy(rec + 0, &time, 8);
+  std::memcpy(rec + 8, &payload, 4);
+  std::memcpy(rec + 12, &ep_code, 1);
+  std::memcpy(rec + 13, &core_id, 1);
+}
+
+EncInput UnpackRecord(const char *rec) {
+  uint64_t time;
+  uint32_t payload;
+  uint8_t ep_code;
+  uint8_t core_id;
+  std::memcpy(&time, rec + 0, 8);
+  std::memcpy(&payload, rec + 8, 4);
+  std::memcpy(&ep_code, rec + 12, 1);
+  std::memcpy(&core_id, rec + 13, 1);
+
+  EncInput out;
+  out.core_id      = core_id;
+  out.FPGA_ep_code = ep_code;
+  out.payload      = payload;
+  out.time         = time;
+  out.sequence_num = 0;
+  return out;
+}
+
+// merging ignores sequence_num: it restarts with every Flush(), and same-time words
+// from one batch (e.g. the 4 words of an SG program) have to stay together
+bool EarlierThan(const EncInput &a, const EncInput &b) { return a.time < b.time; }
+
+}  // anonymous namespace
+
+TimedFeeder::TimedFeeder(
+    MutexBuffer<EncInput> *out_buf,
+    const bdpars::BDPars *bd_pars,
+    std::function<BDTime()> get_fpga_time,
+    BDTime window_units,
+    unsigned int poll_us)
+  : Xcoder(),
+  out_buf_(out_buf),
+  bd_pars_(bd_pars),
+  get_fpga_time_(get_fpga_time),
+  poll_us_(poll_us),
+  window_units_(window_units),
+  file_read_until_(0) {
+  ResetStats();
+}
+
+void TimedFeeder::SetWindow(BDTime window_units) {
+  std::unique_lock<std::mutex> ulock(lock_);
+  window_units_ = window_units;
+  just_appended_.notify_all();
+}
+
+BDTime TimedFeeder::GetWindow() {
+  std::unique_lock<std::mutex> ulock(lock_);
+  return window_units_;
+}
+
+void TimedFeeder::Append(std::vector<EncInput> inputs) {
+  if (inputs.size() == 0) return;
+
+  std::unique_lock<std::mutex> ulock(lock_);
+  Merge(inputs);
+  just_appended_.notify_all();
+}
+
+void TimedFeeder::SetSource(Source source) {
+  std::unique_lock<std::mutex> ulock(lock_);
+  source_ = source;
+  just_appended_.notify_all();
+}
+
+void TimedFeeder::Merge(const std::vector<EncInput> &inputs) {
+  if (schedule_.empty() || !EarlierThan(inputs.front(), schedule_.back())) {
+    // common case, the new inputs come after everything scheduled
+    schedule_.insert(schedule_.end(), inputs.begin(), inputs.end());
+  } else {
+    std::deque<EncInput> merged;
+    std::merge(schedule_.begin(), schedule_.end(), inputs.begin(), inputs.end(),
+        std::back_inserter(merged), EarlierThan);
+    schedule_.swap(merged);
+  }
+}
+
+bool TimedFeeder::OpenScheduleFile(const std::string &filename, BDTime *ns_per_unit) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    cout << "WARNING: TimedFeeder: couldn't open schedule file " << filename << endl;
+    return false;
+  }
+
+  char magic[4];
+  uint32_t version;
+  uint64_t file_ns_per_unit;
+  file.read(magic, 4);
+  file.read(reinterpret_cast<char *>(&version), sizeof(version));
+  file.read(reinterpret_cast<char *>(&file_ns_per_unit), sizeof(file_ns_per_unit));
+
+  if (!file.good() || std::memcmp(magic, kFileMagic, 4) != 0 || version != kFileVersion) {
+    cout << "WARNING: TimedFeeder: " << filename << " is not a timed input schedule file (version " << kFileVersion << ")" << endl;
+    return false;
+  }
+
+  *ns_per_unit = file_ns_per_unit;
+
+  std::unique_lock<std::mutex> ulock(lock_);
+  if (file_.is_open()) {
+    cout << "WARNING: TimedFeeder: already streaming from a file, closing it" << endl;
+    file_.close();
+  }
+  file_.swap(file);
+  file_read_until_ = 0;
+  stats_.file_open = true;
+  just_appended_.notify_all();
+  return true;
+}
+
+bool TimedFeeder::WriteScheduleFile(const std::string &filename, const std::vector<EncInput> &inputs, BDTime ns_per_unit) {
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    cout << "WARNING: TimedFeeder: couldn't open " << filename << " for writing" << endl;
+    return false;
+  }
+
+  uint64_t file_ns_per_unit = ns_per_unit;
+  file.write(kFileMagic, 4);
+  file.write(reinterpret_cast<const char *>(&kFileVersion), sizeof(kFileVersion));
+  file.write(reinterpret_cast<const char *>(&file_ns_per_unit), sizeof(file_ns_per_unit));
+
+  char rec[kRecordBytes];
+  for (auto &it : inputs) {
+    PackRecord(it, rec);
+    file.write(rec, kRecordBytes);
+  }
+  return file.good();
+}
+
+void TimedFeeder::Clear() {
+  std::unique_lock<std::mutex> ulock(lock_);
+  schedule_.clear();
+  if (file_.is_open()) file_.close();
+  stats_.file_open = false;
+  stats_.num_pending = 0;
+}
+
+TimedFeederStats TimedFeeder::GetStats() {
+  std::unique_lock<std::mutex> ulock(lock_);
+  stats_.num_pending = schedule_.size();
+  return stats_;
+}
+
+void TimedFeeder::ResetStats() {
+  std::unique_lock<std::mutex> ulock(lock_);
+  stats_.fpga_time      = 0;
+  stats_.released_until = 0;
+  stats_.lead           = 0;
+  stats_.max_lead       = 0;
+  stats_.max_lag        = 0;
+  stats_.num_released   = 0;
+  stats_.num_pending    = schedule_.size();
+  stats_.file_open      = file_.is_open();
+}
+
+void TimedFeeder::ReadFromFile(BDTime horizon) {
+  // read until we've read one record past the horizon, a chunk at a time so we don't
+  // sit on the lock for too long. Goes by what was read, not schedule_.back(): inputs
+  // Append()ed far ahead would otherwise stop the file
+  char rec[kRecordBytes];
+  unsigned int num_read = 0;
+  while (num_read < driverpars::FEEDER_FILE_CHUNK && file_read_until_ <= horizon) {
+    file_.read(rec, kRecordBytes);
+    if (!file_.good()) {
+      file_.close();
+      stats_.file_open = false;
+      return;
+    }
+
+    EncInput in = UnpackRecord(rec);
+    file_read_until_ = in.time;
+    if (!schedule_.empty() && EarlierThan(in, schedule_.back())) {
+      // file is supposed to be sorted, but inputs Append()ed meanwhile may not be
+      auto pos = std::upper_bound(schedule_.begin(), schedule_.end(), in, EarlierThan);
+      schedule_.insert(pos, in);
+    } else {
+      schedule_.push_back(in);
+    }
+    num_read++;
+  }
+}
+
+void TimedFeeder::RunOnce() {
+  BDTime fpga_time = get_fpga_time_();
+
+  std::unique_lock<std::mutex> ulock(lock_);
+
+  BDTime horizon = fpga_time + window_units_;
+  stats_.fpga_time = fpga_time;
+
+  if (file_.is_open()) {
+    ReadFromFile(horizon);
+  }
+
+  // the source's inputs go out with the schedule's, so the encoder's stream stays in time order
+  if (source_) {
+    std::vector<EncInput> from_source;
+    source_(fpga_time, horizon, &from_source);
+    if (from_source.size() > 0) Merge(from_source);
+  }
+
+  auto to_send = std::make_unique<std::vector<EncInput>>();
+  while (!schedule_.empty() && schedule_.front().time <= horizon) {
+    const EncInput &next = schedule_.front();
+
+    int64_t lag = static_cast<int64_t>(fpga_time) - static_cast<int64_t>(next.time);
+    if (lag > stats_.max_lag) stats_.max_lag = lag;
+
+    stats_.released_until = next.time;
+    to_send->push_back(next);
+    schedule_.pop_front();
+  }
+
+  if (to_send->size() > 0) {
+    stats_.num_released += to_send->size();
+    stats_.lead = static_cast<int64_t>(stats_.released_until) - static_cast<int64_t>(fpga_time);
+    if (stats_.lead > stats_.max_lead) stats_.max_lead = stats_.lead;
+
+    // finish the block so the inputs go out now
+    Encoder::AppendFlush(to_send.get(), bd_pars_);
+
+    out_buf_->Push(std::move(to_send));
+  }
+
+  // FPGA time only advances with upstream HBs, no point in spinning.
+  // Append() and SetWindow() wake us early.
+  just_appended_.wait_for(ulock, std::chrono::microseconds(poll_us_));
+}
+
+}  // bddriver
+}  // pystorm
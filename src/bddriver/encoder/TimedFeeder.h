@@ -0,0 +1,120 @@
+#ifndef TIMEDFEEDER_H
+#define TIMEDFEEDER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/BDPars.h"
+#include "common/DriverPars.h"
+#include "common/DriverTypes.h"
+#include "common/MutexBuffer.h"
+#include "common/Xcoder.h"
+
+namespace pystorm {
+namespace bddriver {
+
+/// How far the feeder is running ahead of (or behind) the FPGA.
+/// Times are in FPGA time units (Driver::GetStreamStats() converts them to ns).
+/// Lead is (last released input time - FPGA time): positive means the feeder
+/// is ahead, negative means it's behind.
+struct TimedFeederStats {
+  BDTime fpga_time;          /// last FPGA time the feeder saw
+  BDTime released_until;     /// time of the last input released to the encoder
+  int64_t lead;              /// released_until - fpga_time at the last release
+  int64_t max_lead;          /// largest lead seen since the last ResetStats()
+  int64_t max_lag;           /// largest (fpga_time - input time) seen at release, i.e. how late inputs went out
+  uint64_t num_released;     /// inputs handed to the encoder
+  uint64_t num_pending;      /// inputs held in memory, not counting what's left in a schedule file
+  bool file_open;            /// whether inputs are still being read from a schedule file
+};
+
+/// TimedFeeder streams a time-ordered schedule of EncInputs to the encoder, keeping
+/// only <window> time units of inputs ahead of the observed FPGA time.
+///
+/// Pushing an entire experiment's timed traffic with Flush() stalls the FPGA's downstream
+/// queue until each input's time comes, which also blocks any untimed traffic behind it.
+/// The feeder holds the schedule in host memory (or reads it lazily from a file) instead,
+/// so both host memory and FPGA queue occupancy stay bounded. A Source (see SetSource())
+/// is released along with the schedule, in time order.
+///
+/// Spawns its own thread.
+class TimedFeeder : public Xcoder {
+ public:
+  /// file format: header, then one record per EncInput, see OpenScheduleFile()
+  static constexpr char kFileMagic[4] = {'B', 'D', 'T', 'I'};
+  static constexpr uint32_t kFileVersion = 1;
+
+  TimedFeeder(
+      MutexBuffer<EncInput> *out_buf,
+      const bdpars::BDPars *bd_pars,
+      std::function<BDTime()> get_fpga_time,
+      BDTime window_units,
+      unsigned int poll_us = driverpars::FEEDER_POLL_US);
+
+  ~TimedFeeder() {};
+
+  /// Set how many FPGA time units of inputs may be released ahead of the FPGA
+  void SetWindow(BDTime window_units);
+  BDTime GetWindow();
+
+  /// Add sorted inputs to the schedule.
+  /// Inputs that belong before what's already scheduled are merged in.
+  void Append(std::vector<EncInput> inputs);
+
+  /// Stream inputs from a schedule file (written by WriteScheduleFile()).
+  /// Returns false and leaves the feeder alone if the file can't be read.
+  /// <ns_per_unit> is set to the time unit the schedule was written with.
+  bool OpenScheduleFile(const std::string &filename, BDTime *ns_per_unit);
+
+  /// Write sorted inputs to a schedule file, returns false on failure
+  static bool WriteScheduleFile(const std::string &filename, const std::vector<EncInput> &inputs, BDTime ns_per_unit);
+
+  /// Another producer of timed inputs, e.g. a SpikeTrainGenerator. Each poll, the feeder has it
+  /// append its sorted inputs up to the horizon to <out>, given the FPGA time, and merges them
+  /// into the schedule. Both go to the encoder as one time-ordered stream
+  typedef std::function<void(BDTime fpga_time, BDTime horizon, std::vector<EncInput> *out)> Source;
+  /// Set the source, an empty Source removes it
+  void SetSource(Source source);
+
+  /// Drop everything that hasn't been released yet (and close any file)
+  void Clear();
+
+  TimedFeederStats GetStats();
+  void ResetStats();
+
+ private:
+  MutexBuffer<EncInput> *out_buf_;
+  const bdpars::BDPars *bd_pars_;
+  std::function<BDTime()> get_fpga_time_;
+  const unsigned int poll_us_;
+
+  std::mutex lock_;
+  std::condition_variable just_appended_;
+
+  BDTime window_units_;
+  std::deque<EncInput> schedule_;
+  Source source_;
+  std::ifstream file_;
+  BDTime file_read_until_; /// time of the last input read from file_
+
+  TimedFeederStats stats_;
+
+  /// merge sorted <inputs> into schedule_, call with lock_ held
+  void Merge(const std::vector<EncInput> &inputs);
+
+  /// refill schedule_ from file_ so that it covers <horizon>, call with lock_ held
+  void ReadFromFile(BDTime horizon);
+
+  void RunOnce();
+};
+
+}  // bddriver
+}  // pystorm
+
+#endif
@@ -26,7 +26,7 @@ BDModel::~BDModel() { delete state_; }
 void BDModel::ParseInput(const std::vector<uint8_t>& input_stream) {
   //cout << "in ParseInput" << endl;
 
-  std::unique_lock<std::mutex>(mutex_);
+  std::unique_lock<std::mutex> ulock(mutex_);
 
   // pack uint8_t stream into uint32_ts
   std::vector<uint32_t> BD_input_words = FPGAInput(input_stream, bd_pars_);
@@ -66,7 +66,7 @@ void BDModel::ParseInput(const std::vector<uint8_t>& input_stream) {
 std::vector<uint8_t> BDModel::GenerateOutputs() {
   //cout << "in GenerateOutputs" << endl;
 
-  std::unique_lock<std::mutex>(mutex_);
+  std::unique_lock<std::mutex> ulock(mutex_);
 
   // serialize words like FPGA
   std::unordered_map<uint8_t, std::vector<uint32_t>> ser_ep_words;
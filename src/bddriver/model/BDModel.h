@@ -23,6 +23,8 @@ class BDModel {
   BDModel(const bdpars::BDPars* bd_pars);
   ~BDModel();
 
+  inline const bdpars::BDPars* GetBDPars() const { return bd_pars_; }
+
   /// parse input stream to update internal BDState object and other state
   void ParseInput(const std::vector<uint8_t>& input_stream);
   /// given internal state, generate requested output stream
@@ -30,10 +32,20 @@ class BDModel {
 
   // calls that will cause the model to emit some traffic, exercising upstream driver calls
   inline void PushOutput(uint8_t ep, const std::vector<BDWord> & to_append) {
-      std::unique_lock<std::mutex>(mutex_);
+      std::unique_lock<std::mutex> ulock(mutex_);
       to_send_.at(ep).insert(to_send_.at(ep).end(), to_append.begin(), to_append.end()); 
   }
 
+  /// whether pushed outputs are still waiting for GenerateOutputs().
+  /// Outputs that go out together aren't kept in the order they were pushed in
+  inline bool HasPendingOutputs() {
+      std::unique_lock<std::mutex> ulock(mutex_);
+      for (auto& it : to_send_) {
+        if (it.second.size() > 0) return true;
+      }
+      return false;
+  }
+
   // calls to retrieve the results of downstream driver calls
 
   /// lock the model, get a const ptr to the state, examine it as you like...
@@ -47,13 +59,13 @@ class BDModel {
   // XXX alternative to these two calls would be GetState which would create a copy of the state, return that
 
   inline std::vector<BDWord> PopSpikes() 
-    { std::unique_lock<std::mutex>(mutex_); 
+    { std::unique_lock<std::mutex> ulock(mutex_); 
       std::vector<BDWord> recvd = std::move(received_spikes_);
       received_spikes_.clear();
       return recvd; }
 
   inline std::vector<BDWord> PopTags() 
-    { std::unique_lock<std::mutex>(mutex_); 
+    { std::unique_lock<std::mutex> ulock(mutex_); 
       std::vector<BDWord> recvd = std::move(received_tags_);
       received_tags_.clear();
       return recvd; }
@@ -1,6 +1,8 @@
 #ifndef BDMODELDRIVER_H
 #define BDMODELDRIVER_H
 
+#include <vector>
+
 #include "Driver.h"
 #include "BDModel.h"
 #include "comm/CommBDModel.h"
@@ -15,22 +17,28 @@ namespace bddriver {
 class BDModelDriver : public Driver {
 
  private:
-   bdmodel::BDModel * model_;
+   std::vector<bdmodel::BDModel *> models_; /// one per core
 
  public: 
-  BDModelDriver() : Driver() {
+  BDModelDriver(unsigned int num_cores = 1) : Driver(num_cores) {
 
-    model_ = new bdmodel::BDModel(GetBDPars());
+    for (unsigned int i = 0; i < num_cores; i++) {
+      models_.push_back(new bdmodel::BDModel(GetBDPars()));
+    }
 
     delete comm_;
     comm_ = new comm::CommBDModel( // overwrite comm_ assignment from base constructor
-        model_,
+        models_,
         dec_buf_in_,
         enc_buf_out_);
   }
-  ~BDModelDriver() { delete model_; }
+  ~BDModelDriver() {
+    for (auto& it : models_) {
+      delete it;
+    }
+  }
 
-  inline bdmodel::BDModel * GetBDModel() { return model_; }
+  inline bdmodel::BDModel * GetBDModel(unsigned int core_id = 0) { return models_.at(core_id); }
 };
 
 }  // bddriver namespace
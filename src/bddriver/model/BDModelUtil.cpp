@@ -57,7 +57,7 @@ std::vector<BDWord> DeserializeEP(const std::vector<uint32_t>& inputs, unsigned
     }
   } else if (D == 2) {
     // we shouldn't have to worry about remainders with BDModel
-    // use a VectorDeserializer anyway so we can copy-paste from RecvFromEP
+    // use a VectorDeserializer anyway
     // XXX should maybe figure out a way to reuse this code better
     VectorDeserializer<uint32_t> deserializer(2);
 
@@ -27,7 +27,7 @@ std::vector<BDWord> DeserializeEP(const std::vector<uint32_t>& inputs, unsigned
 ////////////////////////////////////////
 // downstream functions
 
-/// Does inverse of RecvFromEP's deserialization (looks like SendToEP)
+/// Does inverse of the Decoder's two-word reassembly (looks like SendToEP)
 std::vector<uint32_t> SerializeEP(const std::vector<BDWord>& inputs, unsigned int D);
 
 /// Does inverse of Decoder byte-packing (looks like Encoder)
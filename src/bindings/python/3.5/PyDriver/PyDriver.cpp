@@ -9,6 +9,10 @@
 #undef B0
 #include <Driver.h>
 #include <model/BDModelDriver.h>
+#include <comm/ReplayDriver.h>
+#include <comm/SyntheticDriver.h>
+#include <DriverManager.h>
+#include <daemon/DriverClient.h>
 
 // for brevity, we're not writing new code so there should be no danger of namespace collision
 namespace py = pybind11;
@@ -220,10 +224,12 @@ void bind_unknown_unknown(std::function< py::module &(std::string const &namespa
   { // pystorm::bddriver::bdpars::BDPars file: line:247
     py::class_<pystorm::bddriver::bdpars::BDPars> cl(M("pystorm::bddriver::bdpars"), "BDPars", "BDPars holds all the nitty-gritty information about the BD hardware's parameters.\n\n BDPars contains several array data members containing structs, keyed by enums.\n The enums refer to particular hardware elements or concepts, such as the name of a memory,\n register, or a particular type of programming word.\n BDPars is fully public, but Driver only has a const reference.");
     cl.def(py::init<>());
+    cl.def(py::init<unsigned int>(), py::arg("num_cores"));
 
     cl.def(py::init<const class pystorm::bddriver::bdpars::BDPars &>(), py::arg(""));
 
-    cl.def_readonly_static("NumCores", &pystorm::bddriver::bdpars::BDPars::NumCores);
+    cl.def_readonly("NumCores", &pystorm::bddriver::bdpars::BDPars::NumCores);
+    cl.def_readonly_static("MaxCores", &pystorm::bddriver::bdpars::BDPars::MaxCores);
     cl.def_readonly_static("DnEPFPGARegOffset", &pystorm::bddriver::bdpars::BDPars::DnEPFPGARegOffset);
     cl.def_readonly_static("DnEPFPGANumReg", &pystorm::bddriver::bdpars::BDPars::DnEPFPGANumReg);
     cl.def_readonly_static("DnEPFPGAChannelOffset", &pystorm::bddriver::bdpars::BDPars::DnEPFPGAChannelOffset);
@@ -234,7 +240,15 @@ void bind_unknown_unknown(std::function< py::module &(std::string const &namespa
     cl.def_readonly_static("DnTimeUnitsPerHB", &pystorm::bddriver::bdpars::BDPars::DnTimeUnitsPerHB);
     cl.def_readwrite("Dn_EP_size_", &pystorm::bddriver::bdpars::BDPars::Dn_EP_size_);
     cl.def_readwrite("Up_EP_size_", &pystorm::bddriver::bdpars::BDPars::Up_EP_size_);
-    cl.def_readwrite("mem_info_", &pystorm::bddriver::bdpars::BDPars::mem_info_);
+    // mem_info_ is a dense array keyed by BDMemId, present it as a dict
+    cl.def_property_readonly("mem_info_", [](const pystorm::bddriver::bdpars::BDPars &o) {
+      std::map<pystorm::bddriver::bdpars::BDMemId, pystorm::bddriver::bdpars::MemInfo> m;
+      for (unsigned int i = 0; i < o.mem_info_.size(); i++) {
+        auto id = static_cast<pystorm::bddriver::bdpars::BDMemId>(i);
+        m[id] = o.mem_info_[id];
+      }
+      return m;
+    });
     cl.def("DnEPCodeFor", (unsigned char (pystorm::bddriver::bdpars::BDPars::*)(pystorm::bddriver::bdpars::BDHornEP) const) &pystorm::bddriver::bdpars::BDPars::DnEPCodeFor, "C++: pystorm::bddriver::bdpars::BDPars::DnEPCodeFor(pystorm::bddriver::bdpars::BDHornEP) const --> unsigned char", py::arg("ep"));
     cl.def("DnEPCodeFor", (unsigned char (pystorm::bddriver::bdpars::BDPars::*)(pystorm::bddriver::bdpars::FPGARegEP) const) &pystorm::bddriver::bdpars::BDPars::DnEPCodeFor, "C++: pystorm::bddriver::bdpars::BDPars::DnEPCodeFor(pystorm::bddriver::bdpars::FPGARegEP) const --> unsigned char", py::arg("ep"));
     cl.def("DnEPCodeFor", (unsigned char (pystorm::bddriver::bdpars::BDPars::*)(pystorm::bddriver::bdpars::FPGAChannelEP) const) &pystorm::bddriver::bdpars::BDPars::DnEPCodeFor, "C++: pystorm::bddriver::bdpars::BDPars::DnEPCodeFor(pystorm::bddriver::bdpars::FPGAChannelEP) const --> unsigned char", py::arg("ep"));
@@ -251,14 +265,14 @@ void bind_unknown_unknown(std::function< py::module &(std::string const &namespa
     cl.def("BDHornEPIsReg", (bool (pystorm::bddriver::bdpars::BDPars::*)(pystorm::bddriver::bdpars::BDHornEP) const) &pystorm::bddriver::bdpars::BDPars::BDHornEPIsReg, "C++: pystorm::bddriver::bdpars::BDPars::BDHornEPIsReg(pystorm::bddriver::bdpars::BDHornEP) const --> bool", py::arg("ep"));
     cl.def("GetBDRegs", (class std::vector<pystorm::bddriver::bdpars::BDHornEP, class std::allocator<pystorm::bddriver::bdpars::BDHornEP> > (pystorm::bddriver::bdpars::BDPars::*)() const) &pystorm::bddriver::bdpars::BDPars::GetBDRegs, "C++: pystorm::bddriver::bdpars::BDPars::GetBDRegs() const --> class std::vector<pystorm::bddriver::bdpars::BDHornEP, class std::allocator<pystorm::bddriver::bdpars::BDHornEP> >");
     cl.def("GetDACDefaultCount", &pystorm::bddriver::bdpars::BDPars::GetDACDefaultCount, "", py::arg("dac_signal_id"));
-    cl.def("GetMemAERAddr", (unsigned int (pystorm::bddriver::bdpars::BDPars::*)(unsigned int) const) &pystorm::bddriver::bdpars::BDPars::GetMemAERAddr, "Given flat xy_addr (addr scan along x then y) config memory (16-neuron tile) address, get AER address", py::arg("xy_addr"));
-    cl.def("GetMemAERAddr", (unsigned int (pystorm::bddriver::bdpars::BDPars::*)(unsigned int, unsigned int) const) &pystorm::bddriver::bdpars::BDPars::GetMemAERAddr, "Given x, y config memory (16-neuron tile) address, get AER address", py::arg("x"), py::arg("y"));
-    cl.def("GetSynAERAddr", (unsigned int (pystorm::bddriver::bdpars::BDPars::*)(unsigned int) const) &pystorm::bddriver::bdpars::BDPars::GetSynAERAddr, "Given flat xy_addr (addr scan along x then y) synapse address, get AER address", py::arg("xy_addr"));
-    cl.def("GetSynAERAddr", (unsigned int (pystorm::bddriver::bdpars::BDPars::*)(unsigned int, unsigned int) const) &pystorm::bddriver::bdpars::BDPars::GetSynAERAddr, "Given x, y synapse address, get AER address", py::arg("x"), py::arg("y"));
-    cl.def("GetSomaAERAddr", (unsigned int (pystorm::bddriver::bdpars::BDPars::*)(unsigned int) const) &pystorm::bddriver::bdpars::BDPars::GetSomaAERAddr, "Given flat xy_addr (addr scan along x then y) soma address, get AER address", py::arg("xy_addr"));
-    cl.def("GetSomaAERAddr", (unsigned int (pystorm::bddriver::bdpars::BDPars::*)(unsigned int, unsigned int) const) &pystorm::bddriver::bdpars::BDPars::GetSomaAERAddr, "Given x, y soma address, get AER address", py::arg("x"), py::arg("y"));
-    cl.def("GetSomaXYAddr", &pystorm::bddriver::bdpars::BDPars::GetSomaXYAddr, "Given AER synapse address, get flat xy_addr (y msb, x lsb)", py::arg("aer_addr"));
-    cl.def("GetSomaXYAddrs", &pystorm::bddriver::bdpars::BDPars::GetSomaXYAddrs, "Given AER synapse address, get flat xy_addr (y msb, x lsb)", py::arg("aer_addrs"));
+    cl.def_static("GetMemAERAddr", (unsigned int (*)(unsigned int)) &pystorm::bddriver::bdpars::BDPars::GetMemAERAddr, "Given flat xy_addr (addr scan along x then y) config memory (16-neuron tile) address, get AER address", py::arg("xy_addr"));
+    cl.def_static("GetMemAERAddr", (unsigned int (*)(unsigned int, unsigned int)) &pystorm::bddriver::bdpars::BDPars::GetMemAERAddr, "Given x, y config memory (16-neuron tile) address, get AER address", py::arg("x"), py::arg("y"));
+    cl.def_static("GetSynAERAddr", (unsigned int (*)(unsigned int)) &pystorm::bddriver::bdpars::BDPars::GetSynAERAddr, "Given flat xy_addr (addr scan along x then y) synapse address, get AER address", py::arg("xy_addr"));
+    cl.def_static("GetSynAERAddr", (unsigned int (*)(unsigned int, unsigned int)) &pystorm::bddriver::bdpars::BDPars::GetSynAERAddr, "Given x, y synapse address, get AER address", py::arg("x"), py::arg("y"));
+    cl.def_static("GetSomaAERAddr", (unsigned int (*)(unsigned int)) &pystorm::bddriver::bdpars::BDPars::GetSomaAERAddr, "Given flat xy_addr (addr scan along x then y) soma address, get AER address", py::arg("xy_addr"));
+    cl.def_static("GetSomaAERAddr", (unsigned int (*)(unsigned int, unsigned int)) &pystorm::bddriver::bdpars::BDPars::GetSomaAERAddr, "Given x, y soma address, get AER address", py::arg("x"), py::arg("y"));
+    cl.def_static("GetSomaXYAddr", &pystorm::bddriver::bdpars::BDPars::GetSomaXYAddr, "Given AER synapse address, get flat xy_addr (y msb, x lsb)", py::arg("aer_addr"));
+    cl.def_static("GetSomaXYAddrs", (std::vector<unsigned int> (*)(const std::vector<unsigned int>&)) &pystorm::bddriver::bdpars::BDPars::GetSomaXYAddrs, "Given AER synapse address, get flat xy_addr (y msb, x lsb)", py::arg("aer_addrs"));
   }
 }
 
@@ -287,11 +301,35 @@ void bind_unknown_unknown_2(std::function< py::module &(std::string const &names
     cl.def("AreTrafficRegsOff", (bool (pystorm::bddriver::BDState::*)() const) &pystorm::bddriver::BDState::AreTrafficRegsOff, "C++: pystorm::bddriver::BDState::AreTrafficRegsOff() const --> bool");
     cl.def("IsTrafficOff", (bool (pystorm::bddriver::BDState::*)() const) &pystorm::bddriver::BDState::IsTrafficOff, "is traffic_en == false for all traffic_regs_\n\nC++: pystorm::bddriver::BDState::IsTrafficOff() const --> bool");
     cl.def("WaitForTrafficOff", (void (pystorm::bddriver::BDState::*)() const) &pystorm::bddriver::BDState::WaitForTrafficOff, "has AreTrafficRegsOff been true for traffic_drain_us\n\nC++: pystorm::bddriver::BDState::WaitForTrafficOff() const --> void");
+    cl.def("IsMemValid", &pystorm::bddriver::BDState::IsMemValid, "whether mem_id[addr] has been programmed", py::arg("mem_id"), py::arg("addr"));
+    cl.def("GetNeuronConfigMem", (unsigned int (pystorm::bddriver::BDState::*)(unsigned int, unsigned int, unsigned int, pystorm::bddriver::bdpars::ConfigSomaID) const) &pystorm::bddriver::BDState::GetNeuronConfigMem, "Single config bit: 0 or 1, kConfigUnset if it hasn't been set", py::arg("core_id"), py::arg("tile_id"), py::arg("elem_id"), py::arg("config_type"));
+    cl.def("GetNeuronConfigMem", (unsigned int (pystorm::bddriver::BDState::*)(unsigned int, unsigned int, unsigned int, pystorm::bddriver::bdpars::ConfigSynapseID) const) &pystorm::bddriver::BDState::GetNeuronConfigMem, "Single config bit: 0 or 1, kConfigUnset if it hasn't been set", py::arg("core_id"), py::arg("tile_id"), py::arg("elem_id"), py::arg("config_type"));
+    cl.def("GetNeuronConfigMem", (unsigned int (pystorm::bddriver::BDState::*)(unsigned int, unsigned int, unsigned int, pystorm::bddriver::bdpars::DiffusorCutLocationId) const) &pystorm::bddriver::BDState::GetNeuronConfigMem, "Single config bit: 0 or 1, kConfigUnset if it hasn't been set", py::arg("core_id"), py::arg("tile_id"), py::arg("elem_id"), py::arg("config_type"));
+    cl.def("Snapshot", &pystorm::bddriver::BDState::Snapshot, "Cheap copy, shares everything with this state until either is written to");
+    cl.def("Restore", &pystorm::bddriver::BDState::Restore, "Go back to snapshot's contents (software state only, nothing is sent to the chip)", py::arg("snapshot"));
+    cl.def("Diff", &pystorm::bddriver::BDState::Diff, "What differs between this state and other", py::arg("other"));
+    cl.def("Save", &pystorm::bddriver::BDState::Save, "Write the state to a binary file, returns false on failure", py::arg("filename"));
+    cl.def("Load", &pystorm::bddriver::BDState::Load, "Read a state written by Save()", py::arg("filename"));
+    cl.def("Fingerprint", &pystorm::bddriver::BDState::Fingerprint, "64-bit hash identifying the configuration");
+  }
+  { // pystorm::bddriver::BDStateRange file:BDState.h
+    py::class_<pystorm::bddriver::BDStateRange> cl(M("pystorm::bddriver"), "BDStateRange", "[start, start + count): a run of entries that differ between two BDStates");
+    cl.def_readonly("start", &pystorm::bddriver::BDStateRange::start);
+    cl.def_readonly("count", &pystorm::bddriver::BDStateRange::count);
+  }
+  { // pystorm::bddriver::BDStateDiff file:BDState.h
+    py::class_<pystorm::bddriver::BDStateDiff> cl(M("pystorm::bddriver"), "BDStateDiff", "Everything that differs between two BDStates, see BDState::Diff()");
+    cl.def("MemRanges", &pystorm::bddriver::BDStateDiff::MemRanges, py::return_value_policy::copy, py::arg("mem_id"));
+    cl.def("Empty", &pystorm::bddriver::BDStateDiff::Empty);
+    cl.def_readonly("regs", &pystorm::bddriver::BDStateDiff::regs);
+    cl.def_readonly("soma_config_tiles", &pystorm::bddriver::BDStateDiff::soma_config_tiles);
+    cl.def_readonly("synapse_config_tiles", &pystorm::bddriver::BDStateDiff::synapse_config_tiles);
+    cl.def_readonly("diffusor_config_tiles", &pystorm::bddriver::BDStateDiff::diffusor_config_tiles);
   }
   { // pystorm::bddriver::Driver file:Driver.h line:96
     py::class_<pystorm::bddriver::Driver> cl(M("pystorm::bddriver"), "Driver", "Driver provides low-level, but not dead-stupid, control over the BD hardware.\n Driver tries to provide a complete but not needlessly tedious interface to BD.\n It also tries to prevent the user to do anything that would crash the chip.\n\n Driver looks like this:\n\n                              (user/HAL)\n\n  ---[fns]--[fns]--[fns]----------------------[fns]-----------------------[fns]----  API\n       |      |      |            |             A                           A\n       V      V      V            |             |                           |\n  [private fns, e.g. PackWords]   |        [XXXX private fns, e.g. UnpackWords XXXX]\n          |        |              |             A                           A\n          V        V           [BDState]        |                           |\n   [MutexBuffer:enc_buf_in_]      |      [M.B.:dec_buf_out_[0]]    [M.B.:dec_buf_out_[0]] ...\n              |                   |                   A                   A\n              |                   |                   |                   |\n   ----------------------------[BDPars]------------------------------------------- funnel/horn payloads,\n              |                   |                   |                   |           organized by leaf\n              V                   |                   |                   |\n      [Encoder:encoder_]          |        [XXXXXXXXXXXX Decoder:decoder_ XXXXXXXXXX]\n              |                   |                        A\n              V                   |                        |\n   [MutexBuffer:enc_buf_out_]     |           [MutexBuffer:dec_buf_in_]\n              |                   |                      A\n              |                   |                      |\n  --------------------------------------------------------------------------------- raw data\n              |                                          |\n              V                                          |\n         [XXXXXXXXXXXXXXXXXXXX Comm:comm_ XXXXXXXXXXXXXXXXXXXX]\n                               |      A\n                               V      |\n  --------------------------------------------------------------------------------- USB\n\n                              (Braindrop)\n\n At the heart of driver are a few primary components:\n\n - Encoder\n     Inputs: raw payloads (already serialized, if necessary) and BD horn ids to send them to\n     Outputs: inputs suitable to send to BD, packed into char stream\n     Spawns its own thread.\n\n - Decoder\n     Inputs: char stream of outputs from BD\n     Outputs: one stream per horn leaf of raw payloads from that leaf\n     Spawns its own thread.\n\n - Comm\n     Communicates with BD using libUSB, taking inputs from/giving outputs to\n     the Encoder/Decoder. Spawns its own thread.\n\n - MutexBuffers\n     Provide thread-safe communication and buffering for the inputs and outputs of Encoder\n     and decoder. Note that there are many decoder output buffers, one per funnel leaf.\n\n - BDPars\n     Holds all the nitty-gritty hardware information. The rest of the driver doesn't know\n     anything about word field orders or sizes, for example.\n\n - BDState\n     Software model of the hardware state. Keep track of all the memory words that have\n     been programmed, registers that have been set, etc.\n     Also keeps track of timing assumptions, e.g. whether the traffic has drained after\n     turning off all of the toggles that stop it.");
 
-    cl.def(py::init<>());
+    cl.def(py::init<unsigned int>(), "<num_cores> > 1 drives a BrainDrizzle stack", py::arg("num_cores")=1);
 
     cl.def_readwrite("SetSomaConfigMemory", &pystorm::bddriver::Driver::SetSomaConfigMemory);
     cl.def_readwrite("EnableSoma", &pystorm::bddriver::Driver::EnableSoma);
@@ -335,8 +373,13 @@ void bind_unknown_unknown_2(std::function< py::module &(std::string const &names
     cl.def("GetFPGATime", &Driver::GetFPGATime, "get last received FPGA clock value");
     cl.def("GetFPGATimeSec", &Driver::GetFPGATimeSec, "get last received FPGA clock value in seconds");
     cl.def("SetOKBitFile", (void (pystorm::bddriver::Driver::*)(std::string)) &pystorm::bddriver::Driver::SetOKBitFile, "Set the Opal Kelly bitfile location");
+    cl.def("SetOKSerial", &Driver::SetOKSerial, "Set the Opal Kelly serial number of the board to open (empty: the first one found)", py::arg("serial"));
+    cl.def("GetLatestHBTime", &Driver::GetLatestHBTime, "time (ns) of the most recent upstream HB, doesn't consume any HBs");
     cl.def("ResetBD", (void (pystorm::bddriver::Driver::*)()) &pystorm::bddriver::Driver::ResetBD, "Toggles pReset/sReset");
     cl.def("InitBD", (void (pystorm::bddriver::Driver::*)()) &pystorm::bddriver::Driver::InitBD, "Initializes hardware state\n Calls Flush immediately\n\nC++: pystorm::bddriver::Driver::InitBD() --> void");
+    cl.def("SaveAttachState", &pystorm::bddriver::Driver::SaveAttachState, "Save the driver's view of the chip, for AttachBD()", py::arg("filename"));
+    cl.def("AttachBD", &pystorm::bddriver::Driver::AttachBD, "Use instead of InitBD() if the chip still holds the state saved by SaveAttachState().\n Falls back to InitBD() if it doesn't, returns true if InitBD() was skipped",
+        py::arg("filename"), py::arg("saved_fingerprints") = std::vector<uint64_t>(), py::arg("samples_per_mem") = pystorm::bddriver::driverpars::ATTACH_SAMPLES_PER_MEM);
     cl.def("InitFIFO", (void (pystorm::bddriver::Driver::*)(unsigned int)) &pystorm::bddriver::Driver::InitFIFO, "Clears BD FIFOs\n Calls Flush immediately\n\nC++: pystorm::bddriver::Driver::InitFIFO(unsigned int) --> void", py::arg("core_id"));
 
     // added manually
@@ -344,6 +387,99 @@ void bind_unknown_unknown_2(std::function< py::module &(std::string const &names
     cl.def("InitDAC", &Driver::InitDAC, "Inits the DACs to default values", py::arg("core_id"), py::arg("flush") = true);
 
     cl.def("Flush", (void (pystorm::bddriver::Driver::*)()) &pystorm::bddriver::Driver::Flush, "Flush queued up downstream traffic\n Commits queued-up messages (sends enough nops to flush the USB)\n By default, many configuration calls will call Flush()\n Notably, the Neuron config calls do not call Flush()\n\nC++: pystorm::bddriver::Driver::Flush() --> void");
+    // streaming timed input
+    cl.def("FlushStreamed", &Driver::FlushStreamed, "Like Flush(), but timed traffic is released to the FPGA by a feeder thread, at most the stream window ahead of FPGA time");
+    cl.def("SaveTimedInputs", &Driver::SaveTimedInputs, "Write queued-up timed traffic to a schedule file instead of sending it", py::arg("filename"));
+    cl.def("StreamTimedInputsFromFile", &Driver::StreamTimedInputsFromFile, "Stream a schedule file written by SaveTimedInputs()", py::arg("filename"));
+    cl.def("SetStreamWindow", &Driver::SetStreamWindow, "Set how far ahead of FPGA time (ns) streamed timed traffic may be released", py::arg("window_ns"));
+    cl.def("GetStreamWindow", &Driver::GetStreamWindow, "Get the stream window (ns)");
+    cl.def("SetBulkLead", &Driver::SetBulkLead, "Hold timed traffic until it's due within this long (ns) of FPGA time, so untimed traffic can skip ahead of it. 0 doesn't hold it", py::arg("lead_ns"));
+    cl.def("GetBulkLead", &Driver::GetBulkLead, "Get the bulk lead (ns)");
+    cl.def("GetNumHeldBulkBytes", &Driver::GetNumHeldBulkBytes, "Encoded timed traffic being held back, in bytes");
+    cl.def("ClearStreamedInputs", &Driver::ClearStreamedInputs, "Drop streamed timed traffic that hasn't been released yet");
+    cl.def("GetStreamStats", &Driver::GetStreamStats, "How far the feeder ran ahead of/behind FPGA time (ns)");
+    cl.def("ResetStreamStats", &Driver::ResetStreamStats, "Reset the feeder's lead/lag statistics");
+    cl.def("AddSpikeTrains", &Driver::AddSpikeTrains, "Start host-generated spike trains, one per input tag word. rates[i][j] (Hz) holds for train i from times[j] until times[j+1] (ns), the last until stop_time",
+        py::arg("core_id"), py::arg("tags"), py::arg("type"), py::arg("times"), py::arg("rates"), py::arg("stop_time"));
+    cl.def("ClearSpikeTrains", &Driver::ClearSpikeTrains, "Stop all host-generated spike trains");
+    cl.def("GetSpikeTrainStats", &Driver::GetSpikeTrainStats, "How far the spike train generator is ahead of FPGA time (ns)");
+    cl.def("SetRealTimeMode", &Driver::SetRealTimeMode, "Pin/prioritize the driver's threads and make them busy-poll, RealTimeConfig() restores the normal mode",
+        py::arg("config"));
+    cl.def("GetRealTimeMode", &Driver::GetRealTimeMode, "Last config passed to SetRealTimeMode");
+    cl.def("StartBroadcast", &Driver::StartBroadcast, "Publish decoded upstream words to a shared memory ring, read it with pystorm.hal.shm_ring.ShmRingReader",
+        py::arg("name"), py::arg("capacity") = pystorm::bddriver::driverpars::SHM_RING_DEFAULT_CAPACITY);
+    cl.def("StopBroadcast", &Driver::StopBroadcast, "Stop publishing and remove the shared memory ring");
+    cl.def("GetBroadcastCount", &Driver::GetBroadcastCount, "Records published since StartBroadcast()");
+    cl.def("StartRateMap", &Driver::StartRateMap, "Keep an exponentially weighted rate estimate (Hz, XY order) of every neuron, optionally also in a shared memory segment read with pystorm.hal.rate_map.RateMapReader",
+        py::arg("core_id"), py::arg("tau_ns"), py::arg("refresh_ns"), py::arg("shm_name") = "");
+    cl.def("StopRateMap", &Driver::StopRateMap, "Stop estimating rates and remove the shared memory segment", py::arg("core_id"));
+    cl.def("GetRateMap",
+        [](Driver &d, unsigned int core_id) {
+            auto time_rates = d.GetRateMap(core_id);
+            return py::make_tuple(time_rates.first, py::array_t<float>(time_rates.second.size(), time_rates.second.data()));
+        },
+        "The newest rate map, without popping any spikes\nreturns (time (ns), numpy array of rates in XY order), empty if there isn't one yet",
+        py::arg("core_id"));
+    cl.def("SetRetention", &Driver::SetRetention, "Keep the last horizon_ns of an upstream ep's outputs for GetRetained*(), 0 stops",
+        py::arg("core_id"), py::arg("up_ep_code"), py::arg("horizon_ns"));
+    cl.def("GetRetained", &Driver::GetRetained, "Retained (words, times) of an upstream ep in [t0_ns, t1_ns), without consuming them",
+        py::arg("core_id"), py::arg("up_ep_code"), py::arg("t0_ns"), py::arg("t1_ns"));
+    cl.def("GetRetainedBinned", &Driver::GetRetainedBinned, "Counts of retained outputs in num_bins bins of bin_ns from t0_ns, per neuron (NRNI) or tag (RO_ACC/RO_TAT)\nreturns (counts, num_keys), counts are bin major",
+        py::arg("core_id"), py::arg("up_ep_code"), py::arg("t0_ns"), py::arg("bin_ns"), py::arg("num_bins"));
+    cl.def("ReleaseRetained", &Driver::ReleaseRetained, "Drop retained outputs of an upstream ep before t_ns",
+        py::arg("core_id"), py::arg("up_ep_code"), py::arg("t_ns"));
+    cl.def("SetSubscription", &Driver::SetSubscription, "Only keep an upstream ep's outputs whose key (NRNI: neuron AER address, RO_ACC/RO_TAT: tag, SF_OUTPUT: filter index) is in one of the [first, last) keep ranges. The rest aren't queued, or with before_taps, are dropped while they're decoded, before the rate map, retention, broadcast and hooks see them",
+        py::arg("core_id"), py::arg("up_ep_code"), py::arg("keep"), py::arg("before_taps")=false);
+    cl.def("RouteSubscription", &Driver::RouteSubscription, "Send kept outputs with keys in the [first, last) ranges to a named queue, read with RecvFromQueue()",
+        py::arg("core_id"), py::arg("up_ep_code"), py::arg("queue"), py::arg("keys"));
+    cl.def("ClearSubscription", &Driver::ClearSubscription, "Keep and queue all of an upstream ep's outputs again",
+        py::arg("core_id"), py::arg("up_ep_code"));
+    cl.def("RecvFromQueue", &Driver::RecvFromQueue, "Receive (words, times) from a queue made by RouteSubscription()",
+        py::arg("queue"), py::arg("timeout_us")=1000);
+    cl.def("GetNumFilteredOutputs", &Driver::GetNumFilteredOutputs, "Upstream outputs dropped by subscriptions");
+    cl.def("SetOutputTable", &Driver::SetOutputTable, "Register which output and dimension each spike filter reports, output < 0 for unused filters",
+        py::arg("core_id"), py::arg("outputs"), py::arg("dims"));
+    cl.def("SetPoolTable", &Driver::SetPoolTable, "Register which pool and neuron index each soma (by AER address) is, pool < 0 for somas in none",
+        py::arg("core_id"), py::arg("pools"), py::arg("nrn_idxs"));
+    cl.def("RecvTranslatedOutputs",
+        [](Driver &d, unsigned int core_id, bool group, unsigned int timeout_us) {
+            auto recvd = d.RecvTranslatedOutputs(core_id, group, timeout_us);
+            return py::make_tuple(
+                py::array_t<uint64_t>(std::get<0>(recvd).size(), std::get<0>(recvd).data()),
+                py::array_t<int>(std::get<1>(recvd).size(), std::get<1>(recvd).data()),
+                py::array_t<unsigned int>(std::get<2>(recvd).size(), std::get<2>(recvd).data()),
+                py::array_t<int>(std::get<3>(recvd).size(), std::get<3>(recvd).data()));
+        },
+        "Receive spike filter states translated with SetOutputTable(), optionally grouped by output\nreturns numpy arrays (times, outputs, dims, counts)",
+        py::arg("core_id"), py::arg("group")=false, py::arg("timeout_us")=1000);
+    cl.def("RecvTranslatedSpikes",
+        [](Driver &d, unsigned int core_id, bool group, unsigned int timeout_us) {
+            auto recvd = d.RecvTranslatedSpikes(core_id, group, timeout_us);
+            return py::make_tuple(
+                py::array_t<uint64_t>(std::get<0>(recvd).size(), std::get<0>(recvd).data()),
+                py::array_t<int>(std::get<1>(recvd).size(), std::get<1>(recvd).data()),
+                py::array_t<unsigned int>(std::get<2>(recvd).size(), std::get<2>(recvd).data()));
+        },
+        "Receive spikes translated with SetPoolTable(), optionally grouped by pool\nreturns numpy arrays (times, pools, neuron indices)",
+        py::arg("core_id"), py::arg("group")=false, py::arg("timeout_us")=1000);
+    cl.def("StartCapture", &Driver::StartCapture, "Record every comm frame, with host timestamps, to a trace file ReplayDriver can play back",
+        py::arg("path"));
+    cl.def("StopCapture", &Driver::StopCapture, "Stop recording, returns the number of frames recorded");
+    cl.def("GetDecoderQueueBytes", &Driver::GetDecoderQueueBytes, "Bytes read from comm the decoder hasn't gotten to yet, growing means it can't keep up");
+    cl.def("GetNumUnknownEPWords", &Driver::GetNumUnknownEPWords, "Upstream words dropped because their ep code was unknown (corrupted data)");
+    cl.def("BeginNetworkImage", &Driver::BeginNetworkImage, "Start capturing untimed downstream traffic into a network image instead of sending it");
+    cl.def("EndNetworkImage", &Driver::EndNetworkImage, "Stop capturing, return the encoded network image with the resulting BDStates");
+    cl.def("LoadNetworkImage", (void (Driver::*)(const NetworkImage &)) &Driver::LoadNetworkImage, "Send a network image straight to comm and install its BDStates", py::arg("image"));
+    cl.def("LoadNetworkImage", (bool (Driver::*)(const std::string &)) &Driver::LoadNetworkImage, "Load a network image file written by NetworkImage.Save()", py::arg("filename"));
+    cl.def("AllocMem", &Driver::AllocMem, "Claim the first free run of count entries of mem_id for the next network, -1 if there's no room", py::arg("core_id"), py::arg("mem_id"), py::arg("count"));
+    cl.def("ReserveMem", &Driver::ReserveMem, "Claim [start, start + count) of mem_id for the next (or, with live, the running) network", py::arg("core_id"), py::arg("mem_id"), py::arg("start"), py::arg("count"), py::arg("live") = false);
+    cl.def("GetFreeMem", &Driver::GetFreeMem, "Runs of mem_id that neither network has claimed", py::arg("core_id"), py::arg("mem_id"));
+    cl.def("StageMem", &Driver::StageMem, "Like SetMem(), but doesn't pause traffic. The range must have been claimed for the next network, returns false (and writes nothing) if it wasn't", py::arg("core_id"), py::arg("mem_id"), py::arg("data"), py::arg("start_addr"));
+    cl.def("SwapNetwork", &Driver::SwapNetwork, "Switch to the staged network: write the PAT and TAT entry points in one traffic pause",
+        py::arg("core_id"), py::arg("PAT_data"), py::arg("PAT_start") = 0,
+        py::arg("TAT0_entries") = std::vector<std::pair<unsigned int, BDWord>>(), py::arg("TAT1_entries") = std::vector<std::pair<unsigned int, BDWord>>());
+    cl.def("GetTrafficPausedTime", &Driver::GetTrafficPausedTime, "Total time (ns) traffic has been paused on core_id", py::arg("core_id"));
+    cl.def("IsCapturingNetworkImage", &Driver::IsCapturingNetworkImage);
     cl.def("SetTagTrafficState", [](pystorm::bddriver::Driver &o, unsigned int  const &a0, bool  const &a1) -> void { return o.SetTagTrafficState(a0, a1); }, "", py::arg("core_id"), py::arg("en"));
     cl.def("SetTagTrafficState", (void (pystorm::bddriver::Driver::*)(unsigned int, bool, bool)) &pystorm::bddriver::Driver::SetTagTrafficState, "Control tag traffic\n\nC++: pystorm::bddriver::Driver::SetTagTrafficState(unsigned int, bool, bool) --> void", py::arg("core_id"), py::arg("en"), py::arg("flush"));
     cl.def("SetSpikeTrafficState", [](pystorm::bddriver::Driver &o, unsigned int  const &a0, bool  const &a1) -> void { return o.SetSpikeTrafficState(a0, a1); }, "", py::arg("core_id"), py::arg("en"));
@@ -362,7 +498,8 @@ void bind_unknown_unknown_2(std::function< py::module &(std::string const &names
     cl.def("SetDACtoADCConnectionState", (void (pystorm::bddriver::Driver::*)(unsigned int, pystorm::bddriver::bdpars::BDHornEP, bool, bool)) &pystorm::bddriver::Driver::SetDACtoADCConnectionState, "Make DAC-to-ADC connection for calibration for a particular DAC\n\nC++: pystorm::bddriver::Driver::SetDACtoADCConnectionState(unsigned int, pystorm::bddriver::bdpars::BDHornEP, bool, bool) --> void", py::arg("core_id"), py::arg("dac_signal_id"), py::arg("en"), py::arg("flush"));
 
     // manually added
-    cl.def_readonly_static("BDPars", &pystorm::bddriver::Driver::kBDPars_);
+    cl.def_readonly("BDPars", &pystorm::bddriver::Driver::kBDPars_);
+    cl.def("InitFIFOs", &pystorm::bddriver::Driver::InitFIFOs, "InitFIFO() for several cores at once", py::arg("core_ids"));
 
     cl.def("GetDACScaling", &pystorm::bddriver::Driver::GetDACScaling, "", py::arg("dac_signal_id"));
     cl.def("GetDACUnitCurrent", &pystorm::bddriver::Driver::GetDACUnitCurrent, "", py::arg("dac_signal_id"));
@@ -472,6 +609,21 @@ void bind_unknown_unknown_2(std::function< py::module &(std::string const &names
     cl.def("SetSpikeGeneratorRates", &Driver::SetSpikeGeneratorRates, "Set input rates (in +/- Hz) for Spike Generators.", 
         py::arg("core_id"), py::arg("gen_idxs"), py::arg("tags"), py::arg("rates"), py::arg("time") = 0, py::arg("flush") = true);
 
+    cl.def("SetSpikeGeneratorRateSchedule", &Driver::SetSpikeGeneratorRateSchedule, "Schedule Spike Generator rate changes (in +/- Hz), only sending what changes at each time. Returns number of words sent.",
+        py::arg("core_id"), py::arg("times"), py::arg("gen_idxs"), py::arg("tags"), py::arg("rates"), py::arg("flush") = true);
+
+    cl.def("GetNumSGWordsSent", &Driver::GetNumSGWordsSent, "Number of Spike Generator words sent so far",
+        py::arg("core_id"));
+
+    cl.def("StartRateGovernor", &Driver::StartRateGovernor, "Scale the rates SetSpikeGeneratorRates programs down when FIFOs overflow, and back up when they don't",
+        py::arg("core_id"), py::arg("config"));
+    cl.def("StopRateGovernor", &Driver::StopRateGovernor, "Stop governing, reprogramming governed Spike Generators at the rates they were set to",
+        py::arg("core_id"), py::arg("flush") = true);
+    cl.def("GetRateGovernorScale", &Driver::GetRateGovernorScale, "Scale governed rates are programmed at, 1 if not governing",
+        py::arg("core_id"));
+    cl.def("GetRateGovernorLog", &Driver::GetRateGovernorLog, "Every scale change of the latest StartRateGovernor",
+        py::arg("core_id"));
+
     cl.def("SetSpikeFilterIncrementConst", &Driver::SetSpikeFilterIncrementConst, "Set Spike Filter increment constant",
         py::arg("core_id"), py::arg("increment"), py::arg("flush") = true);
 
@@ -527,8 +679,43 @@ void bind_unknown_unknown_2(std::function< py::module &(std::string const &names
     cl.def("SetSpikeFilterDebug",&Driver::SetSpikeFilterDebug, "enable or disable dumping of raw tags entering spike filter", 
         py::arg("core_id"), py::arg("en"));
 
+    cl.def("StartHostSpikeFilters", &Driver::StartHostSpikeFilters,
+        "Filter tags (filter = tag) and optionally spikes (filter = 2048 + neuron address) on the host, like the FPGA's spike filters with the same constants, but without their filter limit. States are sampled every sample_ns",
+        py::arg("core_id"), py::arg("decay"), py::arg("increment"), py::arg("sample_ns"), py::arg("spikes")=false);
+    cl.def("StopHostSpikeFilters", &Driver::StopHostSpikeFilters, "Stop StartHostSpikeFilters()", py::arg("core_id"));
+    cl.def("RecvHostSpikeFilterStates",
+        [](Driver &d, unsigned int core_id) {
+            auto times_states = d.RecvHostSpikeFilterStates(core_id);
+            const ptrdiff_t num_samples = times_states.first.size();
+            const ptrdiff_t num_filters = num_samples > 0 ? times_states.second.size() / num_samples : 0;
+            return py::make_tuple(
+                py::array_t<uint64_t>(num_samples, times_states.first.data()),
+                py::array_t<float>(std::vector<ptrdiff_t>{num_samples, num_filters}, times_states.second.data()));
+        },
+        "Host spike filter samples taken since the last call\nreturns numpy arrays (times, states[sample, filter])",
+        py::arg("core_id"));
+    cl.def("GetHostSpikeFilterSnapshot",
+        [](Driver &d, unsigned int core_id) {
+            auto time_states = d.GetHostSpikeFilterSnapshot(core_id);
+            return py::make_tuple(time_states.first, py::array_t<float>(time_states.second.size(), time_states.second.data()));
+        },
+        "The latest host spike filter sample, without consuming it\nreturns (time, numpy array of states)",
+        py::arg("core_id"));
+
     // added manually
-    cl.def("RecvTags", &Driver::RecvTags, "Receive a stream of tags\n receive from both tag output leaves, the Acc and TAT", py::arg("core_id"), py::arg("timeout_us")=1000);
+    cl.def("RecvTags", &Driver::RecvTags, "Receive a stream of tags\n receive from both tag output leaves, the Acc and TAT, merged in time order", py::arg("core_id"), py::arg("timeout_us")=1000);
+    cl.def("RecvFromEPs", &Driver::RecvFromEPs, "Wait up to timeout_us for any of the upstream ep_codes, then receive from all of them, merged in time order\nreturns (ep codes, words, times)",
+        py::arg("core_id"), py::arg("ep_codes"), py::arg("timeout_us")=1000);
+    cl.def("RecvBinnedTags", (pystorm::bddriver::TagBinner (Driver::*)(unsigned int, const std::vector<BDTime>&, unsigned int)) &Driver::RecvBinnedTags,
+        "Receive tags from both tag output leaves, summing their signed counts into bins [bin_edges[i], bin_edges[i + 1]) by tag",
+        py::arg("core_id"), py::arg("bin_edges"), py::arg("timeout_us")=1000);
+    cl.def("RecvBinnedTags", (pystorm::bddriver::TagBinner (Driver::*)(unsigned int, BDTime, BDTime, unsigned int, unsigned int)) &Driver::RecvBinnedTags,
+        "Receive tags from both tag output leaves, summing their signed counts into num_bins bins of bin_ns from t0_ns by tag",
+        py::arg("core_id"), py::arg("t0_ns"), py::arg("bin_ns"), py::arg("num_bins"), py::arg("timeout_us")=1000);
+    cl.def("StartTagBinning", &Driver::StartTagBinning, "Bin tags from both leaves as they're decoded, until GetTagBinning(stop=True)",
+        py::arg("core_id"), py::arg("bin_edges"));
+    cl.def("GetTagBinning", &Driver::GetTagBinning, "What StartTagBinning() has binned so far, and stop if stop",
+        py::arg("core_id"), py::arg("stop")=true);
     cl.def("RecvUnpackedTags", &Driver::RecvUnpackedTags, "Receive unpacked tags from both tag output leaves, the Acc and TAT\nreturns {counts, tags, routes, times}", py::arg("core_id"), py::arg("timeout_us")=1000);
     cl.def("GetOutputQueueCounts", &Driver::GetOutputQueueCounts, "Returns the total number of elements in each output queue");
 
@@ -556,6 +743,110 @@ void bind_unknown_unknown_3(std::function< py::module &(std::string const &names
   }
 }
 
+void bind_TimedFeederStats(std::function< py::module &(std::string const &namespace_) > &M)
+{
+  { // pystorm::bddriver::TimedFeederStats
+    py::class_<pystorm::bddriver::TimedFeederStats, std::shared_ptr<pystorm::bddriver::TimedFeederStats>> cl(M("pystorm::bddriver"), "TimedFeederStats", "How far the timed input feeder is running ahead of (or behind) the FPGA");
+    cl.def_readonly("fpga_time", &pystorm::bddriver::TimedFeederStats::fpga_time);
+    cl.def_readonly("released_until", &pystorm::bddriver::TimedFeederStats::released_until);
+    cl.def_readonly("lead", &pystorm::bddriver::TimedFeederStats::lead);
+    cl.def_readonly("max_lead", &pystorm::bddriver::TimedFeederStats::max_lead);
+    cl.def_readonly("max_lag", &pystorm::bddriver::TimedFeederStats::max_lag);
+    cl.def_readonly("num_released", &pystorm::bddriver::TimedFeederStats::num_released);
+    cl.def_readonly("num_pending", &pystorm::bddriver::TimedFeederStats::num_pending);
+    cl.def_readonly("file_open", &pystorm::bddriver::TimedFeederStats::file_open);
+  }
+}
+
+void bind_SpikeTrainGenerator(std::function< py::module &(std::string const &namespace_) > &M)
+{
+  py::enum_<pystorm::bddriver::SpikeTrainType>(M("pystorm::bddriver"), "SpikeTrainType", "Interspike interval statistics of a host-generated spike train")
+    .value("REGULAR", pystorm::bddriver::SpikeTrainType::REGULAR)
+    .value("POISSON", pystorm::bddriver::SpikeTrainType::POISSON);
+
+  { // pystorm::bddriver::SpikeTrainGeneratorStats
+    py::class_<pystorm::bddriver::SpikeTrainGeneratorStats, std::shared_ptr<pystorm::bddriver::SpikeTrainGeneratorStats>> cl(M("pystorm::bddriver"), "SpikeTrainGeneratorStats", "How far the host spike train generator is running ahead of the FPGA");
+    cl.def_readonly("fpga_time", &pystorm::bddriver::SpikeTrainGeneratorStats::fpga_time);
+    cl.def_readonly("generated_until", &pystorm::bddriver::SpikeTrainGeneratorStats::generated_until);
+    cl.def_readonly("lead", &pystorm::bddriver::SpikeTrainGeneratorStats::lead);
+    cl.def_readonly("num_generated", &pystorm::bddriver::SpikeTrainGeneratorStats::num_generated);
+    cl.def_readonly("num_active", &pystorm::bddriver::SpikeTrainGeneratorStats::num_active);
+  }
+}
+
+void bind_RealTimeConfig(std::function< py::module &(std::string const &namespace_) > &M)
+{
+  { // pystorm::bddriver::RealTimeConfig
+    py::class_<pystorm::bddriver::RealTimeConfig, std::shared_ptr<pystorm::bddriver::RealTimeConfig>> cl(M("pystorm::bddriver"), "RealTimeConfig", "Settings for the driver's low-latency (closed-loop) mode. The defaults are the normal mode");
+    cl.def(py::init<>());
+    cl.def_readwrite("comm_cpu", &pystorm::bddriver::RealTimeConfig::comm_cpu);
+    cl.def_readwrite("enc_cpu", &pystorm::bddriver::RealTimeConfig::enc_cpu);
+    cl.def_readwrite("dec_cpu", &pystorm::bddriver::RealTimeConfig::dec_cpu);
+    cl.def_readwrite("fifo_priority", &pystorm::bddriver::RealTimeConfig::fifo_priority);
+    cl.def_readwrite("lock_memory", &pystorm::bddriver::RealTimeConfig::lock_memory);
+    cl.def_readwrite("spin_us", &pystorm::bddriver::RealTimeConfig::spin_us);
+  }
+}
+
+void bind_RateGovernorConfig(std::function< py::module &(std::string const &namespace_) > &M)
+{
+  { // pystorm::bddriver::RateGovernorConfig
+    py::class_<pystorm::bddriver::RateGovernorConfig, std::shared_ptr<pystorm::bddriver::RateGovernorConfig>> cl(M("pystorm::bddriver"), "RateGovernorConfig", "How Driver.StartRateGovernor reacts to FIFO overflows");
+    cl.def(py::init<>());
+    cl.def_readwrite("target_loss_rate", &pystorm::bddriver::RateGovernorConfig::target_loss_rate);
+    cl.def_readwrite("queue_high", &pystorm::bddriver::RateGovernorConfig::queue_high);
+    cl.def_readwrite("decrease", &pystorm::bddriver::RateGovernorConfig::decrease);
+    cl.def_readwrite("increase", &pystorm::bddriver::RateGovernorConfig::increase);
+    cl.def_readwrite("min_scale", &pystorm::bddriver::RateGovernorConfig::min_scale);
+    cl.def_readwrite("interval_ns", &pystorm::bddriver::RateGovernorConfig::interval_ns);
+  }
+  { // pystorm::bddriver::RateGovernorAdjustment
+    py::class_<pystorm::bddriver::RateGovernorAdjustment, std::shared_ptr<pystorm::bddriver::RateGovernorAdjustment>> cl(M("pystorm::bddriver"), "RateGovernorAdjustment", "One change of a rate governor's scale");
+    cl.def_readonly("time", &pystorm::bddriver::RateGovernorAdjustment::time);
+    cl.def_readonly("scale", &pystorm::bddriver::RateGovernorAdjustment::scale);
+    cl.def_readonly("loss_rate", &pystorm::bddriver::RateGovernorAdjustment::loss_rate);
+    cl.def_readonly("queue_fill", &pystorm::bddriver::RateGovernorAdjustment::queue_fill);
+  }
+}
+
+void bind_TagBinner(std::function< py::module &(std::string const &namespace_) > &M)
+{
+  { // pystorm::bddriver::TagBinner
+    py::class_<pystorm::bddriver::TagBinner, std::shared_ptr<pystorm::bddriver::TagBinner>> cl(M("pystorm::bddriver"), "TagBinner", "Signed tag counts summed into (bin, tag) cells, see Driver.RecvBinnedTags()");
+    cl.def(py::init<const std::vector<uint64_t> &, unsigned int>(), py::arg("edges"), py::arg("num_tags") = 2048);
+    cl.def("GetNumBins", &pystorm::bddriver::TagBinner::GetNumBins);
+    cl.def("GetNumTags", &pystorm::bddriver::TagBinner::GetNumTags);
+    cl.def("GetEdges", &pystorm::bddriver::TagBinner::GetEdges);
+    cl.def("GetNumDropped", &pystorm::bddriver::TagBinner::GetNumDropped, "Tags outside the bins");
+    cl.def("GetCounts", [](const pystorm::bddriver::TagBinner &o) {
+            return py::array_t<int32_t>(
+                std::vector<ptrdiff_t>{o.GetNumBins(), o.GetNumTags()},
+                o.GetCounts().data());
+        }, "Dense counts, numpy array indexed [bin, tag]");
+    cl.def("GetSparse", [](const pystorm::bddriver::TagBinner &o) {
+            auto sparse = o.GetSparse();
+            return py::make_tuple(
+                py::array_t<unsigned int>(std::get<0>(sparse).size(), std::get<0>(sparse).data()),
+                py::array_t<unsigned int>(std::get<1>(sparse).size(), std::get<1>(sparse).data()),
+                py::array_t<int32_t>(std::get<2>(sparse).size(), std::get<2>(sparse).data()));
+        }, "Nonzero cells only, numpy arrays (bins, tags, counts)");
+  }
+}
+
+void bind_NetworkImage(std::function< py::module &(std::string const &namespace_) > &M)
+{
+  { // pystorm::bddriver::NetworkImage
+    py::class_<pystorm::bddriver::NetworkImage, std::shared_ptr<pystorm::bddriver::NetworkImage>> cl(M("pystorm::bddriver"), "NetworkImage", "A precompiled network load, see Driver.BeginNetworkImage()");
+    cl.def(py::init<>());
+    cl.def_readonly("states", &pystorm::bddriver::NetworkImage::states);
+    cl.def_readonly("num_AM_dump_words", &pystorm::bddriver::NetworkImage::num_AM_dump_words);
+    cl.def("NumBytes", &pystorm::bddriver::NetworkImage::NumBytes, "total bytes of encoded downstream traffic");
+    cl.def("Save", &pystorm::bddriver::NetworkImage::Save, "Write the image to a binary file", py::arg("filename"));
+    cl.def("Load", [](pystorm::bddriver::NetworkImage &o, const std::string &filename, Driver &driver) -> bool { return o.Load(filename, driver.GetBDPars()); },
+        "Read an image written by Save() for <driver>'s chips", py::arg("filename"), py::arg("driver"));
+  }
+}
+
 void bind_MemInfo(std::function< py::module &(std::string const &namespace_) > &M)
 {
   { // pystorm::bddriver::bdpars::MemInfo file: line:203
@@ -570,13 +861,142 @@ void bind_MemInfo(std::function< py::module &(std::string const &namespace_) > &
   }
 }
 
+void bind_comm_ReplayDriver(std::function< py::module &(std::string const &namespace_) > &M)
+{
+  { // pystorm::bddriver::ReplayDriver file:comm/ReplayDriver.h line:16
+    py::class_<pystorm::bddriver::ReplayDriver, pystorm::bddriver::Driver> cl(M("pystorm::bddriver"), "ReplayDriver", "Specialization of Driver that runs on a trace recorded with Driver.StartCapture() instead of a board");
+    cl.def(py::init<const std::string &, bool, unsigned int>(), py::arg("trace_path"), py::arg("paced")=true, py::arg("num_cores")=1);
+
+    cl.def("IsReplayDone", &pystorm::bddriver::ReplayDriver::IsReplayDone, "Whether every upstream frame in the trace has gone to the decoder");
+    cl.def("GetNumFramesReplayed", &pystorm::bddriver::ReplayDriver::GetNumFramesReplayed);
+  }
+}
+
+void bind_comm_SyntheticDriver(std::function< py::module &(std::string const &namespace_) > &M)
+{
+  { // pystorm::bddriver::comm::SyntheticLoad file:comm/CommSynthetic.h line:23
+    py::class_<pystorm::bddriver::comm::SyntheticLoad, std::shared_ptr<pystorm::bddriver::comm::SyntheticLoad>> cl(M("pystorm::bddriver"), "SyntheticLoad", "What SyntheticDriver generates, rates are events/s");
+    cl.def(py::init<>());
+    cl.def_readwrite("spike_rate", &pystorm::bddriver::comm::SyntheticLoad::spike_rate);
+    cl.def_readwrite("num_neurons", &pystorm::bddriver::comm::SyntheticLoad::num_neurons);
+    cl.def_readwrite("acc_tag_rate", &pystorm::bddriver::comm::SyntheticLoad::acc_tag_rate);
+    cl.def_readwrite("tat_tag_rate", &pystorm::bddriver::comm::SyntheticLoad::tat_tag_rate);
+    cl.def_readwrite("num_tags", &pystorm::bddriver::comm::SyntheticLoad::num_tags);
+    cl.def_readwrite("sf_state_rate", &pystorm::bddriver::comm::SyntheticLoad::sf_state_rate);
+    cl.def_readwrite("num_filters", &pystorm::bddriver::comm::SyntheticLoad::num_filters);
+    cl.def_readwrite("malformed_rate", &pystorm::bddriver::comm::SyntheticLoad::malformed_rate);
+    cl.def_readwrite("overflow_rate", &pystorm::bddriver::comm::SyntheticLoad::overflow_rate);
+    cl.def_readwrite("seed", &pystorm::bddriver::comm::SyntheticLoad::seed);
+  }
+  { // pystorm::bddriver::comm::SyntheticStats file:comm/CommSynthetic.h line:36
+    py::class_<pystorm::bddriver::comm::SyntheticStats, std::shared_ptr<pystorm::bddriver::comm::SyntheticStats>> cl(M("pystorm::bddriver"), "SyntheticStats", "Counts of what SyntheticDriver has generated");
+    cl.def_readonly("num_frames", &pystorm::bddriver::comm::SyntheticStats::num_frames);
+    cl.def_readonly("num_spikes", &pystorm::bddriver::comm::SyntheticStats::num_spikes);
+    cl.def_readonly("num_acc_tags", &pystorm::bddriver::comm::SyntheticStats::num_acc_tags);
+    cl.def_readonly("num_tat_tags", &pystorm::bddriver::comm::SyntheticStats::num_tat_tags);
+    cl.def_readonly("num_sf_states", &pystorm::bddriver::comm::SyntheticStats::num_sf_states);
+    cl.def_readonly("num_malformed", &pystorm::bddriver::comm::SyntheticStats::num_malformed);
+    cl.def_readonly("num_overflows", &pystorm::bddriver::comm::SyntheticStats::num_overflows);
+    cl.def_readonly("num_HBs", &pystorm::bddriver::comm::SyntheticStats::num_HBs);
+    cl.def_readonly("backlog_words", &pystorm::bddriver::comm::SyntheticStats::backlog_words);
+    cl.def_readonly("num_dropped_words", &pystorm::bddriver::comm::SyntheticStats::num_dropped_words);
+  }
+  { // pystorm::bddriver::SyntheticDriver file:comm/SyntheticDriver.h line:12
+    py::class_<pystorm::bddriver::SyntheticDriver, pystorm::bddriver::Driver> cl(M("pystorm::bddriver"), "SyntheticDriver", "Specialization of Driver that runs on a generated upstream load instead of a board");
+    cl.def(py::init<unsigned int>(), py::arg("num_cores")=1);
+
+    cl.def("SetLoad", &pystorm::bddriver::SyntheticDriver::SetLoad, "Change the generated load, also picks up the programmed FPGA timing", py::arg("load"));
+    cl.def("GetLoad", &pystorm::bddriver::SyntheticDriver::GetLoad);
+    cl.def("GetSyntheticStats", &pystorm::bddriver::SyntheticDriver::GetSyntheticStats);
+  }
+}
+
 void bind_model_BDModelDriver(std::function< py::module &(std::string const &namespace_) > &M)
 {
   { // pystorm::bddriver::BDModelDriver file:model/BDModelDriver.h line:15
     py::class_<pystorm::bddriver::BDModelDriver, pystorm::bddriver::Driver> cl(M("pystorm::bddriver"), "BDModelDriver", "Specialization of Driver that uses BDModelComm.\n I could have made Driver depend on BDModel, and have an optional constructor\n argument. I opted to subclass instead to contain the dependency to this \n particular (testing-only) use case.");
+    cl.def(py::init<unsigned int>(), py::arg("num_cores")=1);
+
+    cl.def("GetBDModel", (class pystorm::bddriver::bdmodel::BDModel * (pystorm::bddriver::BDModelDriver::*)(unsigned int)) &pystorm::bddriver::BDModelDriver::GetBDModel, "C++: pystorm::bddriver::BDModelDriver::GetBDModel(unsigned int) --> class pystorm::bddriver::bdmodel::BDModel *", py::arg("core_id")=0, py::return_value_policy::reference_internal);
+  }
+}
+
+void bind_DriverManager(std::function< py::module &(std::string const &namespace_) > &M)
+{
+  { // pystorm::bddriver::DriverManager file:DriverManager.h line:26
+    py::class_<pystorm::bddriver::DriverManager> cl(M("pystorm::bddriver"), "DriverManager", "Runs several boards from one process, one Driver per board, on a shared time base (board 0's clock)");
+    cl.def(py::init<const std::vector<std::string> &>(), py::arg("ok_serials"));
+
+    cl.def("NumBoards", &DriverManager::NumBoards);
+    cl.def("Board", &DriverManager::Board, "the Driver for one board", py::arg("board"), py::return_value_policy::reference_internal);
+    cl.def("Start", &DriverManager::Start, "Start every board. Returns 0 if they all started, otherwise the first failing comm state");
+    cl.def("Stop", &DriverManager::Stop);
+    cl.def("InitBD", &DriverManager::InitBD);
+    cl.def("Flush", &DriverManager::Flush);
+    cl.def("SetTimeUnitLen", &DriverManager::SetTimeUnitLen, py::arg("ns_per_unit"));
+    cl.def("SetTimePerUpHB", &DriverManager::SetTimePerUpHB, py::arg("ns_per_hb"));
+    cl.def("AlignTime", &DriverManager::AlignTime, "Reset every board's FPGA clock, then estimate the clock offsets from upstream HBs",
+        py::arg("num_HBs")=8, py::arg("timeout_us")=1000000);
+    cl.def("GetTimeOffset", &DriverManager::GetTimeOffset, "board time + offset = shared time (ns)", py::arg("board"));
+    cl.def("ToSharedTime", &DriverManager::ToSharedTime, py::arg("board"), py::arg("board_time"));
+    cl.def("ToBoardTime", &DriverManager::ToBoardTime, py::arg("board"), py::arg("shared_time"));
+    cl.def("SendSpikes", &DriverManager::SendSpikes, "Send spikes to one board, times on the shared time base",
+        py::arg("board"), py::arg("core_id"), py::arg("spikes"), py::arg("times"), py::arg("flush")=true);
+    cl.def("SendTags", &DriverManager::SendTags, "Send tags to one board, times on the shared time base",
+        py::arg("board"), py::arg("core_id"), py::arg("tags"), py::arg("times"), py::arg("flush")=true);
+    cl.def("RecvSpikes", &DriverManager::RecvSpikes, "Spikes from every board, in time order, up to the oldest board's latest HB. "
+        "drain also returns the held ones. Returns (boards, spikes, times)", py::arg("core_id"), py::arg("drain")=false);
+    cl.def("RecvTags", &DriverManager::RecvTags, "Tags from every board, in time order, up to the oldest board's latest HB. "
+        "drain also returns the held ones. Returns (boards, tags, times)",
+        py::arg("core_id"), py::arg("timeout_us")=1000, py::arg("drain")=false);
+  }
+}
+
+void bind_DriverClient(std::function< py::module &(std::string const &namespace_) > &M)
+{
+  { // pystorm::bddriver::DriverClient file:daemon/DriverClient.h line:29
+    py::class_<pystorm::bddriver::DriverClient> cl(M("pystorm::bddriver"), "DriverClient", "Talks to a Driver owned by another process (bddriverd), with Driver's call signatures");
     cl.def(py::init<>());
 
-    cl.def("GetBDModel", (class pystorm::bddriver::bdmodel::BDModel * (pystorm::bddriver::BDModelDriver::*)()) &pystorm::bddriver::BDModelDriver::GetBDModel, "C++: pystorm::bddriver::BDModelDriver::GetBDModel() --> class pystorm::bddriver::bdmodel::BDModel *", py::return_value_policy::reference_internal);
+    cl.def("Connect", &DriverClient::Connect, "Connect to a bddriverd. shm_bytes=0 sends bulk payloads over the socket",
+        py::arg("socket_path")=pystorm::bddriver::driverpars::DAEMON_SOCKET_PATH,
+        py::arg("shm_bytes")=pystorm::bddriver::driverpars::DAEMON_SHM_BYTES);
+    cl.def("Disconnect", &DriverClient::Disconnect);
+    cl.def("IsConnected", &DriverClient::IsConnected);
+    cl.def("HasDataSegment", &DriverClient::HasDataSegment);
+    cl.def("Ping", &DriverClient::Ping);
+    cl.def("Start", &DriverClient::Start);
+    cl.def("Stop", &DriverClient::Stop);
+    cl.def("GetBDPars", &DriverClient::GetBDPars, py::return_value_policy::reference_internal);
+    cl.def("InitBD", &DriverClient::InitBD);
+    cl.def("InitFPGA", &DriverClient::InitFPGA);
+    cl.def("ResetBD", &DriverClient::ResetBD);
+    cl.def("Flush", &DriverClient::Flush);
+    cl.def("SetTimeUnitLen", &DriverClient::SetTimeUnitLen, py::arg("ns_per_unit"));
+    cl.def("SetTimePerUpHB", &DriverClient::SetTimePerUpHB, py::arg("ns_per_hb"));
+    cl.def("ResetFPGATime", &DriverClient::ResetFPGATime);
+    cl.def("GetFPGATime", &DriverClient::GetFPGATime);
+    cl.def("GetDriverTime", &DriverClient::GetDriverTime);
+    cl.def("SetTagTrafficState", &DriverClient::SetTagTrafficState, py::arg("core_id"), py::arg("en"), py::arg("flush")=true);
+    cl.def("SetSpikeTrafficState", &DriverClient::SetSpikeTrafficState, py::arg("core_id"), py::arg("en"), py::arg("flush")=true);
+    cl.def("SetSpikeDumpState", &DriverClient::SetSpikeDumpState, py::arg("core_id"), py::arg("en"), py::arg("flush")=true);
+    cl.def("SetDACCount", &DriverClient::SetDACCount, py::arg("core_id"), py::arg("signal_id"), py::arg("value"), py::arg("flush")=true);
+    cl.def("SetDACValue", &DriverClient::SetDACValue, py::arg("core_id"), py::arg("signal_id"), py::arg("value"), py::arg("flush")=true);
+    cl.def("SetSomaEnableStatus", &DriverClient::SetSomaEnableStatus, py::arg("core_id"), py::arg("soma_id"), py::arg("status"));
+    cl.def("SetMem", &DriverClient::SetMem, py::arg("core_id"), py::arg("mem_id"), py::arg("data"), py::arg("start_addr"));
+    cl.def("DumpMem", &DriverClient::DumpMem, py::arg("core_id"), py::arg("mem_id"));
+    cl.def("SendSpikes", &DriverClient::SendSpikes, py::arg("core_id"), py::arg("spikes"), py::arg("times"), py::arg("flush")=true);
+    cl.def("SendTags", &DriverClient::SendTags, py::arg("core_id"), py::arg("tags"), py::arg("times")=std::vector<BDTime>(), py::arg("flush")=true);
+    cl.def("RecvSpikes", &DriverClient::RecvSpikes, py::arg("core_id"));
+    cl.def("RecvTags", &DriverClient::RecvTags, py::arg("core_id"), py::arg("timeout_us")=1000);
+    cl.def("SetSpikeGeneratorRates", &DriverClient::SetSpikeGeneratorRates,
+        py::arg("core_id"), py::arg("gen_idxs"), py::arg("tags"), py::arg("rates"), py::arg("time")=0, py::arg("flush")=true);
+    cl.def("SetNumSpikeFilters", &DriverClient::SetNumSpikeFilters, py::arg("core_id"), py::arg("num"), py::arg("flush")=true);
+    cl.def("RecvSpikeFilterStates", &DriverClient::RecvSpikeFilterStates, py::arg("core_id"), py::arg("timeout_us"));
+    cl.def("GetFIFOOverflowCounts", &DriverClient::GetFIFOOverflowCounts, py::arg("core_id"));
+    cl.def("StartBroadcast", &DriverClient::StartBroadcast, py::arg("name"),
+        py::arg("capacity")=pystorm::bddriver::driverpars::SHM_RING_DEFAULT_CAPACITY);
+    cl.def("StopBroadcast", &DriverClient::StopBroadcast);
   }
 }
 
@@ -1313,6 +1733,10 @@ void bind_unknown_unknown(std::function< py::module &(std::string const &namespa
 void bind_unknown_unknown_2(std::function< py::module &(std::string const &namespace_) > &M);
 void bind_unknown_unknown_3(std::function< py::module &(std::string const &namespace_) > &M);
 void bind_model_BDModelDriver(std::function< py::module &(std::string const &namespace_) > &M);
+void bind_comm_ReplayDriver(std::function< py::module &(std::string const &namespace_) > &M);
+void bind_comm_SyntheticDriver(std::function< py::module &(std::string const &namespace_) > &M);
+void bind_DriverManager(std::function< py::module &(std::string const &namespace_) > &M);
+void bind_DriverClient(std::function< py::module &(std::string const &namespace_) > &M);
 
 
 PYBIND11_PLUGIN(_PyDriver) {
@@ -1339,7 +1763,17 @@ PYBIND11_PLUGIN(_PyDriver) {
   bind_unknown_unknown_2(M);
   bind_unknown_unknown_3(M);
   bind_MemInfo(M);
+  bind_TimedFeederStats(M);
+  bind_SpikeTrainGenerator(M);
+  bind_RealTimeConfig(M);
+  bind_RateGovernorConfig(M);
+  bind_TagBinner(M);
+  bind_NetworkImage(M);
   bind_model_BDModelDriver(M);
+  bind_comm_ReplayDriver(M);
+  bind_comm_SyntheticDriver(M);
+  bind_DriverManager(M);
+  bind_DriverClient(M);
     bind_BDWord(M);
 
   return modules[""]->ptr();
@@ -0,0 +1,171 @@
+#include "DriverManager.h"
+#include "model/BDModelDriver.h"
+#include "BDModel.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using std::cout;
+using std::endl;
+using namespace pystorm;
+using namespace bddriver;
+
+namespace {
+
+const unsigned int kCoreId = 0;
+const BDTime kNsPerUnit = 10000; // Driver's default time unit
+
+DriverManager *MakeModelManager(unsigned int num_boards, std::vector<bdmodel::BDModel *> *models) {
+  std::vector<Driver *> drivers;
+  for (unsigned int i = 0; i < num_boards; i++) {
+    BDModelDriver *driver = new BDModelDriver();
+    models->push_back(driver->GetBDModel());
+    drivers.push_back(driver);
+  }
+  return new DriverManager(drivers);
+}
+
+/// push one output and wait for it to go out, so outputs go out in the order they're pushed
+void PushInOrder(bdmodel::BDModel *model, uint8_t ep_code, BDWord word) {
+  model->PushOutput(ep_code, {word});
+  auto start = std::chrono::steady_clock::now();
+  while (model->HasPendingOutputs() && std::chrono::steady_clock::now() - start < std::chrono::seconds(2)) {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+void PushHB(bdmodel::BDModel *model, const bdpars::BDPars *pars, BDTime HB) {
+  PushInOrder(model, pars->UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_HB_LSB), HB);
+  PushInOrder(model, pars->UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_HB_MSB), 0);
+}
+
+bool WaitForHB(Driver *driver, BDTime HB) {
+  auto start = std::chrono::steady_clock::now();
+  while (driver->GetLatestHBTime() != HB * kNsPerUnit) {
+    if (std::chrono::steady_clock::now() - start > std::chrono::seconds(2)) return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+TEST(DriverManagerTest, AlignTimeAndMerge) {
+  std::vector<bdmodel::BDModel *> models;
+  DriverManager *manager = MakeModelManager(2, &models);
+  ASSERT_EQ(manager->Start(), 0);
+
+  const bdpars::BDPars *pars = manager->Board(0)->GetBDPars();
+  const uint8_t LSB_code = pars->UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_HB_LSB);
+  const uint8_t MSB_code = pars->UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_HB_MSB);
+  const uint8_t NRNI_code = pars->UpEPCodeFor(bdpars::BDFunnelEP::NRNI);
+
+  // the models stand in for FPGAs: both send an HB every 6 ms, board 1's clock is 50 ms ahead.
+  // The LSB and MSB go out separately so the decoder sees them in order
+  const unsigned int kHBPeriodMs = 6;
+  const BDTime kBoard1AheadUnits = 5000;
+  std::atomic<bool> running(true);
+  std::thread fpgas([&] {
+    BDTime HB = 0;
+    while (running) {
+      HB += kHBPeriodMs * 1000000 / kNsPerUnit;
+      models[0]->PushOutput(LSB_code, {HB});
+      models[1]->PushOutput(LSB_code, {HB + kBoard1AheadUnits});
+      std::this_thread::sleep_for(std::chrono::milliseconds(kHBPeriodMs / 2));
+      models[0]->PushOutput(MSB_code, {0});
+      models[1]->PushOutput(MSB_code, {0});
+      std::this_thread::sleep_for(std::chrono::milliseconds(kHBPeriodMs / 2));
+    }
+  });
+
+  manager->AlignTime(8, 2000000);
+  EXPECT_EQ(manager->GetTimeOffset(0), 0);
+  EXPECT_NEAR(manager->GetTimeOffset(1), -static_cast<int64_t>(kBoard1AheadUnits * kNsPerUnit), 5000000);
+
+  // spikes from both boards at about the same time line up on the shared time base
+  const unsigned int M = 16;
+  for (unsigned int i = 0; i < M; i++) {
+    models[1]->PushOutput(NRNI_code, {i});
+    models[0]->PushOutput(NRNI_code, {i});
+    std::this_thread::sleep_for(std::chrono::milliseconds(kHBPeriodMs));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::vector<unsigned int> boards;
+  std::vector<BDWord> spikes;
+  std::vector<BDTime> times;
+  std::tie(boards, spikes, times) = manager->RecvSpikes(kCoreId);
+  ASSERT_EQ(spikes.size(), 2 * M);
+
+  std::vector<std::vector<BDTime>> board_times(2);
+  for (unsigned int i = 0; i < spikes.size(); i++) {
+    if (i > 0) {
+      EXPECT_LE(times[i-1], times[i]);
+    }
+    board_times.at(boards[i]).push_back(times[i]);
+  }
+  ASSERT_EQ(board_times[0].size(), M);
+  ASSERT_EQ(board_times[1].size(), M);
+  for (unsigned int i = 0; i < M; i++) {
+    EXPECT_NEAR(static_cast<double>(board_times[0][i]), static_cast<double>(board_times[1][i]), 2 * kHBPeriodMs * 1e6);
+  }
+
+  running = false;
+  fpgas.join();
+  manager->Stop();
+  delete manager;
+}
+
+TEST(DriverManagerTest, HoldsWordsPastSlowestBoard) {
+  std::vector<bdmodel::BDModel *> models;
+  DriverManager *manager = MakeModelManager(2, &models);
+  ASSERT_EQ(manager->Start(), 0);
+
+  const bdpars::BDPars *pars = manager->Board(0)->GetBDPars();
+  const uint8_t NRNI_code = pars->UpEPCodeFor(bdpars::BDFunnelEP::NRNI);
+
+  // each spike is stamped with the HB before it. Board 1 runs behind board 0
+  PushHB(models[0], pars, 100);
+  PushInOrder(models[0], NRNI_code, 0);
+  PushHB(models[0], pars, 200);
+  PushHB(models[1], pars, 10);
+  PushInOrder(models[1], NRNI_code, 1);
+  PushHB(models[1], pars, 20);
+  ASSERT_TRUE(WaitForHB(manager->Board(0), 200));
+  ASSERT_TRUE(WaitForHB(manager->Board(1), 20));
+
+  // board 1 has only reached 20, board 0's spike at 100 waits
+  std::vector<unsigned int> boards;
+  std::vector<BDWord> spikes;
+  std::vector<BDTime> times;
+  std::tie(boards, spikes, times) = manager->RecvSpikes(kCoreId);
+  EXPECT_EQ(boards, std::vector<unsigned int>({1}));
+  EXPECT_EQ(times, std::vector<BDTime>({10 * kNsPerUnit}));
+
+  // board 1's next spike is older than the held one, and comes out first
+  PushInOrder(models[1], NRNI_code, 2);
+  PushHB(models[1], pars, 300);
+  ASSERT_TRUE(WaitForHB(manager->Board(1), 300));
+  std::tie(boards, spikes, times) = manager->RecvSpikes(kCoreId);
+  EXPECT_EQ(boards, std::vector<unsigned int>({1, 0}));
+  EXPECT_EQ(times, std::vector<BDTime>({20 * kNsPerUnit, 100 * kNsPerUnit}));
+
+  // past board 0's HB, only drain gets it
+  PushInOrder(models[1], NRNI_code, 3);
+  PushHB(models[1], pars, 400);
+  ASSERT_TRUE(WaitForHB(manager->Board(1), 400));
+  std::tie(boards, spikes, times) = manager->RecvSpikes(kCoreId);
+  EXPECT_EQ(spikes.size(), 0u);
+  std::tie(boards, spikes, times) = manager->RecvSpikes(kCoreId, true);
+  EXPECT_EQ(boards, std::vector<unsigned int>({1}));
+  EXPECT_EQ(times, std::vector<BDTime>({300 * kNsPerUnit}));
+
+  manager->Stop();
+  delete manager;
+}
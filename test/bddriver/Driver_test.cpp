@@ -1,6 +1,9 @@
 #include "model/BDModelDriver.h"
+#include "comm/SyntheticDriver.h"
 #include "BDModel.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <random>
@@ -137,6 +140,34 @@ TEST_F(DriverFixture, TestSendTags) {
   SendTags();
 }
 
+TEST_F(DriverFixture, TestSendTagsStreamed) {
+  std::vector<BDWord> tags = MakeRandomInputTags(M);
+  std::vector<BDTime> times;
+  for (unsigned int i = 0; i < tags.size(); i++) {
+    times.push_back(i*10000); // all well inside the default window
+  }
+  driver->SendTags(kCoreId, tags, times, false);
+  driver->FlushStreamed();
+  sent_tags.insert(sent_tags.end(), tags.begin(), tags.end());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  TimedFeederStats stats = driver->GetStreamStats();
+  EXPECT_EQ(stats.num_pending, 0);
+  EXPECT_GE(stats.num_released, tags.size());
+}
+
+TEST_F(DriverFixture, TestSendSpikeTrains) {
+  // 1 kHz regular train for 50 ms, inside the default stream window
+  BDWord tag = PackWord<InputTag>({{InputTag::TAG, 5}, {InputTag::COUNT, 1}});
+  driver->AddSpikeTrains(kCoreId, {tag}, SpikeTrainType::REGULAR, {0}, {{1000.0}}, 50000000);
+  sent_tags.insert(sent_tags.end(), 49, tag); // first spike 1 ms in, last one before the stop
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  SpikeTrainGeneratorStats stats = driver->GetSpikeTrainStats();
+  EXPECT_EQ(stats.num_generated, 49);
+  EXPECT_EQ(stats.num_active, 0);
+}
+
 TEST_F(DriverFixture, TestDownStreamCalls) {
   driver->SetMem(kCoreId, bdpars::BDMemId::PAT, MakeRandomPATData(M), 0);
   driver->SetMem(kCoreId, bdpars::BDMemId::TAT0, MakeRandomTATData(M), 0);
@@ -146,6 +177,138 @@ TEST_F(DriverFixture, TestDownStreamCalls) {
   SendSpikes();
 }
 
+TEST_F(DriverFixture, TestLoadNetworkImage) {
+  const std::string filename = "Driver_test.bdni";
+  BDState before = driver->GetState(kCoreId)->Snapshot();
+
+  driver->BeginNetworkImage();
+  driver->SetMem(kCoreId, bdpars::BDMemId::PAT, MakeRandomPATData(M), 0);
+  driver->SetMem(kCoreId, bdpars::BDMemId::TAT0, MakeRandomTATData(M), 0);
+  driver->SetMem(kCoreId, bdpars::BDMemId::TAT1, MakeRandomTATData(M), 0);
+  driver->SetMem(kCoreId, bdpars::BDMemId::AM, MakeRandomAMData(M), 0);
+  driver->SetMem(kCoreId, bdpars::BDMemId::MM, MakeRandomMMData(M), 0);
+  driver->SetDACCount(kCoreId, bdpars::BDHornEP::DAC_SYN_LK, 20);
+  driver->SetSpikeDumpState(kCoreId, true);
+  NetworkImage image = driver->EndNetworkImage();
+
+  // nothing was sent, driver state is back to what it was
+  EXPECT_TRUE(driver->GetState(kCoreId)->Diff(before).Empty());
+  EXPECT_FALSE(image.states[kCoreId].Diff(before).Empty());
+  EXPECT_EQ(image.num_AM_dump_words[kCoreId], M);
+  ASSERT_GT(image.blocks.size(), 0);
+  for (auto &it : image.blocks) {
+    EXPECT_EQ(it.size() % driverpars::WRITE_BLOCK_SIZE, 0);
+    EXPECT_LE(it.size(), driverpars::MAX_WRITE_SIZE);
+  }
+
+  ASSERT_TRUE(image.Save(filename));
+  NetworkImage loaded;
+  ASSERT_TRUE(loaded.Load(filename, driver->GetBDPars()));
+  EXPECT_EQ(loaded.blocks, image.blocks);
+  EXPECT_TRUE(loaded.states[kCoreId].Diff(image.states[kCoreId]).Empty());
+  std::remove(filename.c_str());
+
+  driver->LoadNetworkImage(loaded);
+  EXPECT_TRUE(driver->GetState(kCoreId)->Diff(image.states[kCoreId]).Empty());
+
+  // the model saw the same traffic (checked in TearDown), and traffic still flows
+  SendSpikes();
+}
+
+TEST_F(DriverFixture, TestAttachBD) {
+  const std::string filename = "Driver_test.bdat";
+
+  driver->InitBD();
+
+  driver->SetMem(kCoreId, bdpars::BDMemId::PAT, MakeRandomPATData(M), 0);
+  driver->SetMem(kCoreId, bdpars::BDMemId::TAT0, MakeRandomTATData(M), 0);
+  driver->SetMem(kCoreId, bdpars::BDMemId::TAT1, MakeRandomTATData(M), 0);
+  driver->SetMem(kCoreId, bdpars::BDMemId::AM, MakeRandomAMData(M), 0);
+  std::vector<BDWord> MM_data = MakeRandomMMData(M);
+  for (auto &it : MM_data) {
+    if (it == 0) it = 1; // 0 is the default, it would look free after attaching
+  }
+  driver->SetMem(kCoreId, bdpars::BDMemId::MM, MM_data, 0);
+  driver->SetDACCount(kCoreId, bdpars::BDHornEP::DAC_SYN_LK, 20);
+  ASSERT_TRUE(driver->SaveAttachState(filename));
+  uint64_t fingerprint = driver->GetState(kCoreId)->Fingerprint();
+
+  // the chip still holds the saved state
+  EXPECT_TRUE(driver->AttachBD(filename, {fingerprint}));
+  EXPECT_EQ(driver->GetState(kCoreId)->Fingerprint(), fingerprint);
+
+  // traffic still flows
+  SendSpikes();
+  std::this_thread::sleep_for(std::chrono::seconds(kSleepS));
+
+  // the attached network's entries are taken, the next one is staged after them
+  for (auto mem_id : {bdpars::BDMemId::TAT0, bdpars::BDMemId::TAT1, bdpars::BDMemId::AM, bdpars::BDMemId::MM}) {
+    EXPECT_FALSE(driver->ReserveMem(kCoreId, mem_id, 0, M));
+    EXPECT_EQ(driver->AllocMem(kCoreId, mem_id, M), M);
+  }
+  EXPECT_FALSE(driver->StageMem(kCoreId, bdpars::BDMemId::MM, MakeRandomMMData(M), 0));
+  EXPECT_TRUE(driver->StageMem(kCoreId, bdpars::BDMemId::MM, MakeRandomMMData(M), M));
+  EXPECT_TRUE(driver->StageMem(kCoreId, bdpars::BDMemId::AM, MakeRandomAMData(M), M));
+
+  // someone else reprogrammed the chip since, falls back to InitBD
+  driver->SetMem(kCoreId, bdpars::BDMemId::PAT, std::vector<BDWord>(M, BDWord(0)), 0);
+  EXPECT_FALSE(driver->AttachBD(filename));
+  EXPECT_NE(driver->GetState(kCoreId)->Fingerprint(), fingerprint);
+
+  std::remove(filename.c_str());
+}
+
+TEST_F(DriverFixture, TestSwapNetwork) {
+  // pausing only costs anything if traffic is on
+  driver->SetSpikeTrafficState(kCoreId, true);
+
+  // network A, programmed in place
+  BDTime paused_before = driver->GetTrafficPausedTime(kCoreId);
+  driver->SetMem(kCoreId, bdpars::BDMemId::PAT, MakeRandomPATData(M), 0);
+  driver->SetMem(kCoreId, bdpars::BDMemId::TAT0, MakeRandomTATData(M), 0);
+  driver->SetMem(kCoreId, bdpars::BDMemId::AM, MakeRandomAMData(M), 0);
+  driver->SetMem(kCoreId, bdpars::BDMemId::MM, MakeRandomMMData(M), 0);
+  BDTime in_place_ns = driver->GetTrafficPausedTime(kCoreId) - paused_before;
+
+  for (auto mem_id : {bdpars::BDMemId::TAT0, bdpars::BDMemId::AM, bdpars::BDMemId::MM}) {
+    ASSERT_TRUE(driver->ReserveMem(kCoreId, mem_id, 0, M, true));
+    EXPECT_FALSE(driver->ReserveMem(kCoreId, mem_id, M / 2, M));
+  }
+
+  // network B, staged next to it while traffic flows
+  paused_before = driver->GetTrafficPausedTime(kCoreId);
+  SendSpikes();
+  std::vector<BDWord> TAT0_data = MakeRandomTATData(M);
+  int TAT0_start = driver->AllocMem(kCoreId, bdpars::BDMemId::TAT0, M);
+  int AM_start = driver->AllocMem(kCoreId, bdpars::BDMemId::AM, M);
+  int MM_start = driver->AllocMem(kCoreId, bdpars::BDMemId::MM, M);
+  ASSERT_EQ(TAT0_start, M);
+  ASSERT_EQ(AM_start, M);
+  ASSERT_EQ(MM_start, M);
+  EXPECT_TRUE(driver->StageMem(kCoreId, bdpars::BDMemId::TAT0, TAT0_data, TAT0_start));
+  EXPECT_TRUE(driver->StageMem(kCoreId, bdpars::BDMemId::AM, MakeRandomAMData(M), AM_start));
+  EXPECT_TRUE(driver->StageMem(kCoreId, bdpars::BDMemId::MM, MakeRandomMMData(M), MM_start));
+  EXPECT_FALSE(driver->StageMem(kCoreId, bdpars::BDMemId::MM, MakeRandomMMData(M), 0)); // A is using it
+  EXPECT_EQ(driver->GetTrafficPausedTime(kCoreId), paused_before);
+
+  // repoint the PAT and the first TAT entry
+  driver->SwapNetwork(kCoreId, MakeRandomPATData(M), 0, {{0, TAT0_data[0]}});
+  BDTime swap_ns = driver->GetTrafficPausedTime(kCoreId) - paused_before;
+  SendSpikes();
+
+  EXPECT_LT(swap_ns, in_place_ns);
+
+  // A's entries are free for the next network, except the TAT entry point B now uses
+  for (auto mem_id : {bdpars::BDMemId::TAT0, bdpars::BDMemId::AM, bdpars::BDMemId::MM}) {
+    const unsigned int B_entries = mem_id == bdpars::BDMemId::TAT0 ? 1 : 0;
+    std::vector<BDStateRange> free_ranges = driver->GetFreeMem(kCoreId, mem_id);
+    ASSERT_GT(free_ranges.size(), 0);
+    EXPECT_EQ(free_ranges[0].start, B_entries);
+    EXPECT_EQ(free_ranges[0].count, M - B_entries);
+  }
+  EXPECT_FALSE(driver->ReserveMem(kCoreId, bdpars::BDMemId::TAT0, 0, 1));
+}
+
 // upstream-downstream tests
 
 // for dump tests, need to program before dumping
@@ -212,6 +375,30 @@ TEST_F(DriverFixture, TestRecvSpikes) {
   ASSERT_EQ(driver->RecvSpikes(kCoreId).first, to_send);
 }
 
+TEST_F(DriverFixture, TestBroadcast) {
+  ASSERT_TRUE(driver->StartBroadcast("bddriver_test_broadcast"));
+  ShmRingReader reader;
+  ASSERT_TRUE(reader.Open("bddriver_test_broadcast"));
+
+  const uint8_t NRNI_code = driver->GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::NRNI);
+  auto to_send = MakeRandomNrnSpikes(M);
+  model->PushOutput(NRNI_code, to_send);
+  std::this_thread::sleep_for(std::chrono::seconds(2));
+
+  // the reader sees the spikes, and they're still there for the driver
+  std::vector<ShmOutput> records;
+  EXPECT_EQ(reader.Read(&records), 0);
+  std::vector<BDWord> broadcast;
+  for (auto& it : records) {
+    if (it.ep_code == NRNI_code) broadcast.push_back(it.payload);
+  }
+  EXPECT_EQ(broadcast, to_send);
+  ASSERT_EQ(driver->RecvSpikes(kCoreId).first, to_send);
+
+  driver->StopBroadcast();
+  EXPECT_EQ(driver->GetBroadcastCount(), 0);
+}
+
 TEST_F(DriverFixture, TestRecvTags) {
   auto to_send = MakeRandomInputTags(M);
   model->PushOutput(driver->GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::RO_TAT), to_send); // XXX not testing acc, has a smaller gtag width, would have to limit gtag size
@@ -256,3 +443,772 @@ TEST_F(DriverFixture, TestFIFOOverflow) {
 
   ASSERT_EQ(driver->GetFIFOOverflowCounts(kCoreId), to_push);
 }
+
+// exposes the timed queue, so we can replay what was sent to the SGs
+class SGTestDriver : public BDModelDriver {
+ public:
+  using Driver::timed_queue_;
+  using Driver::PackSGProgWord;
+};
+
+TEST(DriverSGTest, IncrementalSGUpdates) {
+  // rate sweep over all 256 generators, a few rates change every step
+  const unsigned int N = 256;
+  const unsigned int T = 200;
+  const unsigned int changes_per_step = 8;
+  const BDTime step_ns = 1000000; // default ns_per_unit_ = 10000
+  const unsigned int kCoreId = 0;
+
+  std::default_random_engine generator(0);
+  std::uniform_int_distribution<unsigned int> gen_dist(0, N - 1);
+  std::uniform_int_distribution<int> rate_dist(-250, 1000);
+
+  std::vector<std::vector<int>> rates(T, std::vector<int>(N));
+  for (auto& it : rates[0]) it = rate_dist(generator);
+  for (unsigned int t = 1; t < T; t++) {
+    rates[t] = rates[t-1];
+    for (unsigned int i = 0; i < changes_per_step; i++) {
+      // about 1 in 5 turns a generator off
+      int rate = rate_dist(generator);
+      rates[t][gen_dist(generator)] = rate < 0 ? 0 : rate;
+    }
+  }
+
+  std::vector<unsigned int> gen_idxs(N), tags(N);
+  for (unsigned int i = 0; i < N; i++) {
+    gen_idxs[i] = i;
+    tags[i] = 2 * i;
+  }
+
+  // drivers aren't started, everything stays in the timed queue
+
+  // one SetSpikeGeneratorRates() call per step
+  SGTestDriver per_step;
+  for (unsigned int t = 0; t < T; t++) {
+    per_step.SetSpikeGeneratorRates(kCoreId, gen_idxs, tags, rates[t], (t + 1) * step_ns, false);
+  }
+  uint64_t per_step_words = per_step.GetNumSGWordsSent(kCoreId);
+
+  // one schedule for the whole sweep
+  SGTestDriver scheduled;
+  std::vector<BDTime> sched_times;
+  std::vector<unsigned int> sched_gens, sched_tags;
+  std::vector<int> sched_rates;
+  for (unsigned int t = 0; t < T; t++) {
+    sched_times.insert(sched_times.end(), N, (t + 1) * step_ns);
+    sched_gens.insert(sched_gens.end(), gen_idxs.begin(), gen_idxs.end());
+    sched_tags.insert(sched_tags.end(), tags.begin(), tags.end());
+    sched_rates.insert(sched_rates.end(), rates[t].begin(), rates[t].end());
+  }
+  unsigned int sched_words = scheduled.SetSpikeGeneratorRateSchedule(kCoreId, sched_times, sched_gens, sched_tags, sched_rates, false);
+  EXPECT_EQ(sched_words, scheduled.GetNumSGWordsSent(kCoreId));
+
+  // what we used to send: every program word, all 16 enable words, SG_GENS_USED
+  const uint64_t full_rewrite_words = T * (N + N / 16 + 1);
+  EXPECT_LT(per_step_words, full_rewrite_words);
+  // first step programs everything, later ones at most the changed program words,
+  // their enable words, and SG_GENS_USED
+  EXPECT_LE(sched_words, (N + N / 16 + 1) + (T - 1) * (2 * changes_per_step + 1));
+
+  // replay what the schedule sent, check the FPGA's SG state after every step
+  const bdpars::BDPars * pars = scheduled.GetBDPars();
+  const uint8_t prog_ep = pars->DnEPCodeFor(bdpars::FPGAChannelEP::SG_PROGRAM_MEM);
+  const uint8_t used_ep = pars->DnEPCodeFor(bdpars::FPGARegEP::SG_GENS_USED);
+  const uint8_t en0_ep = pars->DnEPCodeFor(bdpars::FPGARegEP::SG_GENS_EN0);
+
+  std::vector<EncInput> sent = scheduled.timed_queue_;
+  std::sort(sent.begin(), sent.end());
+
+  std::vector<BDWord> prog_mem(N, 0);
+  std::vector<uint16_t> en_words(N / 16, 0);
+  unsigned int gens_used = 0;
+
+  unsigned int j = 0;
+  for (unsigned int t = 0; t < T; t++) {
+    BDTime step_units = (t + 1) * step_ns / 10000;
+    while (j < sent.size() && sent[j].time <= step_units) {
+      uint8_t ep = sent[j].FPGA_ep_code;
+      if (ep == prog_ep) {
+        ASSERT_LE(j + 4, sent.size());
+        BDWord word = PackWord<FOURFPGAREGS>({
+            {FOURFPGAREGS::W0, sent[j].payload}, {FOURFPGAREGS::W1, sent[j+1].payload},
+            {FOURFPGAREGS::W2, sent[j+2].payload}, {FOURFPGAREGS::W3, sent[j+3].payload}});
+        prog_mem.at(GetField(word, FPGASGWORD::GENIDX)) = word;
+        j += 4;
+      } else if (ep == used_ep) {
+        gens_used = sent[j].payload;
+        j++;
+      } else {
+        ASSERT_GE(ep, en0_ep);
+        ASSERT_LT(ep, en0_ep + N / 16);
+        en_words.at(ep - en0_ep) = sent[j].payload;
+        j++;
+      }
+    }
+
+    unsigned int highest_en = 0;
+    for (unsigned int g = 0; g < N; g++) {
+      bool en = (en_words[g / 16] >> (g % 16)) & 1;
+      ASSERT_EQ(en, rates[t][g] != 0) << "step " << t << " gen " << g;
+      if (en) {
+        ASSERT_EQ(prog_mem[g], scheduled.PackSGProgWord(g, tags[g], rates[t][g])) << "step " << t << " gen " << g;
+        highest_en = g + 1;
+      }
+    }
+    ASSERT_EQ(gens_used, highest_en) << "step " << t;
+  }
+  EXPECT_EQ(j, sent.size());
+}
+
+// upstream spike -> closed-loop callback -> downstream tag, through BDModel.
+// Returns response times in us
+std::vector<double> MeasureLoopbackLatency(BDModelDriver * driver, unsigned int N) {
+  bdmodel::BDModel * model = driver->GetBDModel();
+  const uint8_t NRNI_code = driver->GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::NRNI);
+
+  // respond to each spike with a tag carrying the same address
+  driver->SetClosedLoopCallback(0, NRNI_code,
+      [](const std::vector<BDWord>& words, const std::vector<BDTime>& times, std::vector<BDWord>* response_tags) {
+        for (auto& it : words) {
+          response_tags->push_back(PackWord<InputTag>({{InputTag::TAG, it % 2048}, {InputTag::COUNT, 1}}));
+        }
+      }, true);
+
+  std::vector<double> latencies_us;
+  for (unsigned int i = 0; i < N; i++) {
+    BDWord spike = i % 2048;
+    auto t0 = std::chrono::steady_clock::now();
+    model->PushOutput(NRNI_code, {spike});
+
+    std::vector<BDWord> tags;
+    while (tags.size() == 0) {
+      std::this_thread::yield();
+      tags = model->PopTags();
+      if (std::chrono::steady_clock::now() - t0 > std::chrono::seconds(1)) break;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(tags.size(), 1);
+    if (tags.size() > 0) {
+      EXPECT_EQ(GetField(tags[0], InputTag::TAG), spike);
+    }
+    latencies_us.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+  }
+
+  driver->ClearClosedLoopCallback(0, NRNI_code);
+  std::sort(latencies_us.begin(), latencies_us.end());
+  return latencies_us;
+}
+
+double Percentile(const std::vector<double>& sorted, double p) {
+  return sorted.at(static_cast<unsigned int>(p * (sorted.size() - 1)));
+}
+
+TEST(DriverClosedLoopTest, LoopbackLatency) {
+  const unsigned int N = 1000; // enough for a p999
+
+  BDModelDriver driver;
+  driver.Start();
+
+  std::vector<double> normal = MeasureLoopbackLatency(&driver, N);
+  // a few ms of buffer timeouts, nowhere near the 1 s give-up
+  EXPECT_LT(Percentile(normal, .99), 50000);
+
+  // pin if there's room, don't ask for SCHED_FIFO/mlock (needs privileges, and
+  // spinning SCHED_FIFO threads on a shared CPU can starve the machine)
+  RealTimeConfig config;
+  config.spin_us = 200;
+  if (std::thread::hardware_concurrency() >= 4) {
+    config.comm_cpu = 1;
+    config.enc_cpu  = 2;
+    config.dec_cpu  = 3;
+  }
+  EXPECT_TRUE(driver.SetRealTimeMode(config));
+
+  std::vector<double> realtime = MeasureLoopbackLatency(&driver, N);
+  // spinning skips the timeouts
+  EXPECT_LT(Percentile(realtime, .5), Percentile(normal, .5));
+
+  EXPECT_TRUE(driver.SetRealTimeMode(RealTimeConfig()));
+  driver.Stop();
+}
+
+TEST(DriverMultiCoreTest, RoutesEachCore) {
+  const unsigned int kNumCores = 3;
+  const unsigned int M = 64;
+  const unsigned int K = 8192;
+
+  BDModelDriver driver(kNumCores);
+  driver.Start();
+
+  driver.InitBD();
+
+  const uint8_t NRNI_code = driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::NRNI);
+
+  std::vector<std::vector<BDWord>> sent_spikes(kNumCores);
+  for (unsigned int i = 0; i < kNumCores; i++) {
+    // each core gets different memory contents and a different number of spikes
+    driver.SetMem(i, bdpars::BDMemId::MM, MakeRandomMMData(M), i * M);
+
+    std::vector<BDWord> spikes = MakeRandomSynSpikes(M * (i + 1));
+    driver.SendSpikes(i, spikes, std::vector<BDTime>(spikes.size(), 0));
+    sent_spikes[i] = spikes;
+  }
+  // then a larger batch for every core, behind one flush
+  for (unsigned int i = 0; i < kNumCores; i++) {
+    std::vector<BDWord> spikes = MakeRandomSynSpikes(K);
+    driver.SendSpikes(i, spikes, std::vector<BDTime>(K, 0), false);
+    sent_spikes[i].insert(sent_spikes[i].end(), spikes.begin(), spikes.end());
+  }
+  driver.Flush();
+
+  // and each model sends spikes with its core id
+  for (unsigned int i = 0; i < kNumCores; i++) {
+    driver.GetBDModel(i)->PushOutput(NRNI_code, std::vector<BDWord>(i + 1, BDWord(i)));
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(2));
+
+  for (unsigned int i = 0; i < kNumCores; i++) {
+    std::vector<BDWord> recvd = driver.RecvSpikes(i).first;
+    EXPECT_EQ(recvd, std::vector<BDWord>(i + 1, BDWord(i)));
+  }
+
+  driver.Stop();
+
+  for (unsigned int i = 0; i < kNumCores; i++) {
+    bdmodel::BDModel *model = driver.GetBDModel(i);
+    const BDState *model_state = model->LockState();
+    EXPECT_EQ(*model_state, *driver.GetState(i));
+    model->UnlockState();
+    EXPECT_EQ(model->PopSpikes(), sent_spikes[i]);
+  }
+}
+
+// splits DumpMem() so the receive can be timed apart from the wait for the dump
+class DumpTestDriver : public BDModelDriver {
+ public:
+  using BDModelDriver::DumpMemSend;
+  using BDModelDriver::IssuePushWords;
+  using BDModelDriver::DumpMemRecv;
+};
+
+// two-word outputs (memory dumps, tags, SF states) under load:
+// receiving whole dumps, then a large backlog of tags in one call, then keeping up with a stream of them
+TEST(DriverWideEPTest, DumpAndStreamThroughput) {
+  {
+    DumpTestDriver driver;
+    driver.Start();
+    driver.InitBD();
+    for (bdpars::BDMemId mem_id : {bdpars::BDMemId::AM, bdpars::BDMemId::TAT0, bdpars::BDMemId::TAT1}) {
+      unsigned int size = driver.GetBDPars()->mem_info_.at(mem_id).size;
+      auto data = mem_id == bdpars::BDMemId::AM ? MakeRandomAMData(size) : MakeRandomTATData(size);
+      driver.SetMem(0, mem_id, data, 0);
+
+      driver.DumpMemSend(0, mem_id, 0, size);
+      driver.IssuePushWords();
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      auto t0 = std::chrono::steady_clock::now();
+      EXPECT_EQ(driver.DumpMemRecv(0, mem_id, size, 0), data);
+      double recv_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+      // the dump's already there, nothing to wait for
+      EXPECT_LT(recv_ms, 100);
+    }
+    driver.Stop();
+  }
+
+  SyntheticDriver driver;
+  driver.SetTimePerUpHB(1000000);
+  driver.Start();
+
+  // backlog, nobody receives until the traffic stops
+  comm::SyntheticLoad load;
+  load.tat_tag_rate = 1e6;
+  driver.SetLoad(load);
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  driver.SetLoad(comm::SyntheticLoad());
+  for (unsigned int i = 0; i < 1000 && (driver.GetDecoderQueueBytes() > 0 || driver.GetSyntheticStats().backlog_words > 0); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  uint64_t num_tat_tags = driver.GetSyntheticStats().num_tat_tags;
+  auto t0 = std::chrono::steady_clock::now();
+  auto tags = driver.RecvTags(0, 1);
+  double recv_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  EXPECT_EQ(tags.first.size(), num_tat_tags);
+  // tens of M tags/s on the model build
+  EXPECT_GT(num_tat_tags / recv_ms / 1e3, 1);
+
+  // stream, a consumer polls every ms
+  load.tat_tag_rate = 1e6;
+  load.sf_state_rate = 1e6;
+  driver.SetLoad(load);
+  uint64_t received = 0;
+  t0 = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - t0 < std::chrono::seconds(1)) {
+    received += driver.RecvTags(0, 1).first.size();
+    received += std::get<0>(driver.RecvSpikeFilterStates(0, 1)).size();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  unsigned int queue_bytes = driver.GetDecoderQueueBytes();
+  comm::SyntheticStats stats = driver.GetSyntheticStats();
+  driver.SetLoad(comm::SyntheticLoad());
+  uint64_t generated = stats.num_tat_tags - num_tat_tags + stats.num_sf_states;
+  // the consumer keeps up, and the decoder isn't running behind
+  EXPECT_GT(received, generated / 2);
+  EXPECT_LT(queue_bytes, driverpars::READ_LAG_WARNING_SIZE);
+
+  driver.Stop();
+}
+
+// exposes the decoder output buffers, so outputs can be put there directly
+class RecvTestDriver : public BDModelDriver {
+ public:
+  using Driver::dec_bufs_out_;
+  using Driver::UnitsToNs;
+
+  void PushOutputs(bdpars::BDFunnelEP ep, const std::vector<BDTime> &times) {
+    auto outputs = std::make_unique<std::vector<DecOutput>>();
+    for (auto& it : times) {
+      outputs->push_back({it, it}); // payload = time
+    }
+    dec_bufs_out_.at(0).at(GetBDPars()->UpEPCodeFor(ep))->Push(std::move(outputs));
+  }
+};
+
+TEST(DriverRecvFromEPsTest, MergesInTimeOrder) {
+  RecvTestDriver driver;
+  const uint8_t TAT_code = driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::RO_TAT);
+  const uint8_t ACC_code = driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::RO_ACC);
+
+  // two pushes to TAT, one to ACC, with a tie
+  driver.PushOutputs(bdpars::BDFunnelEP::RO_TAT, {1, 3});
+  driver.PushOutputs(bdpars::BDFunnelEP::RO_ACC, {2, 3, 4});
+  driver.PushOutputs(bdpars::BDFunnelEP::RO_TAT, {5});
+
+  auto recvd = driver.RecvFromEPs(0, {TAT_code, ACC_code}, 1000);
+  std::vector<uint8_t> expected_codes = {TAT_code, ACC_code, TAT_code, ACC_code, ACC_code, TAT_code};
+  std::vector<BDWord> expected_words = {1, 2, 3, 3, 4, 5};
+  std::vector<BDTime> expected_times;
+  for (auto& it : expected_words) {
+    expected_times.push_back(driver.UnitsToNs(it));
+  }
+  EXPECT_EQ(std::get<0>(recvd), expected_codes);
+  EXPECT_EQ(std::get<1>(recvd), expected_words);
+  EXPECT_EQ(std::get<2>(recvd), expected_times);
+
+  // RecvTags is the same, minus the codes
+  driver.PushOutputs(bdpars::BDFunnelEP::RO_ACC, {7});
+  driver.PushOutputs(bdpars::BDFunnelEP::RO_TAT, {8, 9});
+  driver.PushOutputs(bdpars::BDFunnelEP::RO_ACC, {9});
+  auto tags = driver.RecvTags(0, 1000);
+  EXPECT_EQ(tags.first, std::vector<BDWord>({7, 8, 9, 9}));
+}
+
+TEST(DriverRecvFromEPsTest, SingleDeadline) {
+  RecvTestDriver driver;
+  std::vector<uint8_t> codes = {
+    driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::RO_TAT),
+    driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::RO_ACC),
+    driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::OVFLW0),
+    driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::OVFLW1)};
+
+  // nothing comes: one timeout, not one per ep
+  auto t0 = std::chrono::steady_clock::now();
+  auto recvd = driver.RecvFromEPs(0, codes, 100000);
+  double waited_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  EXPECT_EQ(std::get<0>(recvd).size(), 0);
+  EXPECT_GE(waited_ms, 100);
+  EXPECT_LT(waited_ms, 200);
+
+  // something comes on the last ep: wakes up then, not at the deadline
+  std::thread pusher([&driver] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    driver.PushOutputs(bdpars::BDFunnelEP::OVFLW1, {1});
+  });
+  t0 = std::chrono::steady_clock::now();
+  recvd = driver.RecvFromEPs(0, codes, 5000000);
+  waited_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  pusher.join();
+  EXPECT_EQ(std::get<0>(recvd), std::vector<uint8_t>({codes[3]}));
+  EXPECT_LT(waited_ms, 1000);
+
+  // the overflow counts go through the same wait
+  driver.PushOutputs(bdpars::BDFunnelEP::OVFLW0, {1, 2});
+  driver.PushOutputs(bdpars::BDFunnelEP::OVFLW1, {3});
+  EXPECT_EQ(driver.GetFIFOOverflowCounts(0), std::make_pair(2u, 1u));
+}
+
+// spikes kept by the driver can be read by range, binned, and released, and still reach RecvXYSpikes
+TEST(DriverRetentionTest, RangesBinsRelease) {
+  SyntheticDriver driver;
+  driver.SetTimePerUpHB(1000000);
+  const uint8_t NRNI_code = driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::NRNI);
+  driver.SetRetention(0, NRNI_code, 10000000000); // 10 s
+  driver.Start();
+
+  comm::SyntheticLoad load;
+  load.spike_rate = 1e5;
+  driver.SetLoad(load);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  driver.SetLoad(comm::SyntheticLoad());
+  for (unsigned int i = 0; i < 1000 && (driver.GetDecoderQueueBytes() > 0 || driver.GetSyntheticStats().backlog_words > 0); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  const uint64_t num_spikes = driver.GetSyntheticStats().num_spikes;
+  ASSERT_GT(num_spikes, 0);
+
+  EXPECT_EQ(std::get<0>(driver.RecvXYSpikes(0)).size(), num_spikes);
+
+  const BDTime end = driver.GetLatestHBTime() + 1;
+  auto all = driver.GetRetained(0, NRNI_code, 0, end);
+  ASSERT_EQ(all.first.size(), num_spikes);
+  EXPECT_EQ(driver.GetRetained(0, NRNI_code, 0, end), all); // reads don't consume
+
+  // ranges split cleanly
+  const BDTime mid = all.second[num_spikes / 2];
+  auto before = driver.GetRetained(0, NRNI_code, 0, mid);
+  auto after  = driver.GetRetained(0, NRNI_code, mid, end);
+  EXPECT_EQ(before.first.size() + after.first.size(), num_spikes);
+  for (auto& it : before.second) EXPECT_LT(it, mid);
+  for (auto& it : after.second) EXPECT_GE(it, mid);
+
+  // binned by neuron, 1 ms bins from mid
+  const unsigned int num_bins = (end - mid) / 1000000 + 1;
+  auto binned = driver.GetRetainedBinned(0, NRNI_code, mid, 1000000, num_bins);
+  EXPECT_EQ(binned.second, bdpars::BDPars::NumNeurons);
+  ASSERT_EQ(binned.first.size(), num_bins * binned.second);
+  uint64_t total = 0;
+  for (auto& it : binned.first) total += it;
+  EXPECT_EQ(total, after.first.size());
+
+  driver.ReleaseRetained(0, NRNI_code, mid);
+  EXPECT_EQ(driver.GetRetained(0, NRNI_code, 0, end), after);
+
+  driver.SetRetention(0, NRNI_code, 0);
+  EXPECT_EQ(driver.GetRetained(0, NRNI_code, 0, end).first.size(), 0);
+
+  driver.Stop();
+}
+
+class SubscriptionTestDriver : public SyntheticDriver {
+ public:
+  using Driver::RecvFromEP;
+};
+
+// spikes outside a subscription never reach a queue, routed ones go to their own
+TEST(DriverSubscriptionTest, FilterAndRoute) {
+  SubscriptionTestDriver driver;
+  driver.SetTimePerUpHB(1000000);
+  const uint8_t NRNI_code = driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::NRNI);
+  ASSERT_TRUE(driver.SetSubscription(0, NRNI_code, {{0, 1024}}));
+  ASSERT_TRUE(driver.RouteSubscription(0, NRNI_code, "low", {{0, 512}}));
+  EXPECT_FALSE(driver.SetSubscription(0, driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::DUMP_PAT), {{0, 1}}));
+  driver.Start();
+
+  comm::SyntheticLoad load;
+  load.spike_rate = 1e5;
+  driver.SetLoad(load);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  driver.SetLoad(comm::SyntheticLoad());
+  for (unsigned int i = 0; i < 1000 && (driver.GetDecoderQueueBytes() > 0 || driver.GetSyntheticStats().backlog_words > 0); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  const uint64_t num_spikes = driver.GetSyntheticStats().num_spikes;
+
+  auto high = driver.RecvFromEP(0, NRNI_code, 1);
+  auto low = driver.RecvFromQueue("low", 1);
+  for (auto& it : high.first) {
+    EXPECT_GE(it, 512);
+    EXPECT_LT(it, 1024);
+  }
+  for (auto& it : low.first) {
+    EXPECT_LT(it, 512);
+  }
+  EXPECT_GT(low.first.size(), 0);
+  EXPECT_GT(high.first.size(), 0);
+  EXPECT_EQ(high.first.size() + low.first.size() + driver.GetNumFilteredOutputs(), num_spikes);
+
+  // everything comes through again
+  driver.ClearSubscription(0, NRNI_code);
+  driver.SetLoad(load);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  driver.SetLoad(comm::SyntheticLoad());
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  uint64_t num_filtered = driver.GetNumFilteredOutputs();
+  EXPECT_GT(driver.RecvFromEP(0, NRNI_code, 1).first.size(), 0);
+  EXPECT_EQ(driver.GetNumFilteredOutputs(), num_filtered);
+
+  driver.Stop();
+}
+
+TEST(DriverTranslationTest, OutputsAndSpikes) {
+  RecvTestDriver driver;
+  auto push = [&driver](uint8_t code, const std::vector<std::pair<BDWord, BDTime>> &outputs) {
+    auto to_push = std::make_unique<std::vector<DecOutput>>();
+    for (auto& it : outputs) {
+      to_push->push_back({it.first, it.second});
+    }
+    driver.dec_bufs_out_.at(0).at(code)->Push(std::move(to_push));
+  };
+  auto SF_word = [](unsigned int filt_idx, uint64_t state) {
+    return PackWord<FPGASFWORD>({{FPGASFWORD::STATE, state}, {FPGASFWORD::FILTIDX, filt_idx}});
+  };
+
+  // filters 0, 1 are output 1 dims 0, 1, filter 2 is output 0, filter 3 isn't used
+  driver.SetOutputTable(0, {1, 1, 0, -1}, {0, 1, 0, 0});
+  const uint64_t minus_2 = (1 << FieldWidth(FPGASFWORD::STATE)) - 2;
+  push(driver.GetBDPars()->UpEPCodeFor(bdpars::FPGAOutputEP::SF_OUTPUT), {
+      {SF_word(0, 5), 1}, {SF_word(2, minus_2), 1}, {SF_word(3, 1), 1}, {SF_word(1, 20000), 2}, {SF_word(2, 7), 2}});
+
+  auto outputs = driver.RecvTranslatedOutputs(0, false, 1);
+  EXPECT_EQ(std::get<1>(outputs), std::vector<int>({1, 0, 1, 0}));
+  EXPECT_EQ(std::get<2>(outputs), std::vector<unsigned int>({0, 0, 1, 0}));
+  EXPECT_EQ(std::get<3>(outputs), std::vector<int>({5, -2, 0, 7})); // 20000 is implausible
+  EXPECT_EQ(std::get<0>(outputs), std::vector<BDTime>({driver.UnitsToNs(1), driver.UnitsToNs(1), driver.UnitsToNs(2), driver.UnitsToNs(2)}));
+
+  // somas 0-3 are pool 1, 4-7 pool 0, the rest in none
+  std::vector<int> pools(bdpars::BDPars::NumNeurons, -1);
+  std::vector<unsigned int> nrn_idxs(bdpars::BDPars::NumNeurons, 0);
+  for (unsigned int i = 0; i < 8; i++) {
+    pools[i] = i < 4 ? 1 : 0;
+    nrn_idxs[i] = i % 4;
+  }
+  driver.SetPoolTable(0, pools, nrn_idxs);
+  const uint8_t NRNI_code = driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::NRNI);
+  push(NRNI_code, {{0, 1}, {5, 2}, {100, 3}, {3, 4}, {6, 5}});
+
+  auto spikes = driver.RecvTranslatedSpikes(0, true, 1);
+  EXPECT_EQ(std::get<1>(spikes), std::vector<int>({0, 0, 1, 1}));
+  EXPECT_EQ(std::get<2>(spikes), std::vector<unsigned int>({1, 2, 0, 3}));
+  EXPECT_EQ(std::get<0>(spikes), std::vector<BDTime>({driver.UnitsToNs(2), driver.UnitsToNs(5), driver.UnitsToNs(1), driver.UnitsToNs(4)}));
+}
+
+// every generated tag (count 1) lands in a bin, whether binned as it arrives or on demand
+TEST(DriverTagBinningTest, IncrementalAndOnDemand) {
+  SyntheticDriver driver;
+  driver.SetTimePerUpHB(1000000);
+  driver.Start();
+  auto run_load = [&driver]() {
+    comm::SyntheticLoad load;
+    load.acc_tag_rate = 1e5;
+    load.tat_tag_rate = 1e5;
+    driver.SetLoad(load);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    driver.SetLoad(comm::SyntheticLoad());
+    for (unsigned int i = 0; i < 1000 && (driver.GetDecoderQueueBytes() > 0 || driver.GetSyntheticStats().backlog_words > 0); i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  };
+  auto total = [](const TagBinner &binner) {
+    int64_t sum = 0;
+    for (auto& it : binner.GetCounts()) sum += it;
+    return sum;
+  };
+  const BDTime kForever = 1000000000000;
+
+  // a closed-loop callback on one of the tag eps keeps seeing its tags, while binning and after
+  std::atomic<uint64_t> num_callback_tags(0);
+  driver.SetClosedLoopCallback(0, driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::RO_ACC),
+      [&num_callback_tags](const std::vector<BDWord>& words, const std::vector<BDTime>&, std::vector<BDWord>*) {
+        num_callback_tags += words.size();
+      });
+
+  driver.StartTagBinning(0, {0, kForever / 2, kForever});
+  run_load();
+  comm::SyntheticStats stats = driver.GetSyntheticStats();
+  TagBinner binned = driver.GetTagBinning(0);
+  EXPECT_EQ(binned.GetNumBins(), 2);
+  EXPECT_GT(stats.num_tat_tags, 0);
+  EXPECT_EQ(total(binned), stats.num_acc_tags + stats.num_tat_tags);
+  EXPECT_EQ(driver.RecvTags(0, 1).first.size(), 0); // the binner took them
+
+  // 1 ms bins from now on
+  const BDTime t0 = driver.GetLatestHBTime();
+  run_load();
+  comm::SyntheticStats stats2 = driver.GetSyntheticStats();
+  TagBinner on_demand = driver.RecvBinnedTags(0, t0, 1000000, (driver.GetLatestHBTime() - t0) / 1000000 + 1, 1);
+  EXPECT_EQ(total(on_demand) + on_demand.GetNumDropped(),
+            stats2.num_acc_tags + stats2.num_tat_tags - stats.num_acc_tags - stats.num_tat_tags);
+  EXPECT_EQ(on_demand.GetNumDropped(), 0);
+  EXPECT_EQ(num_callback_tags, stats2.num_acc_tags);
+
+  driver.ClearClosedLoopCallback(0, driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::RO_ACC));
+  driver.Stop();
+}
+
+// in count mode, the host filters' samples add up to every tag and spike generated
+TEST(DriverHostSpikeFilterTest, CountsEverything) {
+  SyntheticDriver driver;
+  driver.SetTimePerUpHB(1000000);
+  driver.Start();
+
+  ASSERT_FALSE(driver.StartHostSpikeFilters(0, 1 << 28, 1, 1000000)); // decay > 1
+  ASSERT_TRUE(driver.StartHostSpikeFilters(0, 0, 1, 1000000, true));
+
+  comm::SyntheticLoad load;
+  load.spike_rate = 1e5;
+  load.acc_tag_rate = 1e5;
+  load.tat_tag_rate = 1e5;
+  driver.SetLoad(load);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  driver.SetLoad(comm::SyntheticLoad());
+  for (unsigned int i = 0; i < 1000 && (driver.GetDecoderQueueBytes() > 0 || driver.GetSyntheticStats().backlog_words > 0); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50)); // a few more HBs, so the last outputs get sampled
+  comm::SyntheticStats stats = driver.GetSyntheticStats();
+
+  auto times_states = driver.RecvHostSpikeFilterStates(0);
+  const unsigned int kNumFilters = 2048 + 4096;
+  const std::vector<float> &states = times_states.second;
+  ASSERT_GT(times_states.first.size(), 0);
+  ASSERT_EQ(states.size(), times_states.first.size() * kNumFilters);
+  double tags = 0;
+  double spikes = 0;
+  for (unsigned int i = 0; i < states.size(); i++) {
+    (i % kNumFilters < 2048 ? tags : spikes) += states[i];
+  }
+  EXPECT_GT(stats.num_spikes, 0);
+  EXPECT_EQ(tags, stats.num_acc_tags + stats.num_tat_tags);
+  EXPECT_EQ(spikes, stats.num_spikes);
+
+  // outputs still go to their buffers, and the snapshot is the latest sample (HBs keep coming)
+  EXPECT_GT(driver.RecvTags(0, 1).first.size(), 0);
+  auto snapshot = driver.GetHostSpikeFilterSnapshot(0);
+  EXPECT_GE(snapshot.first, times_states.first.back());
+  EXPECT_EQ(snapshot.second.size(), kNumFilters);
+
+  driver.StopHostSpikeFilters(0);
+  EXPECT_EQ(driver.RecvHostSpikeFilterStates(0).first.size(), 0);
+  driver.Stop();
+}
+
+// the filters and tag binning both see every tag, and stopping the filters leaves the binning alone
+TEST(DriverHostSpikeFilterTest, SharesTagsWithBinning) {
+  SyntheticDriver driver;
+  driver.SetTimePerUpHB(1000000);
+  driver.Start();
+
+  ASSERT_TRUE(driver.StartHostSpikeFilters(0, 0, 1, 1000000));
+  driver.StartTagBinning(0, {0, 1000000000000});
+
+  auto run_load = [&driver]() {
+    comm::SyntheticLoad load;
+    load.acc_tag_rate = 1e5;
+    driver.SetLoad(load);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    driver.SetLoad(comm::SyntheticLoad());
+    for (unsigned int i = 0; i < 1000 && (driver.GetDecoderQueueBytes() > 0 || driver.GetSyntheticStats().backlog_words > 0); i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  };
+  auto total = [](const std::vector<float> &states) {
+    double sum = 0;
+    for (auto& it : states) sum += it;
+    return sum;
+  };
+
+  run_load();
+  comm::SyntheticStats stats = driver.GetSyntheticStats();
+  EXPECT_GT(stats.num_acc_tags, 0);
+  EXPECT_EQ(total(driver.RecvHostSpikeFilterStates(0).second), stats.num_acc_tags);
+
+  driver.StopHostSpikeFilters(0);
+  run_load();
+  stats = driver.GetSyntheticStats();
+  TagBinner binned = driver.GetTagBinning(0);
+  int64_t num_binned = 0;
+  for (auto& it : binned.GetCounts()) num_binned += it;
+  EXPECT_EQ(num_binned, stats.num_acc_tags);
+
+  driver.Stop();
+}
+
+// one neuron's rate shows up in the rate map, at its XY address, and spikes still get through
+TEST(DriverRateMapTest, OneNeuron) {
+  SyntheticDriver driver;
+  driver.SetTimePerUpHB(1000000);
+  driver.Start();
+  ASSERT_TRUE(driver.StartRateMap(0, 20000000, 1000000));
+  EXPECT_EQ(driver.GetRateMap(0).second.size(), 0);
+
+  comm::SyntheticLoad load;
+  load.spike_rate = 1e4;
+  load.num_neurons = 1; // AER address 0
+  driver.SetLoad(load);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+  auto time_rates = driver.GetRateMap(0);
+  ASSERT_EQ(time_rates.second.size(), 4096);
+  EXPECT_GT(time_rates.first, 0);
+  const unsigned int xy = driver.GetBDPars()->GetSomaXYAddr(0);
+  EXPECT_NEAR(time_rates.second[xy], 1e4, 3e3);
+  float others = 0;
+  for (unsigned int i = 0; i < time_rates.second.size(); i++) {
+    if (i != xy) others += time_rates.second[i];
+  }
+  EXPECT_EQ(others, 0);
+  EXPECT_GT(std::get<0>(driver.RecvXYSpikes(0)).size(), 0);
+
+  driver.SetLoad(comm::SyntheticLoad());
+  driver.StopRateMap(0);
+  driver.Stop();
+}
+
+// overflows scale governed SG rates down to the floor, and quiet brings them back up, all logged
+TEST(DriverRateGovernorTest, BacksOffAndRecovers) {
+  SyntheticDriver driver;
+  driver.SetTimePerUpHB(1000000);
+  driver.Start();
+
+  RateGovernorConfig config;
+  config.target_loss_rate = 100;
+  config.decrease = 0.5;
+  config.increase = 2;
+  config.min_scale = 0.25;
+  config.interval_ns = 5000000;
+  driver.StartRateGovernor(0, config);
+  driver.SetSpikeGeneratorRates(0, {0, 1}, {10, 11}, {1000, -1});
+  const uint64_t num_SG_words = driver.GetNumSGWordsSent(0);
+
+  comm::SyntheticLoad load;
+  load.overflow_rate = 1e5;
+  driver.SetLoad(load);
+  for (unsigned int i = 0; i < 200 && driver.GetRateGovernorScale(0) > 0.25; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(driver.GetRateGovernorScale(0), 0.25);
+  EXPECT_EQ(driver.GetNumSGWordsSent(0), num_SG_words + 2 * 2); // both generators, at 0.5 then 0.25
+
+  driver.SetLoad(comm::SyntheticLoad());
+  for (unsigned int i = 0; i < 200 && driver.GetRateGovernorScale(0) < 1; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(driver.GetRateGovernorScale(0), 1);
+
+  std::vector<RateGovernorAdjustment> log = driver.GetRateGovernorLog(0);
+  ASSERT_EQ(log.size(), 4);
+  EXPECT_EQ(log[0].scale, 0.5);
+  EXPECT_GT(log[0].loss_rate, 100);
+  EXPECT_EQ(log[1].scale, 0.25);
+  EXPECT_EQ(log[3].scale, 1);
+  EXPECT_EQ(log[3].loss_rate, 0);
+  EXPECT_GT(log[3].time, log[0].time);
+
+  // overflows still get counted
+  auto overflows = driver.GetFIFOOverflowCounts(0);
+  EXPECT_EQ(overflows.first, driver.GetSyntheticStats().num_overflows);
+  EXPECT_EQ(overflows.second, 0);
+
+  // stopping puts the rates back, the scale is 1 from then on
+  driver.StopRateGovernor(0);
+  EXPECT_EQ(driver.GetRateGovernorScale(0), 1);
+  EXPECT_EQ(driver.GetRateGovernorLog(0).size(), 4);
+  driver.Stop();
+}
@@ -0,0 +1,185 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "model/BDModelDriver.h"
+#include "BDModel.h"
+#include "comm/CommTrace.h"
+#include "comm/ReplayDriver.h"
+
+#include "gtest/gtest.h"
+#include "test_util/DriverTypes_util.h"
+
+using std::cout;
+using std::endl;
+using namespace pystorm;
+using namespace bddriver;
+using namespace comm;
+
+std::string TestTracePath(const std::string &name) {
+  return "/tmp/CommReplay_test." + std::to_string(getpid()) + "." + name + ".bdct";
+}
+
+std::vector<COMMWord> DownstreamBytes(const std::vector<CommTraceFrame> &frames) {
+  std::vector<COMMWord> bytes;
+  for (auto& it : frames) {
+    if (it.dir == CommTraceDir::DOWN) bytes.insert(bytes.end(), it.data.begin(), it.data.end());
+  }
+  return bytes;
+}
+
+TEST(CommTraceTest, RoundTrip) {
+  const std::string path = TestTracePath("roundtrip");
+  std::vector<std::vector<COMMWord>> frames = {{1, 2, 3, 4}, {}, std::vector<COMMWord>(4096, 7)};
+  {
+    CommTraceWriter writer(path);
+    ASSERT_TRUE(writer.IsOpen());
+    writer.Record(CommTraceDir::UP, frames[0].data(), frames[0].size());
+    writer.Record(CommTraceDir::DOWN, frames[1].data(), frames[1].size());
+    writer.Record(CommTraceDir::DOWN, frames[2].data(), frames[2].size());
+    EXPECT_EQ(writer.GetNumFrames(), 3);
+  }
+
+  std::vector<CommTraceFrame> read = LoadCommTrace(path);
+  ASSERT_EQ(read.size(), frames.size());
+  EXPECT_EQ(read[0].dir, CommTraceDir::UP);
+  EXPECT_EQ(read[1].dir, CommTraceDir::DOWN);
+  for (unsigned int i = 0; i < frames.size(); i++) {
+    EXPECT_EQ(read[i].data, frames[i]);
+    if (i > 0) {
+      EXPECT_GE(read[i].time_ns, read[i-1].time_ns);
+    }
+  }
+
+  // not a trace
+  EXPECT_FALSE(CommTraceReader("/tmp/CommReplay_test_no_such_trace.bdct").IsOpen());
+  std::remove(path.c_str());
+}
+
+TEST(CommTraceTest, FrameBiggerThanTrace) {
+  const std::string path = TestTracePath("oversized");
+  std::vector<COMMWord> frame(64, 0xab);
+  {
+    CommTraceWriter writer(path);
+    ASSERT_TRUE(writer.IsOpen());
+    writer.Record(CommTraceDir::UP, frame.data(), frame.size());
+  }
+
+  // then a frame header claiming ~2GB, with only a few bytes behind it
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::app);
+    CommTraceFrameHeader header = {0, 0x7fffffff};
+    file.write(reinterpret_cast<const char *>(&header.time_ns), sizeof(header.time_ns));
+    file.write(reinterpret_cast<const char *>(&header.size_and_dir), sizeof(header.size_and_dir));
+    file.write(reinterpret_cast<const char *>(frame.data()), 8);
+  }
+
+  std::vector<CommTraceFrame> read = LoadCommTrace(path);
+  ASSERT_EQ(read.size(), 1u);
+  EXPECT_EQ(read[0].data, frame);
+  std::remove(path.c_str());
+}
+
+// record a session against the model, then play it back through a ReplayDriver
+class CommReplayFixture : public testing::Test {
+  public:
+    void SetUp() {
+      BDModelDriver driver;
+      bdmodel::BDModel * model = driver.GetBDModel();
+      driver.Start();
+      ASSERT_TRUE(driver.StartCapture(trace_path));
+
+      driver.InitBD();
+      mm_data = MakeRandomMMData(M);
+      driver.SetMem(0, bdpars::BDMemId::MM, mm_data, 0);
+
+      // two bursts of upstream spikes, some time apart
+      const uint8_t NRNI_code = driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::NRNI);
+      for (unsigned int i = 0; i < 2; i++) {
+        auto spikes = MakeRandomNrnSpikes(M);
+        model->PushOutput(NRNI_code, spikes);
+        recorded_spikes.insert(recorded_spikes.end(), spikes.begin(), spikes.end());
+        std::this_thread::sleep_for(std::chrono::milliseconds(kGapMs));
+      }
+      ASSERT_EQ(driver.RecvSpikes(0).first, recorded_spikes);
+
+      EXPECT_GT(driver.StopCapture(), 0);
+      driver.Stop();
+
+      frames = LoadCommTrace(trace_path);
+      bool first = true;
+      for (auto& it : frames) {
+        if (it.dir != CommTraceDir::UP) continue;
+        if (first) first_up_ns = it.time_ns;
+        last_up_ns = it.time_ns;
+        first = false;
+      }
+    }
+
+    void TearDown() {
+      std::remove(trace_path.c_str());
+      std::remove(replay_path.c_str());
+    }
+
+    /// Start <driver> and wait for the replay to finish, returns how long it took in ms
+    double RunReplay(ReplayDriver *driver) {
+      auto start = std::chrono::steady_clock::now();
+      driver->Start();
+      while (!driver->IsReplayDone()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const unsigned int M = 64;
+    const unsigned int kGapMs = 300;
+    const std::string trace_path = TestTracePath("session");
+    const std::string replay_path = TestTracePath("replay");
+
+    std::vector<BDWord> mm_data;
+    std::vector<BDWord> recorded_spikes;
+    std::vector<CommTraceFrame> frames;
+    uint64_t first_up_ns = 0;
+    uint64_t last_up_ns = 0;
+};
+
+TEST_F(CommReplayFixture, ReplaysUpstreamAndCapturesDownstream) {
+  ASSERT_GE(last_up_ns - first_up_ns, kGapMs * 1000000ull);
+
+  ReplayDriver driver(trace_path, false);
+  ASSERT_TRUE(driver.StartCapture(replay_path));
+  double replay_ms = RunReplay(&driver);
+  // unpaced, the recorded gap isn't waited out
+  EXPECT_LT(replay_ms, kGapMs);
+
+  // the decoder sees exactly what it saw during the session
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(driver.RecvSpikes(0).first, recorded_spikes);
+
+  // the same calls produce the same downstream traffic
+  driver.InitBD();
+  driver.SetMem(0, bdpars::BDMemId::MM, mm_data, 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  driver.StopCapture();
+  driver.Stop();
+
+  EXPECT_EQ(DownstreamBytes(LoadCommTrace(replay_path)), DownstreamBytes(frames));
+}
+
+TEST_F(CommReplayFixture, KeepsRecordedPacing) {
+  ReplayDriver driver(trace_path, true);
+  double replay_ms = RunReplay(&driver);
+  double recorded_ms = (last_up_ns - first_up_ns) / 1e6;
+  driver.Stop();
+
+  EXPECT_GE(replay_ms, recorded_ms);
+  EXPECT_LT(replay_ms, recorded_ms + 250);
+  EXPECT_EQ(driver.RecvSpikes(0).first, recorded_spikes);
+}
@@ -0,0 +1,169 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "comm/CommSynthetic.h"
+#include "comm/SyntheticDriver.h"
+#include "common/BDPars.h"
+#include "common/BDWord.h"
+#include "common/DriverPars.h"
+
+#include "gtest/gtest.h"
+
+using std::cout;
+using std::endl;
+using namespace pystorm;
+using namespace bddriver;
+using namespace comm;
+
+TEST(CommSyntheticTest, WellFormedFrames) {
+  bdpars::BDPars pars;
+  MutexBuffer<COMMWord> read_buffer, write_buffer;
+  const unsigned int kUnitsPerHB = 1000; // 10 ms at 10 us per unit
+  CommSynthetic comm(&pars, &read_buffer, &write_buffer, 10000, kUnitsPerHB);
+
+  SyntheticLoad load;
+  load.spike_rate = 1e5;
+  load.acc_tag_rate = 1e4;
+  load.tat_tag_rate = 1e4;
+  load.sf_state_rate = 1e4;
+  comm.SetLoad(load);
+
+  comm.StartStreaming();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  comm.StopStreaming();
+  SyntheticStats stats = comm.GetStats();
+  EXPECT_GT(stats.num_spikes, 0);
+  EXPECT_GE(stats.num_HBs, 10);
+  EXPECT_EQ(stats.backlog_words, 0);
+
+  // count every ep code's words
+  std::map<unsigned int, uint64_t> counts;
+  uint64_t num_frames = 0;
+  uint64_t last_HB_LSB = 0;
+  for (auto& frame : read_buffer.PopAll()) {
+    num_frames++;
+    ASSERT_EQ(frame->size(), driverpars::READ_SIZE);
+    for (unsigned int block = 0; block < driverpars::READ_SIZE; block += driverpars::READ_BLOCK_SIZE) {
+      EXPECT_EQ(frame->at(block + 3), pars.UpEPCodeFor(bdpars::FPGAOutputEP::DS_QUEUE_CT)); // what CommOK checks for
+      for (unsigned int i = block + 4; i < block + driverpars::READ_BLOCK_SIZE; i += 4) {
+        uint32_t word = frame->at(i) | (frame->at(i+1) << 8) | (frame->at(i+2) << 16) | (frame->at(i+3) << 24);
+        unsigned int ep_code = GetField<FPGAIO>(word, FPGAIO::EP_CODE);
+        if (ep_code == pars.UpEPCodeFor(bdpars::FPGAOutputEP::NOP)) break;
+        counts[ep_code]++;
+
+        // HBs go up by a period each time
+        if (ep_code == pars.UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_HB_LSB)) {
+          uint64_t HB_LSB = GetField<FPGAIO>(word, FPGAIO::PAYLOAD);
+          if (last_HB_LSB > 0) {
+            EXPECT_EQ(HB_LSB - last_HB_LSB, kUnitsPerHB);
+          }
+          last_HB_LSB = HB_LSB;
+        }
+      }
+    }
+  }
+
+  EXPECT_EQ(num_frames, stats.num_frames);
+  EXPECT_EQ(counts[pars.UpEPCodeFor(bdpars::BDFunnelEP::NRNI)], stats.num_spikes);
+  EXPECT_EQ(counts[pars.UpEPCodeFor(bdpars::BDFunnelEP::RO_ACC)], 2 * stats.num_acc_tags);
+  EXPECT_EQ(counts[pars.UpEPCodeFor(bdpars::BDFunnelEP::RO_TAT)], 2 * stats.num_tat_tags);
+  EXPECT_EQ(counts[pars.UpEPCodeFor(bdpars::FPGAOutputEP::SF_OUTPUT)], 2 * stats.num_sf_states);
+  EXPECT_EQ(counts[pars.UpEPCodeFor(bdpars::FPGAOutputEP::UPSTREAM_HB_MSB)], stats.num_HBs);
+}
+
+TEST(CommSyntheticTest, DriverReceivesEverything) {
+  SyntheticDriver driver;
+  driver.SetTimePerUpHB(1000000); // 1 ms
+  driver.Start();
+
+  SyntheticLoad load;
+  load.spike_rate = 2e5;
+  load.acc_tag_rate = 2e4;
+  load.tat_tag_rate = 2e4;
+  driver.SetLoad(load);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  driver.SetLoad(SyntheticLoad());
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  SyntheticStats stats = driver.GetSyntheticStats();
+  EXPECT_EQ(driver.RecvSpikes(0).first.size(), stats.num_spikes);
+  auto tags = driver.RecvTags(0, 1000);
+  EXPECT_EQ(tags.first.size(), stats.num_acc_tags + stats.num_tat_tags);
+
+  // times come from the HBs, so they fall on HB boundaries and don't go backwards
+  for (unsigned int i = 1; i < tags.second.size(); i++) {
+    EXPECT_EQ(tags.second[i] % 1000000, 0);
+  }
+
+  // malformed words are dropped or garble a tag, but don't take down the decoder
+  load = SyntheticLoad();
+  load.spike_rate = 1e4;
+  load.malformed_rate = 1e3;
+  driver.SetLoad(load);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  driver.SetLoad(SyntheticLoad());
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  SyntheticStats after = driver.GetSyntheticStats();
+  uint64_t num_malformed = after.num_malformed - stats.num_malformed;
+  EXPECT_GT(num_malformed, 0);
+  EXPECT_EQ(driver.GetNumUnknownEPWords(), (num_malformed + 1) / 2);
+  EXPECT_EQ(driver.RecvSpikes(0).first.size(), after.num_spikes - stats.num_spikes);
+
+  driver.Stop();
+}
+
+// Ramp up the spike rate while a consumer keeps calling RecvSpikes(), like a user
+// script would, until the decoder queue starts growing or the consumer falls behind
+TEST(CommSyntheticTest, MaxSustainedRate) {
+  SyntheticDriver driver;
+  driver.SetTimePerUpHB(1000000);
+  driver.Start();
+
+  double max_sustained = 0;
+  for (double rate = 2.5e5; rate <= 64e6; rate *= 2) {
+    SyntheticLoad load;
+    load.spike_rate = rate;
+    uint64_t generated_before = driver.GetSyntheticStats().num_spikes;
+    driver.SetLoad(load);
+
+    // half a second to settle, half a second to see whether the lag grows
+    uint64_t received = 0;
+    unsigned int queue_mid = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) {
+      received += driver.RecvSpikes(0).first.size();
+      if (queue_mid == 0 && std::chrono::steady_clock::now() - start > std::chrono::milliseconds(500)) {
+        queue_mid = driver.GetDecoderQueueBytes() + 1;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    unsigned int queue_end = driver.GetDecoderQueueBytes();
+    SyntheticStats stats = driver.GetSyntheticStats();
+    uint64_t generated = stats.num_spikes - generated_before;
+
+    bool kept_up =
+      stats.backlog_words < driverpars::READ_SIZE &&                       // the comm link kept up
+      queue_end <= queue_mid + 4 * driverpars::READ_SIZE &&                // the decoder kept up
+      received + stats.backlog_words + queue_end / 4 >= 0.9 * generated;   // the consumer kept up
+
+    // let everything drain
+    driver.SetLoad(SyntheticLoad());
+    for (unsigned int i = 0; i < 3000 && (driver.GetDecoderQueueBytes() > 0 || driver.GetSyntheticStats().backlog_words > 0); i++) {
+      driver.RecvSpikes(0);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    driver.RecvSpikes(0);
+
+    if (!kept_up) break;
+    max_sustained = rate;
+  }
+  // about 16 M spikes/s on the model build
+  EXPECT_GE(max_sustained, 1e6);
+
+  driver.Stop();
+}
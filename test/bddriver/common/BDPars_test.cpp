@@ -0,0 +1,83 @@
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "BDPars.h"
+#include "gtest/gtest.h"
+
+using std::cout;
+using std::endl;
+using namespace pystorm;
+using namespace bddriver;
+using namespace bdpars;
+
+TEST(BDParsTest, EPSizesAndMemInfo) {
+  BDPars pars;
+
+  EXPECT_EQ(pars.Dn_EP_size_[pars.DnEPCodeFor(BDHornEP::PROG_AMMM)], 42);
+  EXPECT_EQ(pars.Dn_EP_size_[pars.DnEPCodeFor(FPGAChannelEP::SG_PROGRAM_MEM)], 51);
+  EXPECT_EQ(pars.Up_EP_size_[pars.UpEPCodeFor(FPGAOutputEP::SF_OUTPUT)], 48);
+  EXPECT_EQ(pars.mem_info_[BDMemId::MM].size, 64*1024);
+  EXPECT_EQ(pars.mem_info_.at(BDMemId::PAT).dump_leaf, BDFunnelEP::DUMP_PAT);
+  EXPECT_EQ(pars.dac_info_[BDHornEP::DAC_SYN_LK].scaling, 160);
+
+  // every used up ep code reported once, unused codes have size 0
+  std::vector<uint8_t> up_eps = pars.GetUpEPs();
+  EXPECT_EQ(up_eps.size(), static_cast<unsigned int>(BDFunnelEP::COUNT) + static_cast<unsigned int>(FPGAOutputEP::COUNT) + 1);
+  for (auto& it : up_eps) {
+    EXPECT_GT(pars.Up_EP_size_[it], 0);
+  }
+  EXPECT_EQ(pars.Up_EP_size_[200], 0);
+}
+
+TEST(BDParsTest, BulkAERTranslation) {
+  BDPars pars;
+
+  const unsigned int N = 1 << 20;
+  std::default_random_engine generator(0);
+  std::uniform_int_distribution<uint64_t> distribution(0, BDPars::NumNeurons - 1);
+
+  std::vector<uint64_t> aer(N);
+  for (auto& it : aer) {
+    it = distribution(generator);
+  }
+  // a couple of bad addresses (synchronizer bit flips)
+  aer[10] = BDPars::NumNeurons;
+  aer[N-1] = 1 << 20;
+
+  // scalar, per-spike path
+  std::vector<unsigned int> xy_scalar(N, 0);
+  for (unsigned int i = 0; i < N; i++) {
+    if (aer[i] < BDPars::NumNeurons) {
+      xy_scalar[i] = pars.GetSomaXYAddr(aer[i]);
+    }
+  }
+
+  // bulk path
+  std::vector<unsigned int> xy_bulk(N, 0);
+  unsigned int num_bad = pars.GetSomaXYAddrs(aer.data(), xy_bulk.data(), N);
+
+  EXPECT_EQ(num_bad, 2);
+  for (unsigned int i = 0; i < N; i++) {
+    if (aer[i] < BDPars::NumNeurons) {
+      ASSERT_EQ(xy_scalar[i], xy_bulk[i]);
+      ASSERT_EQ(pars.GetSomaAERAddr(xy_bulk[i]), aer[i]);
+    }
+  }
+
+  // the single-address lookups still check their bounds
+  EXPECT_THROW(pars.GetSomaXYAddr(BDPars::NumNeurons), std::out_of_range);
+  EXPECT_THROW(pars.GetSomaAERAddr(BDPars::NumNeurons), std::out_of_range);
+  EXPECT_THROW(pars.GetSynAERAddr(BDPars::NumSynapses), std::out_of_range);
+  EXPECT_THROW(pars.GetMemAERAddr(256), std::out_of_range);
+
+  // round trip through the other bulk translations
+  std::vector<unsigned int> xy(BDPars::NumSynapses), aer_out(BDPars::NumSynapses);
+  for (unsigned int i = 0; i < BDPars::NumSynapses; i++) xy[i] = i;
+  EXPECT_EQ(pars.GetSynAERAddrs(xy.data(), aer_out.data(), BDPars::NumSynapses), 0);
+  for (unsigned int i = 0; i < BDPars::NumSynapses; i++) {
+    ASSERT_EQ(aer_out[i], pars.GetSynAERAddr(i));
+  }
+}
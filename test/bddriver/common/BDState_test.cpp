@@ -1,7 +1,9 @@
 #include "BDState.h"
 #include "common/DriverPars.h"
 
+#include <cstdio>
 #include <iostream>
+#include <string>
 using std::cout;
 using std::endl;
 
@@ -51,3 +53,99 @@ TEST_F(BDStateFixture, TestTrafficTurnsOff) {
   state->WaitForTrafficOff();
   ASSERT_TRUE(state->IsTrafficOff());
 }
+
+TEST_F(BDStateFixture, TestSnapshotIsCopyOnWrite) {
+  state->SetMem(bdpars::BDMemId::MM, 10, {1, 2, 3});
+  state->SetNeuronConfigMem(0, 5, 3, bdpars::ConfigSomaID::GAIN_0, 1);
+
+  BDState snap = state->Snapshot();
+  // nothing is copied until something is written
+  EXPECT_EQ(snap.GetMem(bdpars::BDMemId::MM), state->GetMem(bdpars::BDMemId::MM));
+  EXPECT_TRUE(state->Diff(snap).Empty());
+
+  state->SetMem(bdpars::BDMemId::MM, 11, {20});
+  state->SetNeuronConfigMem(0, 5, 3, bdpars::ConfigSomaID::GAIN_0, 0);
+  EXPECT_NE(snap.GetMem(bdpars::BDMemId::MM), state->GetMem(bdpars::BDMemId::MM));
+  EXPECT_EQ(snap.GetMem(bdpars::BDMemId::AM), state->GetMem(bdpars::BDMemId::AM));
+
+  // snapshot kept the old values
+  EXPECT_EQ(snap.GetMem(bdpars::BDMemId::MM)->at(11), 2);
+  EXPECT_EQ(state->GetMem(bdpars::BDMemId::MM)->at(11), 20);
+  EXPECT_EQ(snap.GetNeuronConfigMem(0, 5, 3, bdpars::ConfigSomaID::GAIN_0), 1);
+  EXPECT_EQ(state->GetNeuronConfigMem(0, 5, 3, bdpars::ConfigSomaID::GAIN_0), 0);
+
+  state->Restore(snap);
+  EXPECT_TRUE(state->Diff(snap).Empty());
+  EXPECT_EQ(state->GetMem(bdpars::BDMemId::MM)->at(11), 2);
+}
+
+TEST_F(BDStateFixture, TestDiffRanges) {
+  BDState snap = state->Snapshot();
+
+  state->SetMem(bdpars::BDMemId::AM, 0, {0, 0});   // programming zeros still counts
+  state->SetMem(bdpars::BDMemId::MM, 100, {1, 2, 3, 4});
+  state->SetMem(bdpars::BDMemId::MM, 200, {5});
+  state->SetReg(bdpars::BDHornEP::DAC_SYN_LK, 10);
+  state->SetNeuronConfigMem(0, 7, 0, bdpars::ConfigSomaID::ENABLE, 1);
+  state->SetNeuronConfigMem(0, 8, 15, bdpars::ConfigSomaID::ENABLE, 1);
+  state->SetNeuronConfigMem(0, 100, 2, bdpars::ConfigSynapseID::SYN_DISABLE, 0);
+  state->SetNeuronConfigMem(0, 255, 0, bdpars::DiffusorCutLocationId::WEST_TOP, 1);
+
+  BDStateDiff diff = state->Diff(snap);
+  ASSERT_FALSE(diff.Empty());
+
+  ASSERT_EQ(diff.MemRanges(bdpars::BDMemId::AM).size(), 1);
+  EXPECT_EQ(diff.MemRanges(bdpars::BDMemId::AM)[0].start, 0);
+  EXPECT_EQ(diff.MemRanges(bdpars::BDMemId::AM)[0].count, 2);
+
+  ASSERT_EQ(diff.MemRanges(bdpars::BDMemId::MM).size(), 2);
+  EXPECT_EQ(diff.MemRanges(bdpars::BDMemId::MM)[0].start, 100);
+  EXPECT_EQ(diff.MemRanges(bdpars::BDMemId::MM)[0].count, 4);
+  EXPECT_EQ(diff.MemRanges(bdpars::BDMemId::MM)[1].start, 200);
+  EXPECT_EQ(diff.MemRanges(bdpars::BDMemId::MM)[1].count, 1);
+  EXPECT_TRUE(diff.MemRanges(bdpars::BDMemId::PAT).empty());
+
+  ASSERT_EQ(diff.regs.size(), 1);
+  EXPECT_EQ(diff.regs[0], bdpars::BDHornEP::DAC_SYN_LK);
+
+  ASSERT_EQ(diff.soma_config_tiles.size(), 1);
+  EXPECT_EQ(diff.soma_config_tiles[0].start, 7);
+  EXPECT_EQ(diff.soma_config_tiles[0].count, 2);
+  ASSERT_EQ(diff.synapse_config_tiles.size(), 1);
+  EXPECT_EQ(diff.synapse_config_tiles[0].start, 100);
+  ASSERT_EQ(diff.diffusor_config_tiles.size(), 1);
+  EXPECT_EQ(diff.diffusor_config_tiles[0].start, 255);
+
+  // the diff is symmetric
+  EXPECT_EQ(snap.Diff(*state).MemRanges(bdpars::BDMemId::MM).size(), 2);
+}
+
+TEST_F(BDStateFixture, TestSaveLoad) {
+  const std::string filename = "BDState_test.bdst";
+
+  state->SetMem(bdpars::BDMemId::TAT0, 1000, {0xdeadbeef, 7});
+  state->SetMem(bdpars::BDMemId::PAT, 63, {42});
+  state->SetReg(bdpars::BDHornEP::DAC_SOMA_REF, 123);
+  state->SetNeuronConfigMem(0, 12, 4, bdpars::ConfigSynapseID::ADC_DISABLE, 1);
+  ASSERT_TRUE(state->Save(filename));
+
+  BDState loaded(bd_pars);
+  ASSERT_TRUE(loaded.Load(filename));
+  EXPECT_TRUE(loaded.Diff(*state).Empty());
+  EXPECT_EQ(loaded.GetMem(bdpars::BDMemId::TAT0)->at(1000), 0xdeadbeef);
+  EXPECT_TRUE(loaded.IsMemValid(bdpars::BDMemId::PAT, 63));
+  EXPECT_FALSE(loaded.IsMemValid(bdpars::BDMemId::PAT, 62));
+  EXPECT_EQ(loaded.GetReg(bdpars::BDHornEP::DAC_SOMA_REF).first, 123);
+  EXPECT_EQ(loaded.GetNeuronConfigMem(0, 12, 4, bdpars::ConfigSynapseID::ADC_DISABLE), 1);
+  EXPECT_EQ(loaded.GetNeuronConfigMem(0, 12, 3, bdpars::ConfigSynapseID::ADC_DISABLE), BDState::kConfigUnset);
+  EXPECT_EQ(loaded.Fingerprint(), state->Fingerprint());
+  BDState changed = loaded.Snapshot();
+  changed.SetMem(bdpars::BDMemId::PAT, 63, {43});
+  EXPECT_NE(changed.Fingerprint(), state->Fingerprint());
+
+  // bad files leave the state alone
+  EXPECT_FALSE(loaded.Load("does_not_exist.bdst"));
+  EXPECT_TRUE(loaded.Diff(*state).Empty());
+
+  std::remove(filename.c_str());
+}
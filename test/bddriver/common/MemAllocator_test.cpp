@@ -0,0 +1,55 @@
+#include <cstdint>
+#include <vector>
+
+#include "MemAllocator.h"
+#include "gtest/gtest.h"
+
+using namespace pystorm;
+using namespace bddriver;
+
+TEST(MemAllocatorTest, AllocReserveRanges) {
+  MemAllocator alloc(100);
+  EXPECT_EQ(alloc.NumFree(), 100);
+
+  EXPECT_TRUE(alloc.Reserve(10, 20, true));
+  EXPECT_FALSE(alloc.Reserve(25, 10));  // overlaps
+  EXPECT_FALSE(alloc.Reserve(95, 10));  // off the end
+  EXPECT_EQ(alloc.NumFree(), 80);
+
+  // first fit: doesn't fit before the live region
+  EXPECT_EQ(alloc.Alloc(5), 0);
+  EXPECT_EQ(alloc.Alloc(8), 30);
+  EXPECT_EQ(alloc.Alloc(100), -1);
+  EXPECT_TRUE(alloc.IsStaged(30, 8));
+  EXPECT_FALSE(alloc.IsStaged(29, 8));
+
+  std::vector<BDStateRange> free_ranges = alloc.FreeRanges();
+  ASSERT_EQ(free_ranges.size(), 2);
+  EXPECT_EQ(free_ranges[0].start, 5);
+  EXPECT_EQ(free_ranges[0].count, 5);
+  EXPECT_EQ(free_ranges[1].start, 38);
+  EXPECT_EQ(free_ranges[1].count, 62);
+  EXPECT_EQ(alloc.StagedRanges().size(), 2);
+}
+
+TEST(MemAllocatorTest, CommitSwapsGenerations) {
+  MemAllocator alloc(64);
+  ASSERT_TRUE(alloc.Reserve(0, 32, true));
+  ASSERT_EQ(alloc.Alloc(32), 32);
+
+  alloc.Commit();
+  std::vector<BDStateRange> live = alloc.LiveRanges();
+  ASSERT_EQ(live.size(), 1);
+  EXPECT_EQ(live[0].start, 32);
+  EXPECT_EQ(live[0].count, 32);
+  EXPECT_EQ(alloc.StagedRanges().size(), 0);
+
+  // the old network's entries are free for the next one
+  EXPECT_EQ(alloc.Alloc(32), 0);
+  alloc.Commit();
+  EXPECT_EQ(alloc.LiveRanges()[0].start, 0);
+  EXPECT_EQ(alloc.NumFree(), 32);
+
+  alloc.Clear();
+  EXPECT_EQ(alloc.NumFree(), 64);
+}
@@ -0,0 +1,96 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "common/DriverTypes.h"
+#include "common/OutputStore.h"
+
+#include "gtest/gtest.h"
+
+using std::cout;
+using std::endl;
+using namespace pystorm;
+using namespace bddriver;
+
+// <n> outputs starting at <start>, <per_time> of them per time step, payload = index
+std::vector<DecOutput> MakeStoreOutputs(uint64_t start, unsigned int n, unsigned int per_time = 1) {
+  std::vector<DecOutput> outputs;
+  for (uint64_t i = start; i < start + n; i++) {
+    DecOutput out;
+    out.payload = i;
+    out.time = i / per_time;
+    outputs.push_back(out);
+  }
+  return outputs;
+}
+
+TEST(OutputStoreTest, QueryRanges) {
+  OutputStore store(1000000, 64);
+  store.Append(MakeStoreOutputs(0, 1000, 2)); // times 0 - 499, two outputs each
+
+  auto recvd = store.Query(100, 200);
+  ASSERT_EQ(recvd.first.size(), 200);
+  EXPECT_EQ(recvd.first.front(), 200);
+  EXPECT_EQ(recvd.first.back(), 399);
+  EXPECT_EQ(recvd.second.front(), 100);
+  EXPECT_EQ(recvd.second.back(), 199);
+
+  // queries don't consume anything
+  EXPECT_EQ(store.Query(100, 200), recvd);
+  EXPECT_EQ(store.GetNumStored(), 1000);
+
+  // ends of the store, empty ranges
+  EXPECT_EQ(store.Query(0, 1).first, std::vector<BDWord>({0, 1}));
+  EXPECT_EQ(store.Query(499, 10000).first, std::vector<BDWord>({998, 999}));
+  EXPECT_EQ(store.Query(500, 10000).first.size(), 0);
+  EXPECT_EQ(store.Query(200, 200).first.size(), 0);
+  EXPECT_EQ(store.Query(0, 10000).first.size(), 1000);
+}
+
+TEST(OutputStoreTest, HorizonAndRelease) {
+  const unsigned int kSegmentSize = 64;
+  OutputStore store(1000, kSegmentSize);
+  for (unsigned int i = 0; i < 100; i++) {
+    store.Append(MakeStoreOutputs(i * 100, 100));
+  }
+
+  // only about a horizon's worth is kept
+  auto range = store.GetTimeRange();
+  EXPECT_EQ(range.second, 9999);
+  EXPECT_LE(range.first, 9999 - 1000);
+  EXPECT_GT(range.first, 9999 - 1000 - kSegmentSize);
+  EXPECT_LE(store.GetNumStored(), 1000 + kSegmentSize + 1);
+
+  store.Release(9500);
+  EXPECT_EQ(store.GetTimeRange().first, 9500);
+  EXPECT_EQ(store.GetNumStored(), 500);
+  EXPECT_EQ(store.Query(0, 9600).first.size(), 100);
+
+  // the FPGA clock starting over drops what was there
+  store.Append(MakeStoreOutputs(0, 10));
+  EXPECT_EQ(store.GetNumStored(), 10);
+  EXPECT_EQ(store.GetTimeRange(), std::make_pair(BDTime(0), BDTime(9)));
+
+  store.Clear();
+  EXPECT_EQ(store.GetNumStored(), 0);
+  EXPECT_EQ(store.Query(0, 10).first.size(), 0);
+}
+
+TEST(OutputStoreTest, Bin) {
+  OutputStore store(1000000, 64);
+  store.Append(MakeStoreOutputs(0, 1000)); // one output per time
+
+  // bins of 10 from time 95, keyed by payload mod 4, key 3 isn't counted
+  auto counts = store.Bin(95, 3, 10, [](BDWord word) { return word % 4 == 3 ? 100 : word % 4; }, 3);
+  ASSERT_EQ(counts.size(), 3 * 3);
+  // times 95-104
+  EXPECT_EQ(counts[0], 3); // 96, 100, 104
+  EXPECT_EQ(counts[1], 2); // 97, 101
+  EXPECT_EQ(counts[2], 2); // 98, 102
+
+  // everything but the key 3s, in some bin
+  unsigned int total = 0;
+  for (auto& it : counts) total += it;
+  EXPECT_EQ(total, 30 - 8); // 95, 99, ..., 123
+}
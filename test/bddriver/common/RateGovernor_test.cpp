@@ -0,0 +1,60 @@
+#include <cstdint>
+#include <vector>
+
+#include "common/RateGovernor.h"
+
+#include "gtest/gtest.h"
+
+using namespace pystorm;
+using namespace bddriver;
+
+TEST(RateGovernorTest, BacksOffAndRecovers) {
+  RateGovernorConfig config;
+  config.target_loss_rate = 100;
+  config.decrease = 0.5;
+  config.increase = 1.5;
+  config.min_scale = 0.2;
+  config.interval_ns = 1000;
+  RateGovernor governor(config);
+
+  EXPECT_FALSE(governor.Update(0)); // starts the first interval
+
+  // 1 overflow per 1 us is 1M/s, way over
+  governor.AddOverflows(1);
+  EXPECT_FALSE(governor.Update(500)); // interval isn't up
+  EXPECT_TRUE(governor.Update(1000));
+  EXPECT_EQ(governor.GetScale(), 0.5);
+
+  governor.AddOverflows(1);
+  EXPECT_TRUE(governor.Update(2000));
+  governor.AddOverflows(1);
+  EXPECT_TRUE(governor.Update(3000));
+  EXPECT_EQ(governor.GetScale(), 0.2); // min_scale
+  governor.AddOverflows(1);
+  EXPECT_FALSE(governor.Update(4000)); // can't go lower, nothing logged
+
+  // a full downstream queue counts as overloaded too
+  EXPECT_TRUE(governor.Update(5000)); // quiet, back up
+  EXPECT_NEAR(governor.GetScale(), 0.3, 1e-9);
+  governor.AddQueueFill(0.9);
+  EXPECT_TRUE(governor.Update(6000));
+  EXPECT_NEAR(governor.GetScale(), 0.2, 1e-9);
+
+  // half-full queues hold the scale where it is
+  governor.AddQueueFill(0.5);
+  EXPECT_FALSE(governor.Update(7000));
+
+  for (BDTime t = 8000; t < 20000; t += 1000) {
+    governor.Update(t);
+  }
+  EXPECT_EQ(governor.GetScale(), 1);
+
+  const std::vector<RateGovernorAdjustment> &log = governor.GetLog();
+  ASSERT_GE(log.size(), 6);
+  EXPECT_EQ(log[0].time, 1000);
+  EXPECT_EQ(log[0].scale, 0.5);
+  EXPECT_NEAR(log[0].loss_rate, 1e6, 1);
+  EXPECT_EQ(log[4].queue_fill, 0.9);
+  EXPECT_EQ(log.back().scale, 1);
+  EXPECT_EQ(governor.GetNumOverflows(), 4);
+}
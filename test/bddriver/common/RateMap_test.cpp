@@ -0,0 +1,126 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "common/DriverTypes.h"
+#include "common/RateMap.h"
+
+#include "gtest/gtest.h"
+
+using namespace pystorm;
+using namespace bddriver;
+
+// <count> spikes from each of <aer_addrs> at <time>
+std::vector<DecOutput> MakeRateMapSpikes(const std::vector<unsigned int> &aer_addrs, unsigned int count, BDTime time) {
+  std::vector<DecOutput> spikes;
+  for (unsigned int i = 0; i < count; i++) {
+    for (auto &it : aer_addrs) {
+      DecOutput spike;
+      spike.payload = it;
+      spike.time = time;
+      spikes.push_back(spike);
+    }
+  }
+  return spikes;
+}
+
+TEST(RateMapTest, SteadyRatesInXYOrder) {
+  // 2x2 neurons, AER address i is XY 3 - i. 1 us units, 100 ms tau, 1 ms refresh
+  RateMap rate_map({3, 2, 1, 0}, 2, 100000000, 1000000, 1000);
+  ASSERT_TRUE(rate_map.IsOpen());
+
+  BDTime time_ns;
+  std::vector<float> rates;
+  EXPECT_FALSE(rate_map.Read(&time_ns, &rates));
+
+  // AER 0 spikes at 1 kHz, AER 1 at 3 kHz, for a second of 1 ms HBs
+  rate_map.Update(0);
+  for (BDTime t = 1000; t <= 1000000; t += 1000) {
+    rate_map.AddSpikes(MakeRateMapSpikes({0}, 1, t - 1000));
+    rate_map.AddSpikes(MakeRateMapSpikes({1}, 3, t - 1000));
+    rate_map.AddSpikes(MakeRateMapSpikes({1234}, 1, t - 1000)); // not a neuron
+    rate_map.Update(t);
+  }
+
+  ASSERT_TRUE(rate_map.Read(&time_ns, &rates));
+  EXPECT_EQ(time_ns, 1000000000);
+  EXPECT_EQ(rate_map.GetSeq(), 1000);
+  ASSERT_EQ(rates.size(), 4);
+  EXPECT_NEAR(rates[3], 1000, 1);
+  EXPECT_NEAR(rates[2], 3000, 3);
+  EXPECT_EQ(rates[1], 0);
+  EXPECT_EQ(rates[0], 0);
+
+  // nothing new until the next refresh period is up
+  rate_map.Update(1000500);
+  EXPECT_EQ(rate_map.GetSeq(), 1000);
+}
+
+TEST(RateMapTest, SharedMemoryReaders) {
+  const std::string kName = "bddriver_rate_map_test";
+  const unsigned int kNumNeurons = 4096;
+  std::vector<unsigned int> aer_to_xy(kNumNeurons);
+  std::vector<unsigned int> all;
+  for (unsigned int i = 0; i < kNumNeurons; i++) {
+    aer_to_xy[i] = i;
+    all.push_back(i);
+  }
+  RateMap rate_map(aer_to_xy, 64, 10000000, 1000, 1000, kName);
+  ASSERT_TRUE(rate_map.IsOpen());
+
+  RateMapReader reader;
+  ASSERT_TRUE(reader.Open(kName));
+  EXPECT_EQ(reader.GetNumNeurons(), kNumNeurons);
+  EXPECT_EQ(reader.GetWidth(), 64);
+
+  // every map the writer publishes has all neurons at the same rate,
+  // so a reader that sees two different rates in one map got a torn copy
+  std::atomic<bool> done(false);
+  std::atomic<unsigned int> num_torn(0);
+  std::atomic<unsigned int> num_reads(0);
+  std::vector<std::thread> readers;
+  for (unsigned int i = 0; i < 2; i++) {
+    readers.emplace_back([&]() {
+      RateMapReader my_reader;
+      my_reader.Open(kName);
+      BDTime time_ns;
+      std::vector<float> rates;
+      while (!done) {
+        if (my_reader.Read(&time_ns, &rates)) {
+          num_reads++;
+          for (auto &it : rates) {
+            if (it != rates[0]) {
+              num_torn++;
+              break;
+            }
+          }
+        }
+      }
+    });
+  }
+
+  rate_map.Update(0);
+  for (BDTime t = 1; t <= 2000; t++) {
+    rate_map.AddSpikes(MakeRateMapSpikes(all, t % 5, t));
+    rate_map.Update(t);
+  }
+  for (unsigned int i = 0; i < 1000 && num_reads == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  done = true;
+  for (auto &it : readers) it.join();
+
+  EXPECT_GT(num_reads, 0);
+  EXPECT_EQ(num_torn, 0);
+
+  // the reader sees what the writer has
+  BDTime writer_time, reader_time;
+  std::vector<float> writer_rates, reader_rates;
+  ASSERT_TRUE(rate_map.Read(&writer_time, &writer_rates));
+  ASSERT_TRUE(reader.Read(&reader_time, &reader_rates));
+  EXPECT_EQ(reader.GetSeq(), 2000);
+  EXPECT_EQ(reader_time, writer_time);
+  EXPECT_EQ(reader_rates, writer_rates);
+}
@@ -0,0 +1,167 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "ShmRing.h"
+#include "gtest/gtest.h"
+
+using std::cout;
+using std::endl;
+using namespace pystorm;
+using namespace bddriver;
+
+// payload i, time 10 * i
+std::vector<DecOutput> MakeRingOutputs(unsigned int start, unsigned int N) {
+  std::vector<DecOutput> outputs;
+  for (unsigned int i = start; i < start + N; i++) {
+    DecOutput out;
+    out.payload = i;
+    out.time = 10 * i;
+    outputs.push_back(out);
+  }
+  return outputs;
+}
+
+TEST(ShmRingTest, RoundTrip) {
+  ShmRingWriter writer("bddriver_test_ring", 50, 10000);
+  ASSERT_TRUE(writer.IsOpen());
+  EXPECT_EQ(writer.GetCapacity(), 64);
+
+  ShmRingReader reader;
+  ASSERT_TRUE(reader.Open("bddriver_test_ring"));
+  EXPECT_EQ(reader.GetCapacity(), 64);
+  EXPECT_EQ(reader.GetNsPerUnit(), 10000);
+
+  writer.Publish(1, 7, MakeRingOutputs(0, 10));
+
+  std::vector<ShmOutput> out;
+  EXPECT_EQ(reader.Read(&out), 0);
+  ASSERT_EQ(out.size(), 10);
+  for (unsigned int i = 0; i < out.size(); i++) {
+    EXPECT_EQ(out[i].seq, i + 1);
+    EXPECT_EQ(out[i].payload, i);
+    EXPECT_EQ(out[i].time, 10 * i);
+    EXPECT_EQ(out[i].core_id, 1);
+    EXPECT_EQ(out[i].ep_code, 7);
+  }
+
+  // nothing new
+  out.clear();
+  reader.Read(&out);
+  EXPECT_EQ(out.size(), 0);
+
+  writer.SetNsPerUnit(1000);
+  EXPECT_EQ(reader.GetNsPerUnit(), 1000);
+
+  // no ring by that name
+  ShmRingReader missing;
+  EXPECT_FALSE(missing.Open("bddriver_test_no_such_ring"));
+}
+
+TEST(ShmRingTest, IndependentCursors) {
+  ShmRingWriter writer("bddriver_test_ring", 64, 10000);
+  writer.Publish(0, 1, MakeRingOutputs(0, 5));
+
+  ShmRingReader live, old;
+  ASSERT_TRUE(live.Open("bddriver_test_ring"));
+  ASSERT_TRUE(old.Open("bddriver_test_ring", true));
+  EXPECT_EQ(live.GetCursor(), 5);
+  EXPECT_EQ(old.GetCursor(), 0);
+
+  writer.Publish(0, 1, MakeRingOutputs(5, 5));
+
+  std::vector<ShmOutput> live_out, old_out;
+  live.Read(&live_out);
+  old.Read(&old_out, 3);
+  ASSERT_EQ(live_out.size(), 5);
+  EXPECT_EQ(live_out[0].payload, 5);
+  ASSERT_EQ(old_out.size(), 3);
+  EXPECT_EQ(old_out[0].payload, 0);
+
+  // reading one doesn't move the other
+  old_out.clear();
+  old.Read(&old_out);
+  ASSERT_EQ(old_out.size(), 7);
+  EXPECT_EQ(old_out.back().payload, 9);
+  EXPECT_EQ(old.GetNumLost(), 0);
+}
+
+TEST(ShmRingTest, DetectsOverrun) {
+  ShmRingWriter writer("bddriver_test_ring", 16, 10000);
+  ShmRingReader reader;
+  ASSERT_TRUE(reader.Open("bddriver_test_ring"));
+
+  writer.Publish(0, 1, MakeRingOutputs(0, 40));
+
+  // only the newest capacity's worth is still there
+  std::vector<ShmOutput> out;
+  EXPECT_EQ(reader.Read(&out), 24);
+  ASSERT_EQ(out.size(), 16);
+  EXPECT_EQ(out.front().payload, 24);
+  EXPECT_EQ(out.back().payload, 39);
+  EXPECT_EQ(reader.GetNumLost(), 24);
+
+  reader.SeekToLatest();
+  writer.Publish(0, 1, MakeRingOutputs(40, 2));
+  out.clear();
+  EXPECT_EQ(reader.Read(&out), 0);
+  ASSERT_EQ(out.size(), 2);
+  EXPECT_EQ(out[0].payload, 40);
+}
+
+TEST(ShmRingTest, ConcurrentReaders) {
+  // writer thread publishes as fast as it can, readers poll while it's going.
+  // Every record a reader gets must be intact and in order, and whatever it
+  // doesn't get must be counted as lost
+  const unsigned int kBatch = 256;
+  const unsigned int kNumBatches = 8192;
+  const unsigned int kNumReaders = 2;
+  const uint64_t total = static_cast<uint64_t>(kBatch) * kNumBatches;
+
+  ShmRingWriter writer("bddriver_test_ring", 1 << 16, 10000);
+  std::vector<ShmRingReader> readers(kNumReaders);
+  for (auto &it : readers) {
+    ASSERT_TRUE(it.Open("bddriver_test_ring"));
+  }
+
+  std::vector<uint64_t> num_read(kNumReaders, 0);
+  std::vector<bool> intact(kNumReaders, true);
+  std::vector<std::thread> reader_threads;
+  for (unsigned int r = 0; r < kNumReaders; r++) {
+    reader_threads.emplace_back([&, r] {
+      ShmRingReader &reader = readers[r];
+      std::vector<ShmOutput> out;
+      uint64_t last_seq = 0;
+      while (reader.GetCursor() < total) {
+        out.clear();
+        reader.Read(&out);
+        for (auto &it : out) {
+          if (it.seq <= last_seq || it.payload != it.seq - 1 || it.time != 10 * (it.seq - 1)) {
+            intact[r] = false;
+          }
+          last_seq = it.seq;
+        }
+        num_read[r] += out.size();
+        if (out.size() == 0) std::this_thread::yield();
+      }
+    });
+  }
+
+  auto t0 = std::chrono::high_resolution_clock::now();
+  for (unsigned int i = 0; i < kNumBatches; i++) {
+    writer.Publish(0, 1, MakeRingOutputs(i * kBatch, kBatch));
+  }
+  auto t1 = std::chrono::high_resolution_clock::now();
+  for (auto &it : reader_threads) {
+    it.join();
+  }
+
+  for (unsigned int r = 0; r < kNumReaders; r++) {
+    EXPECT_TRUE(intact[r]);
+    EXPECT_EQ(num_read[r] + readers[r].GetNumLost(), total);
+  }
+  // the writer never waits for readers, tens of Mrecords/s here
+  EXPECT_GT(total / std::chrono::duration<double>(t1 - t0).count(), 5e6);
+}
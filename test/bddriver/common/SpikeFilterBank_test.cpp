@@ -0,0 +1,110 @@
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "common/SpikeFilterBank.h"
+
+#include "gtest/gtest.h"
+
+using std::cout;
+using std::endl;
+using namespace pystorm;
+using namespace bddriver;
+
+typedef SpikeFilterBank::Event Event;
+
+// states of <filter> in each sample
+std::vector<float> FilterStates(const std::vector<std::shared_ptr<const SpikeFilterBank::Sample>> &samples, unsigned int filter) {
+  std::vector<float> states;
+  for (auto &it : samples) {
+    states.push_back(it->states.at(filter));
+  }
+  return states;
+}
+
+TEST(SpikeFilterBankTest, DecaysLikeTheFPGA) {
+  // updates and samples every 10
+  SpikeFilterBank bank(2, 0.5, 4, 10, 10, 100);
+
+  bank.Queue({{3, 0, 1}});
+  bank.Flush(10);  // sample at 10: just the increment
+  bank.Flush(20);  // decayed once
+  bank.Queue({{21, 0, 1}, {25, 0, -2}});
+  bank.Flush(40);  // 4 / 4 + 4 - 8, then decayed once
+
+  auto samples = bank.PopSamples();
+  ASSERT_EQ(samples.size(), 4);
+  EXPECT_EQ(samples[0]->time, 10);
+  EXPECT_EQ(samples[3]->time, 40);
+  EXPECT_EQ(FilterStates(samples, 0), std::vector<float>({4, 2, -3, -1.5}));
+  EXPECT_EQ(FilterStates(samples, 1), std::vector<float>({0, 0, 0, 0}));
+  EXPECT_EQ(bank.GetLatest()->time, 40);
+  EXPECT_EQ(bank.PopSamples().size(), 0);
+}
+
+TEST(SpikeFilterBankTest, CountModeAndMergedEps) {
+  // decay = 0 counts each update, like SetSpikeFilterDecayConst(0)
+  SpikeFilterBank bank(3, SpikeFilterBank::DecayFromConst(0), 1, 10, 10, 100);
+
+  // two eps' worth of events, merged into time order
+  bank.Queue({{0, 1, 1}, {12, 1, 1}, {25, 2, 3}});
+  bank.Queue({{5, 1, 2}, {15, 1, -1}, {40, 0, 1}});
+  bank.Queue({{7, 5, 1}}); // no filter 5
+  bank.Flush(40);
+
+  auto samples = bank.PopSamples();
+  ASSERT_EQ(samples.size(), 4);
+  EXPECT_EQ(FilterStates(samples, 1), std::vector<float>({3, 0, 0, 0}));
+  EXPECT_EQ(FilterStates(samples, 2), std::vector<float>({0, 0, 3, 0}));
+  EXPECT_EQ(FilterStates(samples, 0), std::vector<float>({0, 0, 0, 0})); // time 40 isn't before the sample at 40
+  EXPECT_EQ(bank.GetNumEvents(), 6);
+  EXPECT_EQ(bank.GetNumDroppedEvents(), 1);
+}
+
+TEST(SpikeFilterBankTest, SmallDecaysStayFinite) {
+  // decay^-n overflows quickly, the bank has to rebase
+  const double kDecay = 1e-3;
+  SpikeFilterBank bank(1, kDecay, 1, 1, 1, 1000);
+  for (BDTime t = 0; t < 500; t++) {
+    bank.Queue({{t, 0, 1}});
+    bank.Flush(t);
+  }
+  bank.Flush(500);
+
+  auto samples = bank.PopSamples();
+  ASSERT_GT(samples.size(), 0);
+  for (auto &it : samples) {
+    ASSERT_TRUE(std::isfinite(it->states[0]));
+    EXPECT_NEAR(it->states[0], 1 / (1 - kDecay), 2e-3);
+  }
+}
+
+TEST(SpikeFilterBankTest, LongRunsAtEveryBankSize) {
+  // about 1 ms updates at 10 us time units, sampled every update, or hardly ever
+  const BDTime kUpdateLen = 100;
+  const unsigned int kNumEvents = 4000000;
+  const unsigned int kEventsPerUnit = 10;
+  const unsigned int kBatchSize = 10000;
+
+  for (BDTime sample_len : {kUpdateLen, kUpdateLen * 1000}) {
+    for (unsigned int num_filters : {512u, 4096u, 32768u, 65536u}) {
+      SpikeFilterBank bank(num_filters, SpikeFilterBank::DecayFromConst(134083577), 5120, kUpdateLen, sample_len, 16);
+
+      std::vector<Event> batch(kBatchSize);
+      uint32_t lcg = 12345;
+      for (unsigned int i = 0; i < kNumEvents; i += kBatchSize) {
+        for (unsigned int j = 0; j < kBatchSize; j++) {
+          lcg = lcg * 1664525 + 1013904223;
+          batch[j] = {(i + j) / kEventsPerUnit, lcg % num_filters, 1};
+        }
+        bank.Queue(batch);
+        bank.Flush((i + kBatchSize) / kEventsPerUnit);
+        bank.PopSamples();
+      }
+
+      EXPECT_EQ(bank.GetNumEvents(), kNumEvents);
+      EXPECT_EQ(bank.GetLatest()->time, kNumEvents / kEventsPerUnit);
+    }
+  }
+}
@@ -0,0 +1,48 @@
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "common/BDWord.h"
+#include "common/TagBinner.h"
+
+#include "gtest/gtest.h"
+
+using namespace pystorm;
+using namespace bddriver;
+
+BDWord MakeOutputTag(unsigned int tag, int count) {
+  const unsigned int count_width = FieldWidth(TATOutputTag::COUNT);
+  uint64_t count_field = count < 0 ? count + (1 << count_width) : count; // two's complement
+  return PackWord<TATOutputTag>({{TATOutputTag::COUNT, count_field}, {TATOutputTag::TAG, tag}, {TATOutputTag::GLOBAL_ROUTE, 0}});
+}
+
+TEST(TagBinnerTest, SignedCounts) {
+  EXPECT_EQ(TagBinner::DecodeCount(MakeOutputTag(3, 1)), 1);
+  EXPECT_EQ(TagBinner::DecodeCount(MakeOutputTag(3, -1)), -1);
+  EXPECT_EQ(TagBinner::DecodeCount(MakeOutputTag(3, 255)), 255);
+  EXPECT_EQ(TagBinner::DecodeCount(MakeOutputTag(3, -256)), -256);
+}
+
+TEST(TagBinnerTest, FixedAndExplicitBins) {
+  std::vector<BDWord> tags  = {MakeOutputTag(0, 1), MakeOutputTag(1, -1), MakeOutputTag(0, 2), MakeOutputTag(1, 1), MakeOutputTag(0, 1)};
+  std::vector<BDTime> times = {5,                   10,                   19,                  25,                  30};
+
+  // [0, 10), [10, 20), [20, 30)
+  TagBinner fixed(0, 10, 3, 2);
+  fixed.Add(tags, times);
+  EXPECT_EQ(fixed.GetCounts(), std::vector<int32_t>({1, 0, 2, -1, 0, 1}));
+  EXPECT_EQ(fixed.GetNumDropped(), 1); // time 30
+
+  // [0, 6), [6, 26), same answer as a fixed binner with the same edges
+  TagBinner uneven({0, 6, 26}, 2);
+  uneven.Add(tags, times);
+  EXPECT_EQ(uneven.GetCounts(), std::vector<int32_t>({1, 0, 2, 0}));
+  TagBinner same({0, 10, 20, 30}, 2);
+  same.Add(tags, times);
+  EXPECT_EQ(same.GetCounts(), fixed.GetCounts());
+
+  auto sparse = fixed.GetSparse();
+  EXPECT_EQ(std::get<0>(sparse), std::vector<unsigned int>({0, 1, 1, 2}));
+  EXPECT_EQ(std::get<1>(sparse), std::vector<unsigned int>({0, 0, 1, 1}));
+  EXPECT_EQ(std::get<2>(sparse), std::vector<int32_t>({1, 2, -1, 1}));
+}
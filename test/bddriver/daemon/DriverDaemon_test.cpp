@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "model/BDModelDriver.h"
+#include "BDModel.h"
+#include "daemon/DriverClient.h"
+#include "daemon/DriverServer.h"
+#include "ShmRing.h"
+
+#include "gtest/gtest.h"
+#include "test_util/DriverTypes_util.h"
+
+using std::cout;
+using std::endl;
+using namespace pystorm;
+using namespace bddriver;
+
+std::string TestSocketPath() {
+  return "/tmp/bddriverd_test." + std::to_string(getpid()) + ".sock";
+}
+
+// the client does everything the DriverFixture tests do to the driver directly
+class DriverDaemonFixture : public testing::Test {
+  public:
+    DriverDaemonFixture() : server(&driver, TestSocketPath()) {
+      model = driver.GetBDModel();
+    }
+
+    void SetUp() {
+      driver.Start();
+      ASSERT_TRUE(server.Start());
+      ASSERT_TRUE(client.Connect(TestSocketPath()));
+      ASSERT_TRUE(client.HasDataSegment());
+      client.InitBD();
+    }
+
+    void TearDown() {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      client.Disconnect();
+      server.Stop();
+      driver.Stop();
+
+      const BDState * model_state = model->LockState();
+      ASSERT_EQ(*model_state, *driver.GetState(0));
+      model->UnlockState();
+      ASSERT_EQ(model->PopSpikes(), sent_spikes);
+    }
+
+    const unsigned int M = 64;
+    BDModelDriver driver;
+    bdmodel::BDModel * model;
+    DriverServer server;
+    DriverClient client;
+
+    std::vector<BDWord> sent_spikes;
+};
+
+TEST_F(DriverDaemonFixture, SetAndDumpMem) {
+  // big enough to go through the data segment
+  std::vector<BDWord> data = MakeRandomMMData(driver.GetBDPars()->mem_info_.at(bdpars::BDMemId::MM).size);
+  client.SetMem(0, bdpars::BDMemId::MM, data, 0);
+  EXPECT_EQ(client.DumpMem(0, bdpars::BDMemId::MM), data);
+
+  // and a memory with another word type
+  std::vector<BDWord> tat = MakeRandomTATData(driver.GetBDPars()->mem_info_.at(bdpars::BDMemId::TAT0).size);
+  client.SetMem(0, bdpars::BDMemId::TAT0, tat, 0);
+  EXPECT_EQ(client.DumpMem(0, bdpars::BDMemId::TAT0), tat);
+}
+
+TEST_F(DriverDaemonFixture, SpikesBothWays) {
+  std::vector<BDWord> spikes = MakeRandomSynSpikes(M);
+  std::vector<BDTime> times;
+  for (unsigned int i = 0; i < spikes.size(); i++) {
+    times.push_back(i * 10000);
+  }
+  client.SendSpikes(0, spikes, times);
+  sent_spikes = spikes;
+
+  auto to_recv = MakeRandomNrnSpikes(M);
+  model->PushOutput(driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::NRNI), to_recv);
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  EXPECT_EQ(client.RecvSpikes(0).first, to_recv);
+}
+
+TEST_F(DriverDaemonFixture, BadIdsAreRejected) {
+  // none of these reach the driver, and the daemon keeps serving
+  const unsigned int num_cores = driver.GetBDPars()->NumCores;
+  EXPECT_EQ(client.DumpMem(num_cores, bdpars::BDMemId::MM).size(), 0u);
+  EXPECT_EQ(client.DumpMem(0, static_cast<bdpars::BDMemId>(99)).size(), 0u);
+  client.SetMem(0, bdpars::BDMemId::AM, MakeRandomAMData(2), driver.GetBDPars()->mem_info_.at(bdpars::BDMemId::AM).size - 1);
+  client.SetDACCount(0, bdpars::BDHornEP::ADC, 1);
+  client.SetSomaEnableStatus(0, 0, static_cast<bdpars::SomaStatusId>(7));
+  client.SendSpikes(num_cores, MakeRandomSynSpikes(M), std::vector<BDTime>(M, 0));
+  EXPECT_TRUE(client.Ping());
+}
+
+TEST_F(DriverDaemonFixture, SeveralClients) {
+  // another tool attaches while the first client is connected
+  DriverClient other;
+  ASSERT_TRUE(other.Connect(TestSocketPath(), 0)); // socket only
+  EXPECT_FALSE(other.HasDataSegment());
+  EXPECT_EQ(server.GetNumClients(), 2);
+  EXPECT_TRUE(other.Ping());
+
+  std::vector<BDWord> data = MakeRandomAMData(driver.GetBDPars()->mem_info_.at(bdpars::BDMemId::AM).size);
+  client.SetMem(0, bdpars::BDMemId::AM, data, 0);
+  EXPECT_EQ(other.DumpMem(0, bdpars::BDMemId::AM), data);
+
+  // both watch the same upstream traffic through the broadcast ring
+  ASSERT_TRUE(other.StartBroadcast("bddriverd_test_broadcast"));
+  ShmRingReader reader;
+  ASSERT_TRUE(reader.Open("bddriverd_test_broadcast"));
+  auto to_recv = MakeRandomNrnSpikes(M);
+  const uint8_t NRNI_code = driver.GetBDPars()->UpEPCodeFor(bdpars::BDFunnelEP::NRNI);
+  model->PushOutput(NRNI_code, to_recv);
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  std::vector<ShmOutput> records;
+  reader.Read(&records);
+  std::vector<BDWord> broadcast;
+  for (auto& it : records) {
+    if (it.ep_code == NRNI_code) broadcast.push_back(it.payload);
+  }
+  EXPECT_EQ(broadcast, to_recv);
+  EXPECT_EQ(client.RecvSpikes(0).first, to_recv);
+  other.StopBroadcast();
+
+  other.Disconnect();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2 * driverpars::DAEMON_POLL_MS));
+  EXPECT_EQ(server.GetNumClients(), 1);
+}
+
+TEST(DriverDaemonTest, NoServer) {
+  DriverClient client;
+  EXPECT_FALSE(client.Connect("/tmp/bddriverd_test_nobody_home.sock"));
+  EXPECT_FALSE(client.IsConnected());
+  EXPECT_EQ(client.DumpMem(0, bdpars::BDMemId::AM).size(), 0);
+}
+
+double Median(std::vector<double> us) {
+  std::sort(us.begin(), us.end());
+  return us[us.size() / 2];
+}
+
+TEST(DriverDaemonTest, RemoteOverheadAndThroughput) {
+  // the driver isn't started, downstream traffic just queues up in it
+  BDModelDriver driver;
+  DriverServer server(&driver, TestSocketPath());
+  ASSERT_TRUE(server.Start());
+  DriverClient shm_client, socket_client;
+  ASSERT_TRUE(shm_client.Connect(TestSocketPath()));
+  ASSERT_TRUE(socket_client.Connect(TestSocketPath(), 0));
+
+  // small call round trips
+  const unsigned int kNumCalls = 5000;
+  std::vector<double> local_us, remote_us, ping_us;
+  for (unsigned int i = 0; i < kNumCalls; i++) {
+    auto t0 = std::chrono::steady_clock::now();
+    driver.GetDriverTime();
+    auto t1 = std::chrono::steady_clock::now();
+    shm_client.GetDriverTime();
+    auto t2 = std::chrono::steady_clock::now();
+    shm_client.Ping();
+    auto t3 = std::chrono::steady_clock::now();
+    local_us.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+    remote_us.push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
+    ping_us.push_back(std::chrono::duration<double, std::micro>(t3 - t2).count());
+  }
+  // a round trip costs some us over the in-process call, well under a ms
+  EXPECT_LT(Median(local_us), Median(remote_us));
+  EXPECT_LT(Median(remote_us), 1000);
+  EXPECT_LT(Median(ping_us), 1000);
+
+  // bulk timed spikes, queued but not flushed
+  const unsigned int kNumSpikes = 1 << 20;
+  std::vector<BDWord> spikes = MakeRandomSynSpikes(kNumSpikes);
+  std::vector<BDTime> times(kNumSpikes);
+  for (unsigned int i = 0; i < kNumSpikes; i++) {
+    times[i] = i * 10000;
+  }
+  const double MB = kNumSpikes * (sizeof(BDWord) + sizeof(BDTime)) / 1e6;
+
+  auto t1 = std::chrono::steady_clock::now();
+  shm_client.SendSpikes(0, spikes, times, false);
+  auto t2 = std::chrono::steady_clock::now();
+  socket_client.SendSpikes(0, spikes, times, false);
+  auto t3 = std::chrono::steady_clock::now();
+
+  // both remote paths move ~100 MB/s here, about the in-process rate
+  EXPECT_GT(MB / std::chrono::duration<double>(t2 - t1).count(), 10);
+  EXPECT_GT(MB / std::chrono::duration<double>(t3 - t2).count(), 10);
+
+  EXPECT_EQ(server.GetNumCalls(), 2 * kNumCalls + 2 + 2); // + 2 HELLOs
+}
@@ -1,6 +1,7 @@
 #include "Decoder.h"
 #include "common/DriverPars.h"
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <random>
@@ -53,6 +54,9 @@ std::pair<DIVect, std::unordered_map<uint8_t, DOVect>> MakeDecInputAndOutputs(un
 
   static unsigned int last_HB_LSB_recvd;
 
+  // LSB halves of two-word outputs, the decoder holds them until the MSB comes, even across reads
+  static std::unordered_map<uint8_t, uint32_t> pending_lsb;
+
   for (unsigned int i = 0; i < N; i++) {
     // make random input data
     uint8_t b[4];
@@ -114,7 +118,17 @@ std::pair<DIVect, std::unordered_map<uint8_t, DOVect>> MakeDecInputAndOutputs(un
     if (code != pars->UpEPCodeFor(bdpars::FPGAOutputEP::NOP) && 
         code != pars->UpEPCodeFor(bdpars::FPGAOutputEP::DS_QUEUE_CT)) {
       DecOutput to_push;
-      to_push.payload = payload;
+      if (pars->Up_EP_size_[code] > FieldWidth(FPGAIO::PAYLOAD)) {
+        if (pending_lsb.count(code) == 0) {
+          pending_lsb[code] = payload;
+          continue;
+        }
+        to_push.payload = PackWord<TWOFPGAPAYLOADS>(
+            {{TWOFPGAPAYLOADS::LSB, pending_lsb.at(code)}, {TWOFPGAPAYLOADS::MSB, payload}});
+        pending_lsb.erase(code);
+      } else {
+        to_push.payload = payload;
+      }
       to_push.time = last_time_p2;
       last_time_p2 = last_time_p1;
       last_time_p1 = last_time;
@@ -224,3 +238,266 @@ TEST(DecoderTest, MainDecoderTest) {
   }
 }
 
+
+// words after an UPSTREAM_CORE word go to that core's buffers, stamped with that core's HB time
+TEST(DecoderTest, MultiCoreOutputs) {
+
+  const unsigned int kNumCores = 3;
+  BDPars pars(kNumCores);
+
+  MutexBuffer<DecInput> buf_in;
+  std::vector<Decoder::OutputBufs> bufs_out(kNumCores);
+  for (auto& core_bufs : bufs_out) {
+    for (auto& it : pars.GetUpEPs()) {
+      core_bufs.insert({it, new MutexBuffer<DecOutput>()});
+    }
+  }
+
+  const uint8_t core_code = pars.UpEPCodeFor(FPGAOutputEP::UPSTREAM_CORE);
+  const uint8_t NRNI_code = pars.UpEPCodeFor(BDFunnelEP::NRNI);
+  const uint8_t HB_LSB_code = pars.UpEPCodeFor(FPGAOutputEP::UPSTREAM_HB_LSB);
+  const uint8_t HB_MSB_code = pars.UpEPCodeFor(FPGAOutputEP::UPSTREAM_HB_MSB);
+
+  // core 1 at time 10 sends 2 spikes, core 2 at time 20 sends 1, then back to core 0 (time 0) for 1
+  std::vector<std::pair<uint8_t, uint32_t>> words = {
+    {core_code, 1}, {HB_LSB_code, 10}, {HB_MSB_code, 0}, {NRNI_code, 11}, {NRNI_code, 12},
+    {core_code, 2}, {HB_LSB_code, 20}, {HB_MSB_code, 0}, {NRNI_code, 21},
+    {core_code, 0}, {NRNI_code, 1}};
+
+  auto input = std::make_unique<DIVect>();
+  const unsigned int words_per_block = driverpars::READ_BLOCK_SIZE / 4;
+  while (words.size() < words_per_block) {
+    words.push_back({pars.UpEPCodeFor(FPGAOutputEP::NOP), 0});
+  }
+  for (auto& it : words) {
+    uint32_t packed = PackWord<FPGAIO>({{FPGAIO::EP_CODE, it.first}, {FPGAIO::PAYLOAD, it.second}});
+    input->push_back(GetField(packed, FPGABYTES::B0));
+    input->push_back(GetField(packed, FPGABYTES::B1));
+    input->push_back(GetField(packed, FPGABYTES::B2));
+    input->push_back(GetField(packed, FPGABYTES::B3));
+  }
+  buf_in.Push(std::move(input));
+
+  Decoder dec(&buf_in, bufs_out, &pars, 1000);
+  dec.Start();
+
+  std::vector<std::vector<uint32_t>> expected_payloads = {{1}, {11, 12}, {21}};
+  std::vector<BDTime> expected_times = {0, 10, 20};
+  for (unsigned int i = 0; i < kNumCores; i++) {
+    std::vector<DecOutput> recvd;
+    auto start = std::chrono::steady_clock::now();
+    while (recvd.size() < expected_payloads[i].size() && std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) {
+      for (auto& it : bufs_out[i].at(NRNI_code)->PopAll(1000)) {
+        recvd.insert(recvd.end(), it->begin(), it->end());
+      }
+    }
+    ASSERT_EQ(recvd.size(), expected_payloads[i].size());
+    for (unsigned int j = 0; j < recvd.size(); j++) {
+      EXPECT_EQ(recvd[j].payload, expected_payloads[i][j]);
+      EXPECT_EQ(recvd[j].time, expected_times[i]);
+    }
+  }
+
+  // GetLatestHB() follows core 0, which hasn't sent any
+  EXPECT_EQ(dec.GetLatestHB(), 0u);
+
+  dec.Stop();
+
+  for (auto& core_bufs : bufs_out) {
+    for (auto& it : core_bufs) {
+      delete it.second;
+    }
+  }
+}
+
+// one READ_BLOCK_SIZE block of <words> (ep code, payload), padded with nops
+std::unique_ptr<DIVect> MakeBlock(std::vector<std::pair<uint8_t, uint32_t>> words, const BDPars &pars) {
+  auto input = std::make_unique<DIVect>();
+  const unsigned int words_per_block = driverpars::READ_BLOCK_SIZE / 4;
+  while (words.size() < words_per_block) {
+    words.push_back({pars.UpEPCodeFor(FPGAOutputEP::NOP), 0});
+  }
+  for (auto& it : words) {
+    uint32_t packed = PackWord<FPGAIO>({{FPGAIO::EP_CODE, it.first}, {FPGAIO::PAYLOAD, it.second}});
+    input->push_back(GetField(packed, FPGABYTES::B0));
+    input->push_back(GetField(packed, FPGABYTES::B1));
+    input->push_back(GetField(packed, FPGABYTES::B2));
+    input->push_back(GetField(packed, FPGABYTES::B3));
+  }
+  return input;
+}
+
+// outputs wider than an FPGA payload come out whole, timed by their second word,
+// even when the two words are in different reads with another core's words in between
+TEST(DecoderTest, TwoWordOutputs) {
+
+  const unsigned int kNumCores = 2;
+  BDPars pars(kNumCores);
+
+  MutexBuffer<DecInput> buf_in;
+  std::vector<Decoder::OutputBufs> bufs_out(kNumCores);
+  for (auto& core_bufs : bufs_out) {
+    for (auto& it : pars.GetUpEPs()) {
+      core_bufs.insert({it, new MutexBuffer<DecOutput>()});
+    }
+  }
+
+  const uint8_t core_code = pars.UpEPCodeFor(FPGAOutputEP::UPSTREAM_CORE);
+  const uint8_t TAT_code = pars.UpEPCodeFor(BDFunnelEP::RO_TAT);
+  const uint8_t HB_LSB_code = pars.UpEPCodeFor(FPGAOutputEP::UPSTREAM_HB_LSB);
+  const uint8_t HB_MSB_code = pars.UpEPCodeFor(FPGAOutputEP::UPSTREAM_HB_MSB);
+
+  // core 0's tag starts in the first read and finishes in the second, after its next HB
+  buf_in.Push(MakeBlock({
+    {HB_LSB_code, 5}, {HB_MSB_code, 0}, {TAT_code, 0xABCDEF},
+    {core_code, 1}, {TAT_code, 0x111111}, {TAT_code, 0x22}, {core_code, 0}}, pars));
+  buf_in.Push(MakeBlock({
+    {HB_LSB_code, 7}, {HB_MSB_code, 0}, {TAT_code, 0x12}}, pars));
+
+  Decoder dec(&buf_in, bufs_out, &pars, 1000);
+  dec.Start();
+
+  std::vector<uint64_t> expected_payloads = {0x12ABCDEF, 0x22111111};
+  std::vector<BDTime> expected_times = {7, 0};
+  for (unsigned int i = 0; i < kNumCores; i++) {
+    std::vector<DecOutput> recvd;
+    auto start = std::chrono::steady_clock::now();
+    while (recvd.size() < 1 && std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) {
+      for (auto& it : bufs_out[i].at(TAT_code)->PopAll(1000)) {
+        recvd.insert(recvd.end(), it->begin(), it->end());
+      }
+    }
+    ASSERT_EQ(recvd.size(), 1);
+    EXPECT_EQ(recvd[0].payload, expected_payloads[i]);
+    EXPECT_EQ(recvd[0].time, expected_times[i]);
+  }
+
+  dec.Stop();
+
+  for (auto& core_bufs : bufs_out) {
+    for (auto& it : core_bufs) {
+      delete it.second;
+    }
+  }
+}
+
+TEST(DecoderTest, FiltersAndRoutes) {
+
+  BDPars pars(1);
+
+  MutexBuffer<DecInput> buf_in;
+  Decoder::OutputBufs bufs_out;
+  for (auto& it : pars.GetUpEPs()) {
+    bufs_out.insert({it, new MutexBuffer<DecOutput>()});
+  }
+  MutexBuffer<DecOutput> queue;
+
+  const uint8_t NRNI_code = pars.UpEPCodeFor(BDFunnelEP::NRNI);
+
+  // keep even neurons, send 0 and 2 to <queue>
+  Decoder::OutputFilter filter;
+  filter.key_shift = 0;
+  filter.key_width = FieldWidth(OutputSpike::NEURON_ADDRESS);
+  filter.keep.assign((1 << filter.key_width) / 64, 0x5555555555555555);
+  filter.route.assign(1 << filter.key_width, 0);
+  filter.route[0] = 1;
+  filter.route[2] = 1;
+  filter.queues = {&queue};
+
+  Decoder dec(&buf_in, bufs_out, &pars, 1000);
+  dec.SetOutputFilter(0, NRNI_code, filter);
+
+  std::vector<std::pair<uint8_t, uint32_t>> spikes;
+  for (uint32_t i = 0; i < 10; i++) {
+    spikes.push_back({NRNI_code, i});
+  }
+  buf_in.Push(MakeBlock(spikes, pars));
+  dec.Start();
+
+  auto recv = [](MutexBuffer<DecOutput> *buf, unsigned int n) {
+    std::vector<BDWord> recvd;
+    auto start = std::chrono::steady_clock::now();
+    while (recvd.size() < n && std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) {
+      for (auto& it : buf->PopAll(1000)) {
+        for (auto& out : *it) recvd.push_back(out.payload);
+      }
+    }
+    return recvd;
+  };
+  EXPECT_EQ(recv(bufs_out.at(NRNI_code), 3), std::vector<BDWord>({4, 6, 8}));
+  EXPECT_EQ(recv(&queue, 2), std::vector<BDWord>({0, 2}));
+  EXPECT_EQ(dec.GetNumFilteredOutputs(), 5);
+
+  dec.Stop();
+
+  for (auto& it : bufs_out) {
+    delete it.second;
+  }
+}
+
+// hooks see what a filter drops, unless it drops it before_taps
+TEST(DecoderTest, FilterBeforeTaps) {
+
+  BDPars pars(1);
+
+  MutexBuffer<DecInput> buf_in;
+  Decoder::OutputBufs bufs_out;
+  for (auto& it : pars.GetUpEPs()) {
+    bufs_out.insert({it, new MutexBuffer<DecOutput>()});
+  }
+
+  const uint8_t NRNI_code = pars.UpEPCodeFor(BDFunnelEP::NRNI);
+
+  // keep even neurons
+  Decoder::OutputFilter filter;
+  filter.key_shift = 0;
+  filter.key_width = FieldWidth(OutputSpike::NEURON_ADDRESS);
+  filter.keep.assign((1 << filter.key_width) / 64, 0x5555555555555555);
+
+  Decoder dec(&buf_in, bufs_out, &pars, 1000);
+  std::atomic<unsigned int> num_hooked(0);
+  dec.SetOutputHook(0, NRNI_code, "count", [&num_hooked](const std::vector<DecOutput> &outputs) {
+    num_hooked += outputs.size();
+    return false;
+  });
+  dec.SetOutputFilter(0, NRNI_code, filter);
+  dec.Start();
+
+  std::vector<std::pair<uint8_t, uint32_t>> spikes;
+  for (uint32_t i = 0; i < 10; i++) {
+    spikes.push_back({NRNI_code, i});
+  }
+
+  auto recv = [&](unsigned int n_hooked, unsigned int n_queued) {
+    unsigned int num_queued = 0;
+    auto start = std::chrono::steady_clock::now();
+    while ((num_hooked < n_hooked || num_queued < n_queued) && std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) {
+      for (auto& it : bufs_out.at(NRNI_code)->PopAll(1000)) {
+        for (auto& out : *it) {
+          EXPECT_EQ(out.payload % 2, 0);
+          num_queued++;
+        }
+      }
+    }
+    return num_queued;
+  };
+
+  buf_in.Push(MakeBlock(spikes, pars));
+  EXPECT_EQ(recv(10, 5), 5u);
+  EXPECT_EQ(num_hooked, 10u);
+  EXPECT_EQ(dec.GetNumFilteredOutputs(), 5);
+
+  filter.before_taps = true;
+  dec.SetOutputFilter(0, NRNI_code, filter);
+  num_hooked = 0;
+  buf_in.Push(MakeBlock(spikes, pars));
+  EXPECT_EQ(recv(5, 5), 5u);
+  EXPECT_EQ(num_hooked, 5u);
+  EXPECT_EQ(dec.GetNumFilteredOutputs(), 10);
+
+  dec.Stop();
+
+  for (auto& it : bufs_out) {
+    delete it.second;
+  }
+}
@@ -137,3 +137,261 @@ TEST(EncoderTest, MainEncoderTest) {
   enc.Stop();
 }
 
+
+// with more than one core, every word is followed by a route word with its core's hop count
+TEST(EncoderTest, MultiCoreRouting) {
+
+  const unsigned int kNumCores = 4;
+  BDPars pars(kNumCores);
+
+  const uint8_t RI_code = pars.DnEPCodeFor(BDHornEP::RI);
+  const uint8_t time_code = pars.DnEPCodeFor(FPGARegEP::TM_PC_TIME_ELAPSED0);
+
+  // one untimed word per core, then a timed word for core 2, which needs a HB
+  EIVect inputs;
+  for (unsigned int i = 0; i < kNumCores; i++) {
+    inputs.push_back({i, RI_code, 100 + i, 0, 0});
+  }
+  inputs.push_back({2, RI_code, 200, 5, 0});
+
+  std::vector<uint32_t> words;
+  for (auto& block : Encoder::EncodeBlocks(inputs, &pars)) {
+    ASSERT_EQ(block.size() % driverpars::WRITE_BLOCK_SIZE, 0);
+    for (unsigned int i = 0; i < block.size(); i += 4) {
+      words.push_back(PackWord<FPGABYTES>(
+          {{FPGABYTES::B0, block[i]}, {FPGABYTES::B1, block[i+1]}, {FPGABYTES::B2, block[i+2]}, {FPGABYTES::B3, block[i+3]}}));
+    }
+  }
+  ASSERT_EQ(words.size() % 2, 0);
+
+  std::vector<std::vector<uint32_t>> core_payloads(kNumCores);
+  std::vector<unsigned int> time_words(kNumCores, 0);
+  for (unsigned int i = 0; i < words.size(); i += 2) {
+    unsigned int hops = GetField(words[i+1], FPGARoute::HOPS);
+    ASSERT_GE(hops, 1);
+    ASSERT_LE(hops, kNumCores);
+    unsigned int core_id = hops - 1;
+
+    uint8_t code = GetField(words[i], FPGAIO::EP_CODE);
+    if (code == RI_code) {
+      core_payloads[core_id].push_back(GetField(words[i], FPGAIO::PAYLOAD));
+    } else if (code == time_code) {
+      time_words[core_id]++;
+    }
+  }
+
+  for (unsigned int i = 0; i < kNumCores; i++) {
+    std::vector<uint32_t> expected = {100 + i};
+    if (i == 2) expected.push_back(200);
+    EXPECT_EQ(core_payloads[i], expected);
+    EXPECT_EQ(time_words[i], i == 2 ? 1 : 0); // the HB only goes to the core whose time moved
+  }
+}
+
+// unpack comm's bytes back into FPGA words
+void AppendWords(const EOVect &bytes, std::vector<uint32_t> *words) {
+  ASSERT_EQ(bytes.size() % driverpars::WRITE_BLOCK_SIZE, 0);
+  for (unsigned int i = 0; i < bytes.size(); i += 4) {
+    words->push_back(PackWord<FPGABYTES>(
+        {{FPGABYTES::B0, bytes[i]}, {FPGABYTES::B1, bytes[i+1]}, {FPGABYTES::B2, bytes[i+2]}, {FPGABYTES::B3, bytes[i+3]}}));
+  }
+}
+
+// pushes a long timed schedule (RI words, payload i at time kTimedStart + i) while the FPGA's time
+// is stuck at 0, then one untimed command (DAC_UNUSED), and returns everything the encoder sent,
+// once the FPGA's time has moved past the schedule
+const unsigned int kNumTimed = 20000;
+const BDTime kTimedStart = 10;
+const BDTime kBulkLead = 100;
+const uint64_t kTimedBytes = kNumTimed * 4 * 4; // each RI word, and the three words of its HB
+
+void SendCommandBehindSchedule(bool two_lanes, const BDPars *pars, std::vector<uint32_t> *words) {
+  MutexBuffer<EncInput> buf_in;
+  MutexBuffer<EncInput> buf_bulk;
+  MutexBuffer<EncOutput> buf_out;
+  std::atomic<BDTime> fpga_time(0);
+
+  Encoder enc(&buf_in, &buf_out, pars, 1000, two_lanes ? &buf_bulk : nullptr, [&fpga_time] { return fpga_time.load(); });
+  enc.SetBulkLead(kBulkLead);
+
+  const uint8_t RI_code = pars->DnEPCodeFor(BDHornEP::RI);
+  const uint8_t command_code = pars->DnEPCodeFor(BDHornEP::DAC_UNUSED);
+
+  auto schedule = std::make_unique<EIVect>();
+  for (unsigned int i = 0; i < kNumTimed; i++) {
+    schedule->push_back({0, RI_code, i, kTimedStart + i, 0});
+  }
+  schedule->push_back({0, EncInput::kFlushCode, 0, 0, 0});
+  (two_lanes ? buf_bulk : buf_in).Push(std::move(schedule));
+
+  // let it encode the whole schedule, into comm's queue or held back
+  enc.Start();
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (buf_out.TotalSize() + enc.GetNumHeldBytes() < kTimedBytes && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_GE(buf_out.TotalSize() + enc.GetNumHeldBytes(), kTimedBytes);
+
+  // like comm, take everything the encoder sends, until the command comes out
+  buf_in.Push(std::make_unique<EIVect>(EIVect({{0, command_code, 7, 0, 0}, {0, EncInput::kFlushCode, 0, 0, 0}})));
+  auto has_command = [&] {
+    for (auto &word : *words) {
+      if (GetField(word, FPGAIO::EP_CODE) == command_code) return true;
+    }
+    return false;
+  };
+  deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!has_command() && std::chrono::steady_clock::now() < deadline) {
+    for (auto &it : buf_out.PopAll(1000)) {
+      AppendWords(*it, words);
+    }
+  }
+
+  // the FPGA catches up, the rest of the schedule goes out
+  fpga_time = kTimedStart + kNumTimed;
+  deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while ((enc.GetNumHeldBlocks() > 0 || !buf_out.IsEmpty()) && std::chrono::steady_clock::now() < deadline) {
+    for (auto &it : buf_out.PopAll(1000)) {
+      AppendWords(*it, words);
+    }
+  }
+  enc.Stop();
+  for (auto &it : buf_out.PopAll(1)) {
+    AppendWords(*it, words);
+  }
+}
+
+// with a bulk lane, an untimed command goes out ahead of timed traffic the FPGA isn't ready for,
+// and the timed traffic still goes out whole, with the FPGA's HB where it expects it
+TEST(EncoderTest, PriorityLanePassesHeldBulk) {
+
+  BDPars pars;
+  const uint8_t RI_code = pars.DnEPCodeFor(BDHornEP::RI);
+  const uint8_t command_code = pars.DnEPCodeFor(BDHornEP::DAC_UNUSED);
+  uint8_t time_codes[3];
+  time_codes[0] = pars.DnEPCodeFor(FPGARegEP::TM_PC_TIME_ELAPSED0);
+  time_codes[1] = pars.DnEPCodeFor(FPGARegEP::TM_PC_TIME_ELAPSED1);
+  time_codes[2] = pars.DnEPCodeFor(FPGARegEP::TM_PC_TIME_ELAPSED2);
+
+  for (bool two_lanes : {false, true}) {
+    std::vector<uint32_t> words;
+    SendCommandBehindSchedule(two_lanes, &pars, &words);
+
+    // replay the stream against the FPGA's HB
+    uint32_t HB_regs[3] = {0, 0, 0};
+    std::vector<uint32_t> timed;
+    unsigned int timed_ahead = 0;
+    bool command_seen = false;
+    for (auto &word : words) {
+      uint8_t code = GetField(word, FPGAIO::EP_CODE);
+      uint32_t payload = GetField(word, FPGAIO::PAYLOAD);
+      BDTime HB = PackWord<THREEFPGAREGS>({{THREEFPGAREGS::W0, HB_regs[0]}, {THREEFPGAREGS::W1, HB_regs[1]}, {THREEFPGAREGS::W2, HB_regs[2]}});
+
+      for (unsigned int i = 0; i < 3; i++) {
+        if (code == time_codes[i]) HB_regs[i] = payload;
+      }
+      if (code == RI_code) {
+        EXPECT_EQ(HB, kTimedStart + payload) << "timed word " << payload << " sent against the wrong HB";
+        timed.push_back(payload);
+        if (!command_seen) timed_ahead++;
+      } else if (code == command_code) {
+        EXPECT_FALSE(command_seen);
+        EXPECT_EQ(HB, 0);
+        command_seen = true;
+      }
+    }
+
+    EXPECT_TRUE(command_seen);
+    ASSERT_EQ(timed.size(), kNumTimed);
+    for (unsigned int i = 0; i < kNumTimed; i++) {
+      ASSERT_EQ(timed[i], i);
+    }
+
+    // the FPGA can't get to the command until it's done with everything ahead of it
+    BDTime command_waits_for = timed_ahead > 0 ? kTimedStart + timed_ahead - 1 : 0;
+
+    if (two_lanes) {
+      EXPECT_LE(command_waits_for, kBulkLead);
+    } else {
+      EXPECT_EQ(timed_ahead, kNumTimed);
+    }
+  }
+}
+
+// held blocks ClearHeld() drops never go out, and the next bulk block puts back the HB they moved
+TEST(EncoderTest, ClearHeldDropsHeldBulk) {
+
+  BDPars pars;
+  const uint8_t RI_code = pars.DnEPCodeFor(BDHornEP::RI);
+  uint8_t time_codes[3];
+  time_codes[0] = pars.DnEPCodeFor(FPGARegEP::TM_PC_TIME_ELAPSED0);
+  time_codes[1] = pars.DnEPCodeFor(FPGARegEP::TM_PC_TIME_ELAPSED1);
+  time_codes[2] = pars.DnEPCodeFor(FPGARegEP::TM_PC_TIME_ELAPSED2);
+
+  MutexBuffer<EncInput> buf_in;
+  MutexBuffer<EncInput> buf_bulk;
+  MutexBuffer<EncOutput> buf_out;
+  std::atomic<BDTime> fpga_time(0);
+
+  Encoder enc(&buf_in, &buf_out, &pars, 1000, &buf_bulk, [&fpga_time] { return fpga_time.load(); });
+  enc.SetBulkLead(kBulkLead);
+
+  // a schedule the FPGA isn't ready for
+  const unsigned int kNumDropped = 100;
+  const BDTime kDroppedStart = 1000;
+  auto schedule = std::make_unique<EIVect>();
+  for (unsigned int i = 0; i < kNumDropped; i++) {
+    schedule->push_back({0, RI_code, i, kDroppedStart + i, 0});
+  }
+  schedule->push_back({0, EncInput::kFlushCode, 0, 0, 0});
+  buf_bulk.Push(std::move(schedule));
+
+  enc.Start();
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (enc.GetNumHeldBytes() < kNumDropped * 4 * 4 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_GT(enc.ClearHeld(), 0);
+  EXPECT_EQ(enc.GetNumHeldBlocks(), 0);
+  EXPECT_EQ(enc.GetNumHeldBytes(), 0);
+
+  // at the dropped schedule's last time, so it's encoded without a HB of its own
+  const BDTime kLastTime = kDroppedStart + kNumDropped - 1;
+  fpga_time = kLastTime;
+  buf_bulk.Push(std::make_unique<EIVect>(EIVect({{0, RI_code, 500, kLastTime, 0}, {0, EncInput::kFlushCode, 0, 0, 0}})));
+
+  std::vector<uint32_t> words;
+  auto num_timed = [&] {
+    unsigned int num = 0;
+    for (auto &word : words) {
+      if (GetField(word, FPGAIO::EP_CODE) == RI_code) num++;
+    }
+    return num;
+  };
+  deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (num_timed() == 0 && std::chrono::steady_clock::now() < deadline) {
+    for (auto &it : buf_out.PopAll(1000)) {
+      AppendWords(*it, &words);
+    }
+  }
+  enc.Stop();
+  for (auto &it : buf_out.PopAll(1)) {
+    AppendWords(*it, &words);
+  }
+
+  uint32_t HB_regs[3] = {0, 0, 0};
+  std::vector<uint32_t> timed;
+  for (auto &word : words) {
+    uint8_t code = GetField(word, FPGAIO::EP_CODE);
+    uint32_t payload = GetField(word, FPGAIO::PAYLOAD);
+    for (unsigned int i = 0; i < 3; i++) {
+      if (code == time_codes[i]) HB_regs[i] = payload;
+    }
+    if (code == RI_code) {
+      BDTime HB = PackWord<THREEFPGAREGS>({{THREEFPGAREGS::W0, HB_regs[0]}, {THREEFPGAREGS::W1, HB_regs[1]}, {THREEFPGAREGS::W2, HB_regs[2]}});
+      EXPECT_EQ(HB, kLastTime);
+      timed.push_back(payload);
+    }
+  }
+  EXPECT_EQ(timed, std::vector<uint32_t>({500}));
+}
@@ -0,0 +1,183 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "SpikeTrainGenerator.h"
+#include "MutexBuffer.h"
+#include "BDPars.h"
+#include "gtest/gtest.h"
+
+using std::cout;
+using std::endl;
+using namespace pystorm;
+using namespace bddriver;
+
+// pops everything out of buf, dropping what Encoder::AppendFlush() ends each batch with
+std::vector<EncInput> DrainGeneratorOutput(MutexBuffer<EncInput> *buf, const bdpars::BDPars *pars) {
+  std::vector<EncInput> out;
+  for (auto &vect : buf->PopAll(1)) {
+    for (auto &it : *vect) {
+      if (it.FPGA_ep_code != EncInput::kFlushCode && it.FPGA_ep_code != pars->DnEPCodeFor(bdpars::BDHornEP::DAC_UNUSED)) {
+        out.push_back(it);
+      }
+    }
+  }
+  return out;
+}
+
+class SpikeTrainGeneratorFixture : public testing::Test {
+ public:
+  void SetUp() {
+    fpga_time = 0;
+    gen = new SpikeTrainGenerator(&buf, &pars, [this] { return fpga_time.load(); }, kEPCode, kWindow, 0, 100);
+  }
+  void TearDown() {
+    delete gen;
+  }
+
+  const uint8_t kEPCode = 30;
+  const BDTime kWindow = 100;
+  std::atomic<BDTime> fpga_time;
+  bdpars::BDPars pars;
+  MutexBuffer<EncInput> buf;
+  SpikeTrainGenerator *gen;
+};
+
+TEST_F(SpikeTrainGeneratorFixture, RegularTrain) {
+  // 1 spike every 10 time units, from 100 until 1000
+  gen->AddTrain(0, 7, SpikeTrainType::REGULAR, {100}, {0.1}, 1000);
+  EXPECT_EQ(gen->GenerateUntil(2000), 89);
+
+  std::vector<EncInput> out = DrainGeneratorOutput(&buf, &pars);
+  ASSERT_EQ(out.size(), 89);
+  for (unsigned int i = 0; i < out.size(); i++) {
+    EXPECT_EQ(out[i].payload, 7);
+    EXPECT_EQ(out[i].FPGA_ep_code, kEPCode);
+    EXPECT_NEAR(out[i].time, 110 + 10 * i, 1);
+  }
+  EXPECT_EQ(gen->GetStats().num_active, 0);
+}
+
+// a train added after spikes were generated past its start picks up after them
+TEST_F(SpikeTrainGeneratorFixture, TrainAddedBehindGenerator) {
+  gen->AddTrain(0, 1, SpikeTrainType::REGULAR, {0}, {0.1}, 2000);
+  gen->GenerateUntil(1000);
+  DrainGeneratorOutput(&buf, &pars);
+
+  // should have started at 0, the FPGA is still at 0
+  gen->AddTrain(0, 2, SpikeTrainType::REGULAR, {0}, {0.5}, 2000);
+  gen->GenerateUntil(1100);
+
+  unsigned int num_added = 0;
+  for (auto &it : DrainGeneratorOutput(&buf, &pars)) {
+    EXPECT_GT(it.time, 1000);
+    EXPECT_LE(it.time, 1100);
+    if (it.payload == 2) num_added++;
+  }
+  EXPECT_NEAR(num_added, 50, 1);
+}
+
+TEST_F(SpikeTrainGeneratorFixture, PoissonTrains) {
+  const unsigned int N = 1000;
+  const double rate = 0.01;
+  const BDTime T = 100000;
+  for (unsigned int i = 0; i < N; i++) {
+    gen->AddTrain(0, i, SpikeTrainType::POISSON, {0}, {rate}, T);
+  }
+  gen->GenerateUntil(T);
+  std::vector<EncInput> out = DrainGeneratorOutput(&buf, &pars);
+
+  // count is Poisson with mean N * rate * T, sqrt(1e6) = 1000
+  EXPECT_NEAR(out.size(), N * rate * T, 5000);
+
+  // merged stream is in time order, ISIs of each train have CV ~1
+  std::vector<BDTime> last(N, 0);
+  std::vector<double> isis;
+  for (unsigned int i = 0; i < out.size(); i++) {
+    if (i > 0) {
+      ASSERT_LE(out[i-1].time, out[i].time);
+    }
+    unsigned int train = out[i].payload;
+    if (last[train] > 0) isis.push_back(out[i].time - last[train]);
+    last[train] = out[i].time;
+  }
+  double mean = 0, var = 0;
+  for (auto &it : isis) mean += it;
+  mean /= isis.size();
+  for (auto &it : isis) var += (it - mean) * (it - mean);
+  var /= isis.size();
+  EXPECT_NEAR(mean, 1 / rate, 2);
+  EXPECT_NEAR(std::sqrt(var) / mean, 1, 0.05);
+}
+
+TEST_F(SpikeTrainGeneratorFixture, InhomogeneousRateTable) {
+  const unsigned int N = 100;
+  // off, then 0.05/unit, then 0.01/unit
+  for (unsigned int i = 0; i < N; i++) {
+    gen->AddTrain(0, i, SpikeTrainType::POISSON, {0, 1000, 2000}, {0, 0.05, 0.01}, 3000);
+  }
+  gen->GenerateUntil(5000);
+
+  unsigned int counts[3] = {0, 0, 0};
+  for (auto &it : DrainGeneratorOutput(&buf, &pars)) {
+    ASSERT_LT(it.time, 3000);
+    counts[it.time / 1000]++;
+  }
+  EXPECT_EQ(counts[0], 0);
+  EXPECT_NEAR(counts[1], N * 0.05 * 1000, 300);
+  EXPECT_NEAR(counts[2], N * 0.01 * 1000, 150);
+}
+
+TEST_F(SpikeTrainGeneratorFixture, StaysAheadOfFPGA) {
+  gen->AddTrain(0, 0, SpikeTrainType::REGULAR, {0}, {1.0}, 100000);
+  gen->Start();
+
+  std::vector<EncInput> out;
+  const BDTime step = 10;
+  while (fpga_time < 2000) {
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+    for (auto &it : DrainGeneratorOutput(&buf, &pars)) {
+      ASSERT_LE(it.time, fpga_time + kWindow);
+      out.push_back(it);
+    }
+    fpga_time += step;
+  }
+  gen->Stop();
+
+  // generated everything up to (at least) the FPGA time we last saw, and not much more
+  SpikeTrainGeneratorStats stats = gen->GetStats();
+  EXPECT_GE(out.size(), fpga_time - step);
+  EXPECT_LE(out.size(), fpga_time + kWindow + 1);
+  EXPECT_EQ(stats.num_generated, out.size());
+  EXPECT_GE(stats.lead, 0);
+  EXPECT_LE(stats.lead, kWindow);
+}
+
+TEST_F(SpikeTrainGeneratorFixture, Throughput) {
+  // 2000 tags at 10 kHz (10 us time unit), 100 ms at a time
+  const unsigned int N = 2000;
+  const double rate = 0.1;
+  const BDTime chunk = 10000;
+  const unsigned int num_chunks = 5;
+  for (unsigned int i = 0; i < N; i++) {
+    gen->AddTrain(0, i, SpikeTrainType::POISSON, {0}, {rate}, num_chunks * chunk);
+  }
+
+  uint64_t num_spikes = 0;
+  double gen_s = 0;
+  for (unsigned int i = 1; i <= num_chunks; i++) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    num_spikes += gen->GenerateUntil(i * chunk);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    gen_s += std::chrono::duration<double>(t1 - t0).count();
+    buf.PopAll(1); // don't hold on to everything
+  }
+  EXPECT_NEAR(num_spikes, N * rate * num_chunks * chunk, 0.01 * N * rate * num_chunks * chunk);
+
+  // at least a few Mspikes/s (each spike is one 4-byte downstream word)
+  EXPECT_GT(num_spikes / gen_s, 2e6);
+}
@@ -0,0 +1,203 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "TimedFeeder.h"
+#include "SpikeTrainGenerator.h"
+#include "MutexBuffer.h"
+#include "BDPars.h"
+#include "gtest/gtest.h"
+
+using std::cout;
+using std::endl;
+using namespace pystorm;
+using namespace bddriver;
+
+// inputs at times [start, start + N), one per time unit
+std::vector<EncInput> MakeTimedInputs(BDTime start, unsigned int N) {
+  std::vector<EncInput> inputs;
+  for (unsigned int i = 0; i < N; i++) {
+    EncInput in;
+    in.core_id      = 0;
+    in.FPGA_ep_code = 30;
+    in.payload      = i;
+    in.time         = start + i;
+    in.sequence_num = i;
+    inputs.push_back(in);
+  }
+  return inputs;
+}
+
+// pops everything out of buf, dropping what Encoder::AppendFlush() ends each batch with.
+// Checks each input against the horizon that was in effect when it was released
+void DrainFeederOutput(MutexBuffer<EncInput> *buf, const bdpars::BDPars *pars, std::vector<EncInput> *out, BDTime horizon) {
+  for (auto &vect : buf->PopAll(1)) {
+    for (auto &it : *vect) {
+      if (it.FPGA_ep_code != EncInput::kFlushCode && it.FPGA_ep_code != pars->DnEPCodeFor(bdpars::BDHornEP::DAC_UNUSED)) {
+        ASSERT_LE(it.time, horizon);
+        out->push_back(it);
+      }
+    }
+  }
+}
+
+class TimedFeederFixture : public testing::Test {
+ public:
+  void SetUp() {
+    fpga_time = 0;
+    feeder = new TimedFeeder(&buf, &pars, [this] { return fpga_time.load(); }, kWindow, 100);
+    feeder->Start();
+  }
+  void TearDown() {
+    feeder->Stop();
+    delete feeder;
+  }
+
+  const BDTime kWindow = 10;
+  std::atomic<BDTime> fpga_time;
+  bdpars::BDPars pars;
+  MutexBuffer<EncInput> buf;
+  TimedFeeder *feeder;
+
+  // advance FPGA time in steps, checking that the feeder never gets more than kWindow ahead
+  std::vector<EncInput> RunUntil(BDTime end, BDTime step) {
+    std::vector<EncInput> out;
+    while (fpga_time < end) {
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+      DrainFeederOutput(&buf, &pars, &out, fpga_time + kWindow);
+      fpga_time += step;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    DrainFeederOutput(&buf, &pars, &out, fpga_time + kWindow);
+    return out;
+  }
+};
+
+TEST_F(TimedFeederFixture, StaysInsideWindow) {
+  const unsigned int N = 200;
+  feeder->Append(MakeTimedInputs(1, N));
+
+  std::vector<EncInput> out = RunUntil(N + 1, 5);
+
+  ASSERT_EQ(out.size(), N);
+  for (unsigned int i = 0; i < N; i++) {
+    ASSERT_EQ(out[i].payload, i);
+  }
+
+  TimedFeederStats stats = feeder->GetStats();
+  EXPECT_EQ(stats.num_released, N);
+  EXPECT_EQ(stats.num_pending, 0);
+  EXPECT_LE(stats.max_lead, static_cast<int64_t>(kWindow));
+}
+
+TEST_F(TimedFeederFixture, ReportsLag) {
+  // FPGA is already past these inputs, they go out late
+  fpga_time = 100;
+  feeder->Append(MakeTimedInputs(1, 10));
+  std::vector<EncInput> out = RunUntil(101, 1);
+
+  ASSERT_EQ(out.size(), 10);
+  TimedFeederStats stats = feeder->GetStats();
+  EXPECT_EQ(stats.max_lag, 99);
+  EXPECT_LT(stats.lead, 0);
+}
+
+TEST_F(TimedFeederFixture, MergesOutOfOrderAppends) {
+  std::vector<EncInput> evens, odds;
+  for (auto &it : MakeTimedInputs(50, 100)) {
+    (it.time % 2 == 0 ? evens : odds).push_back(it);
+  }
+  feeder->Append(evens);
+  feeder->Append(odds);
+
+  std::vector<EncInput> out = RunUntil(150, 10);
+  ASSERT_EQ(out.size(), 100);
+  for (unsigned int i = 1; i < out.size(); i++) {
+    ASSERT_LE(out[i-1].time, out[i].time);
+  }
+}
+
+TEST_F(TimedFeederFixture, StreamsFromFile) {
+  const unsigned int N = 10000; // a few file chunks
+  const std::string filename = "timed_feeder_test.bin";
+  ASSERT_TRUE(TimedFeeder::WriteScheduleFile(filename, MakeTimedInputs(1, N), 10000));
+
+  BDTime ns_per_unit = 0;
+  ASSERT_TRUE(feeder->OpenScheduleFile(filename, &ns_per_unit));
+  EXPECT_EQ(ns_per_unit, 10000);
+
+  // only about a window's worth should be held in memory
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  EXPECT_LE(feeder->GetStats().num_pending, driverpars::FEEDER_FILE_CHUNK);
+
+  std::vector<EncInput> out = RunUntil(N + 1, 500);
+  ASSERT_EQ(out.size(), N);
+  for (unsigned int i = 0; i < N; i++) {
+    ASSERT_EQ(out[i].payload, i);
+    ASSERT_EQ(out[i].time, i + 1);
+  }
+  EXPECT_FALSE(feeder->GetStats().file_open);
+
+  std::remove(filename.c_str());
+}
+
+TEST_F(TimedFeederFixture, AppendFarAheadWhileStreaming) {
+  const unsigned int N = 10000;
+  const std::string filename = "timed_feeder_test_far.bin";
+  ASSERT_TRUE(TimedFeeder::WriteScheduleFile(filename, MakeTimedInputs(1, N), 10000));
+
+  BDTime ns_per_unit = 0;
+  ASSERT_TRUE(feeder->OpenScheduleFile(filename, &ns_per_unit));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+  // an input long after the file ends mustn't stop the file being read
+  const BDTime far_time = 1000000000;
+  feeder->Append(MakeTimedInputs(far_time, 1));
+
+  std::vector<EncInput> out = RunUntil(N + 1, 500);
+  ASSERT_EQ(out.size(), N);
+  for (unsigned int i = 0; i < N; i++) {
+    ASSERT_EQ(out[i].time, i + 1);
+  }
+  TimedFeederStats stats = feeder->GetStats();
+  EXPECT_FALSE(stats.file_open);
+  EXPECT_EQ(stats.num_pending, 1);
+
+  std::remove(filename.c_str());
+}
+
+// a spike train generator as the source goes out merged with the schedule, in time order,
+// including a train added while the feeder is running
+TEST_F(TimedFeederFixture, MergesSourceInTimeOrder) {
+  const uint8_t kSpikeEPCode = 31;
+  SpikeTrainGenerator gen(&buf, &pars, [this] { return fpga_time.load(); }, kSpikeEPCode, kWindow);
+  gen.AddTrain(0, 1, SpikeTrainType::REGULAR, {0}, {0.5}, 200);
+  feeder->SetSource([&gen](BDTime fpga_time, BDTime horizon, std::vector<EncInput> *out) {
+      gen.GenerateInto(fpga_time, horizon, out);
+    });
+  feeder->Append(MakeTimedInputs(1, 200));
+
+  std::vector<EncInput> out = RunUntil(100, 5);
+  // should have started at 0, its spikes can't go out before what's been released
+  gen.AddTrain(0, 2, SpikeTrainType::REGULAR, {0}, {0.25}, 200);
+  for (auto &it : RunUntil(201, 5)) {
+    out.push_back(it);
+  }
+  feeder->SetSource(TimedFeeder::Source());
+
+  unsigned int num_spikes = 0;
+  for (unsigned int i = 0; i < out.size(); i++) {
+    if (i > 0) {
+      ASSERT_LE(out[i-1].time, out[i].time);
+    }
+    if (out[i].FPGA_ep_code == kSpikeEPCode) num_spikes++;
+  }
+  EXPECT_EQ(out.size() - num_spikes, 200);
+  EXPECT_GT(num_spikes, 99);
+  EXPECT_EQ(num_spikes, gen.GetStats().num_generated);
+  EXPECT_EQ(feeder->GetStats().num_released, out.size());
+}